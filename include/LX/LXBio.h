@@ -54,6 +54,16 @@
 #define LX_BIO_SEQ_DNA        1
 #define LX_BIO_SEQ_PROTEIN    2
 
+/*
+ * @doc: encoded base value of non ACGTU symbols (see LXBioSeqEncode)
+ */
+#define LX_BIO_BAD_BASE       4
+
+/*
+ * @doc: size of codon translation tables (see LXBioCodonTable)
+ */
+#define LX_BIO_CODON_TABLE_SIZE  125
+
 /* ---------------------------------------------------- */
 /* Prototypes of library functions                      */
 /* ---------------------------------------------------- */
@@ -101,6 +111,59 @@ char LXBioCodonTranslate (char *codon, int codid);
  */
 char *LXBioSeqTranslate (char *nucAcSeq, int codid);
 
+/*
+ * @doc:
+ * encode nucleic acid sequence in place : A,C,G,T/U (either case)
+ * are replaced by 0,1,2,3 and any other symbol by LX_BIO_BAD_BASE.
+ * the encoded sequence is suitable for LXBioFrameTranslate.
+ * warning: encoded sequence is no longer a C string (0 is A)
+ * @param nucAcSeq char* sequence to encode
+ * @param length long number of bases to encode
+ * @return encoded sequence (i.e. nucAcSeq)
+ */
+char *LXBioSeqEncode(char *nucAcSeq, long length);
+
+/*
+ * @doc:
+ * setup codon translation table for chosen genetic code
+ * (please refer to LXgenetic.h). table is indexed by
+ * (b1 * 5 + b2) * 5 + b3 where b1,b2,b3 are the encoded bases
+ * (see LXBioSeqEncode) as read in the sequence.
+ * if reverse is TRUE, bases are read backward on the direct
+ * strand, i.e. the table translates the complement codon (b3' b2' b1').
+ * codons with a bad base translate to LX_GENETIC_BAD_AA.
+ * @param table char[LX_BIO_CODON_TABLE_SIZE] table to setup
+ * @param codid int genetic code identifier
+ * @param reverse Bool reverse strand table
+ * @return table or NULL if codid is invalid
+ */
+char *LXBioCodonTable(char *table, int codid, Bool reverse);
+
+/*
+ * @doc:
+ * translate codons [from, to[ of one frame of an encoded sequence
+ * (see LXBioSeqEncode) using codon table (see LXBioCodonTable).
+ * direct frame is read from position frame to the right,
+ * reverse frame is read from position length - 1 - frame to
+ * the left, so that reverse frames are translated without
+ * reverse complementing the sequence. 
+ * frame holds (length - frame) / 3 codons.
+ * @param codes char* encoded sequence
+ * @param length long sequence length
+ * @param frame int frame (0, 1 or 2) 
+ * @param table char* codon table (direct or reverse)
+ * @param reverse Bool TRUE for reverse frame
+ * @param from long first codon to translate
+ * @param to long last codon to translate (excluded)
+ * @param prot char* receives amino acids (prot[0] is codon from)
+ *        should be at least (to - from) long, it is not
+ *        null terminated.
+ * @return prot
+ */
+char *LXBioFrameTranslate(char *codes, long length, int frame,
+                          char *table, Bool reverse,
+                          long from, long to, char *prot);
+
 /*
  * @doc:
  * try to guess the type (i.e. nucleic or proteic) of a biosequence.
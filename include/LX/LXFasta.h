@@ -10,6 +10,7 @@
  * @+ <Wanou> : Dec 01 : last revision
  * @+ <Gloup> : Jan 10 : 64 bits polish
  * @+ <Gloup> : Jan 13:  reduced memory for name and comment
+ * @+ <Gloup> : Oct 26 : windowed reading and fai index
  * -----------------------------------------------------------------------
  * @docstart:
  *
@@ -74,6 +75,66 @@ typedef struct {                             /* -- FastaSequence --     */
                 *seq;                        /* sequence buffer         */
 } LXFastaSequence, *LXFastaSequencePtr;
 
+/**
+ * @doc: Fasta sequence window structure (see LXFastaReadWindow)
+ * - seq     : LXFastaSequencePtr - current window, seq->name and
+ *             seq->comment are those of the sequence, seq->seq and
+ *             seq->length those of the window
+ * - start   : long - position of the window first symbol in sequence
+ * - size    : long - maximum window length
+ * - overlap : long - number of symbols shared by consecutive windows
+ * - first   : Bool - window is the first one of the sequence
+ * - last    : Bool - window is the last one of the sequence
+ * - pending : char* - *internal* symbols read but not yet windowed
+ */
+
+typedef struct {                             /* -- FastaWindow --       */
+        LXFastaSequencePtr seq;              /* current window          */
+        long    start,                       /* window position         */
+                size,                        /* max window length       */
+                overlap;                     /* overlap length          */
+        Bool    first,                       /* first window of seq     */
+                last;                        /* last window of seq      */
+        char    *pending;                    /* *internal*              */
+        long    pendingFrom,                 /* *internal*              */
+                pendingLength;               /* *internal*              */
+} LXFastaWindow, *LXFastaWindowPtr;
+
+/**
+ * @doc: Fasta index entry structure (one line of a .fai file)
+ * - name      : char* - sequence name (first word of header)
+ * - length    : Int64 - sequence length
+ * - offset    : Int64 - file offset of first sequence symbol
+ * - lineBases : Int32 - number of symbols per line
+ * - lineBytes : Int32 - number of bytes per line (including end of line)
+ */
+
+typedef struct {                             /* -- FastaIndexEntry --   */
+        char    *name;                       /* sequence name           */
+        Int64   length,                      /* sequence length         */
+                offset;                      /* first symbol offset     */
+        Int32   lineBases,                   /* symbols per line        */
+                lineBytes;                   /* bytes per line          */
+} LXFastaIndexEntry;
+
+/**
+ * @doc: Fasta index structure
+ * - nbEntries : Int32 - number of sequences
+ * - entry     : LXFastaIndexEntry* - entries in file order
+ * - order     : Int32* - *internal* entries sorted by name
+ * - data      : char* - mapped fasta file (see LXFastaOpenIndex)
+ * - dataSize  : size_t - size of mapped fasta file
+ */
+
+typedef struct {                             /* -- FastaIndex --        */
+        Int32             nbEntries,         /* number of sequences     */
+                          maxEntries;        /* *internal*              */
+        LXFastaIndexEntry *entry;            /* entries                 */
+        Int32             *order;            /* *internal*              */
+        char              *data;             /* mapped fasta file       */
+        size_t            dataSize;          /* mapped size             */
+} LXFastaIndex, *LXFastaIndexPtr;
+
 /* ---------------------------------------------------- */
 /* Prototypes                                           */
 /* ---------------------------------------------------- */
@@ -136,6 +197,54 @@ Bool LXFastaGetSequence (FILE *streamin, LXFastaSequencePtr seq);
 
 Bool LXFastaCheckSequence (LXFastaSequencePtr seq, Bool upper);
 
+/*
+ * @doc: 
+ * Allocate a new fasta window structure
+ * @param size long maximum window length
+ * @param overlap long number of symbols shared by consecutive
+ *        windows of a sequence (should be less than size)
+ * @return LXFastaWindowPtr (NULL on memory error)
+ */
+
+LXFastaWindowPtr LXFastaNewWindow ( long size, long overlap );
+
+/*
+ * @doc: 
+ * Free a fasta window structure
+ * @param win LXFastaWindowPtr to free
+ * @return NULL
+ */
+
+LXFastaWindowPtr LXFastaFreeWindow ( LXFastaWindowPtr win );
+
+/*
+ * @doc:
+ * Read next window of fasta entries (serial reading)
+ * sequences are read by windows of at most win->size symbols,
+ * so that memory does not depend upon sequences length.
+ * consecutive windows of a sequence share win->overlap symbols,
+ * i.e. next window starts win->overlap symbols before the end
+ * of current one. win->first (resp. win->last) tells if window
+ * is the first (resp. last) one of its sequence, a sequence
+ * shorter than win->size has a single (first and last) window.
+ * @param streamin FILE* to read in
+ * @param win LXFastaWindowPtr window to read
+ * @return TRUE if more window to read
+ *         <but> you must check win->seq->ok that may be FALSE
+ * @sample
+ * 
+ * <b>Example:</b>
+ * <pre><code>
+ * LXFastaWindowPtr win = LXFastaNewWindow(1 << 20, 100);
+ * while (LXFastaReadWindow(streamin, win)) {
+ *   if (win->seq->ok)
+ *      MyProcessWindow(win->seq, win->start);
+ * }
+ * </code></pre>
+ */
+
+Bool LXFastaReadWindow  (FILE *streamin, LXFastaWindowPtr win);
+
 /**
  * @doc:
  * Write fasta format sequence
@@ -147,6 +256,122 @@ Bool LXFastaCheckSequence (LXFastaSequencePtr seq, Bool upper);
 void LXFastaWriteSequence (FILE *streamou, LXFastaSequencePtr seq,
                            int char_per_line);
 
+/**
+ * @doc:
+ * Build the (faidx compatible) index of a fasta file.
+ * All lines of a sequence, but the last one, must have the
+ * same length, else the file cannot be indexed.
+ * @param fastaFile char* name of fasta file
+ * @return LXFastaIndexPtr (NULL on error), file is not mapped
+ */
+
+LXFastaIndexPtr LXFastaBuildIndex (const char *fastaFile);
+
+/**
+ * @doc:
+ * Read a .fai index file
+ * @param indexFile char* name of index file
+ * @return LXFastaIndexPtr (NULL on error), fasta file is not mapped
+ */
+
+LXFastaIndexPtr LXFastaReadIndex  (const char *indexFile);
+
+/**
+ * @doc:
+ * Write index in .fai format
+ * @param streamou FILE* to write in
+ * @param index LXFastaIndexPtr index to write
+ * @return LX_NO_ERROR or LX_IO_ERROR
+ */
+
+int LXFastaWriteIndex (FILE *streamou, LXFastaIndexPtr index);
+
+/**
+ * @doc:
+ * Open an indexed fasta file : the index is read from
+ * fastaFile.fai, or else built (and saved into fastaFile.fai
+ * if possible), then the fasta file is mapped into memory
+ * (see LXMapFile) so that sequences can be accessed randomly
+ * without reading the whole file.
+ * @param fastaFile char* name of fasta file
+ * @return LXFastaIndexPtr (NULL on error)
+ * @sample
+ * 
+ * <b>Example:</b>
+ * <pre><code>
+ * LXFastaIndexPtr index = LXFastaOpenIndex("chromo.fst");
+ * Int32 i = LXFastaIndexLookup(index, "chr1");
+ * if (i >= 0)
+ *   len = LXFastaIndexGetRange(index, i, 1000, 500, buffer);
+ * (void) LXFastaCloseIndex(index);
+ * </code></pre>
+ */
+
+LXFastaIndexPtr LXFastaOpenIndex  (const char *fastaFile);
+
+/**
+ * @doc:
+ * Free index (and unmap fasta file if mapped)
+ * @param index LXFastaIndexPtr to free
+ * @return NULL
+ */
+
+LXFastaIndexPtr LXFastaCloseIndex (LXFastaIndexPtr index);
+
+/**
+ * @doc:
+ * Get entry number of sequence name
+ * @param index LXFastaIndexPtr index
+ * @param name char* sequence name
+ * @return entry number (-1 if not found)
+ */
+
+Int32 LXFastaIndexLookup (LXFastaIndexPtr index, const char *name);
+
+/**
+ * @doc:
+ * Get view of symbols [from, from+length[ of sequence #ientry
+ * in mapped fasta file. no copy is made : the view is a pointer
+ * into the mapped file, so it contains end of line bytes unless
+ * range lies in a single line.
+ * @param index LXFastaIndexPtr index (opened by LXFastaOpenIndex)
+ * @param ientry Int32 entry number
+ * @param from Int64 first symbol (0-based)
+ * @param length Int64 number of symbols (clipped to sequence end)
+ * @param nbytes size_t* receives the view size in bytes
+ * @return const char* view (NULL on error)
+ */
+
+const char *LXFastaIndexView (LXFastaIndexPtr index, Int32 ientry,
+                              Int64 from, Int64 length, size_t *nbytes);
+
+/**
+ * @doc:
+ * Copy symbols [from, from+length[ of sequence #ientry
+ * (without end of lines) into buffer and add a terminal '\0'
+ * @param index LXFastaIndexPtr index (opened by LXFastaOpenIndex)
+ * @param ientry Int32 entry number
+ * @param from Int64 first symbol (0-based)
+ * @param length Int64 number of symbols (clipped to sequence end)
+ * @param buffer char* buffer of at least length+1 bytes
+ * @return number of symbols copied (-1 on error)
+ */
+
+Int64 LXFastaIndexGetRange (LXFastaIndexPtr index, Int32 ientry,
+                            Int64 from, Int64 length, char *buffer);
+
+/**
+ * @doc:
+ * Get whole sequence #ientry (with its name and comment)
+ * @param index LXFastaIndexPtr index (opened by LXFastaOpenIndex)
+ * @param ientry Int32 entry number
+ * @param seq LXFastaSequencePtr sequence to fill
+ * @return TRUE if ok (seq->ok is set accordingly)
+ */
+
+Bool LXFastaIndexGetSequence (LXFastaIndexPtr index, Int32 ientry,
+                              LXFastaSequencePtr seq);
+
 #endif
 
 
@@ -8,6 +8,7 @@
  * @+ <Gloup> : May 99 : first version
  * @+ <Wanou> : Dec 01 : last revision 
  * @+ <Gloup> : Jan 10 : endian conversion added
+ * @+ <Gloup> : Oct 26 : peak memory added
  * -----------------------------------------------------------------------
  * @docstart:
  *
@@ -324,6 +325,13 @@ size_t LXAllocSize(void *ptr);
  */
 size_t LXGetUsedMemory(void);
 
+/*
+ * @doc: 
+ * get peak resident memory of current process
+ * @return peak resident set size in bytes (0 if not available)
+ */
+size_t LXGetPeakMemory(void);
+
 /*
  * @doc:
  * Setup IO error internal filename and location.
@@ -405,6 +413,33 @@ int LXOpenTmpFile(LXTmpFile *tmpFile);
  */
 int LXCloseTmpFile(LXTmpFile *tmpFile);
 
+/*
+ * @doc: 
+ * map a file into memory.
+ * (wrapper of mmap(2))
+ * @param filename char* name of the file to map
+ * @param mode char* "r" : map an existing file read only
+ *                   "w" : resize the file (created if needed) to *size 
+ *                         bytes and map it read/write (changes are 
+ *                         written back to the file)
+ * @param size size_t* receives the file size in mode "r",
+ *                     holds the requested size in mode "w"
+ * @return the mapped address (NULL on error)
+ * @note on systems without mmap(2), the file is loaded into memory
+ *       and mode "w" is not available.
+ */
+void *LXMapFile(const char *filename, const char *mode, size_t *size);
+
+/*
+ * @doc: 
+ * unmap a file previously mapped by LXMapFile
+ * (wrapper of munmap(2))
+ * @param addr void* address returned by LXMapFile
+ * @param size size_t size of the mapping
+ * @return LX_NO_ERROR on success else LX_IO_ERROR
+ */
+int LXUnmapFile(void *addr, size_t size);
+
 /*
  * @doc: 
  * read one line in file pointed to by stream, ignoring comment and empty lines.
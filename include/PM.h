@@ -38,7 +38,9 @@
 
 #include "PM/PMHit.h"       /* hits                 */
 #include "PM/PMHitStack.h"  /* stack of hits        */
+#include "PM/PMHitFile.h"   /* hit files            */
 
 #include "PM/PMUtil.h"      /* utilities            */
+#include "PM/PMIndex.h"     /* k-uple index         */
 
 #endif
@@ -6,12 +6,19 @@
  * 
  * @history:
  * @+ <Wanou> : Jan 02 : first version 
+ * @+ <Gloup> : Oct 26 : cleavage maps
+ * @+ <Gloup> : Oct 26 : cleavage maps filled on positions ranges
  * -----------------------------------------------------------------------
  * @docstart:
  *
  * PM enzyme library<br>
  * structure defintion and functions
  *
+ * cut sites may be applied to a whole sequence at once to get
+ * a cleavage map (one bit per residue) that can later be queried
+ * without running any regexp (see PMFillCleavageMap), or only
+ * around the positions to be queried (see PMFillCleavageMapRange).
+ *
  * $Log: PMEnzyme.h,v $
  * Revision 1.1  2003/10/23 15:05:11  reguer
  *
@@ -64,6 +71,12 @@
  * - cCut          : char[PM_ENZYME_MAX_REG_LEN] regexp of the "C-cut"
  * - nCutRegExp    : LXRegexp compiled "N-cut" regexp
  * - cCutRegExp    : LRregexp compiled "C-cut" regexp
+ * - isSimple      : Bool TRUE if both regexps match a single residue
+ *                   (e.g. "[KR]$" and "^[^P]"), they are then
+ *                   compiled into NCutTable and CCutTable
+ * - NCutTable     : UInt8[256] NCutTable[c] : "N-cut" matches residue c
+ * - CCutTable     : UInt8[256] CCutTable[c] : "C-cut" matches residue c
+ * - NCutEmpty     : Bool "N-cut" matches an empty site (begin of sequence)
  */
 typedef struct {
   float     probCut,
@@ -73,6 +86,10 @@ typedef struct {
             CCut[PM_ENZYME_MAX_REG_LEN + 2];
   LXRegExp  *NCutRegExp,
             *CCutRegExp;
+  Bool      isSimple;
+  UInt8     NCutTable[256],
+            CCutTable[256];
+  Bool      NCutEmpty;
 } PMCutSite, *PMCutSitePtr;
 
 /*
@@ -90,6 +107,20 @@ typedef struct {
   char          name[PM_ENZYME_MAX_NAME_LEN + 2];
 } PMEnzyme, *PMEnzymePtr;
 
+/*
+ * @doc: cleavage map of a sequence
+ * bit #pos is set if the enzyme cuts between residues pos-1 and pos
+ * - length        : Int64 sequence length
+ * - size          : Int64 allocated number of words
+ * - bits          : UInt64* bits
+ */
+
+typedef struct {
+  Int64         length;
+  Int64         size;
+  UInt64        *bits;
+} PMCleavageMap, *PMCleavageMapPtr;
+
 /* ---------------------------------------------------- */
 /* Prototypes                                           */
 /* ---------------------------------------------------- */
@@ -125,4 +156,76 @@ int PMLoadEnzyme(char *filename, PMEnzyme *enzyme);
 
 void PMDebugEnzyme(FILE *streamou, PMEnzyme *enzyme);
 
+/*
+ * @doc:
+ * Allocate a new (empty) cleavage map
+ * @return PMCleavageMap* new map (NULL on error)
+ */
+
+PMCleavageMap *PMNewCleavageMap(void);
+
+/*
+ * @doc:
+ * Free cleavage map
+ * @param map PMCleavageMap* map to free
+ * @return NULL
+ */
+
+PMCleavageMap *PMFreeCleavageMap(PMCleavageMap *map);
+
+/*
+ * @doc:
+ * Compute cleavage map of sequence (map is resized as needed).
+ * the sequence is left unchanged.
+ * note: regexps of non simple cut sites are run on every position,
+ * and LXRegExec is not reentrant.
+ * @param map PMCleavageMap* map to fill
+ * @param enzyme PMEnzyme* enzyme
+ * @param seq char* sequence
+ * @param length Int64 sequence length
+ * @return error code LX_NO_ERROR, LX_MEM_ERROR
+ */
+
+int PMFillCleavageMap(PMCleavageMap *map, PMEnzyme *enzyme, char *seq, Int64 length);
+
+/*
+ * @doc:
+ * Compute cleavage map of sequence on positions [from, to[ only.
+ * the first call for a sequence should have from = to = 0 (this
+ * only resizes the map to length). sites at other positions are
+ * left undefined and should not be queried.
+ * note: same restrictions as PMFillCleavageMap
+ * @param map PMCleavageMap* map to fill
+ * @param enzyme PMEnzyme* enzyme
+ * @param seq char* sequence
+ * @param length Int64 sequence length
+ * @param from Int64 first position
+ * @param to Int64 last position (excluded)
+ * @return error code LX_NO_ERROR, LX_MEM_ERROR
+ */
+
+int PMFillCleavageMapRange(PMCleavageMap *map, PMEnzyme *enzyme, char *seq, Int64 length,
+                           Int64 from, Int64 to);
+
+/*
+ * @doc:
+ * check if there is a cleavage site between residues pos-1 and pos
+ * @param map PMCleavageMap* cleavage map
+ * @param pos Int64 position
+ * @return TRUE if there is a site (FALSE if pos is out of sequence)
+ */
+
+Bool PMHasCleavage(PMCleavageMap *map, Int64 pos);
+
+/*
+ * @doc:
+ * count cleavage sites in positions [from, to]
+ * @param map PMCleavageMap* cleavage map
+ * @param from Int64 first position
+ * @param to Int64 last position (included)
+ * @return number of sites
+ */
+
+Int64 PMCountCleavages(PMCleavageMap *map, Int64 from, Int64 to);
+
 #endif
@@ -0,0 +1,271 @@
+/* -----------------------------------------------------------------------
+ * $Id: PMHitFile.h $
+ * -----------------------------------------------------------------------
+ * @file: PMHitFile.h
+ * @desc: hit files library
+ *
+ * @history:
+ * @+ <Gloup> : Oct 26 : first version
+ * @+ <Gloup> : Oct 26 : file indexes of last block read
+ * @+ <Gloup> : Oct 26 : hit sinks (in memory blocks of hits)
+ * -----------------------------------------------------------------------
+ * @docstart:
+ *
+ * hit files (as written by PMMatch and read by PMClust) <br>
+ * a hit file is a sequence of blocks of hits, each block holding
+ * the hits of one tag on one sequence. Three formats are handled :
+ *
+ * - PMHitFileText : the historical format, each block is made of
+ *   the SeqId, the Tag, the hits and an end of hits mark.
+ *
+ * - PMHitFileCompact : text format where each SeqId and each Tag
+ *   is defined once, then referred to by its index :
+ * <pre>
+ *   %PMHits 1 compact
+ *   %S isid
+ *   (SeqId)
+ *   %T itag
+ *   (Tag)
+ *   %H isid itag nbHits
+ *   (nbHits Hits)
+ * </pre>
+ *
+ * - PMHitFileBinary : same records as compact but using the
+ *   PMBinWriteSeqId/PMBinWriteTag/PMBinWriteHit encodings. Each record
+ *   starts with an Int32 record type ('S', 'T' or 'H') followed
+ *   by Int32 index(es) (and number of hits).
+ *
+ * files are written and read through a large stream buffer
+ * (PM_HITFILE_BUFSIZ). The format of a file being read is
+ * automatically detected.
+ *
+ * a hit file may also be opened on a sink (PMHitFileOpenSink) : blocks
+ * are then handed over in memory to a user function instead of being
+ * written, so that a program can consume the hits of another one
+ * without intermediate file (see PMPipeline). hit scores are rounded
+ * as in text format, so that the consumer gets the very same hits as
+ * if they were written then read back.
+ *
+ * @docend:
+ */
+
+#ifndef _H_PMHitFile
+#define _H_PMHitFile
+
+#include "LX.h"
+
+#include "PMSeqId.h"
+#include "PMTag.h"
+#include "PMHit.h"
+#include "PMHitStack.h"
+
+/* ---------------------------------------------------- */
+/* Constants                                            */
+/* ---------------------------------------------------- */
+
+/*
+ * @doc: hit file signature (first line of compact and binary
+ * formats) and version
+ */
+
+#define PM_HITFILE_MAGIC    "%PMHits"
+#define PM_HITFILE_VERSION  1
+
+/*
+ * @doc: size of stream buffer
+ */
+
+#define PM_HITFILE_BUFSIZ   (1 << 20)
+
+/* ---------------------------------------------------- */
+/* Types & Data Structures                              */
+/* ---------------------------------------------------- */
+
+/*
+ * @doc: hit file formats
+ */
+
+typedef enum {
+  PMHitFileText = 0,
+  PMHitFileCompact,
+  PMHitFileBinary
+} PMHitFileFormat;
+
+/*
+ * @doc: hit sink, called at the end of each block of hits written
+ * into a sink hit file (see PMHitFileOpenSink).
+ * isid, seqId, itag and tag are those given to PMHitFileBeginHits,
+ * hits holds the block hits (in order). the sink may pop hits
+ * (it then owns them), the remaining ones are freed on return.
+ * arg is the user argument given to PMHitFileOpenSink.
+ * should return LX_NO_ERROR (or an error code).
+ */
+
+typedef int (*PMHitSink)(Ptr arg, Int32 isid, PMSeqId *seqId,
+                         Int32 itag, PMTag *tag, PMHitStack *hits);
+
+/*
+ * @doc: hit source, a producer of hits that calls sink (with
+ * sinkArg as first argument) on each block of hits. arg is the
+ * source own argument.
+ * should return LX_NO_ERROR (or an error code).
+ */
+
+typedef int (*PMHitSource)(PMHitSink sink, Ptr sinkArg, Ptr arg);
+
+/*
+ * @doc: hit file
+ * - stream     : underlying stream
+ * - format     : file format
+ * - buffer     : stream buffer
+ * - nbSeqIds   : number of SeqIds defined so far
+ * - nbTags     : number of Tags defined so far
+ * - maxXXX     : allocated size of maps (writer) or
+ *                dictionaries (reader)
+ * - seqIdMap   : (writer) user SeqId index to file index
+ * - tagMap     : (writer) user Tag index to file index
+ * - seqIds     : (reader) SeqIds defined so far
+ * - tags       : (reader) Tags defined so far
+ * - isid, itag : (reader) file indexes of the SeqId and Tag of
+ *                the last block read (-1 in text format). in compact
+ *                and binary formats, a SeqId (or Tag) is defined once
+ *                and keeps its index in the whole file, so readers
+ *                may keep their own data by index instead of
+ *                comparing SeqIds (resp. Tags).
+ * - sink       : (sink) user sink (NULL for files)
+ * - sinkArg    : (sink) user argument of sink
+ * - block      : (sink) hits of current block
+ * - blockXXX   : (sink) SeqId and Tag (and their indexes) of
+ *                current block
+ */
+
+typedef struct {
+  FILE            *stream;
+  PMHitFileFormat format;
+  char            *buffer;
+  Int32           nbSeqIds, maxSeqIds;
+  Int32           nbTags,   maxTags;
+  Int32           *seqIdMap, *tagMap;
+  PMSeqId         *seqIds;
+  PMTag           *tags;
+  Int32           isid, itag;
+  PMHitSink       sink;
+  Ptr             sinkArg;
+  PMHitStack      *block;
+  PMSeqId         *blockSeqId;
+  PMTag           *blockTag;
+  Int32           blockIsid, blockItag;
+} PMHitFile, *PMHitFilePtr;
+
+/* ---------------------------------------------------- */
+/* Prototypes                                           */
+/* ---------------------------------------------------- */
+
+/*
+ * @doc:
+ * get format from its name ("text", "compact", "binary" or
+ * their first letter)
+ * @param name char* format name
+ * @param format PMHitFileFormat* receives format
+ * @return error code LX_NO_ERROR, LX_ARG_ERROR
+ */
+
+int PMHitFileFormatFromName(const char *name, PMHitFileFormat *format);
+
+/*
+ * @doc:
+ * open hit file for writing on stream and write signature.
+ * stream should not have been written into yet.
+ * @param streamou FILE* stream to write into
+ * @param format PMHitFileFormat
+ * @return new PMHitFile (NULL on error)
+ */
+
+PMHitFile *PMHitFileOpenWrite(FILE *streamou, PMHitFileFormat format);
+
+/*
+ * @doc:
+ * open hit file for reading from stream and detect its format.
+ * stream should not have been read from yet.
+ * @param streamin FILE* stream to read from
+ * @return new PMHitFile (NULL on error)
+ */
+
+PMHitFile *PMHitFileOpenRead(FILE *streamin);
+
+/*
+ * @doc:
+ * open hit file on sink : each block of hits written (see
+ * PMHitFileBeginHits) is handed over to sink by PMHitFileEndHits
+ * (see PMHitSink).
+ * @param sink PMHitSink user sink
+ * @param arg Ptr user argument of sink
+ * @return new PMHitFile (NULL on error)
+ */
+
+PMHitFile *PMHitFileOpenSink(PMHitSink sink, Ptr arg);
+
+/*
+ * @doc:
+ * flush and close hit file (and its stream)
+ * @param hitFile PMHitFile*
+ * @return NULL
+ */
+
+PMHitFile *PMHitFileClose(PMHitFile *hitFile);
+
+/*
+ * @doc:
+ * start writing a block of nbHits hits of tag on seqId.
+ * isid and itag are the caller own (positive) indexes of seqId
+ * and tag : seqId and tag are written in file the first time
+ * they are seen only (except in text format).
+ * must be followed by nbHits calls to PMHitFileWriteHit and a call
+ * to PMHitFileEndHits
+ * @param hitFile PMHitFile*
+ * @param isid Int32 SeqId index
+ * @param seqId PMSeqId*
+ * @param itag Int32 Tag index
+ * @param tag PMTag*
+ * @param nbHits Int32 number of hits in block
+ * @return error code LX_NO_ERROR, LX_IO_ERROR, LX_MEM_ERROR
+ */
+
+int PMHitFileBeginHits(PMHitFile *hitFile, Int32 isid, PMSeqId *seqId,
+                       Int32 itag, PMTag *tag, Int32 nbHits);
+
+/*
+ * @doc:
+ * write hit of current block
+ * @param hitFile PMHitFile*
+ * @param hit PMHit*
+ * @return error code LX_NO_ERROR, LX_IO_ERROR, LX_MEM_ERROR
+ */
+
+int PMHitFileWriteHit(PMHitFile *hitFile, PMHit *hit);
+
+/*
+ * @doc:
+ * end current block (and call sink on it, see PMHitFileOpenSink)
+ * @param hitFile PMHitFile*
+ * @return error code LX_NO_ERROR, LX_IO_ERROR (or sink error code)
+ */
+
+int PMHitFileEndHits(PMHitFile *hitFile);
+
+/*
+ * @doc:
+ * read next block of hits.
+ * *seqId and *tag point into hitFile and are only valid
+ * until next call. hits are pushed into hits.
+ * @param hitFile PMHitFile*
+ * @param seqId PMSeqId** receives block SeqId
+ * @param tag PMTag** receives block Tag
+ * @param hits PMHitStack* receives hits
+ * @return error code LX_NO_ERROR, LX_EOF, LX_IO_ERROR, LX_MEM_ERROR
+ */
+
+int PMHitFileReadHits(PMHitFile *hitFile, PMSeqId **seqId, PMTag **tag,
+                      PMHitStack *hits);
+
+#endif
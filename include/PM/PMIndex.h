@@ -0,0 +1,244 @@
+/* -----------------------------------------------------------------------
+ * $Id: PMIndex.h $
+ * -----------------------------------------------------------------------
+ * @file: PMIndex.h
+ * @desc: PepMap k-uple index of translated sequences
+ *
+ * @history:
+ * @+ <Gloup> : Oct 26 : first version
+ * -----------------------------------------------------------------------
+ * @docstart:
+ *
+ * PM k-uple index library<br>
+ * An index is a single binary file holding a set of (translated)
+ * sequences together with the sorted positions of every k-uple
+ * (3 <= k <= 6) found in these sequences. It is built once
+ * (see the PMIndex program) and then memory mapped by the programs
+ * that need to lookup k-uples (PMMatch).
+ *
+ * Layout of the index file (native endianness) :
+ * - header     : PMIndexHeader
+ * - residues   : all sequences, each one followed by '\000'
+ * - sequences  : PMIndexSeq[nbSeq]
+ * - strings    : sequences names and comments
+ * - codes      : UInt32[nbCodes] sorted k-uple codes
+ * - starts     : Int64[nbCodes + 1] first position of each code
+ * - positions  : (UInt32|Int64)[nbPos] residue offsets, sorted
+ *                by code then offset
+ *
+ * k-uples are encoded as in PMMatch : base 26 code with L folded
+ * into I and (optionally) Q folded into K.
+ *
+ * @docend:
+ */
+
+#ifndef _H_PMIndex
+
+#define _H_PMIndex
+
+#include "LX/LXSys.h"
+#include "LX/LXFasta.h"
+
+#include "PMSys.h"
+
+/* ---------------------------------------------------- */
+/* Constants                                            */
+/* ---------------------------------------------------- */
+
+/*
+ * @doc: index file signature and version
+ */
+
+#define PM_INDEX_MAGIC     "PMINDEX"
+#define PM_INDEX_VERSION   1
+
+/*
+ * @doc: k-uple size range
+ */
+
+#define PM_INDEX_MIN_KUPLE 3
+#define PM_INDEX_MAX_KUPLE 6
+
+/*
+ * @doc: size of k-uple alphabet
+ */
+
+#define PM_INDEX_ALPHALEN  26
+
+/* ---------------------------------------------------- */
+/* Data Structures                                      */
+/* ---------------------------------------------------- */
+
+/*
+ * @doc: index file header
+ * - magic           : PM_INDEX_MAGIC
+ * - endian          : 1 stored in native endianness
+ * - version         : PM_INDEX_VERSION
+ * - kuple           : k-uple size
+ * - differentiateKQ : TRUE if Q is not folded into K
+ * - posWidth        : width of positions in bytes (4 or 8)
+ * - nbSeq           : number of sequences
+ * - nbResidues      : size of residues section
+ * - nbCodes         : number of distinct k-uples
+ * - nbPos           : total number of k-uples positions
+ * - xxxOffset       : file offset of sections
+ * - fileSize        : total file size
+ */
+
+typedef struct {
+  char   magic[8];
+  Int32  endian;
+  Int32  version;
+  Int32  kuple;
+  Int32  differentiateKQ;
+  Int32  posWidth;
+  Int32  reserved;
+  Int64  nbSeq,
+         nbResidues,
+         nbCodes,
+         nbPos;
+  Int64  seqOffset,
+         strOffset,
+         resOffset,
+         codeOffset,
+         startOffset,
+         posOffset;
+  Int64  fileSize;
+} PMIndexHeader;
+
+/*
+ * @doc: sequence entry
+ * - from    : offset of first residue in residues section
+ * - length  : sequence length
+ * - name    : offset of name in strings section
+ * - comment : offset of comment in strings section
+ */
+
+typedef struct {
+  Int64  from,
+         length,
+         name,
+         comment;
+} PMIndexSeq;
+
+/*
+ * @doc: memory mapped index
+ */
+
+typedef struct {
+  void          *base;
+  size_t        size;
+  PMIndexHeader *header;
+  PMIndexSeq    *seqs;
+  char          *strings;
+  char          *residues;
+  UInt32        *codes;
+  Int64         *starts;
+  void          *positions;
+} PMIndex, *PMIndexPtr;
+
+/* ---------------------------------------------------- */
+/* Prototypes                                           */
+/* ---------------------------------------------------- */
+
+/*
+ * @doc:
+ * fold undifferentiable residues (L->I, Q->K unless differentiateKQ)
+ * @param symbol int residue
+ * @param differentiateKQ Bool
+ * @return folded residue
+ */
+
+int PMIndexFoldSymbol(int symbol, Bool differentiateKQ);
+
+/*
+ * @doc:
+ * compute code of k-uple
+ * @param s char* k-uple (upper case)
+ * @param kuple int k-uple size
+ * @param differentiateKQ Bool
+ * @return k-uple code in [0, 26^kuple[
+ */
+
+Int32 PMIndexKupleCode(const char *s, int kuple, Bool differentiateKQ);
+
+/*
+ * @doc:
+ * build index file from fasta stream
+ * sequences are made upper case and non alpha characters
+ * are replaced by LX_GENETIC_BAD_AA.
+ * note: needs 4 * 26^kuple bytes of memory for counting k-uples
+ * @param streamin FILE* fasta stream to read from
+ * @param filename char* index file to create
+ * @param kuple int k-uple size (PM_INDEX_MIN_KUPLE .. PM_INDEX_MAX_KUPLE)
+ * @param differentiateKQ Bool
+ * @param verbose Bool
+ * @return error code LX_NO_ERROR, LX_IO_ERROR, LX_MEM_ERROR, LX_ARG_ERROR
+ */
+
+int PMIndexBuild(FILE *streamin, const char *filename,
+                 int kuple, Bool differentiateKQ, Bool verbose);
+
+/*
+ * @doc:
+ * open (map) index file
+ * @param filename char* index file
+ * @return index (NULL on error)
+ */
+
+PMIndex *PMIndexOpen(const char *filename);
+
+/*
+ * @doc:
+ * close (unmap) index
+ * @param index PMIndex*
+ * @return NULL
+ */
+
+PMIndex *PMIndexClose(PMIndex *index);
+
+/*
+ * @doc:
+ * get number of sequences in index
+ * @param index PMIndex*
+ * @return number of sequences
+ */
+
+Int64 PMIndexNbSeq(PMIndex *index);
+
+/*
+ * @doc:
+ * get sequence #iseq as a fasta sequence.
+ * name, comment and seq fields of fastaSeq point into the index
+ * and should neither be modified nor freed.
+ * @param index PMIndex*
+ * @param iseq Int64 sequence number (from 0)
+ * @param fastaSeq LXFastaSequence* sequence to fill
+ * @return error code LX_NO_ERROR, LX_ARG_ERROR
+ */
+
+int PMIndexGetSequence(PMIndex *index, Int64 iseq, LXFastaSequence *fastaSeq);
+
+/*
+ * @doc:
+ * lookup k-uple code
+ * @param index PMIndex*
+ * @param code Int32 k-uple code
+ * @param from Int64* receives first position index
+ * @param to Int64* receives last position index (excluded)
+ * @return number of positions
+ */
+
+Int64 PMIndexLookup(PMIndex *index, Int32 code, Int64 *from, Int64 *to);
+
+/*
+ * @doc:
+ * get position (residue offset)
+ * @param index PMIndex*
+ * @param i Int64 position index (as returned by PMIndexLookup)
+ * @return residue offset in residues section
+ */
+
+Int64 PMIndexPosition(PMIndex *index, Int64 i);
+
+#endif
@@ -6,6 +6,7 @@
  *
  * @history:
  * @+ <Gloup> : Jul 06 : first version
+ * @+ <Gloup> : Oct 26 : binary io
  * -----------------------------------------------------------------------
  * @docstart: 
  *
@@ -147,6 +148,29 @@ int PMReadSeqId(FILE *streamin, PMSeqId *seqId);
 
 int PMWriteSeqId(FILE *streamou, PMSeqId *seqId);
 
+/*
+ * @doc: 
+ * write binary seqId in file streamou
+ * (the seqId is encoded as its text record)
+ * @param streamou FILE* binary opened file to write into
+ * @param seqId PMSeqId* seqId to be dumped 
+ * @return result int > 0 if writing operation succeed, 
+ * else return null or negative value
+ */
+
+int PMBinWriteSeqId(FILE *streamou, PMSeqId *seqId);
+
+/*
+ * @doc: 
+ * read binary seqId (written by PMBinWriteSeqId) from file streamin
+ * @param streamin FILE* binary opened file to read into
+ * @param seqId PMSeqId* seqId to be loaded 
+ * @return result int > 0 if reading operation succeed, 
+ * LX_EOF at end of file, else null or negative value 
+ */
+
+int PMBinReadSeqId(FILE *streamin, PMSeqId *seqId);
+
 /*
  * @doc:
  * [debug] print SeqId information
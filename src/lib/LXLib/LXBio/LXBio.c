@@ -7,6 +7,7 @@
  * @history:
  * @+ <Gloup> : Jan 96 : first version for PWG 
  * @+ <Wanou> : Jan 02 : adapted to LX_Ware 
+ * @+ <Gloup> : Oct 26 : table driven translation of encoded sequences
  * -----------------------------------------------------------------------
  * @docstart:
  *
@@ -113,6 +114,79 @@ char *LXBioSeqTranslate(char *nucAcSeq, int codid)
 
 /* ---------------------------- */
 
+char *LXBioSeqEncode(char *nucAcSeq, long length)
+{
+    int  i;
+    long j;
+    char *p, codes[256];
+
+    for (i = 0 ; i < 256 ; i++)
+        codes[i] = LX_BIO_BAD_BASE;
+
+    for (p = sGenNuc ; *p ; p++)
+        codes[(unsigned char) *p] = sNucNum[((int) (p - sGenNuc)) / 2];
+
+    for (j = 0 ; j < length ; j++)
+        nucAcSeq[j] = codes[(unsigned char) nucAcSeq[j]];
+
+    return nucAcSeq;
+}
+
+/* ---------------------------- */
+
+char *LXBioCodonTable(char *table, int codid, Bool reverse)
+{
+    int  b1, b2, b3, hash, *code;
+    
+    if ((codid < 0) || (codid >= LX_GENETIC_MAX_CODES))
+        return NULL;
+
+    code = gLXGeneticCode[codid].code;
+
+    for (b1 = 0 ; b1 <= LX_BIO_BAD_BASE ; b1++)
+    for (b2 = 0 ; b2 <= LX_BIO_BAD_BASE ; b2++)
+    for (b3 = 0 ; b3 <= LX_BIO_BAD_BASE ; b3++) {
+
+        if (   (b1 == LX_BIO_BAD_BASE) 
+            || (b2 == LX_BIO_BAD_BASE) 
+            || (b3 == LX_BIO_BAD_BASE))
+            hash = 64;
+        else if (reverse)                        /* complement is 3 - b */
+            hash = ((3 - b1) * 4 + (3 - b2)) * 4 + (3 - b3);
+        else
+            hash = (b1 * 4 + b2) * 4 + b3;
+
+        table[(b1 * 5 + b2) * 5 + b3] = sGenPro[code[hash]];
+    }
+
+    return table;
+}
+
+/* ---------------------------- */
+
+char *LXBioFrameTranslate(char *codes, long length, int frame,
+                          char *table, Bool reverse,
+                          long from, long to, char *prot)
+{
+    long k;
+    char *ns, *ps = prot;
+
+    if (reverse) {
+        ns = codes + length - 1 - frame - 3 * from;
+        for (k = from ; k < to ; k++, ns -= 3)
+            *ps++ = table[(ns[0] * 5 + ns[-1]) * 5 + ns[-2]];
+    }
+    else {
+        ns = codes + frame + 3 * from;
+        for (k = from ; k < to ; k++, ns += 3)
+            *ps++ = table[(ns[0] * 5 + ns[1]) * 5 + ns[2]];
+    }
+
+    return prot;
+}
+
+/* ---------------------------- */
+
 int LXBioSeqType(char *seq)
 {
     char  *s;
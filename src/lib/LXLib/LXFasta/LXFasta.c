@@ -11,6 +11,8 @@
  * @+ <Gloup> : Feb 02 : corrected comment bug 
  * @+ <Gloup> : Jan 10 : 64 bits polish
  * @+ <Gloup> : Jan 13 : read buffer moved to LXLineBuf library
+ * @+ <Gloup> : Oct 26 : no more write past end of short header lines
+ * @+ <Gloup> : Oct 26 : windowed serial reading
  * -----------------------------------------------------------------------
  * @docstart:
  *
@@ -98,17 +100,23 @@ static char *sNextSpace(char *buffer)
 
 static char *sGetName(char *buffer)
 {
-    char save;
+    char save = '\000';
+    Bool longLine;
 
     static char sName[BUFSIZ+1];
 
-    save = buffer[BUFSIZ];
-    buffer[BUFSIZ] = '\000';
+    /* buffer is only BUFSIZ long for long lines */
+    
+    if ((longLine = (strlen(buffer) > BUFSIZ))) {
+        save = buffer[BUFSIZ];
+        buffer[BUFSIZ] = '\000';
+    }
     
     if (sscanf(buffer + 1, "%s", sName) != 1)
         (void) strcpy(sName, "NO_NAME");
 
-    buffer[BUFSIZ] = save;
+    if (longLine)
+        buffer[BUFSIZ] = save;
 
     return sName;
 }
@@ -118,18 +126,22 @@ static char *sGetName(char *buffer)
 /* -------------------------------------------- */
 static char *sGetComment(char *buffer)
 {
-    char   save, *space;
+    char   save = '\000', *space;
+    Bool   longLine;
 
     static char sComment[BUFSIZ+1];
 
-    save = buffer[BUFSIZ];
-    buffer[BUFSIZ] = '\000';
+    if ((longLine = (strlen(buffer) > BUFSIZ))) {
+        save = buffer[BUFSIZ];
+        buffer[BUFSIZ] = '\000';
+    }
     
     space = sNextSpace(buffer);
     
     strcpy(sComment, (space ? space + 1 : "<no comment>"));
 
-    buffer[BUFSIZ] = save;
+    if (longLine)
+        buffer[BUFSIZ] = save;
 
     return sComment;
 }
@@ -278,6 +290,148 @@ Bool LXFastaGetSequence(FILE *streamin, LXFastaSequencePtr seq)
     return (seq->ok = TRUE);
 }
 
+/* -------------------------------------------- */
+/* create new fasta window                      */
+/* -------------------------------------------- */
+LXFastaWindowPtr LXFastaNewWindow(long size, long overlap)
+{
+    LXFastaWindowPtr win;
+    
+    if (! (win = NEW(LXFastaWindow)))
+        return NULL;
+
+    win->size    = MAX(size, 1);
+    win->overlap = MAX(0, MIN(overlap, win->size - 1));
+    win->start   = 0;
+    win->first   = TRUE;
+    win->last    = TRUE;
+    win->pending = NULL;
+
+    win->pendingFrom = win->pendingLength = 0;
+
+    if (! (win->seq = LXFastaNewSequence(0)))
+        return LXFastaFreeWindow(win);
+
+    return win;
+}
+
+/* -------------------------------------------- */
+/* free fasta window                            */
+/* -------------------------------------------- */
+LXFastaWindowPtr LXFastaFreeWindow(LXFastaWindowPtr win)
+{
+    if (win) {
+        (void) LXFastaFreeSequence(win->seq);
+        IFFREE(win->pending);
+        FREE(win);
+    }
+
+    return NULL;
+}
+
+/* -------------------------------------------- */
+/* @static: get next sequence line of current   */
+/*          entry into window pending buffer    */
+/* returns : FALSE -> end of entry              */
+/* -------------------------------------------- */
+static Bool sNextWindowLine(FILE *streamin, LXFastaWindowPtr win)
+{
+    char *buffer;
+
+    while (win->pendingFrom >= win->pendingLength) {
+
+        if ((buffer = sReadLine(streamin, READ_NEXT, SERIAL)) == NULL)
+            return FALSE;
+
+        if (*buffer == LX_FASTA_SEQ_BEGIN) {
+            (void) sReadLine(streamin, PUSH_BACK, SERIAL);
+            return FALSE;
+        }
+
+        if (! (win->pending = LXStrcpy(win->pending, buffer)))
+            return FALSE;
+
+        win->pendingFrom   = 0;
+        win->pendingLength = strlen(win->pending);
+    }
+
+    return TRUE;
+}
+
+/* -------------------------------------------- */
+/* Serial read Fasta window                     */
+/* returns : FALSE -> last window               */
+/*           TRUE  -> more to read              */
+/*           <but> you must check win->seq->ok  */
+/* -------------------------------------------- */
+Bool LXFastaReadWindow(FILE *streamin, LXFastaWindowPtr win)
+{
+    long               keep, readlen;
+    char               *buffer;
+    LXFastaSequencePtr seq = win->seq;
+
+    seq->ok = FALSE;                        /* assume error         */
+
+    if (win->last) {                        /* next sequence        */
+
+        seq->length = 0;
+
+        seq->offset = ftell(streamin);
+
+        buffer = sReadLine(streamin, READ_NEXT, SERIAL);
+
+        if (   (buffer == NULL) 
+            || (*buffer != LX_FASTA_SEQ_BEGIN)) /* sync error       */
+            return FALSE;                       /* last sequence    */
+    
+        if (seq->offset)
+            seq->offset -= (strlen(buffer) + 1);
+
+        seq->name    = LXStrcpy(seq->name,    sGetName(buffer));
+        seq->comment = LXStrcpy(seq->comment, sGetComment(buffer));
+
+        win->start = 0;
+        win->first = TRUE;
+
+        win->pendingFrom = win->pendingLength = 0;
+    }
+    else {                                  /* next window          */
+
+        keep = MIN(win->overlap, seq->length);
+
+        (void) memmove(seq->seq, seq->seq + seq->length - keep, keep);
+
+        win->start  += seq->length - keep;
+        win->first   = FALSE;
+        seq->length  = keep;
+    }
+
+    /* fill window                          */
+
+    while ((seq->length < win->size) && sNextWindowLine(streamin, win)) {
+
+        readlen = MIN(win->pendingLength - win->pendingFrom, 
+                      win->size - seq->length);
+
+        if (! sAssertSeqBuffer(seq, seq->length + readlen))
+            return TRUE;   /* but seq->ok is FALSE  */
+
+        (void) memcpy(seq->seq + seq->length, win->pending + win->pendingFrom, readlen);
+
+        win->pendingFrom += readlen;
+        seq->length      += readlen;
+    }
+
+    /* this is the last window if no more   */
+    /* symbols follow in current entry      */
+
+    win->last = ! sNextWindowLine(streamin, win);
+
+    seq->seq[seq->length] = '\000';
+
+    return (seq->ok = TRUE);
+}
+
 /* -------------------------------------------- */
 /* Check Fasta sequence                         */
 /* -------------------------------------------- */
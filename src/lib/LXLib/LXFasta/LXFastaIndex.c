@@ -0,0 +1,658 @@
+/* -----------------------------------------------------------------------
+ * $Id: LXFastaIndex.c $
+ * -----------------------------------------------------------------------
+ * @file: LXFastaIndex.c
+ * @desc: random access to fasta files (faidx compatible index)
+ *
+ * @history:
+ * @+ <Gloup> : Oct 26 : first version
+ * -----------------------------------------------------------------------
+ * @docstart:
+ *
+ * LXfasta index C program<br>
+ * the index holds, for each sequence, its name, length, offset
+ * of its first symbol and lines geometry (same as samtools .fai
+ * files), so that any range of any sequence can be located in
+ * constant time in the (mapped) fasta file.
+ *
+ * @docend:
+ */
+
+#include <ctype.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include "LX/LXString.h"
+#include "LX/LXFasta.h"
+
+#define INDEX_SUFFIX    ".fai"
+
+#define NO_COMMENT      "<no comment>"
+
+/* -------------------------------------------- */
+/* @static: new empty index                     */
+/* -------------------------------------------- */
+static LXFastaIndexPtr sNewIndex()
+{
+    LXFastaIndexPtr index;
+
+    if (! (index = NEW(LXFastaIndex)))
+        return NULL;
+
+    index->nbEntries  = 0;
+    index->maxEntries = 64;
+    index->order      = NULL;
+    index->data       = NULL;
+    index->dataSize   = 0;
+
+    if (! (index->entry = NEWN(LXFastaIndexEntry, index->maxEntries))) {
+        FREE(index);
+        return NULL;
+    }
+
+    return index;
+}
+
+/* -------------------------------------------- */
+/* @static: add (empty) entry to index          */
+/* -------------------------------------------- */
+static LXFastaIndexEntry *sAddEntry(LXFastaIndexPtr index)
+{
+    LXFastaIndexEntry *entry;
+
+    if (index->nbEntries >= index->maxEntries) {
+        entry = REALLOC(index->entry, LXFastaIndexEntry, 2 * index->maxEntries);
+        if (! entry)
+            return NULL;
+        index->entry       = entry;
+        index->maxEntries *= 2;
+    }
+
+    entry = index->entry + index->nbEntries++;
+
+    entry->name      = NULL;
+    entry->length    = entry->offset    = 0;
+    entry->lineBases = entry->lineBytes = 0;
+
+    return entry;
+}
+
+/* -------------------------------------------- */
+/* @static: compare entries on name             */
+/* (then on position, so that sort is stable)   */
+/* -------------------------------------------- */
+static int sCompareEntries(const void *p1, const void *p2)
+{
+    LXFastaIndexEntry *e1 = *((LXFastaIndexEntry **) p1),
+                      *e2 = *((LXFastaIndexEntry **) p2);
+    int               cmp = strcmp(e1->name, e2->name);
+
+    return (cmp ? cmp : (e1 < e2 ? -1 : (e1 > e2 ? 1 : 0)));
+}
+
+/* -------------------------------------------- */
+/* @static: sort entries by name (for lookup)   */
+/* -------------------------------------------- */
+static Bool sSortEntries(LXFastaIndexPtr index)
+{
+    Int32             i;
+    LXFastaIndexEntry **sorted;
+
+    IFFREE(index->order);
+
+    index->order = NEWN(Int32, MAX(1, index->nbEntries));
+    sorted       = NEWN(LXFastaIndexEntry *, MAX(1, index->nbEntries));
+
+    if (! (index->order && sorted)) {
+        IFFREE(sorted);
+        return FALSE;
+    }
+
+    for (i = 0 ; i < index->nbEntries ; i++)
+        sorted[i] = index->entry + i;
+
+    qsort(sorted, index->nbEntries, sizeof(LXFastaIndexEntry *), sCompareEntries);
+
+    for (i = 0 ; i < index->nbEntries ; i++)
+        index->order[i] = (Int32) (sorted[i] - index->entry);
+
+    FREE(sorted);
+
+    return TRUE;
+}
+
+/* -------------------------------------------- */
+/* @static: end of line starting at pos         */
+/* -------------------------------------------- */
+static size_t sEndOfLine(const char *data, size_t size, size_t pos)
+{
+    const char *eol = memchr(data + pos, '\n', size - pos);
+
+    return (eol ? (size_t) (eol - data) : size);
+}
+
+/* -------------------------------------------- */
+/* @static: length of the prefix of [pos, eol[  */
+/*          made of chars not in (resp. in) set */
+/* -------------------------------------------- */
+static size_t sSpan(const char *data, size_t pos, size_t eol,
+                    const char *set, Bool inSet)
+{
+    size_t n;
+
+    for (n = pos ; n < eol ; n++) {
+        if ((strchr(set, data[n]) != NULL) != inSet)
+            break;
+    }
+
+    return n - pos;
+}
+
+/* -------------------------------------------- */
+/* @static: file offset of symbol pos of entry  */
+/* -------------------------------------------- */
+static Int64 sSymbolOffset(LXFastaIndexEntry *entry, Int64 pos)
+{
+    if (entry->lineBases <= 0)
+        return entry->offset;
+
+    return   entry->offset
+           + (pos / entry->lineBases) * entry->lineBytes
+           + (pos % entry->lineBases);
+}
+
+/* -------------------------------------------- */
+/* @static: check entry number and clip range   */
+/* -------------------------------------------- */
+static Bool sClipRange(LXFastaIndexPtr index, Int32 ientry,
+                       Int64 from, Int64 *length)
+{
+    LXFastaIndexEntry *entry;
+
+    if ((! index->data) || (ientry < 0) || (ientry >= index->nbEntries))
+        return FALSE;
+
+    entry = index->entry + ientry;
+
+    if ((from < 0) || (from > entry->length) || (*length < 0))
+        return FALSE;
+
+    *length = MIN(*length, entry->length - from);
+
+    return TRUE;
+}
+
+/* -------------------------------------------- */
+/* @static: index mapped fasta data             */
+/* returns : FALSE -> badly formatted file or   */
+/*           memory error                       */
+/* -------------------------------------------- */
+static Bool sIndexData(LXFastaIndexPtr index, const char *data, size_t size)
+{
+    size_t            pos, eol, bytes;
+    Int64             bases;
+    Bool              shortLine, blankLine;
+    char              *name;
+    LXFastaIndexEntry *entry;
+
+    pos = 0;
+
+    while (pos < size) {
+
+        eol = sEndOfLine(data, size, pos);
+
+        if (data[pos] != LX_FASTA_SEQ_BEGIN) {     /* blank line    */
+            if (sSpan(data, pos, eol, " \t\r", TRUE) < eol - pos)
+                return FALSE;                       /* sync error    */
+            pos = eol + 1;
+            continue;
+        }
+
+        /* header : name is first word          */
+
+        if (! (entry = sAddEntry(index)))
+            return FALSE;
+
+        bytes = sSpan(data, pos + 1, eol, " \t\r", FALSE);
+
+        if (! (name = LXNewStr(bytes + 1)))
+            return FALSE;
+
+        (void) memcpy(name, data + pos + 1, bytes);
+        name[bytes] = '\000';
+
+        entry->name   = name;
+        entry->offset = (Int64) MIN(eol + 1, size);
+
+        pos = eol + 1;
+
+        /* sequence lines : all but the last    */
+        /* must have the same length            */
+
+        shortLine = blankLine = FALSE;
+
+        while ((pos < size) && (data[pos] != LX_FASTA_SEQ_BEGIN)) {
+
+            eol   = sEndOfLine(data, size, pos);
+            bases = (Int64) (eol - pos);
+            bytes = (eol < size ? eol - pos + 1 : eol - pos);
+
+            if ((bases > 0) && (data[eol - 1] == '\r'))
+                bases--;
+
+            if (bases == 0) {
+                blankLine = TRUE;
+                pos += bytes;
+                continue;
+            }
+
+            if (shortLine || blankLine)
+                return FALSE;
+
+            if (entry->lineBases == 0) {
+                entry->lineBases = (Int32) bases;
+                entry->lineBytes = (Int32) (eol < size ? bytes : bases + 1);
+            }
+            else if (   (bases > entry->lineBases)
+                     || ((eol < size) && (bases == entry->lineBases)
+                                      && (bytes != entry->lineBytes)))
+                return FALSE;
+
+            shortLine = (bases < entry->lineBases);
+
+            entry->length += bases;
+            pos           += bytes;
+        }
+    }
+
+    return TRUE;
+}
+
+/* -------------------------------------------- */
+/* @static: offset of entry header in mapped    */
+/*          data (header line ends just before  */
+/*          entry offset)                       */
+/* -------------------------------------------- */
+static size_t sHeaderOffset(LXFastaIndexPtr index, LXFastaIndexEntry *entry)
+{
+    size_t header;
+
+    if (entry->offset <= 0)
+        return 0;
+
+    header = (size_t) entry->offset - 1;
+
+    while ((header > 0) && (index->data[header - 1] != '\n'))
+        header--;
+
+    return header;
+}
+
+/* -------------------------------------------- */
+/* @static: comment of entry header in mapped   */
+/*          data (see LXFasta sGetComment)      */
+/* -------------------------------------------- */
+static char *sGetComment(LXFastaIndexPtr index, LXFastaIndexEntry *entry,
+                         char *comment)
+{
+    size_t header, length;
+    char   *space;
+
+    if (entry->offset <= 0)
+        return LXStrcpy(comment, NO_COMMENT);
+
+    header = sHeaderOffset(index, entry);
+
+    length = (size_t) entry->offset - header;
+
+    while ((length > 0) && isspace(index->data[header + length - 1]))
+        length--;
+
+    space = memchr(index->data + header, ' ', length);
+
+    if (! space)
+        space = memchr(index->data + header, '\t', length);
+
+    if (! space)
+        return LXStrcpy(comment, NO_COMMENT);
+
+    length -= (space + 1 - (index->data + header));
+
+    if ((! comment) || (length >= LXAllocSize(comment))) {
+        IFFREE(comment);
+        if (! (comment = LXNewStr(length + 1)))
+            return NULL;
+    }
+
+    (void) memcpy(comment, space + 1, length);
+    comment[length] = '\000';
+
+    return comment;
+}
+
+/* -------------------------------------------- */
+/* API                                          */
+/* -------------------------------------------- */
+
+/* -------------------------------------------- */
+/* free index                                   */
+/* -------------------------------------------- */
+LXFastaIndexPtr LXFastaCloseIndex(LXFastaIndexPtr index)
+{
+    Int32 i;
+
+    if (index) {
+        for (i = 0 ; i < index->nbEntries ; i++)
+            IFFREE(index->entry[i].name);
+        IFFREE(index->entry);
+        IFFREE(index->order);
+        if (index->data)
+            (void) LXUnmapFile(index->data, index->dataSize);
+        FREE(index);
+    }
+
+    return NULL;
+}
+
+/* -------------------------------------------- */
+/* build index of fasta file                    */
+/* -------------------------------------------- */
+LXFastaIndexPtr LXFastaBuildIndex(const char *fastaFile)
+{
+    char            *data;
+    size_t          size;
+    LXFastaIndexPtr index;
+
+    /* size is left unchanged if file is not */
+    /* found and set to 0 if file is empty   */
+
+    size = (size_t) -1;
+
+    if ((! (data = LXMapFile(fastaFile, "r", &size))) && (size != 0)) {
+        (void) IO_ERROR();
+        return NULL;
+    }
+
+    if (! (index = sNewIndex())) {
+        (void) MEMORY_ERROR();
+        if (data) (void) LXUnmapFile(data, size);
+        return NULL;
+    }
+
+    if (! sIndexData(index, data, (data ? size : 0))) {
+        errno = 0;      /* not a system error */
+        (void) FIO_ERROR("fasta file cannot be indexed (lines of different lengths ?)");
+        if (data) (void) LXUnmapFile(data, size);
+        return LXFastaCloseIndex(index);
+    }
+
+    if (data)
+        (void) LXUnmapFile(data, size);
+
+    if (! sSortEntries(index)) {
+        (void) MEMORY_ERROR();
+        return LXFastaCloseIndex(index);
+    }
+
+    return index;
+}
+
+/* -------------------------------------------- */
+/* read .fai index file                         */
+/* -------------------------------------------- */
+LXFastaIndexPtr LXFastaReadIndex(const char *indexFile)
+{
+    FILE              *stream;
+    String            buffer;
+    char              *tab;
+    long long         length, offset;
+    int               lineBases, lineBytes;
+    Bool              eof;
+    LXFastaIndexEntry *entry;
+    LXFastaIndexPtr   index;
+
+    if (! (stream = LXOpenFile(indexFile, "r"))) {
+        (void) IO_ERROR();
+        return NULL;
+    }
+
+    if (! (index = sNewIndex())) {
+        (void) MEMORY_ERROR();
+        (void) fclose(stream);
+        return NULL;
+    }
+
+    buffer = NULL;
+
+    while (LXReadStr(stream, &buffer) >= 0) {
+
+        if (! *buffer)
+            continue;
+
+        if (   (! (tab = strchr(buffer, '\t')))
+            || (sscanf(tab + 1, "%lld %lld %d %d", &length, &offset,
+                                &lineBases, &lineBytes) != 4)) {
+            errno = 0;
+            (void) FIO_ERROR("bad fasta index line");
+            break;
+        }
+
+        *tab = '\000';
+
+        if (! (   (entry = sAddEntry(index))
+               && (entry->name = LXStr(buffer)))) {
+            (void) MEMORY_ERROR();
+            break;
+        }
+
+        entry->length    = (Int64) length;
+        entry->offset    = (Int64) offset;
+        entry->lineBases = (Int32) lineBases;
+        entry->lineBytes = (Int32) lineBytes;
+    }
+
+    eof = feof(stream);
+
+    IFFREE(buffer);
+
+    (void) fclose(stream);
+
+    if (! (eof && sSortEntries(index)))
+        return LXFastaCloseIndex(index);
+
+    return index;
+}
+
+/* -------------------------------------------- */
+/* write index in .fai format                   */
+/* -------------------------------------------- */
+int LXFastaWriteIndex(FILE *streamou, LXFastaIndexPtr index)
+{
+    Int32             i;
+    LXFastaIndexEntry *entry;
+
+    for (i = 0, entry = index->entry ; i < index->nbEntries ; i++, entry++) {
+        if (fprintf(streamou, "%s\t%lld\t%lld\t%d\t%d\n", entry->name,
+                              (long long) entry->length,
+                              (long long) entry->offset,
+                              (int) entry->lineBases,
+                              (int) entry->lineBytes) < 0)
+            return IO_ERROR();
+    }
+
+    return LX_NO_ERROR;
+}
+
+/* -------------------------------------------- */
+/* open indexed fasta file                      */
+/* -------------------------------------------- */
+LXFastaIndexPtr LXFastaOpenIndex(const char *fastaFile)
+{
+    Int32             i;
+    FILE              *stream;
+    struct stat       fastaInfo, indexInfo;
+    LXFastaIndexEntry *entry;
+    LXFastaIndexPtr   index;
+
+    char indexFile[BUFSIZ + sizeof(INDEX_SUFFIX)];
+
+    if (strlen(fastaFile) >= BUFSIZ) {
+        (void) ARG_ERROR();
+        return NULL;
+    }
+
+    (void) sprintf(indexFile, "%s%s", fastaFile, INDEX_SUFFIX);
+
+    /* ---------------------------------- */
+    /* get up to date index or build it   */
+
+    index = NULL;
+
+    if (   (stat(fastaFile, &fastaInfo) == 0)
+        && (stat(indexFile, &indexInfo) == 0)
+        && (indexInfo.st_mtime >= fastaInfo.st_mtime))
+        index = LXFastaReadIndex(indexFile);
+
+    if (! index) {
+
+        if (! (index = LXFastaBuildIndex(fastaFile)))
+            return NULL;
+
+        if ((stream = fopen(indexFile, "w"))) {  /* not an error if */
+            (void) LXFastaWriteIndex(stream, index); /* read only   */
+            (void) fclose(stream);
+        }
+    }
+
+    /* ---------------------------------- */
+    /* map fasta file                     */
+
+    if (index->nbEntries == 0)
+        return index;
+
+    if (! (index->data = LXMapFile(fastaFile, "r", &index->dataSize))) {
+        (void) IO_ERROR();
+        return LXFastaCloseIndex(index);
+    }
+
+    for (i = 0, entry = index->entry ; i < index->nbEntries ; i++, entry++) {
+        if (   (entry->offset < 0)
+            || ((entry->length > 0) && (entry->lineBases <= 0))
+            || ((entry->length > 0) &&
+                (sSymbolOffset(entry, entry->length - 1) >= (Int64) index->dataSize))) {
+            errno = 0;
+            (void) FIO_ERROR("fasta index does not match fasta file");
+            return LXFastaCloseIndex(index);
+        }
+    }
+
+    return index;
+}
+
+/* -------------------------------------------- */
+/* lookup entry by name                         */
+/* -------------------------------------------- */
+Int32 LXFastaIndexLookup(LXFastaIndexPtr index, const char *name)
+{
+    Int32 low, high, mid;
+
+    low  = 0;
+    high = index->nbEntries;
+
+    while (low < high) {            /* first entry >= name  */
+        mid = low + (high - low) / 2;
+        if (strcmp(index->entry[index->order[mid]].name, name) < 0)
+            low = mid + 1;
+        else
+            high = mid;
+    }
+
+    if (   (low < index->nbEntries)
+        && (! strcmp(index->entry[index->order[low]].name, name)))
+        return index->order[low];
+
+    return -1;
+}
+
+/* -------------------------------------------- */
+/* zero copy view of range                      */
+/* -------------------------------------------- */
+const char *LXFastaIndexView(LXFastaIndexPtr index, Int32 ientry,
+                             Int64 from, Int64 length, size_t *nbytes)
+{
+    Int64             start;
+    LXFastaIndexEntry *entry;
+
+    if (! sClipRange(index, ientry, from, &length))
+        return NULL;
+
+    entry = index->entry + ientry;
+
+    start = sSymbolOffset(entry, from);
+
+    *nbytes = (length > 0 ? (size_t) (sSymbolOffset(entry, from + length - 1) + 1 - start)
+                          : 0);
+
+    return index->data + start;
+}
+
+/* -------------------------------------------- */
+/* copy range (without end of lines)            */
+/* -------------------------------------------- */
+Int64 LXFastaIndexGetRange(LXFastaIndexPtr index, Int32 ientry,
+                           Int64 from, Int64 length, char *buffer)
+{
+    Int64             n, chunk;
+    LXFastaIndexEntry *entry;
+
+    if (! sClipRange(index, ientry, from, &length))
+        return -1;
+
+    entry = index->entry + ientry;
+
+    for (n = 0 ; n < length ; n += chunk) {
+        chunk = MIN(length - n, entry->lineBases - ((from + n) % entry->lineBases));
+        (void) memcpy(buffer + n, index->data + sSymbolOffset(entry, from + n), chunk);
+    }
+
+    buffer[length] = '\000';
+
+    return length;
+}
+
+/* -------------------------------------------- */
+/* get whole sequence                           */
+/* -------------------------------------------- */
+Bool LXFastaIndexGetSequence(LXFastaIndexPtr index, Int32 ientry,
+                             LXFastaSequencePtr seq)
+{
+    LXFastaIndexEntry *entry;
+
+    seq->ok = FALSE;                        /* assume error         */
+
+    if ((! index->data) || (ientry < 0) || (ientry >= index->nbEntries))
+        return FALSE;
+
+    entry = index->entry + ientry;
+
+    if (entry->length >= LXAllocSize(seq->seq)) {
+        IFFREE(seq->seq);
+        if (! (seq->seq = LXNewStr(entry->length + 1)))
+            return FALSE;
+    }
+
+    if (! (   (seq->name    = LXStrcpy(seq->name, entry->name))
+           && (seq->comment = sGetComment(index, entry, seq->comment))))
+        return FALSE;
+
+    seq->offset = (long) sHeaderOffset(index, entry);
+
+    seq->length = LXFastaIndexGetRange(index, ientry, 0, entry->length, seq->seq);
+
+    return (seq->ok = (seq->length >= 0));
+}
@@ -0,0 +1,67 @@
+/* test Fasta index */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "LX/LXString.h"
+#include "LX/LXFasta.h"
+
+/* ----------------------------------------------- */
+
+main(argn, argv)
+	int  argn;
+	char *argv[];
+{
+	Int32           i, nbbad;
+	Int64           from, len;
+	size_t          nbytes;
+	const char      *view;
+	char            *buffer;
+	LXFastaIndexPtr index;
+	LXFastaSequence *seq;
+
+	if (! (index = LXFastaOpenIndex(argv[1])))
+	    LX_ERROR("fasta index", LX_IO_ERROR);
+
+	(void) LXFastaWriteIndex(stdout, index);
+
+	seq = LXFastaNewSequence(0);
+
+	nbbad = 0;
+
+	for (i = 0 ; i < index->nbEntries ; i++) {
+
+	    if (LXFastaIndexLookup(index, index->entry[i].name) != i)
+	        nbbad++;
+
+	    if (! LXFastaIndexGetSequence(index, i, seq))
+	        LX_ERROR("fasta indexed sequence", LX_IO_ERROR);
+
+	    LXFastaWriteSequence(stdout, seq, LX_FASTA_CHARS_PER_LINE);
+
+	    /* ranges across lines */
+
+	    buffer = LXNewStr(seq->length + 1);
+
+	    for (from = 0 ; from < seq->length ; from += 37) {
+	        len = LXFastaIndexGetRange(index, i, from, 101, buffer);
+	        if (strncmp(buffer, seq->seq + from, len) || (len != MIN(101, seq->length - from)))
+	            nbbad++;
+	        view = LXFastaIndexView(index, i, from, 1, &nbytes);
+	        if ((nbytes != 1) || (*view != seq->seq[from]))
+	            nbbad++;
+	    }
+
+	    FREE(buffer);
+	}
+
+	printf("lookup unknown = %d\n", LXFastaIndexLookup(index, "unknown"));
+	printf("total seq = %d bad = %d\n", index->nbEntries, nbbad);
+
+	LXFastaFreeSequence(seq);
+
+	(void) LXFastaCloseIndex(index);
+
+	exit(0);
+}
@@ -11,6 +11,7 @@
  * @+ <Gloup> : Jan 10 : binary output changed to little endian
  * @+ <Gloup> : Mar 10 : time functions added
  * @+ <Gloup> : Mar 10 : debug notification added
+ * @+ <Gloup> : Oct 26 : peak memory added
  * -----------------------------------------------------------------------
  * @docstart:
  *
@@ -34,6 +35,9 @@
 #include <sys/types.h>
 #include <sys/time.h>
 #include <sys/sysctl.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
 #endif
 
 #if defined (LX_TARGET_MACOSX) || defined(LX_TARGET_MACINTEL)
@@ -332,6 +336,29 @@ size_t LXGetUsedMemory() {
 
 }
 
+size_t LXGetPeakMemory() {
+
+#if defined(LX_OS_UNIX)
+
+  struct rusage rusage;
+
+  if (getrusage(RUSAGE_SELF, &rusage) != 0)
+    return 0;
+
+#if defined (LX_TARGET_MACOSX) || defined(LX_TARGET_MACINTEL)
+  return (size_t) rusage.ru_maxrss;           /* bytes     */
+#else
+  return (size_t) rusage.ru_maxrss * 1024;    /* kilobytes */
+#endif
+
+#else
+
+  return 0;
+
+#endif
+
+}
+
 /* ==================================================== */
 /* file manipulations                                   */
 /* ==================================================== */
@@ -472,6 +499,92 @@ int LXCloseTmpFile(LXTmpFile *tmpFile)
   return (err ? err : LXRemoveFile(tmpFile->fileName));
 }
 
+/* -------------------------------------------- */
+/* map a file into memory                       */
+/* wrapper to mmap(2)                           */
+/* -------------------------------------------- */
+
+void *LXMapFile(const char *filename, const char *mode, size_t *size)
+{
+  void *addr = NULL;
+  
+  LXSetupIO(filename);
+
+#ifdef LX_OS_UNIX
+
+  int  desc;
+  struct stat info;
+  Bool writable = (*mode == 'w');
+  
+  desc = writable ? open(filename, O_RDWR | O_CREAT, 0666)
+                  : open(filename, O_RDONLY);
+
+  if (desc == -1)
+    return NULL;
+
+  if (writable) {
+    if (ftruncate(desc, (off_t) *size) != 0) {
+      (void) close(desc);
+      return NULL;
+    }
+  }
+  else if (fstat(desc, &info) == 0) {
+    *size = (size_t) info.st_size;
+  }
+  else {
+    (void) close(desc);
+    return NULL;
+  }
+  
+  if (*size > 0) {
+    addr = mmap(NULL, *size, (writable ? PROT_READ | PROT_WRITE : PROT_READ),
+                (writable ? MAP_SHARED : MAP_PRIVATE), desc, 0);
+    if (addr == MAP_FAILED)
+      addr = NULL;
+  }
+  
+  (void) close(desc);
+  
+#else
+
+  // no mmap : load the whole file in memory (read only)
+
+  FILE *stream;
+  
+  if ((*mode == 'r') && (stream = LXOpenFile(filename, "rb"))) {
+    *size = (size_t) LXTellEOF(stream);
+    if ((*size > 0) && (addr = LXMalloc(*size))) {
+      if (fread(addr, 1, *size, stream) != *size) {
+        LXFree(addr);
+        addr = NULL;
+      }
+    }
+    (void) fclose(stream);
+  }
+  
+#endif
+
+  return addr;
+}
+
+/* -------------------------------------------- */
+/* unmap a file                                 */
+/* wrapper to munmap(2)                         */
+/* -------------------------------------------- */
+
+int LXUnmapFile(void *addr, size_t size)
+{
+  if (! addr)
+    return LX_ARG_ERROR;
+
+#ifdef LX_OS_UNIX
+  return (munmap(addr, size) == 0 ? LX_NO_ERROR : LX_IO_ERROR);
+#else
+  LXFree(addr);
+  return LX_NO_ERROR;
+#endif
+}
+
 /* -------------------------------------------- */
 /* read one line in file                        */
 /* wrapper to fgets(2)                          */
@@ -13,6 +13,8 @@ main() {
 
   LXTmpFile tmpfile;
   int err;
+  char *map;
+  size_t size;
   
   LXOpenTmpFile(&tmpfile);
 
@@ -25,5 +27,30 @@ main() {
   if (err != LX_NO_ERROR)
     IO_ERROR();
 
+  /* memory mapped files */
+
+  size = strlen("output mapped");
+
+  if (! (map = LXMapFile("test_fil.bak", "w", &size)))
+    exit(IO_ERROR());
+
+  (void) memcpy(map, "output mapped", size);
+
+  (void) LXUnmapFile(map, size);
+
+  size = 0;
+
+  if (! (map = LXMapFile("test_fil.bak", "r", &size)))
+    exit(IO_ERROR());
+
+  fprintf(stderr, ">%.*s<\n", (int) size, map);
+
+  if ((size != strlen("output mapped")) || strncmp(map, "output mapped", size))
+    exit(IO_ERROR());
+
+  (void) LXUnmapFile(map, size);
+
+  (void) LXRemoveFile("test_fil.bak");
+
   exit(0);  
 }
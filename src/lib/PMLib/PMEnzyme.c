@@ -7,6 +7,8 @@
  * @history:
  * @+ <Wanou> : Jan 02 : first version 
  * @+ <Gloup> : Jul 06 : code cleanup
+ * @+ <Gloup> : Oct 26 : cleavage maps
+ * @+ <Gloup> : Oct 26 : cleavage maps filled on positions ranges
  * -----------------------------------------------------------------------
  * @docstart:
  *
@@ -15,6 +17,7 @@
  * @docend:
  */
 
+#include <ctype.h>
 #include <string.h>
 
 #include "PM/PMSys.h"
@@ -22,6 +25,8 @@
 
 #define LOCAL_ERROR(msg, enz) sIOError(__FILE__, __LINE__, msg, enz)
 
+#define WORD_BITS 64
+
 static char *sCurrentLine = NULL;
 
 /* -------------------------------------------- */
@@ -56,6 +61,95 @@ static char *sNextLine(FILE *streamin)
 }
 
 
+/* -------------------------------------------- */
+/* check if regexp (part) is a single residue   */
+/* matcher, i.e. a letter or a [...] class      */
+/* -------------------------------------------- */
+
+static Bool sIsSingleAtom(const char *exp, size_t len)
+{
+  if (len == 1)
+    return isalpha(exp[0]);
+
+  return    (len >= 3)
+         && (exp[0] == '[')
+         && (exp[len - 1] == ']')
+         && (! memchr(exp + 1, ']', len - 2));
+}
+
+/* -------------------------------------------- */
+/* compile cut site into residue tables if      */
+/* regexps are "x$" and "^y", x and y matching  */
+/* a single residue. tables are filled by the   */
+/* regexp engine itself, so they have the same  */
+/* semantic as the regexps                      */
+/* -------------------------------------------- */
+
+static void sCompileCutSite(PMCutSite *site)
+{
+  int    c;
+  char   buffer[2];
+  size_t nlen = strlen(site->NCut);
+  size_t clen = strlen(site->CCut);
+
+  site->isSimple =    (site->NCutOffset >= 1)
+                   && (nlen >= 2) && (site->NCut[nlen - 1] == '$') 
+                   && sIsSingleAtom(site->NCut, nlen - 1)
+                   && (clen >= 2) && (site->CCut[0] == '^') 
+                   && sIsSingleAtom(site->CCut + 1, clen - 1);
+
+  if (! site->isSimple)
+    return;
+
+  buffer[0] = buffer[1] = '\000';
+
+  site->NCutEmpty = (LXRegExec(site->NCutRegExp, buffer, TRUE) != 0);
+
+  site->NCutTable[0] = site->CCutTable[0] = 0;
+
+  for (c = 1 ; c < 256 ; c++) {
+    buffer[0] = (char) c;
+    site->NCutTable[c] = (LXRegExec(site->NCutRegExp, buffer, TRUE) != 0);
+    site->CCutTable[c] = (LXRegExec(site->CCutRegExp, buffer, TRUE) != 0);
+  }
+}
+
+/* -------------------------------------------- */
+/* general (regexp) check of cut site between   */
+/* residues pos-1 and pos                       */
+/* the N side of the site is copied to a local  */
+/* buffer to leave the sequence unchanged       */
+/* -------------------------------------------- */
+
+static Bool sMatchCutSite(PMCutSite *site, char *seq, Int64 pos)
+{
+  char  nSite[BUFSIZ];
+  Int64 offset = MAX(pos - site->NCutOffset, 0);
+  Int64 len    = MIN(pos - offset, BUFSIZ - 1);
+
+  (void) memcpy(nSite, seq + pos - len, len);
+  nSite[len] = '\000';
+
+  return    LXRegExec(site->NCutRegExp, nSite, TRUE)
+         && LXRegExec(site->CCutRegExp, seq + pos, TRUE);
+}
+
+/* -------------------------------------------- */
+/* count bits in word                           */
+/* -------------------------------------------- */
+
+static int sPopCount(UInt64 word)
+{
+#ifdef __GNUC__
+  return __builtin_popcountll(word);
+#else
+  int n;
+  for (n = 0 ; word ; n++)
+    word &= word - 1;
+  return n;
+#endif
+}
+
 /* -------------------------------------------- */
 /* IO funcs                                     */
 /* -------------------------------------------- */
@@ -103,6 +197,8 @@ int PMReadEnzyme(FILE *streamin, PMEnzyme *enzyme)
 
     if (! (site->NCutRegExp && site->CCutRegExp))
       return LOCAL_ERROR("invalid cut site regexp", enzyme->name);
+
+    sCompileCutSite(site);
   }
 
   /* ------------------ */
@@ -156,3 +252,177 @@ void PMDebugEnzyme(FILE *streamou, PMEnzyme *enzyme)
     }
     fprintf(streamou, "//\n");
 }
+
+/* -------------------------------------------- */
+/* cleavage map funcs                           */
+/* -------------------------------------------- */
+
+/* ---------------------------------------------------- */
+/* new cleavage map                                     */
+/* ---------------------------------------------------- */
+
+PMCleavageMap *PMNewCleavageMap()
+{
+  PMCleavageMap *map;
+
+  if (! (map = NEW(PMCleavageMap))) {
+    MEMORY_ERROR();
+    return NULL;
+  }
+
+  map->length = 0;
+  map->size   = 0;
+  map->bits   = NULL;
+
+  return map;
+}
+
+/* ---------------------------------------------------- */
+/* free cleavage map                                    */
+/* ---------------------------------------------------- */
+
+PMCleavageMap *PMFreeCleavageMap(PMCleavageMap *map)
+{
+  if (map) {
+    if (map->bits)
+      FREE(map->bits);
+    FREE(map);
+  }
+
+  return NULL;
+}
+
+/* ---------------------------------------------------- */
+/* resize cleavage map to sequence length               */
+/* ---------------------------------------------------- */
+
+static int sResizeMap(PMCleavageMap *map, Int64 length)
+{
+  Int64 size = MAX(1, (length + WORD_BITS - 1) / WORD_BITS);
+
+  if (size > map->size) {
+    if (! (map->bits = (map->bits ? REALLOC(map->bits, UInt64, size)
+                                  : NEWN(UInt64, size))))
+      return MEMORY_ERROR();
+    map->size = size;
+  }
+
+  map->length = length;
+
+  return LX_NO_ERROR;
+}
+
+/* ---------------------------------------------------- */
+/* set cleavage bits of positions [from, to[            */
+/* (bits are supposed to be cleared)                    */
+/* ---------------------------------------------------- */
+
+static void sFillSites(PMCleavageMap *map, PMEnzyme *enzyme, char *seq,
+                       Int64 from, Int64 to)
+{
+  int   i;
+  Int64 pos;
+  Bool  cut;
+
+  for (i = 0 ; i < enzyme->nbCuts ; i++) {
+
+    PMCutSite *site = enzyme->cutSite + i;
+
+    for (pos = from ; pos < to ; pos++) {
+
+      if (site->isSimple)
+        cut =    (pos ? site->NCutTable[(UInt8) seq[pos - 1]] : site->NCutEmpty)
+              && site->CCutTable[(UInt8) seq[pos]];
+      else
+        cut = sMatchCutSite(site, seq, pos);
+
+      if (cut)
+        map->bits[pos / WORD_BITS] |= ((UInt64) 1 << (pos % WORD_BITS));
+    }
+  }
+}
+
+/* ---------------------------------------------------- */
+/* compute cleavage map of sequence                     */
+/* ---------------------------------------------------- */
+
+int PMFillCleavageMap(PMCleavageMap *map, PMEnzyme *enzyme, char *seq, Int64 length)
+{
+  if (sResizeMap(map, length) != LX_NO_ERROR)
+    return LX_MEM_ERROR;
+
+  (void) memset(map->bits, 0, map->size * sizeof(UInt64));
+
+  sFillSites(map, enzyme, seq, 0, length);
+
+  return LX_NO_ERROR;
+}
+
+/* ---------------------------------------------------- */
+/* compute cleavage map of sequence on [from, to[       */
+/* ---------------------------------------------------- */
+
+int PMFillCleavageMapRange(PMCleavageMap *map, PMEnzyme *enzyme, char *seq, Int64 length,
+                           Int64 from, Int64 to)
+{
+  Int64 pos;
+
+  if ((length != map->length) && (sResizeMap(map, length) != LX_NO_ERROR))
+    return LX_MEM_ERROR;
+
+  from = MAX(from, 0);
+  to   = MIN(to, length);
+
+  for (pos = from ; pos < to ; pos++)
+    map->bits[pos / WORD_BITS] &= ~((UInt64) 1 << (pos % WORD_BITS));
+
+  sFillSites(map, enzyme, seq, from, to);
+
+  return LX_NO_ERROR;
+}
+
+/* ---------------------------------------------------- */
+/* check cleavage site at position                      */
+/* ---------------------------------------------------- */
+
+Bool PMHasCleavage(PMCleavageMap *map, Int64 pos)
+{
+  if ((pos < 0) || (pos >= map->length))
+    return FALSE;
+
+  return ((map->bits[pos / WORD_BITS] >> (pos % WORD_BITS)) & 1) != 0;
+}
+
+/* ---------------------------------------------------- */
+/* count cleavage sites in [from, to]                   */
+/* ---------------------------------------------------- */
+
+Int64 PMCountCleavages(PMCleavageMap *map, Int64 from, Int64 to)
+{
+  Int64  w, wfrom, wto, count;
+  UInt64 word;
+
+  from = MAX(from, 0);
+  to   = MIN(to, map->length - 1);
+
+  if (from > to)
+    return 0;
+
+  wfrom = from / WORD_BITS;
+  wto   = to   / WORD_BITS;
+
+  for (w = wfrom, count = 0 ; w <= wto ; w++) {
+
+    word = map->bits[w];
+
+    if (w == wfrom)
+      word &= ~(UInt64) 0 << (from % WORD_BITS);
+
+    if ((w == wto) && ((to % WORD_BITS) != WORD_BITS - 1))
+      word &= ((UInt64) 1 << ((to % WORD_BITS) + 1)) - 1;
+
+    count += sPopCount(word);
+  }
+
+  return count;
+}
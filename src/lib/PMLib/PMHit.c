@@ -8,6 +8,7 @@
  * @+ <Wanou> : Dec 01 : first version
  * @+ <Gloup> : Mar 06 : code cleanup
  * @+ <Gloup> : Jan 10 : 64 bits polish
+ * @+ <Gloup> : Oct 26 : binary io fixed (64 bits positions, no seek)
  * -----------------------------------------------------------------------
  * @docstart: 
  *
@@ -239,81 +240,74 @@ int  PMWriteHit(FILE *streamou, PMHit *hit) {
 }
 
 /* -------------------------------------------- */
-/* binary IO (unused)                           */
+/* binary IO                                    */
+/* note: positions are Int64                    */
+/* sizes are computed (not LXTell'ed) so that   */
+/* these work on non seekable streams too       */
 /* -------------------------------------------- */
 
+#define BIN_HIT_SIZE   (4 * sizeof(Int32) + 4 * sizeof(Int64) \
+                        + 2 * sizeof(Int64) + sizeof(float))
+
 int PMBinWriteHit(FILE *streamou, PMHit *hit) {
-  long  initpos;
-  Int32 val32;
-  Int64 val64;
   char  *pepSeq, *pepMatch;
 
-  initpos   = LXTell(streamou);
-  
   pepSeq    = (hit->pepSeq   ? hit->pepSeq : "");
   pepMatch  = (hit->pepMatch ? hit->pepMatch : "");
 
-  val32 = (Int32) hit->type;
-  if (LXBinWriteInt32(streamou, val32)         != 1) IO_ERROR();
-  val64 = (Int64) hit->posMn;
-  if (LXBinWriteInt32(streamou, val64)         != 1) IO_ERROR();
-  val64 = (Int64) hit->posMc;
-  if (LXBinWriteInt32(streamou, val64)         != 1) IO_ERROR();
-  val64 = (Int64) hit->posSn;
-  if (LXBinWriteInt32(streamou, val64)         != 1) IO_ERROR();
-  val64 = (Int64) hit->posSc;
-  if (LXBinWriteInt32(streamou, val64)         != 1) IO_ERROR();
+  if (LXBinWriteInt32(streamou, (Int32) hit->type)  != 1) return -IO_ERROR();
+  if (LXBinWriteInt64(streamou, (Int64) hit->posMn) != 1) return -IO_ERROR();
+  if (LXBinWriteInt64(streamou, (Int64) hit->posMc) != 1) return -IO_ERROR();
+  if (LXBinWriteInt64(streamou, (Int64) hit->posSn) != 1) return -IO_ERROR();
+  if (LXBinWriteInt64(streamou, (Int64) hit->posSc) != 1) return -IO_ERROR();
   
-  if (LXBinWriteStr(streamou, pepSeq)          <= 0) IO_ERROR();
-  if (LXBinWriteStr(streamou, pepMatch)        <= 0) IO_ERROR();
+  if (LXBinWriteStr(streamou, pepSeq)          <= 0) return -IO_ERROR();
+  if (LXBinWriteStr(streamou, pepMatch)        <= 0) return -IO_ERROR();
 
-  if (LXBinWriteInt32(streamou, hit->nbMis)    != 1) IO_ERROR();
-  if (LXBinWriteInt32(streamou, hit->nbOver)   != 1) IO_ERROR();
-  if (LXBinWriteInt32(streamou, hit->nbMod)    != 1) IO_ERROR();
-  if (LXBinWriteFloat(streamou, hit->score)    != 1) IO_ERROR();
+  if (LXBinWriteInt32(streamou, hit->nbMis)    != 1) return -IO_ERROR();
+  if (LXBinWriteInt32(streamou, hit->nbOver)   != 1) return -IO_ERROR();
+  if (LXBinWriteInt32(streamou, hit->nbMod)    != 1) return -IO_ERROR();
+  if (LXBinWriteFloat(streamou, hit->score)    != 1) return -IO_ERROR();
   
-  return (int) (LXTell(streamou) - initpos);
+  return (int) (BIN_HIT_SIZE + strlen(pepSeq) + strlen(pepMatch) + 2);
 }
 
 /* -------------------------------------------- */
 
 int PMBinReadHit (FILE *streamin, PMHit *hit)
 {
-  long  initpos;
   Int32 val32;
   Int64 val64;
   char  buffer[BUFSIZ];
+  size_t nread;
 
-  initpos = LXTell(streamin);
-
-  if (LXIsEOF(streamin)) return EOF;
-
-  if (LXBinReadInt32(streamin, &val32)           != 1) IO_ERROR();
+  if (LXBinReadInt32(streamin, &val32)           != 1) 
+    return (feof(streamin) ? EOF : -IO_ERROR());
   hit->type = val32;
 
-  if (LXBinReadInt64(streamin, &val64)          != 1) IO_ERROR();
+  if (LXBinReadInt64(streamin, &val64)          != 1) return -IO_ERROR();
   hit->posMn = val64;
-  if (LXBinReadInt64(streamin, &val64)          != 1) IO_ERROR();
+  if (LXBinReadInt64(streamin, &val64)          != 1) return -IO_ERROR();
   hit->posMc = val64;
-  if (LXBinReadInt64(streamin, &val64)          != 1) IO_ERROR();
+  if (LXBinReadInt64(streamin, &val64)          != 1) return -IO_ERROR();
   hit->posSn = val64;
-  if (LXBinReadInt64(streamin, &val64)          != 1) IO_ERROR();
+  if (LXBinReadInt64(streamin, &val64)          != 1) return -IO_ERROR();
   hit->posSc = val64;
 
-  if (LXBinReadStr(streamin, buffer)            <= 0) IO_ERROR();
+  if ((nread = LXBinReadStr(streamin, buffer))  <= 0) return -IO_ERROR();
   hit->pepSeq = LXStr(buffer);
 
-  if (LXBinReadStr(streamin, buffer)            <= 0) IO_ERROR();
+  if ((nread += LXBinReadStr(streamin, buffer)) <= 0) return -IO_ERROR();
   hit->pepMatch = LXStr(buffer);
   
-  if (LXBinReadInt32(streamin, &(hit->nbMis))   != 1) IO_ERROR();
-  if (LXBinReadInt32(streamin, &(hit->nbOver))  != 1) IO_ERROR();
-  if (LXBinReadInt32(streamin, &(hit->nbMod))   != 1) IO_ERROR();
-  if (LXBinReadFloat(streamin, &(hit->score))   != 1) IO_ERROR();
+  if (LXBinReadInt32(streamin, &(hit->nbMis))   != 1) return -IO_ERROR();
+  if (LXBinReadInt32(streamin, &(hit->nbOver))  != 1) return -IO_ERROR();
+  if (LXBinReadInt32(streamin, &(hit->nbMod))   != 1) return -IO_ERROR();
+  if (LXBinReadFloat(streamin, &(hit->score))   != 1) return -IO_ERROR();
 
   (void) sCheckHit(hit);
   
-  return (int) (LXTell(streamin) - initpos);
+  return (int) (BIN_HIT_SIZE + nread);
 }
 
 /* -------------------------------------------- */
@@ -0,0 +1,624 @@
+/* -----------------------------------------------------------------------
+ * $Id: PMHitFile.c $
+ * -----------------------------------------------------------------------
+ * @file: PMHitFile.c
+ * @desc: hit files
+ *
+ * @history:
+ * @+ <Gloup> : Oct 26 : first version
+ * @+ <Gloup> : Oct 26 : file indexes of last block read
+ * @+ <Gloup> : Oct 26 : hit sinks (in memory blocks of hits)
+ * @+ <Gloup> : Oct 26 : seqId comment separator dropped when read
+ * -----------------------------------------------------------------------
+ * @docstart:
+ *
+ * hit files library<br>
+ * see PMHitFile.h for formats description
+ *
+ * @docend:
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "PM/PMSys.h"
+#include "PM/PMHitFile.h"
+
+/* record types */
+
+#define REC_SEQID   'S'
+#define REC_TAG     'T'
+#define REC_HITS    'H'
+
+/* initial size of dictionaries */
+
+#define MIN_ENTRIES 64
+
+static const char *sFormatName[] = {"text", "compact", "binary"};
+
+/* ---------------------------------------------------- */
+/* @static: make sure *array can hold index            */
+/* new entries of maps are set to -1                    */
+/* ---------------------------------------------------- */
+
+static Bool sAssertMap(Int32 **map, Int32 *size, Int32 index)
+{
+  Int32 i, newSize;
+
+  if (index < *size)
+    return TRUE;
+
+  newSize = MAX(MIN_ENTRIES, 2 * *size);
+  newSize = MAX(newSize, index + 1);
+
+  if (! (*map = (*map ? REALLOC(*map, Int32, newSize) : NEWN(Int32, newSize))))
+    return FALSE;
+
+  for (i = *size ; i < newSize ; i++)
+    (*map)[i] = -1;
+
+  *size = newSize;
+
+  return TRUE;
+}
+
+/* ---------------------------------------------------- */
+/* @static: make sure reader dictionaries can hold      */
+/* entry #index                                         */
+/* ---------------------------------------------------- */
+
+static Bool sAssertSeqIds(PMHitFile *hitFile, Int32 index)
+{
+  Int32 newSize;
+
+  if (index < hitFile->maxSeqIds)
+    return TRUE;
+
+  newSize = MAX(MIN_ENTRIES, 2 * index);
+
+  if (! (hitFile->seqIds = (hitFile->seqIds
+                            ? REALLOC(hitFile->seqIds, PMSeqId, newSize)
+                            : NEWN(PMSeqId, newSize))))
+    return FALSE;
+
+  hitFile->maxSeqIds = newSize;
+
+  return TRUE;
+}
+
+static Bool sAssertTags(PMHitFile *hitFile, Int32 index)
+{
+  Int32 newSize;
+
+  if (index < hitFile->maxTags)
+    return TRUE;
+
+  newSize = MAX(MIN_ENTRIES, 2 * index);
+
+  if (! (hitFile->tags = (hitFile->tags
+                          ? REALLOC(hitFile->tags, PMTag, newSize)
+                          : NEWN(PMTag, newSize))))
+    return FALSE;
+
+  hitFile->maxTags = newSize;
+
+  return TRUE;
+}
+
+/* ---------------------------------------------------- */
+/* @static: new hitFile                                 */
+/* ---------------------------------------------------- */
+
+static PMHitFile *sNewHitFile(FILE *stream)
+{
+  PMHitFile *hitFile;
+
+  if (! (hitFile = NEW(PMHitFile))) {
+    MEMORY_ERROR();
+    return NULL;
+  }
+
+  (void) memset(hitFile, 0, sizeof(PMHitFile));
+
+  hitFile->stream = stream;
+  hitFile->format = PMHitFileText;
+  hitFile->isid   = -1;
+  hitFile->itag   = -1;
+
+  if (! (hitFile->buffer = NEWN(char, PM_HITFILE_BUFSIZ))) {
+    MEMORY_ERROR();
+    FREE(hitFile);
+    return NULL;
+  }
+
+  (void) setvbuf(stream, hitFile->buffer, _IOFBF, PM_HITFILE_BUFSIZ);
+
+  return hitFile;
+}
+
+/* ---------------------------------------------------- */
+/* @static: copy hit into current block of sink         */
+/* score is rounded as in text format                   */
+/* ---------------------------------------------------- */
+
+static int sSinkHit(PMHitFile *hitFile, PMHit *hit)
+{
+  PMHit *copy;
+  char  buffer[BUFSIZ];
+
+  if (! (copy = PMNewHit()))
+    return LX_MEM_ERROR;
+
+  *copy = *hit;
+
+  copy->tag      = NULL;
+  copy->pepSeq   = LXStr(hit->pepSeq);
+  copy->pepMatch = LXStr(hit->pepMatch);
+
+  (void) sprintf(buffer, "%f", hit->score);
+  (void) sscanf(buffer, "%f", &copy->score);
+
+  if (! (copy->pepSeq && copy->pepMatch && LXPushpIn(hitFile->block, (Ptr) copy))) {
+    (void) PMFreeHit(copy);
+    return MEMORY_ERROR();
+  }
+
+  return LX_NO_ERROR;
+}
+
+/* ---------------------------------------------------- */
+/* @static: hand current block over to sink             */
+/* ---------------------------------------------------- */
+
+static int sSinkBlock(PMHitFile *hitFile)
+{
+  int   stat;
+  PMHit *hit;
+
+  stat = hitFile->sink(hitFile->sinkArg, hitFile->blockIsid, hitFile->blockSeqId,
+                       hitFile->blockItag, hitFile->blockTag, hitFile->block);
+
+  while (LXPoppOut(hitFile->block, (Ptr *) &hit))
+    (void) PMFreeHit(hit);
+
+  return stat;
+}
+
+/* ---------------------------------------------------- */
+/* @static: write record header                         */
+/* ---------------------------------------------------- */
+
+static int sWriteRecord(PMHitFile *hitFile, int type, Int32 i1, Int32 i2, Int32 i3)
+{
+  FILE *stream = hitFile->stream;
+
+  if (hitFile->format == PMHitFileCompact) {
+    int nwrite;
+    if (type == REC_HITS)
+      nwrite = fprintf(stream, "%c%c %d %d %d\n", PM_END_OF_RECORD, type, i1, i2, i3);
+    else
+      nwrite = fprintf(stream, "%c%c %d\n", PM_END_OF_RECORD, type, i1);
+    return ((nwrite <= 0) ? IO_ERROR() : LX_NO_ERROR);
+  }
+
+  if (   (LXBinWriteInt32(stream, (Int32) type) != 1)
+      || (LXBinWriteInt32(stream, i1) != 1))
+    return IO_ERROR();
+
+  if (   (type == REC_HITS)
+      && (   (LXBinWriteInt32(stream, i2) != 1)
+          || (LXBinWriteInt32(stream, i3) != 1)))
+    return IO_ERROR();
+
+  return LX_NO_ERROR;
+}
+
+/* ---------------------------------------------------- */
+/* @static: read record header                          */
+/* ---------------------------------------------------- */
+
+static int sReadRecord(PMHitFile *hitFile, int *type, Int32 *i1, Int32 *i2, Int32 *i3)
+{
+  Int32 val32;
+  char  buffer[BUFSIZ];
+  FILE  *stream = hitFile->stream;
+
+  if (hitFile->format == PMHitFileCompact) {
+
+    if (! LXGetLine(buffer, sizeof(buffer), stream))
+      return LX_EOF;
+
+    *type = buffer[1];
+
+    if (   (*buffer != PM_END_OF_RECORD)
+        || (sscanf(buffer + 2, "%d%d%d", i1, i2, i3) != ((*type == REC_HITS) ? 3 : 1))) {
+      fprintf(stderr, "// IO-Format error at: %s\n", buffer);
+      return IO_ERROR();
+    }
+  }
+  else {
+
+    if (LXBinReadInt32(stream, &val32) != 1)
+      return (feof(stream) ? LX_EOF : IO_ERROR());
+
+    *type = val32;
+
+    if (LXBinReadInt32(stream, i1) != 1)
+      return IO_ERROR();
+
+    if (   (*type == REC_HITS)
+        && (   (LXBinReadInt32(stream, i2) != 1)
+            || (LXBinReadInt32(stream, i3) != 1)))
+      return IO_ERROR();
+  }
+
+  if ((*type != REC_SEQID) && (*type != REC_TAG) && (*type != REC_HITS))
+    return IO_ERROR();
+
+  return LX_NO_ERROR;
+}
+
+/* ---------------------------------------------------- */
+/* @static: read seqId (text or binary)                 */
+/* PMReadSeqId keeps the blank that separates length    */
+/* from comment, that PMWriteSeqId writes again : it is */
+/* dropped here so that seqIds do not grow at each      */
+/* write/read cycle (e.g. conversions)                  */
+/* ---------------------------------------------------- */
+
+static int sReadSeqId(FILE *stream, PMSeqId *seqId, Bool binary)
+{
+  int stat;
+
+  if (binary)
+    stat = ((PMBinReadSeqId(stream, seqId) > 0) ? LX_NO_ERROR : LX_IO_ERROR);
+  else
+    stat = PMReadSeqId(stream, seqId);
+
+  if (stat != LX_NO_ERROR)
+    return stat;
+
+  if (seqId->comment[0] == ' ')
+    (void) memmove(seqId->comment, seqId->comment + 1, strlen(seqId->comment));
+
+  return LX_NO_ERROR;
+}
+
+/* ---------------------------------------------------- */
+/* @static: read block in text format                   */
+/* ---------------------------------------------------- */
+
+static int sReadTextHits(PMHitFile *hitFile, PMSeqId **seqId, PMTag **tag,
+                         PMHitStack *hits)
+{
+  int stat;
+
+  if (! (sAssertSeqIds(hitFile, 0) && sAssertTags(hitFile, 0)))
+    return MEMORY_ERROR();
+
+  if ((stat = sReadSeqId(hitFile->stream, hitFile->seqIds, FALSE)) != LX_NO_ERROR)
+    return stat;
+
+  if ((stat = PMReadTag(hitFile->stream, hitFile->tags)) != LX_NO_ERROR)
+    return stat;
+
+  *seqId = hitFile->seqIds;
+  *tag   = hitFile->tags;
+
+  return PMReadHitStack(hitFile->stream, hits, FALSE);
+}
+
+/* ---------------------------------------------------- */
+/* API                                                  */
+/* ---------------------------------------------------- */
+
+/* ---------------------------------------------------- */
+/* get format from name                                 */
+/* ---------------------------------------------------- */
+
+int PMHitFileFormatFromName(const char *name, PMHitFileFormat *format)
+{
+  int i;
+
+  for (i = PMHitFileText ; i <= PMHitFileBinary ; i++) {
+    if (   (! strcmp(name, sFormatName[i]))
+        || ((name[0] == sFormatName[i][0]) && (name[1] == '\000'))) {
+      *format = (PMHitFileFormat) i;
+      return LX_NO_ERROR;
+    }
+  }
+
+  return ARG_ERROR();
+}
+
+/* ---------------------------------------------------- */
+/* open hit file for writing                            */
+/* ---------------------------------------------------- */
+
+PMHitFile *PMHitFileOpenWrite(FILE *streamou, PMHitFileFormat format)
+{
+  PMHitFile *hitFile;
+
+  if (! (hitFile = sNewHitFile(streamou)))
+    return NULL;
+
+  hitFile->format = format;
+
+  if (   (format != PMHitFileText)
+      && (fprintf(streamou, "%s %d %s\n", PM_HITFILE_MAGIC, PM_HITFILE_VERSION,
+                            sFormatName[format]) <= 0)) {
+    IO_ERROR();
+    return PMHitFileClose(hitFile);
+  }
+
+  return hitFile;
+}
+
+/* ---------------------------------------------------- */
+/* open hit file for reading                            */
+/* ---------------------------------------------------- */
+
+PMHitFile *PMHitFileOpenRead(FILE *streamin)
+{
+  int       c, version, i;
+  char      buffer[BUFSIZ], name[BUFSIZ];
+  PMHitFile *hitFile;
+  size_t    lmagic = strlen(PM_HITFILE_MAGIC);
+
+  if (! (hitFile = sNewHitFile(streamin)))
+    return NULL;
+
+  if ((c = getc(streamin)) == EOF)
+    return hitFile;
+
+  (void) ungetc(c, streamin);
+
+  if (c != PM_END_OF_RECORD)
+    return hitFile;
+
+  if (   (! LXGetLine(buffer, sizeof(buffer), streamin))
+      || strncmp(buffer, PM_HITFILE_MAGIC, lmagic)
+      || (sscanf(buffer + lmagic, "%d%s", &version, name) != 2)
+      || (version != PM_HITFILE_VERSION)) {
+    fprintf(stderr, "// Invalid hit file signature\n");
+    IO_ERROR();
+    return PMHitFileClose(hitFile);
+  }
+
+  for (i = PMHitFileCompact ; i <= PMHitFileBinary ; i++) {
+    if (! strcmp(name, sFormatName[i]))
+      hitFile->format = (PMHitFileFormat) i;
+  }
+
+  if (hitFile->format == PMHitFileText) {
+    fprintf(stderr, "// Invalid hit file format %s\n", name);
+    IO_ERROR();
+    return PMHitFileClose(hitFile);
+  }
+
+  return hitFile;
+}
+
+/* ---------------------------------------------------- */
+/* open hit file on sink                                */
+/* ---------------------------------------------------- */
+
+PMHitFile *PMHitFileOpenSink(PMHitSink sink, Ptr arg)
+{
+  PMHitFile *hitFile;
+
+  if (! (hitFile = NEW(PMHitFile))) {
+    MEMORY_ERROR();
+    return NULL;
+  }
+
+  (void) memset(hitFile, 0, sizeof(PMHitFile));
+
+  hitFile->format  = PMHitFileText;
+  hitFile->isid    = -1;
+  hitFile->itag    = -1;
+  hitFile->sink    = sink;
+  hitFile->sinkArg = arg;
+
+  if (! (hitFile->block = LXNewStackp(LX_STKP_MIN_SIZE))) {
+    MEMORY_ERROR();
+    return PMHitFileClose(hitFile);
+  }
+
+  return hitFile;
+}
+
+/* ---------------------------------------------------- */
+/* close hit file                                       */
+/* ---------------------------------------------------- */
+
+PMHitFile *PMHitFileClose(PMHitFile *hitFile)
+{
+  if (hitFile) {
+    if (hitFile->stream)
+      (void) fclose(hitFile->stream);
+    if (hitFile->buffer)
+      FREE(hitFile->buffer);
+    if (hitFile->seqIdMap)
+      FREE(hitFile->seqIdMap);
+    if (hitFile->tagMap)
+      FREE(hitFile->tagMap);
+    if (hitFile->seqIds)
+      FREE(hitFile->seqIds);
+    if (hitFile->tags)
+      FREE(hitFile->tags);
+    if (hitFile->block)
+      (void) LXFreeStackp(hitFile->block, (void (*)(Ptr)) PMFreeHit);
+    FREE(hitFile);
+  }
+
+  return NULL;
+}
+
+/* ---------------------------------------------------- */
+/* begin block of hits                                  */
+/* ---------------------------------------------------- */
+
+int PMHitFileBeginHits(PMHitFile *hitFile, Int32 isid, PMSeqId *seqId,
+                       Int32 itag, PMTag *tag, Int32 nbHits)
+{
+  int  stat;
+  FILE *stream = hitFile->stream;
+  Bool binary  = (hitFile->format == PMHitFileBinary);
+
+  if (hitFile->sink) {
+    hitFile->blockIsid  = isid;
+    hitFile->blockSeqId = seqId;
+    hitFile->blockItag  = itag;
+    hitFile->blockTag   = tag;
+    return LX_NO_ERROR;
+  }
+
+  if (hitFile->format == PMHitFileText) {
+    if (   (PMWriteSeqId(stream, seqId) != LX_NO_ERROR)
+        || (PMWriteTag(stream, tag)     != LX_NO_ERROR))
+      return IO_ERROR();
+    return LX_NO_ERROR;
+  }
+
+  /* define seqId and tag if needed */
+
+  if (! (   sAssertMap(&hitFile->seqIdMap, &hitFile->maxSeqIds, isid)
+         && sAssertMap(&hitFile->tagMap,   &hitFile->maxTags,   itag)))
+    return MEMORY_ERROR();
+
+  if (hitFile->seqIdMap[isid] < 0) {
+    hitFile->seqIdMap[isid] = hitFile->nbSeqIds++;
+    if ((stat = sWriteRecord(hitFile, REC_SEQID, hitFile->seqIdMap[isid], 0, 0)) != LX_NO_ERROR)
+      return stat;
+    if ((binary ? (PMBinWriteSeqId(stream, seqId) <= 0)
+                : (PMWriteSeqId(stream, seqId) != LX_NO_ERROR)))
+      return IO_ERROR();
+  }
+
+  if (hitFile->tagMap[itag] < 0) {
+    hitFile->tagMap[itag] = hitFile->nbTags++;
+    if ((stat = sWriteRecord(hitFile, REC_TAG, hitFile->tagMap[itag], 0, 0)) != LX_NO_ERROR)
+      return stat;
+    if ((binary ? (PMBinWriteTag(stream, tag) <= 0)
+                : (PMWriteTag(stream, tag) != LX_NO_ERROR)))
+      return IO_ERROR();
+  }
+
+  /* block header */
+
+  return sWriteRecord(hitFile, REC_HITS, hitFile->seqIdMap[isid],
+                      hitFile->tagMap[itag], nbHits);
+}
+
+/* ---------------------------------------------------- */
+/* write hit of current block                           */
+/* ---------------------------------------------------- */
+
+int PMHitFileWriteHit(PMHitFile *hitFile, PMHit *hit)
+{
+  if (hitFile->sink)
+    return sSinkHit(hitFile, hit);
+
+  if (hitFile->format == PMHitFileBinary)
+    return ((PMBinWriteHit(hitFile->stream, hit) <= 0) ? IO_ERROR() : LX_NO_ERROR);
+
+  return PMWriteHit(hitFile->stream, hit);
+}
+
+/* ---------------------------------------------------- */
+/* end current block                                    */
+/* ---------------------------------------------------- */
+
+int PMHitFileEndHits(PMHitFile *hitFile)
+{
+  if (hitFile->sink)
+    return sSinkBlock(hitFile);
+
+  if (   (hitFile->format == PMHitFileText)
+      && (fprintf(hitFile->stream, "%cEndOfHits\n", PM_END_OF_RECORD) <= 0))
+    return IO_ERROR();
+
+  return LX_NO_ERROR;
+}
+
+/* ---------------------------------------------------- */
+/* read next block of hits                              */
+/* ---------------------------------------------------- */
+
+int PMHitFileReadHits(PMHitFile *hitFile, PMSeqId **seqId, PMTag **tag,
+                      PMHitStack *hits)
+{
+  int   stat, type;
+  Int32 i, i1, i2, nbHits;
+  FILE  *stream = hitFile->stream;
+  Bool  binary  = (hitFile->format == PMHitFileBinary);
+
+  if (hitFile->format == PMHitFileText)
+    return sReadTextHits(hitFile, seqId, tag, hits);
+
+  /* read definitions up to next block */
+
+  while ((stat = sReadRecord(hitFile, &type, &i1, &i2, &nbHits)) == LX_NO_ERROR) {
+
+    if (type == REC_HITS)
+      break;
+
+    if (type == REC_SEQID) {
+      if (i1 != hitFile->nbSeqIds)
+        return IO_ERROR();
+      if (! sAssertSeqIds(hitFile, i1))
+        return MEMORY_ERROR();
+      if (sReadSeqId(stream, hitFile->seqIds + i1, binary) != LX_NO_ERROR)
+        return IO_ERROR();
+      hitFile->nbSeqIds++;
+    }
+    else {
+      if (i1 != hitFile->nbTags)
+        return IO_ERROR();
+      if (! sAssertTags(hitFile, i1))
+        return MEMORY_ERROR();
+      if ((binary ? (PMBinReadTag(stream, hitFile->tags + i1) <= 0)
+                  : (PMReadTag(stream, hitFile->tags + i1) != LX_NO_ERROR)))
+        return IO_ERROR();
+      hitFile->nbTags++;
+    }
+  }
+
+  if (stat != LX_NO_ERROR)
+    return stat;
+
+  if (   (i1 < 0) || (i1 >= hitFile->nbSeqIds)
+      || (i2 < 0) || (i2 >= hitFile->nbTags))
+    return IO_ERROR();
+
+  *seqId = hitFile->seqIds + i1;
+  *tag   = hitFile->tags   + i2;
+
+  hitFile->isid = i1;
+  hitFile->itag = i2;
+
+  /* read hits */
+
+  for (i = 0 ; i < nbHits ; i++) {
+
+    PMHit *hit;
+
+    if (! (hit = PMNewHit()))
+      return MEMORY_ERROR();
+
+    stat = (binary ? ((PMBinReadHit(stream, hit) > 0) ? LX_NO_ERROR : LX_IO_ERROR)
+                   : PMReadHit(stream, hit));
+
+    if (stat != LX_NO_ERROR) {
+      (void) PMFreeHit(hit);
+      return IO_ERROR();
+    }
+
+    if (! LXPushpIn(hits, (Ptr) hit))
+      return MEMORY_ERROR();
+  }
+
+  return LX_NO_ERROR;
+}
@@ -0,0 +1,590 @@
+/* -----------------------------------------------------------------------
+ * $Id: PMIndex.c $
+ * -----------------------------------------------------------------------
+ * @file: PMIndex.c
+ * @desc: PepMap k-uple index library
+ *
+ * @history:
+ * @+ <Gloup> : Oct 26 : first version
+ * -----------------------------------------------------------------------
+ * @docstart:
+ *
+ * PM k-uple index library<br>
+ *
+ * @docend:
+ */
+
+#include <ctype.h>
+#include <string.h>
+
+#include "LX/LXSys.h"
+#include "LX/LXGenetic.h"
+
+#include "PM/PMIndex.h"
+
+/* ----------------------------------------------------- */
+/* @static: align offset on 8 bytes                      */
+/* ----------------------------------------------------- */
+
+static Int64 sAlign(Int64 offset)
+{
+  return (offset + 7) & ~((Int64) 7);
+}
+
+/* ----------------------------------------------------- */
+/* @static: pad stream with zeros up to aligned offset   */
+/* ----------------------------------------------------- */
+
+static int sPad(FILE *stream, Int64 *offset)
+{
+  static char sZeros[8] = {0, 0, 0, 0, 0, 0, 0, 0};
+
+  size_t pad = (size_t) (sAlign(*offset) - *offset);
+
+  if (pad && (fwrite(sZeros, 1, pad, stream) != pad))
+    return IO_ERROR();
+
+  *offset += pad;
+
+  return LX_NO_ERROR;
+}
+
+/* ----------------------------------------------------- */
+/* @static: write section and update offset              */
+/* ----------------------------------------------------- */
+
+static int sWrite(FILE *stream, void *data, size_t size, Int64 *offset)
+{
+  if (size && (fwrite(data, 1, size, stream) != size))
+    return IO_ERROR();
+
+  *offset += size;
+
+  return LX_NO_ERROR;
+}
+
+/* ----------------------------------------------------- */
+/* @static: make sequence upper case and replace         */
+/* non alpha chars by LX_GENETIC_BAD_AA                  */
+/* (same as PMMatch)                                     */
+/* ----------------------------------------------------- */
+
+static void sValidate(char *seq)
+{
+  char *s;
+
+  for (s = seq ; *s ; s++) {
+
+    if (! isalpha(*s))
+      *s = LX_GENETIC_BAD_AA;
+
+    if (islower(*s))
+      *s = toupper(*s);
+  }
+}
+
+/* ----------------------------------------------------- */
+/* @static: ALPHALEN^k                                   */
+/* ----------------------------------------------------- */
+
+static Int32 sPower(int k)
+{
+  Int32 pow = 1;
+
+  while (k-- > 0)
+    pow *= PM_INDEX_ALPHALEN;
+
+  return pow;
+}
+
+/* ----------------------------------------------------- */
+/* @static: code of next k-uple                          */
+/* ----------------------------------------------------- */
+
+static Int32 sNextCode(Int32 previous, Int32 power, int symbol, Bool differentiateKQ)
+{
+  return   (previous % power) * PM_INDEX_ALPHALEN
+         + (PMIndexFoldSymbol(symbol, differentiateKQ) - 'A');
+}
+
+/* ----------------------------------------------------- */
+/* @static: append string to growing pool                */
+/* ----------------------------------------------------- */
+
+static Int64 sAppendString(char **pool, Int64 *used, Int64 *size, char *s)
+{
+  Int64 offset = *used;
+  Int64 len    = strlen(s) + 1;
+
+  while (*used + len > *size) {
+    *size *= 2;
+    if (! (*pool = REALLOC(*pool, char, *size))) {
+      MEMORY_ERROR();
+      return -1;
+    }
+  }
+
+  (void) memcpy(*pool + *used, s, len);
+
+  *used += len;
+
+  return offset;
+}
+
+/* ----------------------------------------------------- */
+/* @static: index building, pass #1                      */
+/* copy sequences into index file and count k-uples      */
+/* ----------------------------------------------------- */
+
+static int sBuildPass1(FILE *streamin, FILE *streamou, PMIndexHeader *header,
+                       UInt32 *counts, PMIndexSeq **seqs,
+                       char **strings, Int64 *nbStrings, Bool verbose)
+{
+  Int32 code, power;
+  Int64 i, nbSeqAlloc, nbStrAlloc;
+  Int64 offset;
+  PMIndexSeq *entry;
+  LXFastaSequence *fastaSeq;
+
+  power = sPower(header->kuple - 1);
+
+  nbSeqAlloc = nbStrAlloc = BUFSIZ;
+
+  if (   (! (*seqs = NEWN(PMIndexSeq, nbSeqAlloc)))
+      || (! (*strings = NEWN(char, nbStrAlloc)))
+      || (! (fastaSeq = LXFastaNewSequence(BUFSIZ))))
+    return MEMORY_ERROR();
+
+  *nbStrings = 0;
+
+  offset = header->resOffset;
+
+  while (LXFastaReadSequence(streamin, fastaSeq)) {
+
+    if (! fastaSeq->ok) {
+      fprintf(stderr, "# Error reading sequence #%ld\n", (long) header->nbSeq + 1);
+      return IO_ERROR();
+    }
+
+    if (header->nbSeq >= nbSeqAlloc) {
+      nbSeqAlloc *= 2;
+      if (! (*seqs = REALLOC(*seqs, PMIndexSeq, nbSeqAlloc)))
+        return MEMORY_ERROR();
+    }
+
+    sValidate(fastaSeq->seq);
+
+    entry = *seqs + header->nbSeq++;
+
+    entry->from    = offset - header->resOffset;
+    entry->length  = fastaSeq->length;
+    entry->name    = sAppendString(strings, nbStrings, &nbStrAlloc, fastaSeq->name);
+    entry->comment = sAppendString(strings, nbStrings, &nbStrAlloc, fastaSeq->comment);
+
+    if ((entry->name < 0) || (entry->comment < 0))
+      return LX_MEM_ERROR;
+
+    if (sWrite(streamou, fastaSeq->seq, fastaSeq->length + 1, &offset) != LX_NO_ERROR)
+      return LX_IO_ERROR;
+
+    if (verbose)
+      fprintf(stderr, "# indexing sequence: %ld %s %s (%ld aa)\n",
+                      (long) header->nbSeq, fastaSeq->name, fastaSeq->comment, fastaSeq->length);
+
+    /* count kuples */
+
+    if (fastaSeq->length < header->kuple)
+      continue;
+
+    code = PMIndexKupleCode(fastaSeq->seq, header->kuple, header->differentiateKQ);
+    counts[code]++;
+
+    for (i = header->kuple ; i < fastaSeq->length ; i++) {
+      code = sNextCode(code, power, fastaSeq->seq[i], header->differentiateKQ);
+      counts[code]++;
+    }
+
+    header->nbPos += fastaSeq->length - header->kuple + 1;
+  }
+
+  header->nbResidues = offset - header->resOffset;
+
+  (void) LXFastaFreeSequence(fastaSeq);
+
+  return LX_NO_ERROR;
+}
+
+/* ----------------------------------------------------- */
+/* @static: index building, pass #2                      */
+/* fill positions in mapped index file                   */
+/* counts[code] is the index of code in codes section    */
+/* ----------------------------------------------------- */
+
+static void sBuildPass2(char *base, UInt32 *counts, Int64 *cursor)
+{
+  Int32 code, power;
+  Int64 iseq, i, pos;
+
+  PMIndexHeader *header   = (PMIndexHeader *) base;
+  PMIndexSeq    *seqs     = (PMIndexSeq *) (base + header->seqOffset);
+  char          *residues = base + header->resOffset;
+  UInt32        *pos32    = (UInt32 *) (base + header->posOffset);
+  Int64         *pos64    = (Int64 *)  (base + header->posOffset);
+
+  power = sPower(header->kuple - 1);
+
+  for (iseq = 0 ; iseq < header->nbSeq ; iseq++) {
+
+    char *seq = residues + seqs[iseq].from;
+
+    if (seqs[iseq].length < header->kuple)
+      continue;
+
+    for (i = 0 ; i <= seqs[iseq].length - header->kuple ; i++) {
+
+      code = (i == 0) ? PMIndexKupleCode(seq, header->kuple, header->differentiateKQ)
+                      : sNextCode(code, power, seq[i + header->kuple - 1],
+                                  header->differentiateKQ);
+
+      pos = cursor[counts[code]]++;
+
+      if (header->posWidth == sizeof(UInt32))
+        pos32[pos] = (UInt32) (seqs[iseq].from + i);
+      else
+        pos64[pos] = seqs[iseq].from + i;
+    }
+  }
+}
+
+/* ----------------------------------------------------- */
+/* API                                                   */
+/* ----------------------------------------------------- */
+
+/* ----------------------------------------------------- */
+/* fold undifferentiable symbols                         */
+/* ----------------------------------------------------- */
+
+int PMIndexFoldSymbol(int symbol, Bool differentiateKQ)
+{
+  if (symbol == 'L')
+    return 'I';
+  if ((symbol == 'Q') && (! differentiateKQ))
+    return 'K';
+  return symbol;
+}
+
+/* ----------------------------------------------------- */
+/* k-uple code                                           */
+/* ----------------------------------------------------- */
+
+Int32 PMIndexKupleCode(const char *s, int kuple, Bool differentiateKQ)
+{
+  int   i;
+  Int32 code = 0;
+
+  for (i = 0 ; i < kuple ; i++) {
+    code *= PM_INDEX_ALPHALEN;
+    code += (PMIndexFoldSymbol(s[i], differentiateKQ) - 'A');
+  }
+
+  return code;
+}
+
+/* ----------------------------------------------------- */
+/* build index file                                      */
+/* ----------------------------------------------------- */
+
+int PMIndexBuild(FILE *streamin, const char *filename,
+                 int kuple, Bool differentiateKQ, Bool verbose)
+{
+  int           err;
+  Int32         code, size;
+  Int64         offset, nbStrings, icode, start;
+  size_t        fileSize;
+  FILE          *streamou;
+  char          *base, *strings;
+  UInt32        *counts, *codes;
+  Int64         *starts;
+  PMIndexSeq    *seqs;
+  PMIndexHeader header;
+
+  if ((kuple < PM_INDEX_MIN_KUPLE) || (kuple > PM_INDEX_MAX_KUPLE))
+    return ARG_ERROR();
+
+  (void) memset(&header, 0, sizeof(header));
+
+  (void) strcpy(header.magic, PM_INDEX_MAGIC);
+
+  header.endian          = 1;
+  header.version         = PM_INDEX_VERSION;
+  header.kuple           = kuple;
+  header.differentiateKQ = differentiateKQ;
+  header.resOffset       = sAlign(sizeof(PMIndexHeader));
+
+  size = sPower(kuple);
+
+  if (! (counts = NEWN(UInt32, size)))
+    return MEMORY_ERROR();
+
+  (void) memset(counts, 0, size * sizeof(UInt32));
+
+  seqs    = NULL;
+  strings = NULL;
+  codes   = NULL;
+  starts  = NULL;
+
+  /* ------------------------------------------ */
+  /* pass #1 : sequences and strings            */
+
+  if (! (streamou = LXOpenFile(filename, "wb"))) {
+    FREE(counts);
+    return IO_ERROR();
+  }
+
+  offset = 0;
+
+  err = sWrite(streamou, &header, sizeof(header), &offset);
+
+  if (! err)
+    err = sPad(streamou, &offset);
+
+  if (! err)
+    err = sBuildPass1(streamin, streamou, &header, counts,
+                      &seqs, &strings, &nbStrings, verbose);
+
+  offset = header.resOffset + header.nbResidues;
+
+  if (! err)
+    err = sPad(streamou, &offset);
+
+  header.seqOffset = offset;
+
+  if (! err)
+    err = sWrite(streamou, seqs, header.nbSeq * sizeof(PMIndexSeq), &offset);
+
+  header.strOffset = offset;
+
+  if (! err)
+    err = sWrite(streamou, strings, nbStrings, &offset);
+
+  if (! err)
+    err = sPad(streamou, &offset);
+
+  /* ------------------------------------------ */
+  /* k-uples codes and starts                   */
+  /* counts are replaced by codes indexes       */
+
+  for (code = 0 ; code < size ; code++) {
+    if (counts[code])
+      header.nbCodes++;
+  }
+
+  if (   (! err)
+      && (   (! (codes  = NEWN(UInt32, MAX(1, header.nbCodes))))
+          || (! (starts = NEWN(Int64, header.nbCodes + 1)))))
+    err = MEMORY_ERROR();
+
+  if (! err) {
+
+    for (code = 0, icode = 0, start = 0 ; code < size ; code++) {
+      if (counts[code]) {
+        codes[icode]  = code;
+        starts[icode] = start;
+        start += counts[code];
+        counts[code] = icode++;
+      }
+    }
+    starts[icode] = start;
+  }
+
+  header.codeOffset = offset;
+
+  if (! err)
+    err = sWrite(streamou, codes, header.nbCodes * sizeof(UInt32), &offset);
+
+  if (! err)
+    err = sPad(streamou, &offset);
+
+  header.startOffset = offset;
+
+  if (! err)
+    err = sWrite(streamou, starts, (header.nbCodes + 1) * sizeof(Int64), &offset);
+
+  header.posOffset = offset;
+
+  header.posWidth = (header.nbResidues < ((Int64) 1 << 32)) ? sizeof(UInt32) : sizeof(Int64);
+
+  header.fileSize = header.posOffset + header.nbPos * header.posWidth;
+
+  if (LXCloseFile(streamou) != LX_NO_ERROR)
+    err = IO_ERROR();
+
+  /* ------------------------------------------ */
+  /* pass #2 : positions                        */
+  /* starts are used as cursors                 */
+
+  if (! err) {
+
+    fileSize = (size_t) header.fileSize;
+
+    if ((base = LXMapFile(filename, "w", &fileSize))) {
+      (void) memcpy(base, &header, sizeof(header));
+      sBuildPass2(base, counts, starts);
+      err = LXUnmapFile(base, fileSize);
+    }
+    else {
+      err = IO_ERROR();
+    }
+  }
+
+  /* ------------------------------------------ */
+  /* cleanup                                    */
+
+  if (verbose && (! err))
+    fprintf(stderr, "# %ld sequences %ld kuples %ld positions\n",
+                    (long) header.nbSeq, (long) header.nbCodes, (long) header.nbPos);
+
+  FREE(counts);
+
+  if (seqs)    FREE(seqs);
+  if (strings) FREE(strings);
+  if (codes)   FREE(codes);
+  if (starts)  FREE(starts);
+
+  return err;
+}
+
+/* ----------------------------------------------------- */
+/* open index                                            */
+/* ----------------------------------------------------- */
+
+PMIndex *PMIndexOpen(const char *filename)
+{
+  PMIndex       *index;
+  PMIndexHeader *header;
+  char          *base;
+
+  if (! (index = NEW(PMIndex))) {
+    MEMORY_ERROR();
+    return NULL;
+  }
+
+  (void) memset(index, 0, sizeof(PMIndex));
+
+  if (! (index->base = LXMapFile(filename, "r", &index->size))) {
+    IO_ERROR();
+    return PMIndexClose(index);
+  }
+
+  base   = (char *) index->base;
+  header = index->header = (PMIndexHeader *) base;
+
+  if (   (index->size < sizeof(PMIndexHeader))
+      || strcmp(header->magic, PM_INDEX_MAGIC)
+      || (header->endian  != 1)
+      || (header->version != PM_INDEX_VERSION)
+      || (header->fileSize != (Int64) index->size)) {
+    fprintf(stderr, "// Invalid or incompatible index file: %s\n", filename);
+    IO_ERROR();
+    return PMIndexClose(index);
+  }
+
+  index->seqs      = (PMIndexSeq *) (base + header->seqOffset);
+  index->strings   = base + header->strOffset;
+  index->residues  = base + header->resOffset;
+  index->codes     = (UInt32 *) (base + header->codeOffset);
+  index->starts    = (Int64 *) (base + header->startOffset);
+  index->positions = (void *) (base + header->posOffset);
+
+  return index;
+}
+
+/* ----------------------------------------------------- */
+/* close index                                           */
+/* ----------------------------------------------------- */
+
+PMIndex *PMIndexClose(PMIndex *index)
+{
+  if (index) {
+    if (index->base)
+      (void) LXUnmapFile(index->base, index->size);
+    FREE(index);
+  }
+
+  return NULL;
+}
+
+/* ----------------------------------------------------- */
+/* number of sequences                                   */
+/* ----------------------------------------------------- */
+
+Int64 PMIndexNbSeq(PMIndex *index)
+{
+  return index->header->nbSeq;
+}
+
+/* ----------------------------------------------------- */
+/* get sequence view                                     */
+/* ----------------------------------------------------- */
+
+int PMIndexGetSequence(PMIndex *index, Int64 iseq, LXFastaSequence *fastaSeq)
+{
+  PMIndexSeq *entry;
+
+  if ((iseq < 0) || (iseq >= index->header->nbSeq))
+    return LX_ARG_ERROR;
+
+  entry = index->seqs + iseq;
+
+  fastaSeq->ok      = TRUE;
+  fastaSeq->length  = (long) entry->length;
+  fastaSeq->offset  = (long) entry->from;
+  fastaSeq->name    = index->strings  + entry->name;
+  fastaSeq->comment = index->strings  + entry->comment;
+  fastaSeq->seq     = index->residues + entry->from;
+
+  return LX_NO_ERROR;
+}
+
+/* ----------------------------------------------------- */
+/* lookup k-uple                                         */
+/* binary search in codes                                */
+/* ----------------------------------------------------- */
+
+Int64 PMIndexLookup(PMIndex *index, Int32 code, Int64 *from, Int64 *to)
+{
+  Int64 lo, hi, mid;
+
+  lo = 0;
+  hi = index->header->nbCodes;
+
+  while (lo < hi) {
+    mid = (lo + hi) / 2;
+    if (index->codes[mid] < (UInt32) code)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+
+  if ((lo < index->header->nbCodes) && (index->codes[lo] == (UInt32) code)) {
+    *from = index->starts[lo];
+    *to   = index->starts[lo + 1];
+  }
+  else {
+    *from = *to = 0;
+  }
+
+  return *to - *from;
+}
+
+/* ----------------------------------------------------- */
+/* get position                                          */
+/* ----------------------------------------------------- */
+
+Int64 PMIndexPosition(PMIndex *index, Int64 i)
+{
+  if (index->header->posWidth == sizeof(UInt32))
+    return (Int64) ((UInt32 *) index->positions)[i];
+
+  return ((Int64 *) index->positions)[i];
+}
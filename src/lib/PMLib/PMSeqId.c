@@ -6,6 +6,7 @@
  * 
  * @history:
  * @+ <Gloup> : Jul 06 : first version 
+ * @+ <Gloup> : Oct 26 : binary io
  * -----------------------------------------------------------------------
  * @docstart:
  *
@@ -192,6 +193,53 @@ int PMWriteSeqId(FILE *streamou, PMSeqId *seqId)
   return sWriteFormatSeqId(streamou, seqId);
 }
 
+/* ---------------------------------------------------- */
+/* binary write seqId to file                           */
+/* the seqId is encoded as its text record, so that     */
+/* PMBinReadSeqId and PMReadSeqId give the same seqId   */
+/* ---------------------------------------------------- */
+
+int PMBinWriteSeqId(FILE *streamou, PMSeqId *seqId)
+{
+  char buffer[BUFSIZ];
+
+  (void) snprintf(buffer, sizeof(buffer), "%s %c %d %ld %s",
+                  seqId->name,
+                  seqId->strand,
+                  seqId->frame,
+                  seqId->length,
+                  sValidComment(seqId->comment));
+
+  if (LXBinWriteStr(streamou, buffer) <= 0)
+    return -IO_ERROR();
+
+  return (int) (sizeof(Int64) + strlen(buffer) + 1);
+}
+
+/* ---------------------------------------------------- */
+/* binary read seqId from file                          */
+/* ---------------------------------------------------- */
+
+int PMBinReadSeqId(FILE *streamin, PMSeqId *seqId)
+{
+  Int64  size;
+  char   buffer[BUFSIZ];
+
+  if (LXBinReadInt64(streamin, &size) != 1) 
+    return (feof(streamin) ? LX_EOF : -IO_ERROR());
+
+  if (   (size <= 0) || (size > BUFSIZ)
+      || (LXBinReadChars(streamin, buffer, size) != size))
+    return -IO_ERROR();
+
+  buffer[size - 1] = '\000';
+
+  if (sReadFormatSeqId(buffer, seqId) != LX_NO_ERROR)
+    return -IO_ERROR();
+
+  return (int) (sizeof(Int64) + size);
+}
+
 /* -------------------------------------------- */
 /* debug funcs                                  */
 /* -------------------------------------------- */
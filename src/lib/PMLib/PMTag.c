@@ -10,6 +10,7 @@
  * @+ <Wanou> : May 02 : comment feature added
  * @+ <Gloup> : Aug 05 : removed GEX/LX formats
  * @+ <Gloup> : Jul 06 : code cleanup
+ * @+ <Gloup> : Oct 26 : binary io without seek
  * -----------------------------------------------------------------------
  * @docstart: 
  *
@@ -166,77 +167,67 @@ void PMDebugTag ( FILE *streamou, PMTag *tag )
 }
 
 /* -------------------------------------------- */
+/* binary IO                                    */
+/* -------------------------------------------- */
+
+#define BIN_TAG_SIZE  (PM_TAG_TAGID_LEN + PM_TAG_MAX_SEQ_LEN + 4 + 4 * sizeof(float))
 
 int PMBinWriteTag (FILE *streamou, PMTag *tag)
 {
-  int res;
-  Int32 initpos;
-
-  initpos = LXTell(streamou);
-
-  if ((res=LXBinWriteChars(streamou, tag->id, PM_TAG_TAGID_LEN + 2)) <= 0) {
+  if (LXBinWriteChars(streamou, tag->id, PM_TAG_TAGID_LEN + 2) <= 0) {
     return -IO_ERROR();
   }
 
-  if ((res=LXBinWriteChars(streamou, tag->seq, PM_TAG_MAX_SEQ_LEN + 2)) <= 0) {
+  if (LXBinWriteChars(streamou, tag->seq, PM_TAG_MAX_SEQ_LEN + 2) <= 0) {
     return -IO_ERROR();
   }
 
-  if ((res=LXBinWriteFloat(streamou, tag->mN)) != 1) {
+  if (LXBinWriteFloat(streamou, tag->mN) != 1) {
     return -IO_ERROR();
   }
 
-  if ((res=LXBinWriteFloat(streamou, tag->mC)) != 1) {
+  if (LXBinWriteFloat(streamou, tag->mC) != 1) {
     return -IO_ERROR();
   }
 
-  if ((res=LXBinWriteFloat(streamou, tag->mParent)) != 1) {
+  if (LXBinWriteFloat(streamou, tag->mParent) != 1) {
     return -IO_ERROR();
   }
 
-  if ((res=LXBinWriteFloat(streamou, tag->score)) != 1) {
+  if (LXBinWriteFloat(streamou, tag->score) != 1) {
     return -IO_ERROR();
   }
 
-  return (int) (LXTell(streamou) - initpos);
+  return BIN_TAG_SIZE;
 }
 
 /* -------------------------------------------- */
 
 int PMBinReadTag (FILE *streamin, PMTag *tag)
 {
-  int res;
-  Int32 initpos;
-
-  initpos = LXTell(streamin);
-
-  if (LXIsEOF(streamin)) {
-    return LX_EOF;
-  }
-  
-  if ((res=LXBinReadChars(streamin, tag->id, PM_TAG_TAGID_LEN + 2)) <= 0) {
-    return -IO_ERROR();
+  if (LXBinReadChars(streamin, tag->id, PM_TAG_TAGID_LEN + 2) <= 0) {
+    return (feof(streamin) ? LX_EOF : -IO_ERROR());
   }
 
-  if ((res=LXBinReadChars(streamin, tag->seq, PM_TAG_MAX_SEQ_LEN + 2)) <= 0) {
+  if (LXBinReadChars(streamin, tag->seq, PM_TAG_MAX_SEQ_LEN + 2) <= 0) {
     return -IO_ERROR();
   }
 
-  if ((res=LXBinReadFloat(streamin, &(tag->mN))) != 1) {
+  if (LXBinReadFloat(streamin, &(tag->mN)) != 1) {
     return -IO_ERROR();
   }
 
-  if ((res=LXBinReadFloat(streamin, &(tag->mC))) != 1) {
+  if (LXBinReadFloat(streamin, &(tag->mC)) != 1) {
     return -IO_ERROR();
   }
 
-  if ((res=LXBinReadFloat(streamin, &(tag->mParent))) != 1) {
+  if (LXBinReadFloat(streamin, &(tag->mParent)) != 1) {
     return -IO_ERROR();
   }
 
-  if ((res=LXBinReadFloat(streamin, &(tag->score))) != 1) {
+  if (LXBinReadFloat(streamin, &(tag->score)) != 1) {
     return -IO_ERROR();
   }
 
-  return (int) (LXTell(streamin) - initpos);
+  return BIN_TAG_SIZE;
 }
@@ -3,17 +3,58 @@
 #include <ctype.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "PM.h"
 
+static char sSeq[] = "KAKPRRGEDKXWRPAEKDDPMKR";
+
 main() {
 
-  PMEnzyme enz;
+  Int64         pos, len;
+  PMEnzyme      enz;
+  PMCleavageMap *map, *range;
 
   LXSetupIO("stdin");
 
-  while (PMReadEnzyme(stdin, &enz) == LX_NO_ERROR)
+  map   = PMNewCleavageMap();
+  range = PMNewCleavageMap();
+
+  len = strlen(sSeq);
+
+  while (PMReadEnzyme(stdin, &enz) == LX_NO_ERROR) {
+
     PMDebugEnzyme(stdout, &enz);
 
+    (void) PMFillCleavageMap(map, &enz, sSeq, len);
+
+    printf("// map  %s : %s\n// cuts    : ", (enz.cutSite[0].isSimple ? "simple" : "regexp"), sSeq);
+
+    for (pos = -1 ; pos <= len ; pos++) {
+      if (PMHasCleavage(map, pos))
+        printf(" %d", (int) pos);
+    }
+
+    printf("\n// count   : %d %d %d\n", (int) PMCountCleavages(map, 0, len - 1),
+                                             (int) PMCountCleavages(map, 2, 8),
+                                             (int) PMCountCleavages(map, -5, 1));
+
+    (void) PMFillCleavageMapRange(range, &enz, sSeq, len, 0, 0);
+    (void) PMFillCleavageMapRange(range, &enz, sSeq, len, 2, 9);
+    (void) PMFillCleavageMapRange(range, &enz, sSeq, len, 15, len + 5);
+
+    printf("// range   : ");
+
+    for (pos = 2 ; pos < len ; pos = (pos == 8 ? 15 : pos + 1)) {
+      if (PMHasCleavage(range, pos))
+        printf(" %d", (int) pos);
+    }
+
+    printf("\n// rcount  : %d\n//\n", (int) PMCountCleavages(range, 2, 8));
+  }
+
+  (void) PMFreeCleavageMap(map);
+  (void) PMFreeCleavageMap(range);
+
   exit(0);
 }
@@ -0,0 +1,80 @@
+/* test Hit files */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "PM.h"
+
+#define MAX_ENTRIES 1024
+
+static PMSeqId sSeqIds[MAX_ENTRIES];
+static PMTag   sTags[MAX_ENTRIES];
+static int     sNbSeqIds = 0, sNbTags = 0;
+
+/* user indexes of seqId and tag */
+
+static int sSeqIdIndex(PMSeqId *seqId) {
+  int i;
+  for (i = 0 ; i < sNbSeqIds ; i++)
+    if (   (! strcmp(sSeqIds[i].name, seqId->name))
+        && (sSeqIds[i].strand == seqId->strand)
+        && (sSeqIds[i].frame  == seqId->frame))
+      return i;
+  sSeqIds[sNbSeqIds] = *seqId;
+  return sNbSeqIds++;
+}
+
+static int sTagIndex(PMTag *tag) {
+  int i;
+  for (i = 0 ; i < sNbTags ; i++)
+    if (! strcmp(sTags[i].id, tag->id))
+      return i;
+  sTags[sNbTags] = *tag;
+  return sNbTags++;
+}
+
+/* copy hit file in into file out in format */
+
+static void sCopy(FILE *in, FILE *out, PMHitFileFormat format) {
+  PMHitFile  *hin, *hout;
+  PMHitStack *hits;
+  PMSeqId    *seqId;
+  PMTag      *tag;
+  PMHit      *hit;
+
+  hin  = PMHitFileOpenRead(in);
+  hout = PMHitFileOpenWrite(out, format);
+  hits = PMNewHitStack();
+
+  while (PMHitFileReadHits(hin, &seqId, &tag, hits) == LX_NO_ERROR) {
+    (void) PMHitFileBeginHits(hout, sSeqIdIndex(seqId), seqId,
+                              sTagIndex(tag), tag, LXStackpSize(hits));
+    (void) LXReverseStackp(hits);
+    while (LXPoppOut(hits, (Ptr *) &hit)) {
+      (void) PMHitFileWriteHit(hout, hit);
+      (void) PMFreeHit(hit);
+    }
+    (void) PMHitFileEndHits(hout);
+  }
+
+  (void) PMFreeHitStack(hits);
+  (void) PMHitFileClose(hin);
+  (void) PMHitFileClose(hout);
+}
+
+int main() {
+
+  LXSetupIO("stdin");
+
+  /* text -> compact -> binary -> text */
+
+  sCopy(stdin, LXOpenFile("test_hfl.c.bak", "w"), PMHitFileCompact);
+
+  sCopy(LXOpenFile("test_hfl.c.bak", "r"), LXOpenFile("test_hfl.b.bak", "w"),
+        PMHitFileBinary);
+
+  sCopy(LXOpenFile("test_hfl.b.bak", "r"), stdout, PMHitFileText);
+
+  exit(0);
+}
@@ -8,6 +8,12 @@
  * @+ <Wanou> : Jan 02 : first version
  * @+ <Gloup> : Aug 06 : complete code revision
  * @+ <Gloup> : Jan 10 : 64 bits polish
+ * @+ <Gloup> : Oct 26 : hits partitions clusterized in parallel
+ * @+ <Gloup> : Oct 26 : external memory mode (-m)
+ * @+ <Gloup> : Oct 26 : seqIds and tags cached by hit file index
+ * @+ <Gloup> : Oct 26 : ClustMain, hits may be pulled from a source
+ * @+ <Gloup> : Oct 26 : streaming mode (-s)
+ * @+ <Gloup> : Oct 26 : seqIds and tags interned in hash tables
  * -----------------------------------------------------------------------
  * @docstart: 
  *
@@ -38,6 +44,22 @@
 #define DFT_DISTANCE           3000
 #define DFT_MIN_FULL           3
 #define DFT_MIN_PEPHITS        1
+#define DFT_THREADS            1
+#define DFT_MAX_HITS           0       /* 0 : in memory */
+
+/*
+ * @doc: max number of runs merged at once in external memory mode
+ */
+
+#define SPILL_MAX_RUNS         64
+
+/*
+ * @doc: initial number of slots (a power of 2) and size of arena
+ *       chunks (in bytes) of interned records tables
+ */
+
+#define INTERN_MIN_SLOTS       1024
+#define INTERN_CHUNK_SIZE      65536
 
 /* ---------------------------------------------------- */
 /* Data Structures                                      */
@@ -50,11 +72,39 @@
 typedef struct {
    long          from;     /* left nuc. position  */
    long          to;       /* right nuc. position */
+   long          rank;     /* input order         */
    PMSeqId       *seqId;
    PMTag         *tag;
    PMHit         *hit;
 } ExtendedHit;
 
+/*
+ * @doc: interned data (seqIds or tags) by hit file index
+ *       (see PMHitFile.h)
+ */
+
+typedef struct {
+   Int32         size;
+   Ptr           *data;
+} IndexCache;
+
+/*
+ * @doc: interned records (seqIds or tags) table
+ *       (see PMClustIntern.c)
+ */
+
+typedef struct {
+   UInt32     (*hash)(const void *data);
+   int        (*compare)(const void *p1, const void *p2);
+   size_t     (*size)(const void *data);
+   size_t     mask;        /* number of slots - 1   */
+   Ptr        *slots;      /* hash table            */
+   LXStackp   *records;    /* records by index      */
+   LXStackp   *chunks;     /* arena chunks          */
+   char       *next;       /* arena free space      */
+   char       *end;        /* end of current chunk  */
+} InternTable;
+
 /*
  * @doc: cluster
  */
@@ -67,6 +117,31 @@ typedef struct {
    LXStackp   *xhits;      /* stack of extended hits  */
 } Cluster;
 
+/*
+ * @doc: clusterizer, hits are added one at a time (sorted by
+ *       ClustSortXhits) and the clusters to be reported are pushed
+ *       into clusters (see PMClustCluster.c)
+ */
+
+typedef struct {
+   ExtendedHit *currentFull;  /* last full hit of cluster */
+   Cluster     cluster;       /* current cluster          */
+   LXStackp    *clusters;     /* clusters to report       */
+} Clusterizer;
+
+/*
+ * @doc: partition of hits sharing the same sequence name, strand
+ *       and frame (with -f), i.e. hits that may belong to the same
+ *       clusters (see PMClustThread.c)
+ */
+
+typedef struct {
+   long       from;        /* hits [from, to[ of    */
+   long       to;          /* partitioned hits      */
+   long       carry;       /* first hit clusterized */
+   LXStackp   *clusters;   /* clusters to report    */
+} Partition;
+
 /*
  * @doc: Parameters structure
  */
@@ -79,8 +154,29 @@ typedef struct {
   Bool  framed;
   Bool  addPartial;
   Bool  verbose;
+  int   nbThreads;
+  long  maxHits;
+  Bool  streamed;
 } Parameter;
 
+/*
+ * @doc: external memory hits sorter : hits are sorted by batches
+ *       into temporary runs, that are then merged (see PMClustSpill.c)
+ */
+
+typedef struct {
+   long       nbHits;      /* number of hits read    */
+   long       nbRuns;      /* number of sorted runs  */
+   LXStackp   *runs;       /* runs to be merged      */
+   LXStackp   *heap;       /* runs merge heap        */
+   LXStackp   *batch;      /* hits of current batch  */
+   InternTable *seqTable;  /* interned seqIds        */
+   InternTable *tagTable;  /* interned tags          */
+   IndexCache seqCache;    /* seqIds by file index   */
+   IndexCache tagCache;    /* tags by file index     */
+   Parameter  *param;
+} HitSorter;
+
 /* ----------------------------------------------- */
 /* prototypes                                      */
 /* ----------------------------------------------- */
@@ -89,11 +185,86 @@ typedef struct {
                 /* PMClustHelp.c                        */
                 /* ------------------------------------ */
 
-void StartupBanner(int argc, char *argv[]);
+void ClustStartupBanner(int argc, char *argv[]);
 
-void ExitUsage(int stat);
+void ClustExitUsage(int stat);
 
-void PrintHelp(void);
+void ClustPrintHelp(void);
+
+                /* ------------------------------------ */
+                /* PMClustRun.c                         */
+                /* ------------------------------------ */
+
+int         ClustMain        (int argc, char *argv[],
+                              PMHitSource source, Ptr sourceArg);
+
+                /* ------------------------------------ */
+                /* PMClustCluster.c                     */
+                /* ------------------------------------ */
+
+int         ClustSortXhitsWithFrame    (const void *h1, const void *h2);
+
+int         ClustSortXhitsWithoutFrame (const void *h1, const void *h2);
+
+Clusterizer *ClustNewClusterizer  (LXStackp *clusters);
+
+Clusterizer *ClustFreeClusterizer (Clusterizer *clz);
+
+int         ClustAddHit       (Clusterizer *clz, ExtendedHit *xhit, 
+                               Parameter *param);
+
+int         ClustFlush        (Clusterizer *clz, Parameter *param);
+
+int         ClustMakeClusters (ExtendedHit **xhits, long nbHits, 
+                               Parameter *param, LXStackp *clusters);
+
+Cluster     *ClustFreeCluster (Cluster *cluster);
+
+                /* ------------------------------------ */
+                /* PMClustIntern.c                      */
+                /* ------------------------------------ */
+
+InternTable *InternNewSeqIds  (void);
+
+InternTable *InternNewTags    (void);
+
+InternTable *InternFreeTable  (InternTable *table);
+
+Ptr         InternGet         (InternTable *table, Ptr data);
+
+Int32       InternIndex       (Ptr record);
+
+Ptr         InternRecord      (InternTable *table, Int32 index);
+
+                /* ------------------------------------ */
+                /* PMClustSpill.c                       */
+                /* ------------------------------------ */
+
+HitSorter   *SpillNewSorter  (InternTable *seqTable, InternTable *tagTable,
+                              Parameter *param);
+
+int         SpillAddHits     (HitSorter *sorter, Int32 isid, PMSeqId *seqId,
+                              Int32 itag, PMTag *tag, PMHitStack *hits);
+
+int         SpillEndHits     (HitSorter *sorter);
+
+HitSorter   *SpillReadHits   (InternTable *seqTable, InternTable *tagTable,
+                              Parameter *param);
+
+ExtendedHit *SpillNextHit    (HitSorter *sorter, int *stat);
+
+HitSorter   *SpillFreeSorter (HitSorter *sorter);
+
+                /* ------------------------------------ */
+                /* PMClustThread.c                      */
+                /* ------------------------------------ */
+
+int         ThreadCompareSeqKeys (PMSeqId *s1, PMSeqId *s2, Parameter *param);
+
+int         ThreadMakeClusters   (LXStackp *hits, Parameter *param,
+                                  Partition **parts, long *nbParts);
+
+Partition   *ThreadFreePartitions (Partition *parts, long nbParts);
 
                 /* ------------------------------------ */
                 /* PMClustUtil.c						*/
@@ -101,18 +272,26 @@ void PrintHelp(void);
 
 int         UtilCompareSeqId(const void *p1, const void *p2);
 
-void        UtilFreeSeqId(void *p);
-
 int         UtilCompareTag(const void *p1, const void *p2);
 
-void        UtilFreeTag(void *p);
+int         UtilReadExtendedHits(LXStackp *stkp, InternTable *seqTable,
+                                 InternTable *tagTable, Parameter *param);
 
-int         UtilReadExtendedHits(LXStackp *stkp, LXDict *seqDict,
-                                 LXDict *tagDict, Parameter *param);
+int         UtilAddExtendedHits(LXStackp *stkp, PMSeqId *seqId, PMTag *tag,
+                                PMHitStack *hits, InternTable *seqTable,
+                                InternTable *tagTable, Parameter *param);
+
+int         UtilReadHitBlocks(PMHitSink sink, Ptr sinkArg, Ptr arg);
 
 ExtendedHit *UtilNewXHit(PMSeqId *seqId, PMTag *tag , PMHit *hit, Bool isProteic);
 
 void        UtilFreeXHit(void *data);
 
+Ptr         UtilCacheGet(IndexCache *cache, Int32 index);
+
+Bool        UtilCachePut(IndexCache *cache, Int32 index, Ptr data);
+
+void        UtilCacheFree(IndexCache *cache);
+
 
 #endif
@@ -0,0 +1,422 @@
+/* -----------------------------------------------------------------------
+ * $Id: PMClustCluster.c $
+ * -----------------------------------------------------------------------
+ * @file: PMClustCluster.c
+ * @desc: PMClust clustering of a (sorted) run of hits
+ *
+ * @history:
+ * @+ <Wanou> : Jan 02 : first version (in PMClustMain.c)
+ * @+ <Gloup> : Aug 06 : complete code revision
+ * @+ <Gloup> : Oct 26 : moved from PMClustMain.c, clusters are kept
+ *                       (rather than printed) so that they can be
+ *                       made in parallel (see PMClustThread.c)
+ * @+ <Gloup> : Oct 26 : hits added one at a time (Clusterizer)
+ * -----------------------------------------------------------------------
+ * @docstart:
+ *
+ * PepMap PMClust clustering functions <br>
+ *
+ * @docend:
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "LX.h"
+#include "PM.h"
+
+#include "PMClust.h"
+
+/* ----------------------------------------------- */
+/* compare ExtendedHits on sequence name, strand,  */
+/* frame (if withFrame) and from position.         */
+/* ties are broken by input rank, so that sort is  */
+/* stable whatever the qsort implementation        */
+/* ----------------------------------------------- */
+
+static int sCompareXhits(ExtendedHit *x1, ExtendedHit *x2, Bool withFrame)
+{
+  PMSeqId *s1 = x1->seqId;
+  PMSeqId *s2 = x2->seqId;
+
+  int cmp;
+
+  // first sort by seqId->name
+
+  if ((s1 != s2) && ((cmp = strcmp(s1->name, s2->name)) != 0))
+    return cmp;
+
+  // sort by strand
+
+  if ((cmp = (s1->strand - s2->strand)) != 0)
+    return cmp;
+
+  // sort by frame
+
+  if (withFrame && ((cmp = (s1->frame - s2->frame)) != 0))
+    return cmp;
+
+  // then sort by from position
+
+  if (x1->from != x2->from)
+    return ((x1->from < x2->from) ? -1 : 1);
+
+  // finally keep input order
+
+  if (x1->rank == x2->rank)
+    return 0;
+
+  return ((x1->rank < x2->rank) ? -1 : 1);
+}
+
+/* ----------------------------------------------- */
+/* clean cluster                                   */
+/* because some upstream partial hits maybe wrong  */
+/* ----------------------------------------------- */
+
+static void sCleanCluster(Cluster *cluster, Parameter *param)
+{
+  ExtendedHit *xhit, *full;
+
+  // search first full hit
+
+  full = NULL;
+
+  LXCurspToTop(cluster->xhits);
+
+  while (LXReadpDown(cluster->xhits, (Ptr *) &xhit)) {
+    if (xhit->hit->type == FullHit) {
+      full = xhit;
+      break;
+    }
+  }
+
+  // no full hit -> empty stack
+
+  if (full == NULL) {
+    cluster->xhits->top = 0;
+    return;
+  }
+
+  // skip over partial hits that are too far
+
+  LXCurspToTop(cluster->xhits);
+
+  while (LXReadpDown(cluster->xhits, (Ptr *) &xhit)) {
+    long delta = full->from - xhit->to;
+    if (delta <= param->distance)
+      break;
+  }
+
+  cluster->xhits->top = cluster->xhits->cursor + 1;
+}
+
+/* ----------------------------------------------- */
+/* count full hits in cluster                      */
+/* ----------------------------------------------- */
+
+static int sCountFullHits(Cluster *cluster)
+{
+  int count;
+  ExtendedHit *xhit;
+
+  count = 0;
+  LXCurspToTop(cluster->xhits);
+
+  while (LXReadpDown(cluster->xhits, (Ptr *) &xhit)) {
+    if (xhit->hit->type == FullHit)
+      count++;
+  }
+
+  return count;
+}
+
+/* ----------------------------------------------- */
+/* count pephits in cluster                        */
+/* ----------------------------------------------- */
+
+static int sCountPepHits(Cluster *cluster)
+{
+  long from, to;
+  int  count;
+  ExtendedHit *xhit;
+
+  from = to = -1;
+  count = 0;
+  LXCurspToTop(cluster->xhits);
+
+  while (LXReadpDown(cluster->xhits, (Ptr *) &xhit)) {
+    if (xhit->hit->type == FullHit) {
+      if (   (from < 0)
+          || (xhit->from != from)
+          || (xhit->to   != to)) {
+        count++;
+        from = xhit->from;
+        to   = xhit->to;
+      }
+    }
+  }
+
+  return count;
+}
+
+/* ----------------------------------------------- */
+/* sum hit scores in cluster                       */
+/* ----------------------------------------------- */
+
+static float sSumScore(Cluster *cluster)
+{
+  float score;
+  ExtendedHit *xhit;
+
+  score = 0.;
+  LXCurspToTop(cluster->xhits);
+
+  while (LXReadpDown(cluster->xhits, (Ptr *) &xhit)) {
+    if (xhit->hit->type == FullHit) {
+      score += xhit->hit->score;
+    }
+  }
+
+  return score;
+}
+
+/* ----------------------------------------------- */
+/* score cluster                                   */
+/* ----------------------------------------------- */
+
+static void sScoreCluster(Cluster *cluster, Parameter *param)
+{
+  cluster->nbHits    = cluster->xhits->top;
+  cluster->nbFull    = sCountFullHits(cluster);
+  cluster->nbPephits = sCountPepHits(cluster);
+  cluster->score     = sSumScore(cluster);
+}
+
+/* ----------------------------------------------- */
+/* should cluster be reported                      */
+/* ----------------------------------------------- */
+
+static Bool sKeepCluster(Cluster *cluster, Parameter *param)
+{
+  return    (cluster->xhits->top > 0)
+         && (cluster->nbFull    >= param->minFull)
+         && (cluster->nbPephits >= param->minPephits);
+}
+
+/* ----------------------------------------------- */
+/* cleanup and score cluster, then push a copy     */
+/* into clusters if it should be reported          */
+/* ----------------------------------------------- */
+
+static int sProcessCluster(Cluster *cluster, Parameter *param, LXStackp *clusters)
+{
+  Cluster *kept;
+
+  LXReverseStackp(cluster->xhits);
+  sCleanCluster(cluster, param);
+  sScoreCluster(cluster, param);
+
+  if (! sKeepCluster(cluster, param))
+    return LX_NO_ERROR;
+
+  if (! (kept = NEW(Cluster)))
+    return MEMORY_ERROR();
+
+  *kept = *cluster;
+
+  if (! (   (kept->xhits = LXCopyStackp(cluster->xhits, NULL))
+         && LXPushpIn(clusters, (Ptr) kept))) {
+    (void) ClustFreeCluster(kept);
+    return MEMORY_ERROR();
+  }
+
+  return LX_NO_ERROR;
+}
+
+/* ----------------------------------------------- */
+/* API                                             */
+/* ----------------------------------------------- */
+
+/* ----------------------------------------------- */
+/* comparison function for sorting ExtendedHit     */
+/* ** taking sequence frame into account **        */
+/* ----------------------------------------------- */
+
+int ClustSortXhitsWithFrame(const void *h1, const void *h2)
+{
+  return sCompareXhits(*((ExtendedHit **) h1), *((ExtendedHit **) h2), TRUE);
+}
+
+/* ----------------------------------------------- */
+/* comparison function for sorting ExtendedHit     */
+/* ** ignoring sequence frame **                   */
+/* ----------------------------------------------- */
+
+int ClustSortXhitsWithoutFrame(const void *h1, const void *h2)
+{
+  return sCompareXhits(*((ExtendedHit **) h1), *((ExtendedHit **) h2), FALSE);
+}
+
+/* ----------------------------------------------- */
+/* free cluster                                    */
+/* ----------------------------------------------- */
+
+Cluster *ClustFreeCluster(Cluster *cluster)
+{
+  if (cluster) {
+    if (cluster->xhits)
+      (void) LXFreeStackp(cluster->xhits, NULL);
+    FREE(cluster);
+  }
+
+  return NULL;
+}
+
+/* ----------------------------------------------- */
+/* new clusterizer : clusters to be reported will  */
+/* be pushed into clusters                         */
+/* ----------------------------------------------- */
+
+Clusterizer *ClustNewClusterizer(LXStackp *clusters)
+{
+  Clusterizer *clz;
+
+  if (! (clz = NEW(Clusterizer))) {
+    MEMORY_ERROR();
+    return NULL;
+  }
+
+  clz->currentFull = NULL;
+  clz->clusters    = clusters;
+
+  if (! (clz->cluster.xhits = LXNewStackp(LX_STKP_MIN_SIZE))) {
+    MEMORY_ERROR();
+    FREE(clz);
+    return NULL;
+  }
+
+  return clz;
+}
+
+/* ----------------------------------------------- */
+/* free clusterizer (not the clusters stack)       */
+/* ----------------------------------------------- */
+
+Clusterizer *ClustFreeClusterizer(Clusterizer *clz)
+{
+  if (clz) {
+    if (clz->cluster.xhits)
+      (void) LXFreeStackp(clz->cluster.xhits, NULL);
+    FREE(clz);
+  }
+
+  return NULL;
+}
+
+/* ----------------------------------------------- */
+/* add next hit (in ClustSortXhits order) to       */
+/* clusterizer. the current cluster is processed   */
+/* (and pushed into clusters if it should be       */
+/* reported) when xhit does not belong to it       */
+/* ----------------------------------------------- */
+
+int ClustAddHit(Clusterizer *clz, ExtendedHit *xhit, Parameter *param)
+{
+  int         stat;
+  Bool        printIt;
+  ExtendedHit *currentFull = clz->currentFull;
+
+  if (xhit->hit->type == InvalidHit)           /* ignore these guys  */
+    return LX_NO_ERROR;
+
+  if (currentFull == NULL) {                   /* first full hit     */
+    printIt = FALSE;
+  }
+                                               /* change sequence    */
+  else if (strcmp(currentFull->seqId->name, xhit->seqId->name)) {
+    printIt = TRUE;
+  }
+                                               /* change strand      */
+  else if (    (! param->isProteic)
+            && (currentFull->seqId->strand != xhit->seqId->strand)) {
+    printIt = TRUE;
+  }
+                                               /* change frame       */
+  else if (    (! param->isProteic)
+            && (param->framed)
+            && (currentFull->seqId->frame != xhit->seqId->frame)) {
+    printIt = TRUE;
+  }
+
+  else {                                       /* check distance     */
+    long delta = xhit->from - currentFull->to;
+    printIt = (delta > param->distance);
+  }
+
+  stat = LX_NO_ERROR;
+
+  if (printIt) {
+    stat = sProcessCluster(&clz->cluster, param, clz->clusters);
+
+    clz->cluster.xhits->top = 0;  /* quick way to reset stack  */
+    clz->currentFull = NULL;      /* reset cluster lower bound */
+  }
+
+  if (    (xhit->hit->type == FullHit)
+       || (param->addPartial)) {
+    if (! LXPushpIn(clz->cluster.xhits, (Ptr) xhit))
+      stat = MEMORY_ERROR();
+  }
+
+  if (xhit->hit->type == FullHit)
+    clz->currentFull = xhit;
+
+  return stat;
+}
+
+/* ----------------------------------------------- */
+/* process last cluster                            */
+/* ----------------------------------------------- */
+
+int ClustFlush(Clusterizer *clz, Parameter *param)
+{
+  int stat;
+
+  stat = sProcessCluster(&clz->cluster, param, clz->clusters);
+
+  clz->cluster.xhits->top = 0;
+  clz->currentFull = NULL;
+
+  return stat;
+}
+
+/* ----------------------------------------------- */
+/* clusterize xhits[0..nbHits[ (sorted by          */
+/* ClustSortXhits) and push the clusters to be     */
+/* reported into clusters                          */
+/* ----------------------------------------------- */
+
+int ClustMakeClusters(ExtendedHit **xhits, long nbHits, Parameter *param,
+                      LXStackp *clusters)
+{
+  int         stat;
+  long        i;
+  Clusterizer *clz;
+
+  if (! (clz = ClustNewClusterizer(clusters)))
+    return LX_MEM_ERROR;
+
+  stat = LX_NO_ERROR;
+
+  for (i = 0 ; (i < nbHits) && (stat == LX_NO_ERROR) ; i++)
+    stat = ClustAddHit(clz, xhits[i], param);
+
+  if (stat == LX_NO_ERROR)          // don't forget last cluster
+    stat = ClustFlush(clz, param);
+
+  (void) ClustFreeClusterizer(clz);
+
+  return stat;
+}
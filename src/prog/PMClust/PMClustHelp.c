@@ -7,6 +7,10 @@
  * @history:
  * @+ <Wanou> : Jul 02 : first version
  * @+ <Gloup> : Aug 06 : complete code revision
+ * @+ <Gloup> : Oct 26 : -j and -m options
+ * @+ <Gloup> : Oct 26 : Clust prefix (PMClust is linked with PMMatch in PMPipeline)
+ * @+ <Gloup> : Oct 26 : -s option
+ * @+ <Gloup> : Oct 26 : -s numbering and order caveat
  * -----------------------------------------------------------------------
  * @docstart: 
  *
@@ -28,7 +32,7 @@
 /* print startup banner                            */
 /* ----------------------------------------------- */
 
-void StartupBanner(int argc, char *argv[])
+void ClustStartupBanner(int argc, char *argv[])
 {
   int i;
   fprintf(stderr,"# ------------------------------\n");
@@ -47,7 +51,7 @@ void StartupBanner(int argc, char *argv[])
 /* print usage and exit(stat)                      */
 /* ----------------------------------------------- */
 
-void ExitUsage(int stat)
+void ClustExitUsage(int stat)
 {
   fprintf(stderr,"Usage: PMClust [options]\n");
   fprintf(stderr,"type PMClust -h for help\n");
@@ -58,7 +62,7 @@ void ExitUsage(int stat)
 /* print Help                                      */
 /* ----------------------------------------------- */
 
-void PrintHelp()
+void ClustPrintHelp()
 {
   fprintf(stderr,"Usage: PMClust [options]\n");
   fprintf(stderr," options:\n");
@@ -69,13 +73,33 @@ void PrintHelp()
   fprintf(stderr,"                    (default = off)\n");
   fprintf(stderr," -h               : print this help\n");
   fprintf(stderr," -i HitFile       : Hits filename\n");
+  fprintf(stderr,"                    in text, compact or binary format (see PMMatch -w)\n");
   fprintf(stderr,"                    (default = <stdin>)\n");
+  fprintf(stderr," -j nbThreads     : number of threads used to make clusters\n");
+  fprintf(stderr,"                    (sequences and strands are processed in parallel)\n");
+  fprintf(stderr,"                    output is identical whatever the number of threads\n");
+  fprintf(stderr,"                    (default = %d)\n", DFT_THREADS);
+  fprintf(stderr," -m maxHits       : external memory mode : sort hits by batches of\n");
+  fprintf(stderr,"                    maxHits hits spilled to temporary files, then\n");
+  fprintf(stderr,"                    merge them while making clusters (-j is ignored)\n");
+  fprintf(stderr,"                    output is identical to the in memory mode\n");
+  fprintf(stderr,"                    (default = in memory)\n");
   fprintf(stderr," -o outputFile    : output (cluster) filename\n");
   fprintf(stderr,"                    (default = <stdout>)\n");
   fprintf(stderr," -p               : add partial hits in clusters\n");
   fprintf(stderr,"                    (default = off)\n");
   fprintf(stderr," -P               : cluster in Protein mode\n");
   fprintf(stderr,"                    (default = Nucleic mode)\n");
+  fprintf(stderr," -s               : streaming mode : hits must be grouped by sequence\n");
+  fprintf(stderr,"                    (as written by PMMatch), each sequence and strand\n");
+  fprintf(stderr,"                    (and frame with -f) is clusterized as soon as it\n");
+  fprintf(stderr,"                    has been read and its clusters printed at once\n");
+  fprintf(stderr,"                    (-j is ignored, cannot be used with -m)\n");
+  fprintf(stderr,"                    clusters are numbered and printed in input order :\n");
+  fprintf(stderr,"                    same output as the other modes only if sequences\n");
+  fprintf(stderr,"                    are sorted by name, else same clusters up to\n");
+  fprintf(stderr,"                    numbering and order\n");
+  fprintf(stderr,"                    (default = off)\n");
   fprintf(stderr," -t threshold     : report only clusters with at least threshold full hits\n");
   fprintf(stderr,"                    (default = %d)\n", DFT_MIN_FULL);
   fprintf(stderr," -T threshold     : report only cluster with at least threshold pephits\n");
@@ -0,0 +1,366 @@
+/* -----------------------------------------------------------------------
+ * $Id: PMClustIntern.c $
+ * -----------------------------------------------------------------------
+ * @file: PMClustIntern.c
+ * @desc: PMClust interned seqIds and tags
+ *
+ * @history:
+ * @+ <Gloup> : Oct 26 : first version
+ * -----------------------------------------------------------------------
+ * @docstart:
+ *
+ * PepMap PMClust interned seqIds and tags <br>
+ * a table holds a single copy of each distinct record (seqId or tag).
+ * records are looked up (or inserted) in a single call, through an
+ * open addressing hash table (linear probing) of record pointers :
+ * the full comparison (UtilCompareSeqId or UtilCompareTag) is only
+ * made on records with the same hash code.
+ * records are numbered in insertion order and copied into an arena
+ * of large chunks (freed at once with the table) preceded by their
+ * index and hash code. a seqId copy is cut right after the end of
+ * its comment, that is usually much shorter than PM_SEQID_COM_LEN.
+ *
+ * @docend:
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "LX.h"
+#include "PM.h"
+
+#include "PMClust.h"
+
+/* ----------------------------------------------- */
+/* record header (in arena, before the record)     */
+/* ----------------------------------------------- */
+
+typedef union {
+  struct {
+    Int32  index;            /* insertion index     */
+    UInt32 hash;             /* record hash code    */
+  } h;
+  double align;              /* records alignment   */
+} InternHeader;
+
+#define HEADER(record) (((InternHeader *) (record)) - 1)
+
+#define ALIGNED(size)  ((((size) + sizeof(InternHeader) - 1) / sizeof(InternHeader)) \
+                        * sizeof(InternHeader))
+
+/* ----------------------------------------------- */
+/* hash bytes (FNV-1a)                             */
+/* ----------------------------------------------- */
+
+#define FNV_BASIS 2166136261U
+#define FNV_PRIME 16777619U
+
+static UInt32 sHashBytes(UInt32 hash, const void *data, size_t size)
+{
+  const unsigned char *p = (const unsigned char *) data;
+
+  while (size--) {
+    hash ^= (UInt32) *p++;
+    hash *= FNV_PRIME;
+  }
+
+  return hash;
+}
+
+/* ----------------------------------------------- */
+/* hash string (including trailing 0)              */
+/* ----------------------------------------------- */
+
+static UInt32 sHashString(UInt32 hash, const char *s)
+{
+  do {
+    hash ^= (UInt32) (unsigned char) *s;
+    hash *= FNV_PRIME;
+  } while (*s++);
+
+  return hash;
+}
+
+/* ----------------------------------------------- */
+/* hash float (+0 and -0 compare equal)            */
+/* ----------------------------------------------- */
+
+static UInt32 sHashFloat(UInt32 hash, float f)
+{
+  if (f == 0.)
+    f = 0.;
+
+  return sHashBytes(hash, &f, sizeof(float));
+}
+
+/* ----------------------------------------------- */
+/* seqId hash code and size                        */
+/* (on the fields compared by UtilCompareSeqId)    */
+/* ----------------------------------------------- */
+
+static UInt32 sHashSeqId(const void *data)
+{
+  PMSeqId *seqId = (PMSeqId *) data;
+
+  UInt32 hash = FNV_BASIS;
+
+  hash = sHashBytes(hash, &seqId->frame,  sizeof(seqId->frame));
+  hash = sHashBytes(hash, &seqId->strand, sizeof(seqId->strand));
+  hash = sHashString(hash, seqId->name);
+
+  return sHashString(hash, seqId->comment);
+}
+
+static size_t sSizeSeqId(const void *data)
+{
+  PMSeqId *seqId = (PMSeqId *) data;
+
+  return offsetof(PMSeqId, comment) + strlen(seqId->comment) + 1;
+}
+
+/* ----------------------------------------------- */
+/* tag hash code and size                          */
+/* (on the fields compared by UtilCompareTag)      */
+/* ----------------------------------------------- */
+
+static UInt32 sHashTag(const void *data)
+{
+  PMTag *tag = (PMTag *) data;
+
+  UInt32 hash = FNV_BASIS;
+
+  hash = sHashFloat(hash, tag->mN);
+  hash = sHashFloat(hash, tag->mC);
+  hash = sHashFloat(hash, tag->mParent);
+  hash = sHashFloat(hash, tag->score);
+  hash = sHashString(hash, tag->seq);
+
+  return sHashString(hash, tag->id);
+}
+
+static size_t sSizeTag(const void *data)
+{
+  return sizeof(PMTag);
+}
+
+/* ----------------------------------------------- */
+/* new table                                       */
+/* ----------------------------------------------- */
+
+static InternTable *sNewTable(UInt32 (*hash)(const void *),
+                              int    (*compare)(const void *, const void *),
+                              size_t (*size)(const void *))
+{
+  InternTable *table;
+
+  if (! (table = NEW(InternTable))) {
+    MEMORY_ERROR();
+    return NULL;
+  }
+
+  (void) memset(table, 0, sizeof(InternTable));
+
+  table->hash    = hash;
+  table->compare = compare;
+  table->size    = size;
+  table->mask    = INTERN_MIN_SLOTS - 1;
+  table->slots   = NEWN(Ptr, INTERN_MIN_SLOTS);
+  table->records = LXNewStackp(LX_STKP_MIN_SIZE);
+  table->chunks  = LXNewStackp(LX_STKP_MIN_SIZE);
+
+  if (! (table->slots && table->records && table->chunks)) {
+    MEMORY_ERROR();
+    return InternFreeTable(table);
+  }
+
+  (void) memset(table->slots, 0, INTERN_MIN_SLOTS * sizeof(Ptr));
+
+  return table;
+}
+
+/* ----------------------------------------------- */
+/* double the number of slots                      */
+/* ----------------------------------------------- */
+
+static Bool sGrowTable(InternTable *table)
+{
+  size_t i, j, mask;
+  Ptr    *slots;
+
+  mask = 2 * table->mask + 1;
+
+  if (! (slots = NEWN(Ptr, mask + 1)))
+    return FALSE;
+
+  (void) memset(slots, 0, (mask + 1) * sizeof(Ptr));
+
+  for (i = 0 ; i < (size_t) table->records->top ; i++) {
+    j = HEADER(table->records->val[i])->h.hash & mask;
+    while (slots[j])
+      j = (j + 1) & mask;
+    slots[j] = table->records->val[i];
+  }
+
+  FREE(table->slots);
+
+  table->slots = slots;
+  table->mask  = mask;
+
+  return TRUE;
+}
+
+/* ----------------------------------------------- */
+/* room for size bytes in arena                    */
+/* ----------------------------------------------- */
+
+static Ptr sArenaAlloc(InternTable *table, size_t size)
+{
+  Ptr    chunk;
+  size_t chunkSize;
+
+  if ((size_t) (table->end - table->next) < size) {
+
+    chunkSize = MAX(size, INTERN_CHUNK_SIZE);
+
+    if (! (chunk = (Ptr) NEWN(InternHeader, chunkSize / sizeof(InternHeader))))
+      return NULL;
+
+    if (! LXPushpIn(table->chunks, chunk)) {
+      FREE(chunk);
+      return NULL;
+    }
+
+    table->next = (char *) chunk;
+    table->end  = table->next + chunkSize;
+  }
+
+  chunk = (Ptr) table->next;
+
+  table->next += size;
+
+  return chunk;
+}
+
+/* ----------------------------------------------- */
+/* free arena chunk                                */
+/* ----------------------------------------------- */
+
+static void sFreeChunk(void *p)
+{
+  if (p) FREE(p);
+}
+
+/* ----------------------------------------------- */
+/* API                                             */
+/* ----------------------------------------------- */
+
+/* ----------------------------------------------- */
+/* new table of seqIds                             */
+/* ----------------------------------------------- */
+
+InternTable *InternNewSeqIds()
+{
+  return sNewTable(sHashSeqId, UtilCompareSeqId, sSizeSeqId);
+}
+
+/* ----------------------------------------------- */
+/* new table of tags                               */
+/* ----------------------------------------------- */
+
+InternTable *InternNewTags()
+{
+  return sNewTable(sHashTag, UtilCompareTag, sSizeTag);
+}
+
+/* ----------------------------------------------- */
+/* free table and its records                      */
+/* ----------------------------------------------- */
+
+InternTable *InternFreeTable(InternTable *table)
+{
+  if (table) {
+    IFFREE(table->slots);
+    if (table->records)
+      (void) LXFreeStackp(table->records, NULL);
+    if (table->chunks)
+      (void) LXFreeStackp(table->chunks, sFreeChunk);
+    FREE(table);
+  }
+
+  return NULL;
+}
+
+/* ----------------------------------------------- */
+/* get the record equal to data, a copy of data is */
+/* inserted if there is none.                      */
+/* returns NULL on memory error                    */
+/* ----------------------------------------------- */
+
+Ptr InternGet(InternTable *table, Ptr data)
+{
+  size_t       i, size;
+  UInt32       hash;
+  Ptr          record;
+  InternHeader *header;
+
+  hash = table->hash(data);
+
+  for (i = hash & table->mask ; (record = table->slots[i]) ; i = (i + 1) & table->mask) {
+    if (    (HEADER(record)->h.hash == hash)
+         && (table->compare(record, data) == 0))
+      return record;
+  }
+
+  size = table->size(data);
+
+  if (! (header = (InternHeader *) sArenaAlloc(table, sizeof(InternHeader) + ALIGNED(size)))) {
+    MEMORY_ERROR();
+    return NULL;
+  }
+
+  record = (Ptr) (header + 1);
+
+  (void) memcpy(record, data, size);
+
+  header->h.index = (Int32) table->records->top;
+  header->h.hash  = hash;
+
+  if (! LXPushpIn(table->records, record)) {
+    MEMORY_ERROR();
+    return NULL;
+  }
+
+  table->slots[i] = record;
+
+  if ((size_t) table->records->top > (table->mask + 1) / 2) {
+    if (! sGrowTable(table)) {
+      MEMORY_ERROR();
+      return NULL;
+    }
+  }
+
+  return record;
+}
+
+/* ----------------------------------------------- */
+/* insertion index of record                       */
+/* ----------------------------------------------- */
+
+Int32 InternIndex(Ptr record)
+{
+  return HEADER(record)->h.index;
+}
+
+/* ----------------------------------------------- */
+/* record by insertion index (NULL if none)        */
+/* ----------------------------------------------- */
+
+Ptr InternRecord(InternTable *table, Int32 index)
+{
+  if ((index < 0) || (index >= (Int32) table->records->top))
+    return NULL;
+
+  return table->records->val[index];
+}
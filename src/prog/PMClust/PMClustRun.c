@@ -0,0 +1,773 @@
+/* -----------------------------------------------------------------------
+ * $Id: PMClustRun.c $
+ * -----------------------------------------------------------------------
+ * @file: PMClustRun.c
+ * @desc: PepMap cluster main program
+ *
+ * @history:
+ * @+ <Wanou> : Jan 02 : first version
+ * @+ <Gloup> : Aug 06 : complete code revision
+ * @+ <Gloup> : Oct 26 : clusters made in parallel (-j)
+ * @+ <Gloup> : Oct 26 : external memory mode (-m)
+ * @+ <Gloup> : Oct 26 : moved from PMClustMain.c to ClustMain, hits
+ *                       may be pulled from a source (see PMPipeline)
+ * @+ <Gloup> : Oct 26 : streaming mode (-s)
+ * @+ <Gloup> : Oct 26 : seqIds and tags interned in hash tables
+ * @+ <Gloup> : Oct 26 : seqIds printed with two blanks before comment
+ * -----------------------------------------------------------------------
+ * @docstart: 
+ *
+ * PepMap cluster program (PMClust)<br>
+ * ClustMain runs PMClust with its command line arguments. hits are
+ * either read from stdin or, if source is not NULL, handed over by
+ * source in memory (see PMHitSource).
+ * in streaming mode (-s), hits are expected to be grouped by sequence
+ * (as written by PMMatch) : each partition (sequence name, strand and
+ * frame with -f) is sorted and clusterized as soon as its last block
+ * has been read and its clusters are printed at once, so that hits
+ * of a single partition only are kept in memory. the output is the
+ * same as in memory mode when partitions come in sort order (e.g.
+ * fasta entries sorted by name), else clusters follow input order.
+ *
+ * @docend:
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h> 
+#include <string.h> 
+
+#include "LX.h"
+#include "PM.h"
+
+#include "PMClust.h"
+
+/* -------------------------------------------------------------------- */
+/* Local functs                                                         */
+/* -------------------------------------------------------------------- */
+
+/* ----------------------------------------------- */
+/* print seqId                                     */
+/* the comment used to keep the blank separating   */
+/* it from the length when read (see PMHitFile.c), */
+/* clusters seqIds are still printed with two      */
+/* blanks for compatibility                        */
+/* ----------------------------------------------- */
+
+static void sPrintSeqId(PMSeqId *seqId)
+{
+  printf("%s %c %d %ld  %s\n", seqId->name, seqId->strand, seqId->frame, seqId->length,
+                               (*seqId->comment ? seqId->comment : "<no comment>"));
+}
+
+/* ----------------------------------------------- */
+/* print hit with Nucleotidic positions            */
+/* ----------------------------------------------- */
+
+static void sPrintNucleotidicHit(ExtendedHit *xhit)
+{
+  long oldMn, oldSn, oldMc, oldSc;
+   
+  oldMn = xhit->hit->posMn;
+  oldSn = xhit->hit->posSn;
+  oldMc = xhit->hit->posMc;
+  oldSc = xhit->hit->posSc;
+
+  UtilNucleotidicPosition(xhit->seqId,   xhit->hit->posMn,    xhit->hit->posMc, 
+                                       &(xhit->hit->posMn), &(xhit->hit->posMc));
+  UtilNucleotidicPosition(xhit->seqId,   xhit->hit->posSn,    xhit->hit->posSc, 
+                                       &(xhit->hit->posSn), &(xhit->hit->posSc));
+
+  (void) PMWriteHit(stdout, xhit->hit);
+  
+  xhit->hit->posMn = oldMn;
+  xhit->hit->posSn = oldSn;
+  xhit->hit->posMc = oldMc;
+  xhit->hit->posSc = oldSc;
+}
+
+/* ----------------------------------------------- */
+/* print cluster                                   */
+/* ----------------------------------------------- */
+
+static int sPrintCluster(Cluster *cluster, Parameter *param, int clustIndex)
+{
+  ExtendedHit *xhit;
+
+  if (cluster->xhits->top <= 0)
+    return clustIndex;
+    
+  if (cluster->nbFull < param->minFull)
+    return clustIndex;
+
+  if (cluster->nbPephits < param->minPephits)
+    return clustIndex;
+
+  clustIndex++;
+  
+  printf("CLUSTER %d %d %d %d %g\n", clustIndex,
+                                     cluster->nbHits, cluster->nbFull, 
+                                     cluster->nbPephits, cluster->score);
+
+  LXCurspToTop(cluster->xhits);
+
+  while (LXReadpDown(cluster->xhits, (Ptr *) &xhit)) {
+    sPrintSeqId(xhit->seqId);
+    (void) PMWriteTag(stdout, xhit->tag);
+    if (param->isProteic) {
+      (void) PMWriteHit(stdout, xhit->hit);
+    }
+    else {
+      sPrintNucleotidicHit(xhit);
+    }
+  }
+  
+  printf("%cEndOfCluster\n", PM_END_OF_RECORD);
+  
+  return clustIndex;
+}
+
+/* ----------------------------------------------- */
+/* print stack of clusters (in order)              */
+/* ----------------------------------------------- */
+
+static int sPrintStack(LXStackp *clusters, Parameter *param, int clustIndex)
+{
+  long    i;
+  Cluster *cluster;
+
+  for (i = 0 ; i < (long) clusters->top ; i++) {
+    cluster    = (Cluster *) LXStackpGetValue(clusters, i);
+    clustIndex = sPrintCluster(cluster, param, clustIndex);
+  }
+
+  return clustIndex;
+}
+
+/* ----------------------------------------------- */
+/* print clusters of partitions (in order)         */
+/* ----------------------------------------------- */
+
+static int sPrintClusters(Partition *parts, long nbParts, Parameter *param)
+{
+  int     clustIndex;
+  long    ipart;
+
+  clustIndex = 0;
+
+  for (ipart = 0 ; ipart < nbParts ; ipart++)
+    clustIndex = sPrintStack(parts[ipart].clusters, param, clustIndex);
+
+  return clustIndex;
+}
+
+/* ----------------------------------------------- */
+/* print then free reported clusters               */
+/* ----------------------------------------------- */
+
+static int sFlushClusters(LXStackp *clusters, Parameter *param, int clustIndex)
+{
+  Cluster *cluster;
+
+  clustIndex = sPrintStack(clusters, param, clustIndex);
+
+  while (LXPoppOut(clusters, (Ptr *) &cluster))
+    (void) ClustFreeCluster(cluster);
+
+  return clustIndex;
+}
+
+/* ----------------------------------------------- */
+/* free pending hits (read since last release)     */
+/* that cannot belong to current cluster anymore   */
+/* i.e. all of them if the cluster is empty or all */
+/* but the last one if it is alone in cluster      */
+/* ----------------------------------------------- */
+
+static void sReleaseHits(LXStackp *pending, LXStackp *current)
+{
+  ExtendedHit *last;
+
+  if (current->top > 1)
+    return;
+
+  if ((current->top == 1) && (current->val[0] != pending->val[pending->top - 1]))
+    return;
+
+  last = NULL;
+
+  if (current->top == 1)
+    (void) LXPoppOut(pending, (Ptr *) &last);
+
+  while (pending->top > 0)
+    UtilFreeXHit(pending->val[--pending->top]);
+
+  if (last)
+    (void) LXPushpIn(pending, (Ptr) last);
+}
+
+/* ----------------------------------------------- */
+/* cluster stream : sorted hits are clusterized    */
+/* and clusters printed on the fly                 */
+/* ----------------------------------------------- */
+
+typedef struct {
+  int         clustIndex;
+  LXStackp    *clusters;
+  LXStackp    *pending;
+  Clusterizer *clz;
+} ClusterStream;
+
+/* ----------------------------------------------- */
+/* open cluster stream                             */
+/* ----------------------------------------------- */
+
+static int sOpenStream(ClusterStream *stream)
+{
+  stream->clustIndex = 0;
+  stream->clusters   = LXNewStackp(LX_STKP_MIN_SIZE);
+  stream->pending    = LXNewStackp(LX_STKP_MIN_SIZE);
+  stream->clz        = (stream->clusters ? ClustNewClusterizer(stream->clusters) : NULL);
+
+  if (stream->clusters && stream->pending && stream->clz)
+    return LX_NO_ERROR;
+
+  return MEMORY_ERROR();
+}
+
+/* ----------------------------------------------- */
+/* add next hit (in ClustSortXhits order) to       */
+/* stream, the stream owns xhit from now on        */
+/* ----------------------------------------------- */
+
+static int sStreamHit(ClusterStream *stream, ExtendedHit *xhit, Parameter *param)
+{
+  int stat;
+
+  if (! LXPushpIn(stream->pending, (Ptr) xhit)) {
+    UtilFreeXHit(xhit);
+    return MEMORY_ERROR();
+  }
+
+  stat = ClustAddHit(stream->clz, xhit, param);
+
+  stream->clustIndex = sFlushClusters(stream->clusters, param, stream->clustIndex);
+
+  sReleaseHits(stream->pending, stream->clz->cluster.xhits);
+
+  return stat;
+}
+
+/* ----------------------------------------------- */
+/* close cluster stream (flushing last cluster if  */
+/* stat is LX_NO_ERROR)                            */
+/* returns the number of clusters (-1 on error)    */
+/* ----------------------------------------------- */
+
+static int sCloseStream(ClusterStream *stream, int stat, Parameter *param)
+{
+  if (stat == LX_NO_ERROR)          // don't forget last cluster
+    stat = ClustFlush(stream->clz, param);
+
+  if (stream->clusters)
+    stream->clustIndex = sFlushClusters(stream->clusters, param, stream->clustIndex);
+
+  (void) ClustFreeClusterizer(stream->clz);
+
+  if (stream->clusters) (void) LXFreeStackp(stream->clusters, NULL);
+  if (stream->pending)  (void) LXFreeStackp(stream->pending, UtilFreeXHit);
+
+  return ((stat == LX_NO_ERROR) ? stream->clustIndex : -1);
+}
+
+/* ----------------------------------------------- */
+/* external memory mode : clusterize and print     */
+/* merged hits on the fly                          */
+/* returns the number of clusters (-1 on error)    */
+/* ----------------------------------------------- */
+
+static int sStreamClusters(HitSorter *sorter, Parameter *param)
+{
+  int           stat;
+  ExtendedHit   *xhit;
+  ClusterStream stream;
+
+  stat = sOpenStream(&stream);
+
+  while ((stat == LX_NO_ERROR) && (xhit = SpillNextHit(sorter, &stat)))
+    stat = sStreamHit(&stream, xhit, param);
+
+  return sCloseStream(&stream, stat, param);
+}
+
+/* ----------------------------------------------- */
+/* streaming mode : hits of current partition      */
+/* ----------------------------------------------- */
+
+typedef struct {
+  long          nbHits;     /* number of hits read     */
+  long          nbParts;    /* number of partitions    */
+  PMSeqId       *key;       /* current partition key   */
+  LXStackp      *hits;      /* current partition hits  */
+  LXDict        *done;      /* ended partitions keys   */
+  InternTable   *seqTable;
+  InternTable   *tagTable;
+  Parameter     *param;
+  ClusterStream stream;
+} SeqStreamer;
+
+static Parameter *sParam = NULL;   /* for sCompareKeys only */
+
+/* ----------------------------------------------- */
+/* compare seqIds on partition keys                */
+/* ----------------------------------------------- */
+
+static int sCompareKeys(const void *p1, const void *p2)
+{
+  return ThreadCompareSeqKeys((PMSeqId *) p1, (PMSeqId *) p2, sParam);
+}
+
+/* ----------------------------------------------- */
+/* streaming mode : sort current partition then    */
+/* clusterize it. clusters are printed at once,    */
+/* but for the last one (that may still get the    */
+/* partial hits of next partition)                 */
+/* ----------------------------------------------- */
+
+static int sEndPartition(SeqStreamer *streamer)
+{
+  int      stat;
+  long     i;
+  LXStackp *hits = streamer->hits;
+
+  if (! streamer->key)
+    return LX_NO_ERROR;
+
+  qsort(hits->val, hits->top, sizeof(ExtendedHit *),
+        (streamer->param->framed ? ClustSortXhitsWithFrame
+                                 : ClustSortXhitsWithoutFrame));
+
+  for (i = 0, stat = LX_NO_ERROR ; i < (long) hits->top ; i++) {
+    if (stat == LX_NO_ERROR)
+      stat = sStreamHit(&streamer->stream, (ExtendedHit *) hits->val[i], streamer->param);
+    else
+      UtilFreeXHit(hits->val[i]);
+  }
+
+  hits->top = 0;
+
+  (void) LXAddDict(streamer->done, (Ptr) streamer->key);
+
+  streamer->key = NULL;
+  streamer->nbParts++;
+
+  return stat;
+}
+
+/* ----------------------------------------------- */
+/* streaming mode : sink of hits, the current      */
+/* partition ends with the first block of another  */
+/* one. a partition cannot show up twice           */
+/* ----------------------------------------------- */
+
+static int sStreamHits(Ptr arg, Int32 isid, PMSeqId *seqId,
+                       Int32 itag, PMTag *tag, PMHitStack *hits)
+{
+  int         stat;
+  SeqStreamer *streamer = (SeqStreamer *) arg;
+
+  if (    streamer->key
+       && ThreadCompareSeqKeys(streamer->key, seqId, streamer->param)) {
+    if ((stat = sEndPartition(streamer)) != LX_NO_ERROR)
+      return stat;
+  }
+
+  if ((! streamer->key) && LXHasDict(streamer->done, (Ptr) seqId)) {
+    fprintf(stderr, "# hits of %s %c %d are not grouped by sequence\n",
+                    seqId->name, seqId->strand, seqId->frame);
+    return LX_ARG_ERROR;
+  }
+
+  streamer->nbHits += (long) hits->top;
+
+  stat = UtilAddExtendedHits(streamer->hits, seqId, tag, hits,
+                             streamer->seqTable, streamer->tagTable,
+                             streamer->param);
+
+  if ((! streamer->key) && (streamer->hits->top > 0))
+    streamer->key = ((ExtendedHit *) streamer->hits->val[0])->seqId;
+
+  return stat;
+}
+
+/* ----------------------------------------------- */
+/* source mode : in memory hits collector          */
+/* ----------------------------------------------- */
+
+typedef struct {
+  LXStackp    *hits;
+  InternTable *seqTable;
+  InternTable *tagTable;
+  Parameter   *param;
+} Collector;
+
+/* ----------------------------------------------- */
+/* source mode : sink of in memory hits            */
+/* ----------------------------------------------- */
+
+static int sCollectHits(Ptr arg, Int32 isid, PMSeqId *seqId,
+                        Int32 itag, PMTag *tag, PMHitStack *hits)
+{
+  Collector *collector = (Collector *) arg;
+
+  return UtilAddExtendedHits(collector->hits, seqId, tag, hits,
+                             collector->seqTable, collector->tagTable,
+                             collector->param);
+}
+
+/* ----------------------------------------------- */
+/* source mode : sink of external memory hits      */
+/* seqIds and tags are interned by their tables    */
+/* (as in text format) whatever their index        */
+/* ----------------------------------------------- */
+
+static int sSpillHits(Ptr arg, Int32 isid, PMSeqId *seqId,
+                      Int32 itag, PMTag *tag, PMHitStack *hits)
+{
+  return SpillAddHits((HitSorter *) arg, -1, seqId, -1, tag, hits);
+}
+
+/* -------------------------------------------------------------------- */
+/* API                                                                  */
+/* -------------------------------------------------------------------- */
+
+/* ----------------------------------------------- */
+/* run PMClust with command line arguments         */
+/* hits are pulled from source (with sourceArg) if */
+/* source is not NULL, else they are read from     */
+/* stdin                                           */
+/* ----------------------------------------------- */
+
+int ClustMain(int argc, char *argv[], PMHitSource source, Ptr sourceArg)
+{  
+  extern char *optarg;
+
+  Collector collector;
+
+  SeqStreamer streamer;
+  
+  int opt, nbClust, stat;
+
+  long nbParts;
+
+  Partition *parts;
+
+  HitSorter *sorter;
+
+  InternTable *tagTable, *seqTable;
+  
+  Parameter param;
+  
+  char inputFilename[BUFSIZ],
+       outputFilename[BUFSIZ];
+
+  /* --------------------------------- */
+  /* setup default parameters          */
+  
+  param.distance           = DFT_DISTANCE;
+  param.minFull            = DFT_MIN_FULL;
+  param.minPephits         = DFT_MIN_PEPHITS;
+  param.isProteic          = FALSE;
+  param.framed             = FALSE;
+  param.addPartial         = FALSE;
+  param.verbose            = FALSE;
+  param.nbThreads          = DFT_THREADS;
+  param.maxHits            = DFT_MAX_HITS;
+  param.streamed           = FALSE;
+  
+  *inputFilename  = '\000';
+  *outputFilename = '\000';
+
+  /* --------------------------------- */
+  /* get user's parameters             */
+
+  while ((opt = getopt(argc, argv, "d:fHhi:j:m:o:pPst:T:v")) != -1) {
+  
+    switch (opt) {
+      
+      case 'd':                                   // clustering distance
+        if (   (sscanf(optarg, "%d", &param.distance) != 1)
+            || (param.distance <= 0)) {
+          fprintf(stderr, "# Wrong value for clustering distance\n");
+          ClustExitUsage(LX_ARG_ERROR);
+        }
+        break;
+
+      case 'f' :                                  // force frame clustering
+        param.framed = TRUE;
+        break;
+
+      case 'H' :                                  // help
+      case 'h' :
+        ClustPrintHelp();
+        exit(0);
+        break;
+  
+      case 'i' :                                  // input (hits) filename
+        if (source) {
+          fprintf(stderr, "# -i option cannot be used in pipeline mode\n");
+          ClustExitUsage(LX_ARG_ERROR);
+        }
+        (void) strcpy(inputFilename, optarg);
+        if(! LXAssignToStdin(inputFilename)) {
+          fprintf(stderr,"# Cannot open : %s\n", inputFilename);
+          exit (LX_IO_ERROR); 
+        }
+        break;
+        break;
+
+      case 'j':                                   // number of threads
+        if (   (sscanf(optarg, "%d", &param.nbThreads) != 1)
+            || (param.nbThreads <= 0)) {
+          fprintf(stderr, "# Wrong value for number of threads\n");
+          ClustExitUsage(LX_ARG_ERROR);
+        }
+        break;
+
+      case 'm':                                   // external memory mode
+        if (   (sscanf(optarg, "%ld", &param.maxHits) != 1)
+            || (param.maxHits <= 0)) {
+          fprintf(stderr, "# Wrong value for max hits in memory\n");
+          ClustExitUsage(LX_ARG_ERROR);
+        }
+        break;
+
+      case 'o' :                                  // output (hits) filename
+	    (void) strcpy(outputFilename, optarg);
+        if (! LXAssignToStdout(outputFilename)) {
+          fprintf(stderr,"# Cannot create : %s\n", outputFilename);
+          exit (LX_IO_ERROR);
+        }
+        break;
+
+      case 'p' :                                  // add partial
+        param.addPartial = TRUE;
+        break;
+
+      case 'P' :                                  // Protein mode
+        param.isProteic = TRUE;
+        break;
+
+      case 's' :                                  // streaming mode
+        param.streamed = TRUE;
+        break;
+
+      case 't':                                   // min full hits
+        if (   (sscanf(optarg, "%d", &param.minFull) != 1)
+            || (param.minFull <= 0)) {
+          fprintf(stderr, "# Wrong value for minimum full hits\n");
+          ClustExitUsage(LX_ARG_ERROR);
+        }
+        break;
+
+      case 'T':                                   // min pephits
+        if (   (sscanf(optarg, "%d", &param.minPephits) != 1)
+            || (param.minPephits <= 0)) {
+          fprintf(stderr, "# Wrong value for minimum pephits\n");
+          ClustExitUsage(LX_ARG_ERROR);
+        }
+        break;
+
+      case 'v' :                                  // verbose mode
+        param.verbose = TRUE;
+        break;
+
+      case '?' :                                  // oops !
+        ClustExitUsage(LX_ARG_ERROR);
+        break;      
+    }
+  }
+
+  /* --------------------------------- */
+  /* adjust parameters                 */
+
+  /* for proteic cluster :             */
+  /* set distance to infinity          */
+
+  if (param.isProteic) {
+    param.distance = BIG_INT32;
+  }
+
+  if (param.streamed && (param.maxHits > 0)) {
+    fprintf(stderr, "# -s and -m options are exclusive\n");
+    ClustExitUsage(LX_ARG_ERROR);
+  }
+
+  /* --------------------------------- */
+  /* go ahead                          */
+
+  ClustStartupBanner(argc, argv);
+  
+  tagTable = InternNewTags();
+  seqTable = InternNewSeqIds();
+
+  if (! (tagTable && seqTable)) {
+     LX_ERROR("Cannot read hits", 10);
+  }
+  
+  /* --------------------------------- */
+  /* streaming mode : each partition   */
+  /* is clusterized as soon as it has  */
+  /* been read                         */
+
+  if (param.streamed) {
+
+    streamer.nbHits   = 0;
+    streamer.nbParts  = 0;
+    streamer.key      = NULL;
+    streamer.hits     = LXNewStackp(LX_STKP_MIN_SIZE);
+    streamer.done     = LXNewDict(sCompareKeys);
+    streamer.seqTable = seqTable;
+    streamer.tagTable = tagTable;
+    streamer.param    = &param;
+
+    sParam = &param;
+
+    if (! (streamer.hits && streamer.done)) {
+       MEMORY_ERROR();
+       LX_ERROR("Cannot make clusters", 10);
+    }
+
+    if (param.verbose) 
+      fprintf(stderr, "# making clusters\n");
+
+    stat = sOpenStream(&streamer.stream);
+
+    if (stat == LX_NO_ERROR)
+      stat = (source ? source : UtilReadHitBlocks)(sStreamHits, (Ptr) &streamer, sourceArg);
+
+    if (stat == LX_NO_ERROR)
+      stat = sEndPartition(&streamer);
+
+    if ((nbClust = sCloseStream(&streamer.stream, stat, &param)) < 0) {
+       LX_ERROR("Cannot make clusters", 10);
+    }
+
+    if (param.verbose) {
+      fprintf(stderr, "# %ld hits read, %ld partitions\n", streamer.nbHits, streamer.nbParts);
+      fprintf(stderr, "# %d clusters\n", nbClust);
+    }
+
+    (void) LXFreeStackp(streamer.hits, UtilFreeXHit);
+    (void) LXFreeDict(streamer.done, NULL);
+
+    (void) InternFreeTable(seqTable);
+    (void) InternFreeTable(tagTable);
+
+    return LX_NO_ERROR;
+  }
+
+  /* --------------------------------- */
+  /* external memory mode : hits are   */
+  /* sorted by batches into temporary  */
+  /* runs, that are merged while       */
+  /* making clusters                   */
+
+  if (param.maxHits > 0) {
+
+    if (source) {
+      if (   (! (sorter = SpillNewSorter(seqTable, tagTable, &param)))
+          || (source(sSpillHits, (Ptr) sorter, sourceArg) != LX_NO_ERROR)
+          || (SpillEndHits(sorter) != LX_NO_ERROR)) {
+         LX_ERROR("Cannot read hits", 10);
+      }
+    }
+    else if (! (sorter = SpillReadHits(seqTable, tagTable, &param))) {
+       LX_ERROR("Cannot read hits", 10);
+    }
+
+    if (param.verbose) 
+      fprintf(stderr, "# %ld hits read, %ld sorted runs\n", sorter->nbHits, sorter->nbRuns);
+
+    if (param.verbose) 
+      fprintf(stderr, "# making clusters\n");
+
+    if ((nbClust = sStreamClusters(sorter, &param)) < 0) {
+       LX_ERROR("Cannot make clusters", 10);
+    }
+
+    sorter = SpillFreeSorter(sorter);
+
+    if (param.verbose) 
+      fprintf(stderr, "# %d clusters\n", nbClust);
+
+    (void) InternFreeTable(seqTable);
+    (void) InternFreeTable(tagTable);
+
+    return LX_NO_ERROR;
+  }
+
+  /* --------------------------------- */
+  /* read hits                         */
+
+  LXStackp *allHits;
+  
+  allHits = LXNewStackp(LX_STKP_MIN_SIZE);
+
+  collector.hits     = allHits;
+  collector.seqTable = seqTable;
+  collector.tagTable = tagTable;
+  collector.param    = &param;
+  
+  if (source) {
+    if (source(sCollectHits, (Ptr) &collector, sourceArg) != LX_NO_ERROR) {
+       LX_ERROR("Cannot read hits", 10);
+    }
+  }
+  else if (UtilReadExtendedHits(allHits, seqTable, tagTable, &param) != LX_NO_ERROR) {
+     LX_ERROR("Cannot read hits", 10);
+  }
+  
+  if (param.verbose) 
+    fprintf(stderr, "# %ld hits read\n", allHits->top);
+
+  /* --------------------------------- */
+  /* make clusters : hits are          */
+  /* partitioned by sequence, strand   */
+  /* (and frame) then partitions are   */
+  /* sorted and clusterized (in        */
+  /* parallel in multithreaded mode)   */
+
+  if (param.verbose) 
+    fprintf(stderr, "# making clusters\n");
+
+  stat = ThreadMakeClusters(allHits, &param, &parts, &nbParts);
+
+  if (stat != LX_NO_ERROR) {
+     LX_ERROR("Cannot make clusters", 10);
+  }
+
+  if (param.verbose) 
+    fprintf(stderr, "# %ld partitions, %d thread(s)\n", nbParts, param.nbThreads);
+
+  /* --------------------------------- */
+  /* print clusters in serial order    */
+
+  nbClust = sPrintClusters(parts, nbParts, &param);
+
+  parts = ThreadFreePartitions(parts, nbParts);
+
+  if (param.verbose) 
+    fprintf(stderr, "# %d clusters\n", nbClust);
+
+  /* --------------------------------- */
+  /* end                               */
+
+  (void) LXFreeStackp(allHits, UtilFreeXHit);
+  
+  (void) InternFreeTable(seqTable);
+  (void) InternFreeTable(tagTable);
+
+  return LX_NO_ERROR;
+}
+
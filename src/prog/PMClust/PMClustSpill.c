@@ -0,0 +1,646 @@
+/* -----------------------------------------------------------------------
+ * $Id: PMClustSpill.c $
+ * -----------------------------------------------------------------------
+ * @file: PMClustSpill.c
+ * @desc: PMClust external memory hits sorter
+ *
+ * @history:
+ * @+ <Gloup> : Oct 26 : first version
+ * @+ <Gloup> : Oct 26 : seqIds and tags cached by hit file index
+ * @+ <Gloup> : Oct 26 : hits may be added by blocks (SpillAddHits)
+ * @+ <Gloup> : Oct 26 : seqIds and tags indexed by their intern table
+ * -----------------------------------------------------------------------
+ * @docstart:
+ *
+ * PepMap PMClust external memory hits sorter <br>
+ * hits are read by batches of (about) param->maxHits hits. each
+ * batch is sorted (see ClustSortXhits) and written into a temporary
+ * run of compact binary records. runs are k-way merged (at most
+ * SPILL_MAX_RUNS at once) : as soon as SPILL_MAX_RUNS runs of the same
+ * level are available while reading (so that the number of temporary
+ * files stays small), then at end of input. the final merge delivers
+ * hits one at a time, in the very same order as the in memory sort,
+ * so that they can be clusterized on the fly.
+ * seqIds and tags are kept (interned) in memory : a record only
+ * holds their index (see InternIndex), the input rank and the hit
+ * itself.
+ *
+ * @docend:
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "LX.h"
+#include "PM.h"
+
+#include "PMClust.h"
+
+/* ----------------------------------------------- */
+/* sorted run and its current (smallest) hit       */
+/* ----------------------------------------------- */
+
+typedef struct {
+  FILE        *file;
+  ExtendedHit *head;
+  int         level;     /* number of merges */
+} HitRun;
+
+/* ----------------------------------------------- */
+/* compare ExtendedHits in sorter order            */
+/* ----------------------------------------------- */
+
+static int sCompareXhits(HitSorter *sorter, ExtendedHit *x1, ExtendedHit *x2)
+{
+  return (sorter->param->framed ? ClustSortXhitsWithFrame(&x1, &x2)
+                                : ClustSortXhitsWithoutFrame(&x1, &x2));
+}
+
+/* ----------------------------------------------- */
+/* write hit record                                */
+/* ----------------------------------------------- */
+
+static int sWriteHit(FILE *file, ExtendedHit *xhit)
+{
+  if (LXBinWriteInt32(file, InternIndex(xhit->seqId)) != 1)
+    return IO_ERROR();
+
+  if (LXBinWriteInt32(file, InternIndex(xhit->tag)) != 1)
+    return IO_ERROR();
+
+  if (LXBinWriteInt64(file, (Int64) xhit->rank) != 1)
+    return IO_ERROR();
+
+  if (PMBinWriteHit(file, xhit->hit) <= 0)
+    return IO_ERROR();
+
+  return LX_NO_ERROR;
+}
+
+/* ----------------------------------------------- */
+/* read hit record                                 */
+/* returns NULL at end of file or on error (stat)  */
+/* ----------------------------------------------- */
+
+static ExtendedHit *sReadHit(HitSorter *sorter, FILE *file, int *stat)
+{
+  Int32       iseq, itag;
+  Int64       rank;
+  PMSeqId     *seqId;
+  PMTag       *tag;
+  PMHit       *hit;
+  ExtendedHit *xhit;
+
+  *stat = LX_NO_ERROR;
+
+  if (LXBinReadInt32(file, &iseq) != 1) {
+    if (! feof(file))
+      *stat = IO_ERROR();
+    return NULL;
+  }
+
+  if (   (LXBinReadInt32(file, &itag) != 1)
+      || (LXBinReadInt64(file, &rank) != 1)
+      || (! (seqId = (PMSeqId *) InternRecord(sorter->seqTable, iseq)))
+      || (! (tag   = (PMTag *)   InternRecord(sorter->tagTable, itag)))) {
+    *stat = IO_ERROR();
+    return NULL;
+  }
+
+  if (! (hit = PMNewHit())) {
+    *stat = LX_MEM_ERROR;
+    return NULL;
+  }
+
+  if (PMBinReadHit(file, hit) <= 0) {
+    (void) PMFreeHit(hit);
+    *stat = IO_ERROR();
+    return NULL;
+  }
+
+  xhit = UtilNewXHit(seqId, tag, hit, sorter->param->isProteic);
+
+  if (! xhit) {
+    (void) PMFreeHit(hit);
+    *stat = LX_MEM_ERROR;
+    return NULL;
+  }
+
+  xhit->rank = (long) rank;
+
+  return xhit;
+}
+
+/* ----------------------------------------------- */
+/* new (empty) run, in a temporary file            */
+/* ----------------------------------------------- */
+
+static HitRun *sNewRun()
+{
+  HitRun *run;
+
+  if (! (run = NEW(HitRun))) {
+    MEMORY_ERROR();
+    return NULL;
+  }
+
+  run->head  = NULL;
+  run->level = 0;
+
+  if (! (run->file = tmpfile())) {
+    FIO_ERROR("cannot create temporary file");
+    FREE(run);
+    return NULL;
+  }
+
+  return run;
+}
+
+/* ----------------------------------------------- */
+/* free run (and close its temporary file)         */
+/* ----------------------------------------------- */
+
+static void sFreeRun(void *data)
+{
+  HitRun *run = (HitRun *) data;
+
+  if (run) {
+    if (run->file)
+      (void) fclose(run->file);
+    UtilFreeXHit(run->head);
+    FREE(run);
+  }
+}
+
+/* ----------------------------------------------- */
+/* sort batch of hits and write it into a new run  */
+/* hits are freed                                  */
+/* ----------------------------------------------- */
+
+static int sSpillBatch(HitSorter *sorter, LXStackp *batch, LXStackp *runs)
+{
+  int         stat;
+  size_t      i;
+  HitRun      *run;
+
+  qsort(batch->val, batch->top, sizeof(Ptr),
+        (sorter->param->framed ? ClustSortXhitsWithFrame
+                               : ClustSortXhitsWithoutFrame));
+
+  if (! (run = sNewRun()))
+    return LX_IO_ERROR;
+
+  for (i = 0, stat = LX_NO_ERROR ; i < batch->top ; i++) {
+    if (stat == LX_NO_ERROR)
+      stat = sWriteHit(run->file, (ExtendedHit *) batch->val[i]);
+    UtilFreeXHit(batch->val[i]);
+  }
+
+  batch->top = 0;
+
+  if ((stat == LX_NO_ERROR) && (fflush(run->file) != 0))
+    stat = IO_ERROR();
+
+  if ((stat == LX_NO_ERROR) && ! LXPushpIn(runs, (Ptr) run))
+    stat = MEMORY_ERROR();
+
+  if (stat != LX_NO_ERROR) {
+    sFreeRun(run);
+    return stat;
+  }
+
+  rewind(run->file);
+
+  return LX_NO_ERROR;
+}
+
+/* ----------------------------------------------- */
+/* merge heap (smallest head on top)               */
+/* ----------------------------------------------- */
+
+static Bool sHeapLess(HitSorter *sorter, size_t i, size_t j)
+{
+  HitRun *ri = (HitRun *) sorter->heap->val[i];
+  HitRun *rj = (HitRun *) sorter->heap->val[j];
+
+  return (sCompareXhits(sorter, ri->head, rj->head) < 0);
+}
+
+static void sHeapSwap(HitSorter *sorter, size_t i, size_t j)
+{
+  Ptr tmp = sorter->heap->val[i];
+
+  sorter->heap->val[i] = sorter->heap->val[j];
+  sorter->heap->val[j] = tmp;
+}
+
+static void sHeapDown(HitSorter *sorter, size_t i)
+{
+  size_t child, n = sorter->heap->top;
+
+  while ((child = 2 * i + 1) < n) {
+    if ((child + 1 < n) && sHeapLess(sorter, child + 1, child))
+      child++;
+    if (! sHeapLess(sorter, child, i))
+      break;
+    sHeapSwap(sorter, i, child);
+    i = child;
+  }
+}
+
+static void sHeapUp(HitSorter *sorter, size_t i)
+{
+  size_t parent;
+
+  while (i > 0) {
+    parent = (i - 1) / 2;
+    if (! sHeapLess(sorter, i, parent))
+      break;
+    sHeapSwap(sorter, i, parent);
+    i = parent;
+  }
+}
+
+/* ----------------------------------------------- */
+/* start merging runs : read their first hit and   */
+/* push them into heap. runs are moved to heap     */
+/* (or freed if empty)                             */
+/* ----------------------------------------------- */
+
+static int sMergeStart(HitSorter *sorter, LXStackp *runs)
+{
+  int    stat;
+  HitRun *run;
+
+  stat = LX_NO_ERROR;
+
+  while (LXPoppOut(runs, (Ptr *) &run)) {
+
+    if (stat == LX_NO_ERROR)
+      run->head = sReadHit(sorter, run->file, &stat);
+
+    if (! run->head) {
+      sFreeRun(run);
+      continue;
+    }
+
+    if (! LXPushpIn(sorter->heap, (Ptr) run)) {
+      sFreeRun(run);
+      stat = MEMORY_ERROR();
+      continue;
+    }
+
+    sHeapUp(sorter, sorter->heap->top - 1);
+  }
+
+  return stat;
+}
+
+/* ----------------------------------------------- */
+/* next merged hit (NULL at end or on error)       */
+/* ----------------------------------------------- */
+
+static ExtendedHit *sMergeNext(HitSorter *sorter, int *stat)
+{
+  HitRun      *run;
+  ExtendedHit *xhit;
+
+  *stat = LX_NO_ERROR;
+
+  if (sorter->heap->top == 0)
+    return NULL;
+
+  run  = (HitRun *) sorter->heap->val[0];
+  xhit = run->head;
+
+  run->head = sReadHit(sorter, run->file, stat);
+
+  if (! run->head) {              // run exhausted (or error)
+    sorter->heap->val[0] = sorter->heap->val[--sorter->heap->top];
+    sFreeRun(run);
+  }
+
+  sHeapDown(sorter, 0);
+
+  if (*stat != LX_NO_ERROR) {
+    UtilFreeXHit(xhit);
+    return NULL;
+  }
+
+  return xhit;
+}
+
+/* ----------------------------------------------- */
+/* merge the n runs on top of sorter->runs into a  */
+/* single run (one level up)                       */
+/* ----------------------------------------------- */
+
+static int sMergeTopRuns(HitSorter *sorter, size_t n)
+{
+  int         stat, level;
+  size_t      i;
+  HitRun      *run;
+  LXStackp    *group;
+  ExtendedHit *xhit;
+
+  if (! (group = LXNewStackp(n)))
+    return MEMORY_ERROR();
+
+  for (i = 0, level = 0 ; (i < n) && LXPoppOut(sorter->runs, (Ptr *) &run) ; i++) {
+    level = MAX(level, run->level);
+    (void) LXPushpIn(group, (Ptr) run);
+  }
+
+  if (! (run = sNewRun())) {
+    (void) LXFreeStackp(group, sFreeRun);
+    return LX_IO_ERROR;
+  }
+
+  run->level = level + 1;
+
+  stat = sMergeStart(sorter, group);
+
+  while ((stat == LX_NO_ERROR) && (xhit = sMergeNext(sorter, &stat))) {
+    stat = sWriteHit(run->file, xhit);
+    UtilFreeXHit(xhit);
+  }
+
+  (void) LXFreeStackp(group, sFreeRun);
+
+  if ((stat == LX_NO_ERROR) && (fflush(run->file) != 0))
+    stat = IO_ERROR();
+
+  if ((stat == LX_NO_ERROR) && ! LXPushpIn(sorter->runs, (Ptr) run))
+    stat = MEMORY_ERROR();
+
+  if (stat != LX_NO_ERROR) {
+    sFreeRun(run);
+    return stat;
+  }
+
+  rewind(run->file);
+
+  return LX_NO_ERROR;
+}
+
+/* ----------------------------------------------- */
+/* merge the last SPILL_MAX_RUNS runs as long as   */
+/* they have the same level, so that the number of */
+/* (open) runs stays logarithmic                   */
+/* ----------------------------------------------- */
+
+static int sCascadeRuns(HitSorter *sorter)
+{
+  int      stat;
+  LXStackp *runs = sorter->runs;
+
+  stat = LX_NO_ERROR;
+
+  while (    (stat == LX_NO_ERROR)
+          && (runs->top >= SPILL_MAX_RUNS)
+          && (   ((HitRun *) runs->val[runs->top - SPILL_MAX_RUNS])->level
+              == ((HitRun *) runs->val[runs->top - 1])->level)) {
+    stat = sMergeTopRuns(sorter, SPILL_MAX_RUNS);
+  }
+
+  return stat;
+}
+
+/* ----------------------------------------------- */
+/* merge runs until there are at most              */
+/* SPILL_MAX_RUNS runs left                        */
+/* ----------------------------------------------- */
+
+static int sReduceRuns(HitSorter *sorter)
+{
+  int    stat;
+  size_t n;
+
+  stat = LX_NO_ERROR;
+
+  while ((stat == LX_NO_ERROR) && (sorter->runs->top > SPILL_MAX_RUNS)) {
+    n    = MIN(SPILL_MAX_RUNS, sorter->runs->top - SPILL_MAX_RUNS + 1);
+    stat = sMergeTopRuns(sorter, n);
+  }
+
+  return stat;
+}
+
+/* ----------------------------------------------- */
+/* API                                             */
+/* ----------------------------------------------- */
+
+/* ----------------------------------------------- */
+/* free sorter                                     */
+/* (seqIds and tags are owned by their tables)     */
+/* ----------------------------------------------- */
+
+HitSorter *SpillFreeSorter(HitSorter *sorter)
+{
+  if (sorter) {
+    if (sorter->runs)
+      (void) LXFreeStackp(sorter->runs, sFreeRun);
+    if (sorter->heap)
+      (void) LXFreeStackp(sorter->heap, sFreeRun);
+    if (sorter->batch)
+      (void) LXFreeStackp(sorter->batch, UtilFreeXHit);
+    UtilCacheFree(&sorter->seqCache);
+    UtilCacheFree(&sorter->tagCache);
+    FREE(sorter);
+  }
+
+  return NULL;
+}
+
+/* ----------------------------------------------- */
+/* new sorter : hits will be sorted by runs of     */
+/* param->maxHits hits. seqIds and tags are        */
+/* interned into seqTable and tagTable (that       */
+/* should be empty, since their index is spilled)  */
+/* ----------------------------------------------- */
+
+HitSorter *SpillNewSorter(InternTable *seqTable, InternTable *tagTable,
+                          Parameter *param)
+{
+  HitSorter *sorter;
+
+  if (! (sorter = NEW(HitSorter))) {
+    MEMORY_ERROR();
+    return NULL;
+  }
+
+  (void) memset(sorter, 0, sizeof(HitSorter));
+
+  sorter->param    = param;
+  sorter->seqTable = seqTable;
+  sorter->tagTable = tagTable;
+  sorter->runs     = LXNewStackp(LX_STKP_MIN_SIZE);
+  sorter->heap     = LXNewStackp(LX_STKP_MIN_SIZE);
+  sorter->batch    = LXNewStackp(LX_STKP_MIN_SIZE);
+
+  if (! (sorter->runs && sorter->heap && sorter->batch)) {
+    MEMORY_ERROR();
+    return SpillFreeSorter(sorter);
+  }
+
+  return sorter;
+}
+
+/* ----------------------------------------------- */
+/* add block of hits of tag on seqId (hits are     */
+/* popped out of hits). isid and itag are the      */
+/* hit file indexes of seqId and tag (-1 if not    */
+/* known). the current batch is spilled into a new */
+/* run as soon as it holds param->maxHits hits     */
+/* ----------------------------------------------- */
+
+int SpillAddHits(HitSorter *sorter, Int32 isid, PMSeqId *seqId,
+                 Int32 itag, PMTag *tag, PMHitStack *hits)
+{
+  int         stat;
+  PMHit       *hit;
+  PMSeqId     *currentId;
+  PMTag       *currentTag;
+  ExtendedHit *xhit;
+  LXStackp    *batch = sorter->batch;
+
+  if (! (currentId = (PMSeqId *) UtilCacheGet(&sorter->seqCache, isid)))
+    currentId = (PMSeqId *) InternGet(sorter->seqTable, (Ptr) seqId);
+
+  if (! (currentTag = (PMTag *) UtilCacheGet(&sorter->tagCache, itag)))
+    currentTag = (PMTag *) InternGet(sorter->tagTable, (Ptr) tag);
+
+  if (! (   currentId && currentTag
+         && UtilCachePut(&sorter->seqCache, isid, currentId)
+         && UtilCachePut(&sorter->tagCache, itag, currentTag)))
+    return LX_MEM_ERROR;
+
+  // hits are popped as in UtilReadExtendedHits, so that
+  // ranks (and hence ties order) are the same
+
+  while (LXPoppOut(hits, (Ptr *) &hit)) {
+    if (! (xhit = UtilNewXHit(currentId, currentTag, hit, sorter->param->isProteic))) {
+      (void) PMFreeHit(hit);
+      return LX_MEM_ERROR;
+    }
+    if (! LXPushpIn(batch, (Ptr) xhit)) {
+      UtilFreeXHit(xhit);
+      return MEMORY_ERROR();
+    }
+    xhit->rank = sorter->nbHits++;
+  }
+
+  stat = LX_NO_ERROR;
+
+  if ((long) batch->top >= sorter->param->maxHits) {
+    stat = sSpillBatch(sorter, batch, sorter->runs);
+    sorter->nbRuns++;
+  }
+
+  if (stat == LX_NO_ERROR)
+    stat = sCascadeRuns(sorter);
+
+  return stat;
+}
+
+/* ----------------------------------------------- */
+/* end of hits : spill last batch and merge the    */
+/* remaining runs until they can be merged at once */
+/* then get ready to deliver hits (SpillNextHit)   */
+/* ----------------------------------------------- */
+
+int SpillEndHits(HitSorter *sorter)
+{
+  int stat;
+
+  stat = LX_NO_ERROR;
+
+  if (sorter->batch->top > 0) {
+    stat = sSpillBatch(sorter, sorter->batch, sorter->runs);
+    sorter->nbRuns++;
+  }
+
+  UtilCacheFree(&sorter->seqCache);
+  UtilCacheFree(&sorter->tagCache);
+
+  if (stat == LX_NO_ERROR)
+    stat = sReduceRuns(sorter);
+
+  if (stat == LX_NO_ERROR)
+    stat = sMergeStart(sorter, sorter->runs);
+
+  return stat;
+}
+
+/* ----------------------------------------------- */
+/* read hits (from stdin) into sorted runs of      */
+/* param->maxHits hits and get ready to merge them */
+/* seqIds and tags are interned into seqTable and  */
+/* tagTable (that should be empty).                */
+/* returns NULL on error                           */
+/* ----------------------------------------------- */
+
+HitSorter *SpillReadHits(InternTable *seqTable, InternTable *tagTable,
+                         Parameter *param)
+{
+  int        stat;
+  PMSeqId    *seqId;
+  PMTag      *tag;
+  PMHitStack *hits;
+  PMHitFile  *hitFile;
+  HitSorter  *sorter;
+
+  if (! (sorter = SpillNewSorter(seqTable, tagTable, param)))
+    return NULL;
+
+  if (! (hits = LXNewStackp(LX_STKP_MIN_SIZE))) {
+    MEMORY_ERROR();
+    return SpillFreeSorter(sorter);
+  }
+
+  if (! (hitFile = PMHitFileOpenRead(stdin))) {
+    IO_ERROR();
+    (void) LXFreeStackp(hits, NULL);
+    return SpillFreeSorter(sorter);
+  }
+
+  /* ---------------------------------- */
+  /* read and spill batches of hits     */
+
+  while ((stat = PMHitFileReadHits(hitFile, &seqId, &tag, hits)) == LX_NO_ERROR) {
+    stat = SpillAddHits(sorter, hitFile->isid, seqId, hitFile->itag, tag, hits);
+    if (stat != LX_NO_ERROR)
+      break;
+  }
+
+  if (stat == LX_EOF)
+    stat = LX_NO_ERROR;
+
+  (void) LXFreeStackp(hits, (void (*)(Ptr)) PMFreeHit);
+
+  (void) PMHitFileClose(hitFile);
+
+  /* ---------------------------------- */
+  /* spill last batch and merge the     */
+  /* remaining runs                     */
+
+  if (stat == LX_NO_ERROR)
+    stat = SpillEndHits(sorter);
+
+  if (stat != LX_NO_ERROR)
+    return SpillFreeSorter(sorter);
+
+  return sorter;
+}
+
+/* ----------------------------------------------- */
+/* next hit in ClustSortXhits order                */
+/* returns NULL at end or on error (*stat)         */
+/* the caller owns the hit (see UtilFreeXHit)      */
+/* ----------------------------------------------- */
+
+ExtendedHit *SpillNextHit(HitSorter *sorter, int *stat)
+{
+  return sMergeNext(sorter, stat);
+}
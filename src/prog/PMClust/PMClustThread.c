@@ -0,0 +1,489 @@
+/* -----------------------------------------------------------------------
+ * $Id: PMClustThread.c $
+ * -----------------------------------------------------------------------
+ * @file: PMClustThread.c
+ * @desc: PMClust multithreaded clustering
+ *
+ * @history:
+ * @+ <Gloup> : Oct 26 : first version
+ * @+ <Gloup> : Oct 26 : ThreadCompareSeqKeys exported (see -s)
+ * -----------------------------------------------------------------------
+ * @docstart:
+ *
+ * PepMap PMClust multithreaded clustering <br>
+ * clusters never cross a sequence name or strand boundary (nor a
+ * frame boundary with -f), so hits are first partitioned on these
+ * keys (partitions are numbered in sort order and keep the input
+ * order of hits). partitions are then sorted and clusterized by a
+ * pool of worker threads, each pulling partitions from a shared
+ * counter. the clusters of each partition are kept in the partition
+ * own slot, so that the main thread can later print them in the
+ * original (serial) order and with the same numbering.
+ * with -p, the partial hits that follow the last cluster of a
+ * partition are, in the serial walk, the head of the first cluster
+ * of the next partition (and are then kept or not by the cluster
+ * cleanup). to give the very same output, partitions are processed
+ * in two passes : all partitions are first sorted, then each
+ * partition is clusterized starting at its 'carry' hit, i.e. with
+ * the partial hits carried over from the previous partitions.
+ *
+ * @docend:
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <pthread.h>
+
+#include "LX.h"
+#include "PM.h"
+
+#include "PMClust.h"
+
+/* ----------------------------------------------- */
+/* worker shared state                             */
+/* ----------------------------------------------- */
+
+typedef enum {
+  SortPass,
+  ClusterPass
+} WorkerPass;
+
+typedef struct {
+  ExtendedHit     **xhits;
+  Partition       **order;
+  long            nbParts;
+  long            next;
+  int             status;
+  WorkerPass      pass;
+  Parameter       *param;
+  pthread_mutex_t lock;
+} WorkerPool;
+
+/* ----------------------------------------------- */
+/* sequence ids with their partition number        */
+/* ----------------------------------------------- */
+
+typedef struct {
+  PMSeqId *seqId;
+  long    part;
+} SeqPart;
+
+static Parameter *sParam = NULL;   /* for sCompareSeqParts only */
+
+/* ----------------------------------------------- */
+/* compare SeqParts on seqId address               */
+/* ----------------------------------------------- */
+
+static int sCompareSeqAddress(const void *p1, const void *p2)
+{
+  PMSeqId *s1 = ((SeqPart *) p1)->seqId;
+  PMSeqId *s2 = ((SeqPart *) p2)->seqId;
+
+  return (s1 < s2 ? -1 : (s1 > s2 ? 1 : 0));
+}
+
+/* ----------------------------------------------- */
+/* compare SeqParts on partition keys              */
+/* ----------------------------------------------- */
+
+static int sCompareSeqParts(const void *p1, const void *p2)
+{
+  return ThreadCompareSeqKeys(((SeqPart *) p1)->seqId, ((SeqPart *) p2)->seqId, sParam);
+}
+
+/* ----------------------------------------------- */
+/* partition number of seqId                       */
+/* (seqParts are sorted by seqId address)          */
+/* ----------------------------------------------- */
+
+static long sPartOf(SeqPart *seqParts, long nbSeqs, PMSeqId *seqId)
+{
+  long low, high, mid;
+
+  low  = 0;
+  high = nbSeqs - 1;
+
+  while (low < high) {
+    mid = (low + high) / 2;
+    if (seqParts[mid].seqId < seqId)
+      low = mid + 1;
+    else
+      high = mid;
+  }
+
+  return seqParts[low].part;
+}
+
+/* ----------------------------------------------- */
+/* compare partitions on decreasing size           */
+/* ----------------------------------------------- */
+
+static int sCompareSizes(const void *p1, const void *p2)
+{
+  Partition *t1 = *((Partition **) p1),
+            *t2 = *((Partition **) p2);
+  long      n1  = t1->to - t1->from,
+            n2  = t2->to - t2->from;
+
+  if (n1 != n2)
+    return (n1 > n2 ? -1 : 1);
+
+  return (t1 < t2 ? -1 : (t1 > t2 ? 1 : 0));
+}
+
+/* ----------------------------------------------- */
+/* partition hits : xhits receives the hits of     */
+/* partition #i in [parts[i].from, parts[i].to[    */
+/* (in input order). partitions are numbered in    */
+/* keys order.                                     */
+/* returns the number of partitions (-1 on error)  */
+/* ----------------------------------------------- */
+
+static long sPartitionHits(LXStackp *hits, Parameter *param,
+                           ExtendedHit **xhits, Partition **parts)
+{
+  long        i, n, nbSeqs, nbParts, part, *start;
+  PMSeqId     *last;
+  SeqPart     *seqParts;
+  ExtendedHit *xhit;
+
+  *parts = NULL;
+
+  if (! (seqParts = NEWN(SeqPart, MAX(1, hits->top)))) {
+    MEMORY_ERROR();
+    return -1;
+  }
+
+  /* ---------------------------------- */
+  /* distinct seqIds (hits come by      */
+  /* blocks sharing the same seqId)     */
+
+  for (i = nbSeqs = 0, last = NULL ; i < (long) hits->top ; i++) {
+    xhit = (ExtendedHit *) hits->val[i];
+    if (xhit->seqId != last)
+      seqParts[nbSeqs++].seqId = last = xhit->seqId;
+  }
+
+  qsort(seqParts, nbSeqs, sizeof(SeqPart), sCompareSeqAddress);
+
+  for (i = n = 0 ; i < nbSeqs ; i++) {
+    if ((n == 0) || (seqParts[i].seqId != seqParts[n - 1].seqId))
+      seqParts[n++] = seqParts[i];
+  }
+
+  nbSeqs = n;
+
+  /* ---------------------------------- */
+  /* number partitions in keys order    */
+
+  sParam = param;
+
+  qsort(seqParts, nbSeqs, sizeof(SeqPart), sCompareSeqParts);
+
+  for (i = 0, nbParts = 0 ; i < nbSeqs ; i++) {
+    if ((i == 0) || ThreadCompareSeqKeys(seqParts[i - 1].seqId, seqParts[i].seqId, param))
+      nbParts++;
+    seqParts[i].part = nbParts - 1;
+  }
+
+  qsort(seqParts, nbSeqs, sizeof(SeqPart), sCompareSeqAddress);
+
+  /* ---------------------------------- */
+  /* count and scatter hits             */
+
+  *parts = NEWN(Partition, MAX(1, nbParts));
+  start  = NEWN(long, nbParts + 1);
+
+  if (! (*parts && start)) {
+    MEMORY_ERROR();
+    IFFREE(start);
+    FREE(seqParts);
+    return -1;
+  }
+
+  (void) memset(start, 0, (nbParts + 1) * sizeof(long));
+
+  for (i = 0, last = NULL, part = 0 ; i < (long) hits->top ; i++) {
+    xhit = (ExtendedHit *) hits->val[i];
+    if (xhit->seqId != last)
+      part = sPartOf(seqParts, nbSeqs, last = xhit->seqId);
+    start[part + 1]++;
+  }
+
+  for (part = 0 ; part < nbParts ; part++) {
+    start[part + 1]         += start[part];
+    (*parts)[part].from      = start[part];
+    (*parts)[part].to        = start[part + 1];
+    (*parts)[part].carry     = start[part];
+    (*parts)[part].clusters  = NULL;
+  }
+
+  for (i = 0, last = NULL, part = 0 ; i < (long) hits->top ; i++) {
+    xhit = (ExtendedHit *) hits->val[i];
+    if (xhit->seqId != last)
+      part = sPartOf(seqParts, nbSeqs, last = xhit->seqId);
+    xhits[start[part]++] = xhit;
+  }
+
+  FREE(start);
+  FREE(seqParts);
+
+  return nbParts;
+}
+
+/* ----------------------------------------------- */
+/* get next partition to process (NULL if none)    */
+/* ----------------------------------------------- */
+
+static Partition *sNextPartition(WorkerPool *pool)
+{
+  Partition *part = NULL;
+
+  pthread_mutex_lock(&pool->lock);
+
+  if ((pool->next < pool->nbParts) && (pool->status == LX_NO_ERROR))
+    part = pool->order[pool->next++];
+
+  pthread_mutex_unlock(&pool->lock);
+
+  return part;
+}
+
+/* ----------------------------------------------- */
+/* set partitions carry : the partial hits found   */
+/* after the last full hit of a partition (farther */
+/* than distance), or all hits of a partition      */
+/* without full hit, are the head of the first     */
+/* cluster of the next partition in the serial     */
+/* walk (see ClustMakeClusters).                   */
+/* partitions should be sorted                     */
+/* ----------------------------------------------- */
+
+static void sCarryOver(ExtendedHit **xhits, Partition *parts, long nbParts,
+                       Parameter *param)
+{
+  long        ipart, i, last, carry;
+  ExtendedHit *xhit;
+
+  for (ipart = 0, carry = 0 ; ipart < nbParts ; ipart++) {
+
+    parts[ipart].carry = (param->addPartial ? carry : parts[ipart].from);
+
+    // last full hit of partition
+
+    for (last = parts[ipart].to - 1 ; last >= parts[ipart].from ; last--) {
+      if (xhits[last]->hit->type == FullHit)
+        break;
+    }
+
+    if (last < parts[ipart].from)     // no full hit : carry goes on
+      continue;
+
+    // first partial hit too far from last full hit
+
+    for (i = last + 1 ; i < parts[ipart].to ; i++) {
+      xhit = xhits[i];
+      if (    (xhit->hit->type != InvalidHit)
+           && (xhit->from - xhits[last]->to > param->distance))
+        break;
+    }
+
+    carry = i;
+  }
+}
+
+/* ----------------------------------------------- */
+/* worker thread entry point                       */
+/* ----------------------------------------------- */
+
+static void *sWorker(void *arg)
+{
+  int        stat;
+  Partition  *part;
+  WorkerPool *pool = (WorkerPool *) arg;
+
+  while ((part = sNextPartition(pool))) {
+
+    if (pool->pass == SortPass) {
+      qsort(pool->xhits + part->from, part->to - part->from,
+            sizeof(ExtendedHit *),
+            (pool->param->framed ? ClustSortXhitsWithFrame
+                                 : ClustSortXhitsWithoutFrame));
+      continue;
+    }
+
+    if (! (part->clusters = LXNewStackp(LX_STKP_MIN_SIZE)))
+      stat = MEMORY_ERROR();
+    else
+      stat = ClustMakeClusters(pool->xhits + part->carry,
+                               part->to - part->carry,
+                               pool->param, part->clusters);
+
+    if (stat != LX_NO_ERROR) {
+      pthread_mutex_lock(&pool->lock);
+      pool->status = stat;
+      pthread_mutex_unlock(&pool->lock);
+    }
+  }
+
+  return NULL;
+}
+
+/* ----------------------------------------------- */
+/* run one pass of workers                         */
+/* ----------------------------------------------- */
+
+static int sRunPass(WorkerPool *pool, WorkerPass pass,
+                    pthread_t *threads, int nbThreads)
+{
+  int i, nbStarted;
+
+  pool->pass = pass;
+  pool->next = 0;
+
+  for (i = nbStarted = 0 ; (nbThreads > 1) && (i < nbThreads) ; i++) {
+    if (pthread_create(threads + nbStarted, NULL, sWorker, pool) == 0)
+      nbStarted++;
+  }
+
+  // single thread or no thread could be started :
+  // do the job ourselves
+
+  if (nbStarted == 0)
+    (void) sWorker(pool);
+
+  for (i = 0 ; i < nbStarted ; i++)
+    (void) pthread_join(threads[i], NULL);
+
+  return pool->status;
+}
+
+/* ----------------------------------------------- */
+/* API                                             */
+/* ----------------------------------------------- */
+
+/* ----------------------------------------------- */
+/* compare seqIds on partition keys : name, then   */
+/* strand and frame (with -f) in nucleic mode      */
+/* ----------------------------------------------- */
+
+int ThreadCompareSeqKeys(PMSeqId *s1, PMSeqId *s2, Parameter *param)
+{
+  int cmp;
+
+  if ((cmp = strcmp(s1->name, s2->name)) != 0)
+    return cmp;
+
+  if (param->isProteic)
+    return 0;
+
+  if ((cmp = (s1->strand - s2->strand)) != 0)
+    return cmp;
+
+  if (param->framed)
+    return (s1->frame - s2->frame);
+
+  return 0;
+}
+
+/* ----------------------------------------------- */
+/* free partitions (and their clusters)            */
+/* ----------------------------------------------- */
+
+Partition *ThreadFreePartitions(Partition *parts, long nbParts)
+{
+  long    i;
+  Cluster *cluster;
+
+  if (parts) {
+    for (i = 0 ; i < nbParts ; i++) {
+      if (parts[i].clusters) {
+        while (LXPoppOut(parts[i].clusters, (Ptr *) &cluster))
+          (void) ClustFreeCluster(cluster);
+        (void) LXFreeStackp(parts[i].clusters, NULL);
+      }
+    }
+    FREE(parts);
+  }
+
+  return NULL;
+}
+
+/* ----------------------------------------------- */
+/* partition, sort and clusterize hits using       */
+/* param->nbThreads threads (or the calling thread */
+/* only if param->nbThreads <= 1).                 */
+/* *parts receives the *nbParts partitions, in     */
+/* serial order, each with the stack of clusters   */
+/* to be reported (see ClustMakeClusters)          */
+/* ----------------------------------------------- */
+
+int ThreadMakeClusters(LXStackp *hits, Parameter *param,
+                       Partition **parts, long *nbParts)
+{
+  int        nbThreads;
+  long       ipart;
+  pthread_t  *threads;
+  WorkerPool pool;
+
+  *parts   = NULL;
+  *nbParts = 0;
+
+  pool.param  = param;
+  pool.next   = 0;
+  pool.status = LX_NO_ERROR;
+  pool.pass   = SortPass;
+  pool.order  = NULL;
+
+  if (! (pool.xhits = NEWN(ExtendedHit *, MAX(1, hits->top))))
+    return MEMORY_ERROR();
+
+  if ((pool.nbParts = sPartitionHits(hits, param, pool.xhits, parts)) < 0) {
+    FREE(pool.xhits);
+    return LX_MEM_ERROR;
+  }
+
+  *nbParts = pool.nbParts;
+
+  /* ---------------------------------- */
+  /* larger partitions first            */
+
+  nbThreads = MAX(1, MIN(param->nbThreads, pool.nbParts));
+
+  threads    = NEWN(pthread_t, nbThreads);
+  pool.order = NEWN(Partition *, MAX(1, pool.nbParts));
+
+  if (! (threads && pool.order)) {
+    IFFREE(threads);
+    IFFREE(pool.order);
+    FREE(pool.xhits);
+    return MEMORY_ERROR();
+  }
+
+  for (ipart = 0 ; ipart < pool.nbParts ; ipart++)
+    pool.order[ipart] = *parts + ipart;
+
+  qsort(pool.order, pool.nbParts, sizeof(Partition *), sCompareSizes);
+
+  /* ---------------------------------- */
+  /* run workers : sort, then carry     */
+  /* partial hits over partitions and   */
+  /* clusterize                         */
+
+  (void) pthread_mutex_init(&pool.lock, NULL);
+
+  if (sRunPass(&pool, SortPass, threads, nbThreads) == LX_NO_ERROR) {
+    sCarryOver(pool.xhits, *parts, pool.nbParts, param);
+    (void) sRunPass(&pool, ClusterPass, threads, nbThreads);
+  }
+
+  (void) pthread_mutex_destroy(&pool.lock);
+
+  FREE(threads);
+  FREE(pool.order);
+  FREE(pool.xhits);
+
+  return pool.status;
+}
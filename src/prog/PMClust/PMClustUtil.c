@@ -7,6 +7,13 @@
  * @history:
  * @+ <Wanou> : Jul 02 : first version
  * @+ <Gloup> : Aug 06 : complete code revision
+ * @+ <Gloup> : Oct 26 : read hits through PMHitFile (text, compact or binary)
+ * @+ <Gloup> : Oct 26 : hits input rank
+ * @+ <Gloup> : Oct 26 : UtilFreeXHit also frees the extended hit
+ * @+ <Gloup> : Oct 26 : seqIds and tags cached by hit file index
+ * @+ <Gloup> : Oct 26 : hits may be pushed by blocks (UtilAddExtendedHits)
+ * @+ <Gloup> : Oct 26 : stdin as a source of blocks (UtilReadHitBlocks)
+ * @+ <Gloup> : Oct 26 : seqIds and tags interned in hash tables
  * -----------------------------------------------------------------------
  * @docstart: 
  *
@@ -60,16 +67,6 @@ int UtilCompareSeqId(const void *p1, const void *p2)
   return 0;
 }
 
-/* ----------------------------------------------- */
-/* free SeqId                                      */
-/* ----------------------------------------------- */
-
-void UtilFreeSeqId(void *p)
-{
-  PMSeqId *s = (PMSeqId *) p;
-  if (s) FREE(s);
-}
-
 /* ----------------------------------------------- */
 /* compare Tags                                    */
 /*                                                 */
@@ -102,17 +99,6 @@ int UtilCompareTag(const void *p1, const void *p2)
   return strcmp(t1->id, t2->id);
 }
 
-/* ----------------------------------------------- */
-/* free Tag                                        */
-/* ----------------------------------------------- */
-
-void UtilFreeTag(void *p)
-{
-  PMTag *t = (PMTag *) p;
-  
-  if (t) (void) PMFreeTag(t);
-}
-
 /* ----------------------------------------------- */
 /* compute projected nucleotidic position          */
 /* ----------------------------------------------- */
@@ -149,6 +135,7 @@ ExtendedHit *UtilNewXHit(PMSeqId *seqId, PMTag *tag , PMHit *hit, Bool isProteic
   xhit->seqId = seqId;
   xhit->tag   = tag;
   xhit->hit   = hit;
+  xhit->rank  = 0;
 
   nPos = ((xhit->hit->type == CDefinedHit) ? xhit->hit->posSn : xhit->hit->posMn);
   cPos = ((xhit->hit->type == NDefinedHit) ? xhit->hit->posSc : xhit->hit->posMc);
@@ -172,86 +159,249 @@ ExtendedHit *UtilNewXHit(PMSeqId *seqId, PMTag *tag , PMHit *hit, Bool isProteic
 
 void UtilFreeXHit(void *data) {
   ExtendedHit *xhit = (ExtendedHit *) data;
-  if ((xhit) && (xhit->hit))
-    (void) PMFreeHit(xhit->hit);
+  if (xhit) {
+    if (xhit->hit)
+      (void) PMFreeHit(xhit->hit);
+    FREE(xhit);
+  }
+}
+
+/* ----------------------------------------------- */
+/* get cached data by file index                   */
+/* (NULL if not cached or if index < 0)            */
+/* ----------------------------------------------- */
+
+Ptr UtilCacheGet(IndexCache *cache, Int32 index)
+{
+  if ((index < 0) || (index >= cache->size))
+    return NULL;
+
+  return cache->data[index];
+}
+
+/* ----------------------------------------------- */
+/* cache data by file index (ignored if index < 0) */
+/* ----------------------------------------------- */
+
+Bool UtilCachePut(IndexCache *cache, Int32 index, Ptr data)
+{
+  Int32 i, newSize;
+  Ptr   *newData;
+
+  if (index < 0)
+    return TRUE;
+
+  if (index >= cache->size) {
+
+    newSize = MAX(2 * cache->size, MAX(index + 1, 256));
+
+    newData = (cache->data ? REALLOC(cache->data, Ptr, newSize)
+                           : NEWN(Ptr, newSize));
+
+    if (! newData)
+      return FALSE;
+
+    for (i = cache->size ; i < newSize ; i++)
+      newData[i] = NULL;
+
+    cache->data = newData;
+    cache->size = newSize;
+  }
+
+  cache->data[index] = data;
+
+  return TRUE;
+}
+
+/* ----------------------------------------------- */
+/* free cache (not the cached data)                */
+/* ----------------------------------------------- */
+
+void UtilCacheFree(IndexCache *cache)
+{
+  IFFREE(cache->data);
+  cache->data = NULL;
+  cache->size = 0;
+}
+
+/* ----------------------------------------------- */
+/* intern seqId (looked up in cache by hit file    */
+/* index first)                                    */
+/* ----------------------------------------------- */
+
+static PMSeqId *sInternSeqId(InternTable *seqTable, IndexCache *cache,
+                             Int32 index, PMSeqId *seqId)
+{
+  PMSeqId *currentId;
+
+  if ((currentId = (PMSeqId *) UtilCacheGet(cache, index)))
+    return currentId;
+
+  if (! (currentId = (PMSeqId *) InternGet(seqTable, (Ptr) seqId)))
+    return NULL;
+
+  return (UtilCachePut(cache, index, currentId) ? currentId : NULL);
+}
+
+/* ----------------------------------------------- */
+/* intern tag (looked up in cache by hit file      */
+/* index first)                                    */
+/* ----------------------------------------------- */
+
+static PMTag *sInternTag(InternTable *tagTable, IndexCache *cache,
+                         Int32 index, PMTag *tag)
+{
+  PMTag *currentTag;
+
+  if ((currentTag = (PMTag *) UtilCacheGet(cache, index)))
+    return currentTag;
+
+  if (! (currentTag = (PMTag *) InternGet(tagTable, (Ptr) tag)))
+    return NULL;
+
+  return (UtilCachePut(cache, index, currentTag) ? currentTag : NULL);
+}
+
+/* ----------------------------------------------- */
+/* pop hits of block and push extended hits into   */
+/* stkp                                            */
+/* ----------------------------------------------- */
+
+static int sPushHits(LXStackp *stkp, PMSeqId *seqId, PMTag *tag,
+                     PMHitStack *hits, Parameter *param)
+{
+  PMHit       *hit;
+  ExtendedHit *xhit;
+
+  while (LXPoppOut(hits, (Ptr *) &hit)) {
+    if (! (xhit = UtilNewXHit(seqId, tag, hit, param->isProteic))) {
+      (void) PMFreeHit(hit);
+      return LX_MEM_ERROR;
+    }
+    xhit->rank = (long) stkp->top;
+    if (! LXPushpIn(stkp, (Ptr) xhit)) {
+      UtilFreeXHit(xhit);
+      return MEMORY_ERROR();
+    }
+  }
+
+  return LX_NO_ERROR;
 }
 
 /* ----------------------------------------------- */
 /* read hits and push extended hits into stkp      */
+/* hit file format (see PMHitFile.h) is detected   */
+/* in compact and binary formats, seqIds and tags  */
+/* are looked up in tables only once per file      */
+/* index                                           */
 /* ----------------------------------------------- */
 
-int UtilReadExtendedHits(LXStackp *stkp, LXDict *seqDict, LXDict *tagDict,
-                         Parameter *param)
+int UtilReadExtendedHits(LXStackp *stkp, InternTable *seqTable,
+                         InternTable *tagTable, Parameter *param)
 {
-  int stat;
-  
-	PMHitStack *hits;
-	
-	hits = LXNewStackp(LX_STKP_MIN_SIZE);
-
-	while (1) {
-
-	  /* --------------------------------------- */
-	  /*  read SeqId                             */
-	  
-		PMSeqId seqId, *currentId;
-	
-		stat = PMReadSeqId(stdin, &seqId);
-	
-	    if (stat == LX_EOF) {
-	        stat = LX_NO_ERROR;
-	        break;
-	    }
-
-		if (stat != LX_NO_ERROR)
-	        break;
-		
-		if (LXHasDict(seqDict, &seqId)) {
-			currentId = (PMSeqId *) LXGetDict(seqDict, &seqId);
-		}
-		else {
-			currentId = NEW(PMSeqId);
-			(void) memcpy(currentId, &seqId, sizeof(PMSeqId));
-			(void) LXAddDict(seqDict, currentId);
-		}
-
-	  /* --------------------------------------- */
-	  /*  read Tag                               */
-
-        PMTag tag, *currentTag;
-    
-		stat = PMReadTag(stdin, &tag);
-
-		if (stat != LX_NO_ERROR)
-	    break;
-
-		if (LXHasDict(tagDict, &tag)) {
-			currentTag = (PMTag *) LXGetDict(tagDict, &tag);
-		}
-		else {
-			currentTag = PMNewTag();
-			(void) memcpy(currentTag, &tag, sizeof(PMTag));
-			(void) LXAddDict(tagDict, currentTag);
-		}
-
-	  /* --------------------------------------- */
-	  /*  read Hits and build extended hits      */
-		
-		PMHit *hit;
-		
-		stat = PMReadHitStack(stdin, hits, FALSE);
-		
-		if (stat != LX_NO_ERROR)
-	    break;
-	
-		while (LXPoppOut(hits, (Ptr *) &hit)) {
-		  ExtendedHit *xhit = UtilNewXHit(currentId, currentTag, hit, param->isProteic);
-		  (void) LXPushpIn(stkp, (Ptr) xhit);
-		}
-		
-	}
-
-	(void) LXFreeStackp(hits, NULL);
+  int        stat;
+  PMSeqId    *seqId, *currentId;
+  PMTag      *tag, *currentTag;
+  PMHitStack *hits;
+  PMHitFile  *hitFile;
+  IndexCache seqCache = {0, NULL},
+             tagCache = {0, NULL};
+
+  if (! (hitFile = PMHitFileOpenRead(stdin)))
+    return IO_ERROR();
+
+  hits = LXNewStackp(LX_STKP_MIN_SIZE);
+
+  while ((stat = PMHitFileReadHits(hitFile, &seqId, &tag, hits)) == LX_NO_ERROR) {
+
+    currentId  = sInternSeqId(seqTable, &seqCache, hitFile->isid, seqId);
+    currentTag = sInternTag(tagTable, &tagCache, hitFile->itag, tag);
+
+    if (! (currentId && currentTag)) {
+      stat = MEMORY_ERROR();
+      break;
+    }
+
+    if ((stat = sPushHits(stkp, currentId, currentTag, hits, param)) != LX_NO_ERROR)
+      break;
+  }
+
+  if (stat == LX_EOF)
+    stat = LX_NO_ERROR;
+
+  UtilCacheFree(&seqCache);
+  UtilCacheFree(&tagCache);
+
+  (void) LXFreeStackp(hits, (void (*)(Ptr)) PMFreeHit);
+
+  (void) PMHitFileClose(hitFile);
+
+  return stat;
+}
+
+/* ----------------------------------------------- */
+/* push extended hits of a block of hits (handed   */
+/* over by a PMHitSink) into stkp, hits are popped */
+/* as in UtilReadExtendedHits                      */
+/* seqIds and tags are looked up in tables (as in  */
+/* text format) whatever their index               */
+/* ----------------------------------------------- */
+
+int UtilAddExtendedHits(LXStackp *stkp, PMSeqId *seqId, PMTag *tag,
+                        PMHitStack *hits, InternTable *seqTable,
+                        InternTable *tagTable, Parameter *param)
+{
+  PMSeqId    *currentId;
+  PMTag      *currentTag;
+  IndexCache noCache = {0, NULL};
+
+  currentId  = sInternSeqId(seqTable, &noCache, -1, seqId);
+  currentTag = sInternTag(tagTable, &noCache, -1, tag);
+
+  if (! (currentId && currentTag))
+    return MEMORY_ERROR();
+
+  return sPushHits(stkp, currentId, currentTag, hits, param);
+}
+
+/* ----------------------------------------------- */
+/* read hits from stdin and hand them over to sink */
+/* block by block (this is a PMHitSource, arg is   */
+/* not used). hits left in a block by sink are     */
+/* freed                                           */
+/* ----------------------------------------------- */
+
+int UtilReadHitBlocks(PMHitSink sink, Ptr sinkArg, Ptr arg)
+{
+  int        stat;
+  PMSeqId    *seqId;
+  PMTag      *tag;
+  PMHit      *hit;
+  PMHitStack *hits;
+  PMHitFile  *hitFile;
+
+  if (! (hitFile = PMHitFileOpenRead(stdin)))
+    return IO_ERROR();
+
+  hits = LXNewStackp(LX_STKP_MIN_SIZE);
+
+  while ((stat = PMHitFileReadHits(hitFile, &seqId, &tag, hits)) == LX_NO_ERROR) {
+
+    stat = sink(sinkArg, hitFile->isid, seqId, hitFile->itag, tag, hits);
+
+    while (LXPoppOut(hits, (Ptr *) &hit))
+      (void) PMFreeHit(hit);
+
+    if (stat != LX_NO_ERROR)
+      break;
+  }
+
+  if (stat == LX_EOF)
+    stat = LX_NO_ERROR;
+
+  (void) LXFreeStackp(hits, (void (*)(Ptr)) PMFreeHit);
+
+  (void) PMHitFileClose(hitFile);
 
   return stat;
 }
@@ -0,0 +1,370 @@
+/* -----------------------------------------------------------------------
+ * $Id: PMHitConv.c $
+ * -----------------------------------------------------------------------
+ * @file: PMHitConv.c
+ * @desc: convert hit files between text, compact and binary formats
+ *
+ * @history:
+ * @+ <Gloup> : Oct 26 : first version
+ * @+ <Gloup> : Oct 26 : main returns int, getopt declared
+ * -----------------------------------------------------------------------
+ * @docstart:
+ *
+ * Hit file conversion program <br>
+ * read a hit file in any format (see PMHitFile.h) and write it in
+ * the requested one. blocks and hits are kept in order.
+ * when converting from text format, identical SeqIds (resp. Tags)
+ * are defined once in compact and binary output.
+ *
+ * @docend:
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "LX.h"
+#include "PM.h"
+
+/* ----------------------------------------------- */
+/* SeqIds and Tags with their index (text input)   */
+/* (seqId and tag must come first, so that these   */
+/* can be compared as PMSeqId and PMTag)           */
+/* ----------------------------------------------- */
+
+typedef struct {
+  PMSeqId seqId;
+  Int32   index;
+} SeqEntry;
+
+typedef struct {
+  PMTag   tag;
+  Int32   index;
+} TagEntry;
+
+/* ----------------------------------------------- */
+static void sStartupBanner(int argc, char *argv[])
+{
+  int i;
+  fprintf(stderr,"# ------------------------------\n");
+  fprintf(stderr,"# PepMap PMHitConv v %s\n", VERSION);
+  fprintf(stderr,"#\n");
+  fprintf(stderr,"# Convert hit files between\n");
+  fprintf(stderr,"# text, compact and binary formats\n");
+  fprintf(stderr,"# ------------------------------\n");
+  fprintf(stderr,"# run: ");
+  for (i = 0 ; i < argc ; i++)
+    fprintf(stderr,"%s ", argv[i]);
+  fprintf(stderr,"\n");
+  fprintf(stderr,"# ------------------------------\n");
+}
+
+/* ----------------------------------------------- */
+static void sUsage(int err)
+{
+  fprintf(stderr,"Usage: PMHitConv [options]\n");
+  fprintf(stderr,"type PMHitConv -h for help\n");
+  exit(err);
+}
+
+/* ----------------------------------------------- */
+static void sHelp()
+{
+  fprintf(stderr,"Usage: PMHitConv [options]\n");
+  fprintf(stderr," options:\n");
+  fprintf(stderr," -h               : print this help\n");
+  fprintf(stderr," -i hitFile       : input hits filename\n");
+  fprintf(stderr,"                    in text, compact or binary format (detected)\n");
+  fprintf(stderr,"                    (default = <stdin>)\n");
+  fprintf(stderr," -o hitFile       : output hits filename\n");
+  fprintf(stderr,"                    (default = <stdout>)\n");
+  fprintf(stderr," -v               : verbose mode (add some internal information)\n");
+  fprintf(stderr,"                    (default = off)\n");
+  fprintf(stderr," -w t|c|b         : output format\n");
+  fprintf(stderr,"                    t = text : sequence and tag written before each block of hits\n");
+  fprintf(stderr,"                    c = compact text : sequences and tags written once\n");
+  fprintf(stderr,"                        and referred to by index\n");
+  fprintf(stderr,"                    b = binary : same as compact, binary encoded\n");
+  fprintf(stderr,"                    (default = t)\n");
+  fprintf(stderr,"\n");
+  exit(0);
+}
+
+/* ----------------------------------------------- */
+/* compare SeqIds (all fields)                     */
+/* ----------------------------------------------- */
+
+static int sCompareSeqIds(const void *p1, const void *p2)
+{
+  PMSeqId *s1 = (PMSeqId *) p1;
+  PMSeqId *s2 = (PMSeqId *) p2;
+
+  int cmp;
+
+  if ((cmp = (s1->frame - s2->frame)) != 0)
+    return cmp;
+
+  if ((cmp = (s1->strand - s2->strand)) != 0)
+    return cmp;
+
+  if (s1->length != s2->length)
+    return (s1->length > s2->length ? 1 : -1);
+
+  if ((cmp = strcmp(s1->name, s2->name)) != 0)
+    return cmp;
+
+  return strcmp(s1->comment, s2->comment);
+}
+
+/* ----------------------------------------------- */
+/* compare Tags (all fields)                       */
+/* ----------------------------------------------- */
+
+static int sCompareTags(const void *p1, const void *p2)
+{
+  PMTag *t1 = (PMTag *) p1;
+  PMTag *t2 = (PMTag *) p2;
+
+  int cmp;
+
+  if (t1->mN != t2->mN)
+    return (t1->mN > t2->mN ? 1 : -1);
+
+  if (t1->mC != t2->mC)
+    return (t1->mC > t2->mC ? 1 : -1);
+
+  if (t1->mParent != t2->mParent)
+    return (t1->mParent > t2->mParent ? 1 : -1);
+
+  if (t1->score != t2->score)
+    return (t1->score > t2->score ? 1 : -1);
+
+  if ((cmp = strcmp(t1->seq, t2->seq)) != 0)
+    return cmp;
+
+  return strcmp(t1->id, t2->id);
+}
+
+/* ----------------------------------------------- */
+/* free dictionary entry                           */
+/* ----------------------------------------------- */
+
+static void sFreeEntry(void *p)
+{
+  if (p) FREE(p);
+}
+
+/* ----------------------------------------------- */
+/* index of seqId (new index if not yet seen)      */
+/* ----------------------------------------------- */
+
+static Int32 sSeqIdIndex(LXDict *dict, PMSeqId *seqId, Int32 *nbSeqIds)
+{
+  SeqEntry *entry;
+
+  if ((entry = (SeqEntry *) LXGetDict(dict, seqId)))
+    return entry->index;
+
+  if (! (entry = NEW(SeqEntry))) {
+    MEMORY_ERROR();
+    return -1;
+  }
+
+  (void) memcpy(&entry->seqId, seqId, sizeof(PMSeqId));
+
+  entry->index = (*nbSeqIds)++;
+
+  (void) LXAddDict(dict, entry);
+
+  return entry->index;
+}
+
+/* ----------------------------------------------- */
+/* index of tag (new index if not yet seen)        */
+/* ----------------------------------------------- */
+
+static Int32 sTagIndex(LXDict *dict, PMTag *tag, Int32 *nbTags)
+{
+  TagEntry *entry;
+
+  if ((entry = (TagEntry *) LXGetDict(dict, tag)))
+    return entry->index;
+
+  if (! (entry = NEW(TagEntry))) {
+    MEMORY_ERROR();
+    return -1;
+  }
+
+  (void) memcpy(&entry->tag, tag, sizeof(PMTag));
+
+  entry->index = (*nbTags)++;
+
+  (void) LXAddDict(dict, entry);
+
+  return entry->index;
+}
+
+/* ----------------------------------------------- */
+
+int main(int argc, char *argv[])
+{
+  int  opt, stat;
+
+  Int32 isid, itag, nbSeqIds, nbTags;
+
+  long nbBlocks, nbHits;
+
+  size_t i;
+
+  Bool verbose;
+
+  PMHitFileFormat format;
+
+  PMHitFile *inFile, *outFile;
+
+  PMHitStack *hits;
+
+  PMHit *hit;
+
+  PMSeqId *seqId;
+
+  PMTag *tag;
+
+  LXDict *seqDict, *tagDict;
+
+  char inputFileName[BUFSIZ];
+  char outputFileName[BUFSIZ];
+
+  extern char *optarg;  /* externs for getopts (3C) */
+
+  /* -------------------------- */
+  /* setup default parameters   */
+
+  verbose         = FALSE;
+  format          = PMHitFileText;
+  *inputFileName  ='\000';
+  *outputFileName ='\000';
+
+  /* -------------------------- */
+  /* get user's parameters      */
+
+  while ((opt = getopt(argc, argv, "hHi:o:vw:")) != -1) {
+
+    switch (opt) {
+
+      case 'H' :                                  // help
+      case 'h' :
+        sHelp();
+        break;
+
+      case 'i' :                                  // input file
+        (void) strcpy(inputFileName, optarg);
+        if(! LXAssignToStdin(inputFileName)) {
+          fprintf(stderr,"Cannot open : %s\n", inputFileName);
+          exit (LX_IO_ERROR);
+        }
+        break;
+
+      case 'o' :                                  // output file
+        (void) strcpy(outputFileName, optarg);
+        if (! LXAssignToStdout(outputFileName)) {
+          fprintf(stderr,"Cannot create : %s\n", outputFileName);
+          exit (LX_IO_ERROR);
+        }
+        break;
+
+      case 'v' :                                  // verbose mode
+        verbose = TRUE;
+        break;
+
+      case 'w' :                                  // output format
+        if (PMHitFileFormatFromName(optarg, &format) != LX_NO_ERROR) {
+          fprintf(stderr, "# Wrong output format %s\n", optarg);
+          sUsage(LX_ARG_ERROR);
+        }
+        break;
+
+      case '?' :                                  // oops !
+        sUsage(LX_ARG_ERROR);
+        break;
+      }
+  }
+
+  /* -------------------------- */
+  /* start processing           */
+
+  sStartupBanner(argc, argv);
+
+  if (! (inFile = PMHitFileOpenRead(stdin))) {
+    fprintf(stderr,"# Cannot read hits\n");
+    exit(LX_IO_ERROR);
+  }
+
+  if (! (outFile = PMHitFileOpenWrite(stdout, format))) {
+    fprintf(stderr,"# Cannot write hits\n");
+    exit(LX_IO_ERROR);
+  }
+
+  seqDict = LXNewDict(sCompareSeqIds);
+  tagDict = LXNewDict(sCompareTags);
+  hits    = LXNewStackp(LX_STKP_MIN_SIZE);
+
+  nbSeqIds = nbTags = 0;
+  nbBlocks = nbHits = 0;
+
+  /* -------------------------- */
+  /* copy blocks of hits        */
+  /* (input file indexes are    */
+  /* kept, except in text       */
+  /* format where SeqIds and    */
+  /* Tags are indexed here)     */
+
+  while ((stat = PMHitFileReadHits(inFile, &seqId, &tag, hits)) == LX_NO_ERROR) {
+
+    isid = ((inFile->isid >= 0) ? inFile->isid : sSeqIdIndex(seqDict, seqId, &nbSeqIds));
+    itag = ((inFile->itag >= 0) ? inFile->itag : sTagIndex(tagDict, tag, &nbTags));
+
+    if ((isid < 0) || (itag < 0)) {
+      stat = LX_MEM_ERROR;
+      break;
+    }
+
+    stat = PMHitFileBeginHits(outFile, isid, seqId, itag, tag, (Int32) hits->top);
+
+    for (i = 0 ; (i < hits->top) && (stat == LX_NO_ERROR) ; i++)
+      stat = PMHitFileWriteHit(outFile, (PMHit *) hits->val[i]);
+
+    if (stat == LX_NO_ERROR)
+      stat = PMHitFileEndHits(outFile);
+
+    nbBlocks++;
+    nbHits += (long) hits->top;
+
+    while (LXPoppOut(hits, (Ptr *) &hit))
+      (void) PMFreeHit(hit);
+
+    if (stat != LX_NO_ERROR)
+      break;
+  }
+
+  if (stat != LX_EOF) {
+    fprintf(stderr,"# Cannot convert hits\n");
+    exit(stat);
+  }
+
+  (void) PMHitFileClose(inFile);
+  (void) PMHitFileClose(outFile);
+
+  if (verbose)
+    fprintf(stderr, "# %ld blocks, %ld hits\n", nbBlocks, nbHits);
+
+  /* ------------------- */
+  /* end of program      */
+
+  (void) LXFreeStackp(hits, NULL);
+  (void) LXFreeDict(seqDict, sFreeEntry);
+  (void) LXFreeDict(tagDict, sFreeEntry);
+
+  return 0;
+}
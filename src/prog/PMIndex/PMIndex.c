@@ -0,0 +1,173 @@
+/* -----------------------------------------------------------------------
+ * $Id: PMIndex.c $
+ * -----------------------------------------------------------------------
+ * @file: PMIndex.c
+ * @desc: build kuple index of translated chromosome(s)
+ *
+ * @history:
+ * @+ <Gloup> : Oct 26 : first version
+ * @+ <Gloup> : Oct 26 : main returns int, getopt declared
+ * -----------------------------------------------------------------------
+ * @docstart: 
+ *
+ * Kuple index program <br>
+ * build, once for all, the kuple index of a PMTrans output.
+ * the index is then memory mapped by PMMatch (-I option)
+ * instead of scanning the sequences at each run.
+ *
+ * @docend:
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "LX.h"
+#include "PM.h"
+
+#define DFT_KUPLE 3
+
+/* ----------------------------------------------- */
+static void sStartupBanner(int argc, char *argv[])
+{
+  int i;
+  fprintf(stderr,"# ------------------------------\n");
+  fprintf(stderr,"# PepMap PMIndex v %s\n", VERSION);
+  fprintf(stderr,"#\n");
+  fprintf(stderr,"# Build kuple index of translated\n");
+  fprintf(stderr,"# chromosome(s) for PMMatch\n");
+  fprintf(stderr,"# ------------------------------\n");
+  fprintf(stderr,"# run: ");
+  for (i = 0 ; i < argc ; i++)
+    fprintf(stderr,"%s ", argv[i]);
+  fprintf(stderr,"\n");
+  fprintf(stderr,"# ------------------------------\n");
+}
+
+/* ----------------------------------------------- */
+static void sUsage(int err)
+{
+  fprintf(stderr,"Usage: PMIndex [options] -o indexFile\n");
+  fprintf(stderr,"type PMIndex -h for help\n");
+  exit(err);
+}
+
+/* ----------------------------------------------- */
+static void sHelp()
+{
+  fprintf(stderr,"Usage: PMIndex [options] -o indexFile\n");
+  fprintf(stderr," options:\n");
+  fprintf(stderr," -h               : print this help\n");
+  fprintf(stderr," -i fastaFile     : translated chromosome(s) filename (PMTrans output)\n");
+  fprintf(stderr,"                    (default = <stdin>)\n");
+  fprintf(stderr," -k               : differentiate between K/Q\n");
+  fprintf(stderr,"                    should be the same as PMMatch -k option\n");
+  fprintf(stderr,"                    (default = off)\n");
+  fprintf(stderr," -l kuple         : kuple size (%d-%d)\n", 
+                                      PM_INDEX_MIN_KUPLE, PM_INDEX_MAX_KUPLE);
+  fprintf(stderr,"                    should be the length of PMMatch tags\n");
+  fprintf(stderr,"                    (default = %d)\n", DFT_KUPLE);
+  fprintf(stderr," -o indexFile     : output index filename\n");
+  fprintf(stderr,"                    (default = NONE) *you should provide this filename*\n");
+  fprintf(stderr," -v               : verbose mode (add some internal information)\n");
+  fprintf(stderr,"                    (default = off)\n");
+  fprintf(stderr,"\n");
+  fprintf(stderr,"note: indexing needs 4 * 26^kuple bytes of memory\n");
+  fprintf(stderr,"      (i.e. about 1.2 Gb for kuple = 6)\n");
+  exit(0);
+}
+
+/* ----------------------------------------------- */
+
+int main(int argc, char *argv[])
+{
+  int  opt, kuple;
+  
+  Bool verbose, differentiateKQ;
+  
+  char inputFileName[BUFSIZ];
+  char outputFileName[BUFSIZ];
+  
+  extern char *optarg;  /* externs for getopts (3C) */
+
+  /* -------------------------- */
+  /* setup default parameters   */
+  
+  kuple           = DFT_KUPLE;
+  verbose         = FALSE;
+  differentiateKQ = FALSE;
+  *inputFileName  ='\000';
+  *outputFileName ='\000';
+
+  /* -------------------------- */
+  /* get user's parameters      */
+
+  while ((opt = getopt(argc, argv, "hHi:kl:o:v")) != -1) {
+  
+    switch (opt) {
+    
+      case 'H' :                                  // help
+      case 'h' :
+        sHelp();
+        break;
+        
+      case 'i' :                                  // input file
+        (void) strcpy(inputFileName, optarg);
+        if(! LXAssignToStdin(inputFileName)) {
+          fprintf(stderr,"Cannot open : %s\n", inputFileName);
+          exit (LX_IO_ERROR); 
+        }
+        break;
+
+      case 'k' :                                  // differentiate K/Q
+        differentiateKQ = TRUE;
+        break;
+
+      case 'l':                                   // kuple size
+        if (    (sscanf(optarg, "%d", &kuple) != 1) 
+             || (kuple < PM_INDEX_MIN_KUPLE) || (kuple > PM_INDEX_MAX_KUPLE)) {
+          fprintf(stderr,"invalid kuple value: -l (%d-%d)\n", 
+                         PM_INDEX_MIN_KUPLE, PM_INDEX_MAX_KUPLE);
+          sUsage(LX_ARG_ERROR);
+        }
+        break;
+        
+      case 'o' :                                  // output (index) filename
+        (void) strcpy(outputFileName, optarg);
+        break;
+
+      case 'v' :                                  // verbose mode
+        verbose = TRUE;
+        break;
+
+      case '?' :                                  // oops !
+        sUsage(LX_ARG_ERROR);
+        break;
+      }
+  }
+
+  if (! *outputFileName) {
+    fprintf(stderr, "# You should provide an index filename by using -o option\n");
+    sUsage(LX_ARG_ERROR);
+  }
+
+  /* -------------------------- */
+  /* start processing           */
+  
+  sStartupBanner(argc, argv);
+
+  (void) LXStrCpuTime(TRUE);
+
+  if (PMIndexBuild(stdin, outputFileName, kuple, differentiateKQ, verbose) != LX_NO_ERROR) {
+    fprintf(stderr,"# Cannot build index : %s\n", outputFileName);
+    exit(LX_IO_ERROR);
+  }
+
+  /* ------------------- */
+  /* end of program      */
+
+  fprintf(stderr,"# %s\n", LXStrCpuTime(FALSE));
+ 
+  return 0;
+}
@@ -138,7 +138,7 @@ PMFragmentPtr PMNewFragment()
 PMFragmentPtr PMFreeFragment(PMFragmentPtr frag)
 {
   if (frag)
-    free(frag);
+    FREE(frag);
   
   return NULL;
 }
@@ -8,6 +8,8 @@
  * @+ <Wanou> : Jan 02 : first version
  * @+ <Gloup> : Aug 06 : complete code revision
  * @+ <Gloup> : Jan 10 : 64 bits polish
+ * @+ <Gloup> : Oct 26 : MatchMain (hits may be handed over to a sink)
+ * @+ <Gloup> : Oct 26 : ThreadPool started once per run
  * -----------------------------------------------------------------------
  * @docstart: 
  *
@@ -27,6 +29,8 @@
 #include "PM.h"
 #endif
 
+#include <pthread.h>
+
 /* ----------------------------------------------- */
 /* constants                                       */
 /* ----------------------------------------------- */
@@ -43,6 +47,17 @@
 #define DFT_AA_FILENAME       "aa_mono.ref"
 #define DFT_ENZ_FILENAME      "trypsine.ref"
 #define DFT_HITSCORE           PSTHitScoreType
+#define DFT_THREADS            1
+#define DFT_BATCH_SUFFIX       ".hit"
+#define DFT_OUTPUT_FORMAT      PMHitFileText
+#define DFT_GENETIC_CODE       LX_GENETIC_CODE_UNIVL
+#define DFT_WINDOW_SIZE        0L
+
+/*
+ * @doc: max number of modifications on each side of a hit
+ */
+
+#define MAX_MODIF              16
 
 
 /* ---------------------------------------------------- */
@@ -64,14 +79,70 @@ typedef enum {
 
 /*
  * HashTable for hashing kuple
+ * tags sharing the same kuple make a group
  */
  
 typedef struct {
    Int32       kuple;
-   Int32       size;
-   LXStackpPtr *stk;
+   Int32       bits;       /* log2(size)                            */
+   Int32       size;       /* open addressing table size            */
+   Int32       *keys;      /* slot kuple code (or -1)               */
+   Int32       *groups;    /* slot group of tags                    */
+   Int32       nbCodes;    /* number of distinct tags kuples        */
+   Int32       *codes;     /* distinct tags kuples (i.e. groups)    */
+   LXStackpPtr *stk;       /* positions of kuple codes[i]           */
+   long        *start;     /* tags of kuple codes[i] are            */
+   long        *tags;      /* tags[start[i]] .. tags[start[i+1]-1]  */
+   Int64       *cursor;    /* index mode: next position of kuples   */
+   Int64       *last;      /* index mode: end of positions          */
 } HashTable;
 
+/*
+ * Cumulated masses of sequence residues
+ * mass[i] is the mass of residues [0, i[ (invalid residues,
+ * such as Stop, weight 0 : flanks are cut at these residues
+ * when walked, see MassWalkFlanks)
+ */
+
+typedef struct {
+   long        size;       /* allocated size                        */
+   long        length;     /* sequence length                       */
+   double      *mass;
+} MassTable;
+
+/*
+ * One side (N or C) of a kuple occurrence, walked once for
+ * all tags of a group (see MassWalkFlanks).
+ * residue at distance d (d >= 1) from the kuple is at
+ * origin - d (N side) or origin + d - 1 (C side). length is
+ * the longest flank any tag of the group may reach and
+ * mass[len] (len <= length) the mass of the unmodified
+ * flank of length len (walk->masses[from + len])
+ */
+
+typedef struct {
+   Bool        isNterm;
+   long        origin;
+   long        length;
+   long        from;
+   double      *mass;
+} MassFlank;
+
+/*
+ * Flanks of all occurrences of a group kuple
+ * (one walk per worker thread, reused from group to group)
+ */
+
+typedef struct {
+   long        maxFlanks;
+   MassFlank   *nFlanks;
+   MassFlank   *cFlanks;
+   long        nbMasses,
+               maxMasses;
+   double      *masses;
+   double      minShift;   /* lightest modification shift (<= 0) */
+} FlankWalk;
+
 /*
  * Count estimator (for stats)
  */
@@ -96,8 +167,213 @@ typedef struct {
   Bool  	    partialHit;
   Bool  	    verbose;
   HitScoreType  hitScoreType;
+  int           nbThreads;
+  PMHitFileFormat outputFormat;
+  long          windowSize;
 } Parameter;
 
+/*
+ * @doc: Window of a sequence read by pieces (see LXFastaReadWindow)
+ * - offset : long - position of window start in the whole sequence
+ * - coreFrom, coreTo : long - hits starting in [coreFrom, coreTo[
+ *   (window positions) are reported by this window, the others
+ *   by the previous or next window
+ */
+
+typedef struct {
+  long  offset;
+  long  coreFrom;
+  long  coreTo;
+} SeqWindow;
+
+/*
+ * @doc: Mass index of spectrum peaks
+ * peaks are sorted by increasing mass in order/mass, and
+ * [minMass, maxMass] is split into nbBins bins of width binWidth.
+ * first[b] is the rank (in order) of the first peak whose
+ * mass is in bin b or above (first[nbBins] = nbPeaks)
+ */
+
+typedef struct {
+  PMSpectrum      *spectrum;
+  long            nbPeaks;
+  long            nbBins;
+  float           minMass,
+                  binWidth;
+  Int32           *order;     /* peaks indexes by increasing mass   */
+  float           *mass;      /* mass[i] = peak[order[i]].mass      */
+  Int32           *first;
+} PeakIndex;
+
+/*
+ * @doc: Hits scoring model
+ * built once per run (see ScoreNewModel).
+ * logMatch[type + (index - 1) * nbTypes] (resp. logMiss) is the
+ * log10 likelihood ratio of fragment type<index> (e.g. y3) being
+ * (resp. not being) assigned to a spectrum peak. Fragments
+ * with index above maxIndex use the maxIndex entry.
+ * logFact[n] = ln(n!) for n <= maxFrags is used by the REMT
+ * score (binomial tail of the number of fragments matched at
+ * random).
+ */
+
+typedef struct {
+  int             nbTypes;
+  int             maxIndex;
+  int             maxFrags;
+  double          pRandom;
+  double          *logMatch;
+  double          *logMiss;
+  double          *logFact;
+} ScoreModel;
+
+/*
+ * @doc: Reader of translated frames of nucleic sequences
+ * (see PMMatchFrame.c). iframe is the next frame to translate
+ * (0-2 direct, 3-5 reverse, 6 : read next nucleic sequence).
+ * nucSeq is the current (encoded) nucleic sequence and
+ * frameSeq the current translated frame.
+ */
+
+typedef struct {
+  int             iframe;
+  LXFastaSequence *nucSeq;
+  LXFastaSequence *frameSeq;
+  PMSeqId         seqId;
+  char            tables[2][LX_BIO_CODON_TABLE_SIZE];
+} FrameReader;
+
+/*
+ * @doc: Matching context
+ * everything needed to process the tags on the current sequence
+ */
+
+typedef struct {
+  PMTagStack      *tagStack;
+  HashTable       *hashTable;
+  MassTable       *massTable;
+  PMCleavageMap   *cleavageMap;
+  LXFastaSequence *fastaSeq;
+  PMAminoAlphabet *alpha;
+  PMEnzyme        *enzyme;
+  PeakIndex       **peakIndex;   /* per tag spectrum index (or NULL) */
+  ScoreModel      *scoreModel;
+  Parameter       *param;
+} MatchContext;
+
+/*
+ * @doc: Modified residue of a hit
+ */
+
+typedef struct {
+  long            pos;        /* sequence position                  */
+  PMSymbol        code;       /* modified amino acid                */
+} HitMod;
+
+/*
+ * @doc: Hits arena
+ * hits (and their modifications) are kept in flat arrays
+ * reused from sequence to sequence. hit peptides (pepSeq and
+ * pepMatch) are not stored but computed from positions only
+ * when needed (see ArenaFormatHit).
+ * the modifications of hits[i] are mods[modFrom[i]] ..
+ * mods[modFrom[i] + hits[i].nbMod - 1]
+ */
+
+typedef struct {
+  long            nbHits,
+                  maxHits;
+  PMHit           *hits;
+  long            *modFrom;
+  long            nbMods,
+                  maxMods;
+  HitMod          *mods;
+} HitArena;
+
+/*
+ * @doc: Processing phases (for timing report, see -v)
+ * - LoadPhase     : read tags and spectra
+ * - HashFillPhase : hash tags kuples (and bind kuple index)
+ * - ReadPhase     : read sequence, compute masses and cut sites
+ * - LookupPhase   : lookup sequence kuples into hash table
+ * - ExtendPhase   : extend hits left and right (mass match)
+ * - ScorePhase    : score hits
+ * - OutputPhase   : format and write hits
+ */
+
+typedef enum {
+  LoadPhase = 0,
+  HashFillPhase,
+  ReadPhase,
+  LookupPhase,
+  ExtendPhase,
+  ScorePhase,
+  OutputPhase,
+  NbPhases
+} MatchPhase;
+
+/*
+ * @doc: Time spent in each phase (seconds)
+ * there is one MatchTiming per thread, ExtendPhase and
+ * ScorePhase times are summed over threads when reported
+ */
+
+typedef struct {
+  double          elapsed[NbPhases];
+} MatchTiming;
+
+/*
+ * @doc: Hits of a tag
+ * arena->hits[from] .. arena->hits[from + count - 1]
+ */
+
+typedef struct {
+  HitArena        *arena;
+  long            from,
+                  count;
+} TagHits;
+
+/*
+ * @doc: Worker of a ThreadPool
+ * arena receives its hits, walk holds its flanks and round
+ * is the last round (i.e. sequence) it has processed
+ */
+
+typedef struct {
+  struct ThreadPool *pool;
+  HitArena        *arena;
+  FlankWalk       *walk;
+  MatchTiming     *timing;
+  long            round;
+} ThreadWorker;
+
+/*
+ * @doc: Pool of worker threads (see PMMatchThread.c)
+ * started once per run (see ThreadNewPool) and handed over one
+ * sequence at a time (see ThreadProcessTags) : each sequence is
+ * a new round, nbBusy counts the workers still busy on it and
+ * groups [next, nbGroups[ are still to be processed.
+ * nbStarted is 0 if tags are processed by the calling thread.
+ */
+
+typedef struct ThreadPool {
+  MatchContext    *context;
+  TagHits         *tagHits;
+  int             nbThreads;
+  int             nbStarted;
+  pthread_t       *threads;
+  ThreadWorker    *workers;
+  long            nbGroups;
+  long            next;
+  long            round;
+  int             nbBusy;
+  int             status;
+  Bool            quit;
+  pthread_mutex_t lock;
+  pthread_cond_t  start;
+  pthread_cond_t  done;
+} ThreadPool;
+
 
 /* ----------------------------------------------- */
 /* prototypes                                      */
@@ -113,6 +389,28 @@ void ExitUsage(int stat);
 
 void PrintHelp(void);
 
+                /* ------------------------------------ */
+                /* PMMatchRun.c                         */
+                /* ------------------------------------ */
+
+int MatchMain(int argc, char *argv[], PMHitSink sink, Ptr sinkArg);
+
+                /* ------------------------------------ */
+                /* PMMatchArena.c                       */
+                /* ------------------------------------ */
+
+HitArena *ArenaNew       (void);
+
+HitArena *ArenaFree      (HitArena *arena);
+
+void      ArenaReset     (HitArena *arena);
+
+int       ArenaPushHit   (HitArena *arena, PMHit *hit, HitMod *mods);
+
+void      ArenaFormatHit (HitArena *arena, long ihit,
+                          LXFastaSequence *fastaSeq, PMAminoAlphabet *alpha,
+                          char *pepSeq, char *pepMatch);
+
                 /* ------------------------------------ */
                 /* PMMatchHash.c                        */
                 /* ------------------------------------ */
@@ -131,40 +429,118 @@ void       HashFlattenTable    (HashTable *table);
 
 void       HashInitTable       (HashTable *table, PMTagStack *tagStack, Bool differentiateKQ);
 
+Int32      HashGroup           (HashTable *table, Int32 code);
+
 void       HashFillTable       (HashTable *table, char *seq, int kuple, Bool differentiateKQ);
 
-PMHitStack *HashLookupHits     (HashTable *table, PMTag *tag, Bool differentiateKQ);
+int        HashBindIndex       (HashTable *table, PMIndex *index);
+
+void       HashFillTableFromIndex (HashTable *table, PMIndex *index, Int64 iseq);
+
+long       HashNbOccurrences   (HashTable *table);
+
+int        HashFillCleavageMap (HashTable *table, PMCleavageMap *map, PMEnzyme *enzyme,
+                                LXFastaSequence *fastaSeq, long margin);
 
 
                 /* ------------------------------------ */
                 /* PMMatchMass.c                        */
                 /* ------------------------------------ */
 
-Bool MassMatchHit (PMTag *tag, 
-	 	           PMHit *hit,
-		           LXFastaSequence *fastaSeq,
-		           PMAminoAlphabet *alpha,
-		           PMEnzyme *enzyme,
-		           Parameter *param);
+void MassTagWindow (PMTag *tag,
+                    Parameter *param,
+                    Bool isNterm,
+                    float *massMini,
+                    float *massMaxi);
 
-int MassMatchHitStack (PMTag *tag, 
-		               PMHitStack *hitStack,
-		               LXFastaSequence *fastaSeq,
-		               PMAminoAlphabet *alpha,
-		               PMEnzyme *enzyme,
-		               Parameter *param);
+long MassMaxFlank  (PMTagStack *tagStack,
+                    PMAminoAlphabet *alpha,
+                    Parameter *param);
 
-                /* ------------------------------------ */
-                /* PMMatchScore.c						*/
-                /* ------------------------------------ */
+MassTable *MassNewTable  (void);
+
+MassTable *MassFreeTable (MassTable *table);
+
+int        MassFillTable (MassTable *table, 
+                          LXFastaSequence *fastaSeq, 
+                          PMAminoAlphabet *alpha);
+
+FlankWalk *MassNewWalk   (PMAminoAlphabet *alpha);
 
-int ScoreHitStack (PMTag *tag, 
-                   PMHitStack *hitStack,
+FlankWalk *MassFreeWalk  (FlankWalk *walk);
+
+int        MassWalkFlanks (FlankWalk *walk,
+                           LXStackpPtr positions,
+                           int kuple,
+                           float nMaxi,
+                           float cMaxi,
+                           MassTable *massTable,
+                           LXFastaSequence *fastaSeq,
+                           PMAminoAlphabet *alpha,
+                           Parameter *param);
+
+Bool MassMatchHit (PMTag *tag,
+                   PMHit *hit,
+                   HitMod *mods,
+                   MassFlank *nFlank,
+                   MassFlank *cFlank,
+                   PMCleavageMap *cleavageMap,
                    LXFastaSequence *fastaSeq,
                    PMAminoAlphabet *alpha,
-                   PMEnzyme *enzyme,
                    Parameter *param);
 
+                /* ------------------------------------ */
+                /* PMMatchFrame.c                       */
+                /* ------------------------------------ */
+
+FrameReader     *FrameNewReader    (int code);
+
+FrameReader     *FrameFreeReader   (FrameReader *reader);
+
+LXFastaSequence *FrameNextSequence (FrameReader *reader, FILE *streamin);
+
+                /* ------------------------------------ */
+                /* PMMatchPeak.c                        */
+                /* ------------------------------------ */
+
+PeakIndex *PeakNewIndex  (PMSpectrum *spectrum);
+
+PeakIndex *PeakFreeIndex (PeakIndex *index);
+
+PMPeak    *PeakLookup    (PeakIndex *index, float mass, float tolerance);
+
+                /* ------------------------------------ */
+                /* PMMatchScore.c						*/
+                /* ------------------------------------ */
+
+ScoreModel *ScoreNewModel  (Parameter *param);
+
+ScoreModel *ScoreFreeModel (ScoreModel *model);
+
+int ScoreHits (TagHits *tagHits,
+               PeakIndex *peakIndex,
+               ScoreModel *model,
+               LXFastaSequence *fastaSeq,
+               PMAminoAlphabet *alpha,
+               PMEnzyme *enzyme,
+               Parameter *param);
+
+
+                /* ------------------------------------ */
+                /* PMMatchThread.c                      */
+                /* ------------------------------------ */
+
+int ThreadProcessGroup (MatchContext *context, Int32 igroup,
+                        HitArena *arena, FlankWalk *walk,
+                        MatchTiming *timing, TagHits *tagHits);
+
+ThreadPool *ThreadNewPool  (MatchContext *context, HitArena **arenas,
+                            MatchTiming *timings, TagHits *tagHits);
+
+ThreadPool *ThreadFreePool (ThreadPool *pool);
+
+int ThreadProcessTags  (ThreadPool *pool);
+
 
                 /* ------------------------------------ */
                 /* PMMatchUtil.c						*/
@@ -174,7 +550,19 @@ char *UtilValidateSequence (char *seq);
 
 int   UtilCheckTags        (PMTagStack *tagStack);
 
-int   UtilPrintHitStack    (PMTag *tag, PMHitStack *hitStack, LXFastaSequence *fastaSeq);
+int   UtilPrintHits        (PMHitFile *hitFile, Int32 iseq, PMSeqId *seqId,
+                            Int32 itag, PMTag *tag, TagHits *tagHits, 
+                            LXFastaSequence *fastaSeq, PMAminoAlphabet *alpha,
+                            SeqWindow *window);
+
+long  UtilCountHits        (TagHits *tagHits, SeqWindow *window);
+
+double UtilClock           (MatchTiming *timing);
+
+void  UtilLapTime          (MatchTiming *timing, MatchPhase phase, double *clock);
+
+void  UtilPrintTiming      (FILE *streamou, MatchTiming *timings, int nbTimings,
+                            long nbTags, long nbSeq, long nbHits, double total);
 
 
 #endif
@@ -0,0 +1,208 @@
+/* -----------------------------------------------------------------------
+ * $Id: PMMatchArena.c $
+ * -----------------------------------------------------------------------
+ * @file: PMMatchArena.c
+ * @desc: PMMatch hits arena
+ *
+ * @history:
+ * @+ <Gloup> : Oct 26 : first version
+ * -----------------------------------------------------------------------
+ * @docstart:
+ *
+ * PepMap PMMatch hits arena <br>
+ * hits are stored in flat arrays (one arena per worker thread)
+ * that only grow and are reset after each sequence, so that
+ * no allocation is needed per hit. Hit peptides are formatted
+ * from positions when hits are scored or printed.
+ *
+ * @docend:
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "LX.h"
+#include "PM.h"
+
+#include "PMMatch.h"
+
+/* initial arena sizes */
+
+#define MIN_HITS 256
+#define MIN_MODS 256
+
+/* ----------------------------------------------- */
+/* copy residues [from, to] of sequence into buf   */
+/* using modified codes if any                     */
+/* return end of buffer                            */
+/* ----------------------------------------------- */
+
+static char *sCopyResidues(char *buf, long from, long to,
+                           HitMod *mods, int nbMods,
+                           LXFastaSequence *fastaSeq, PMAminoAlphabet *alpha)
+{
+  int  i;
+  long pos;
+
+  for (pos = from ; pos <= to ; pos++) {
+    PMAminoAcid *amino = PMGetAminoAcid(alpha, (PMSymbol) fastaSeq->seq[pos]);
+    *buf = (amino ? amino->oneLetterCode : fastaSeq->seq[pos]);
+    for (i = 0 ; i < nbMods ; i++) {
+      if (mods[i].pos == pos)
+        *buf = mods[i].code;
+    }
+    buf++;
+  }
+
+  return buf;
+}
+
+/* ----------------------------------------------- */
+/* API                                             */
+/* ----------------------------------------------- */
+
+/* ----------------------------------------------- */
+/* new (empty) arena                               */
+/* ----------------------------------------------- */
+
+HitArena *ArenaNew()
+{
+  HitArena *arena;
+
+  if (! (arena = NEW(HitArena))) {
+    MEMORY_ERROR();
+    return NULL;
+  }
+
+  arena->nbHits  = arena->nbMods  = 0;
+  arena->maxHits = MIN_HITS;
+  arena->maxMods = MIN_MODS;
+
+  arena->hits    = NEWN(PMHit, arena->maxHits);
+  arena->modFrom = NEWN(long,  arena->maxHits);
+  arena->mods    = NEWN(HitMod, arena->maxMods);
+
+  if (! (arena->hits && arena->modFrom && arena->mods)) {
+    MEMORY_ERROR();
+    return ArenaFree(arena);
+  }
+
+  return arena;
+}
+
+/* ----------------------------------------------- */
+/* free arena                                      */
+/* ----------------------------------------------- */
+
+HitArena *ArenaFree(HitArena *arena)
+{
+  if (arena) {
+    if (arena->hits)
+      FREE(arena->hits);
+    if (arena->modFrom)
+      FREE(arena->modFrom);
+    if (arena->mods)
+      FREE(arena->mods);
+    FREE(arena);
+  }
+
+  return NULL;
+}
+
+/* ----------------------------------------------- */
+/* reset arena (keep memory)                       */
+/* ----------------------------------------------- */
+
+void ArenaReset(HitArena *arena)
+{
+  arena->nbHits = 0;
+  arena->nbMods = 0;
+}
+
+/* ----------------------------------------------- */
+/* push copy of hit and of its hit->nbMod          */
+/* modifications                                   */
+/* ----------------------------------------------- */
+
+int ArenaPushHit(HitArena *arena, PMHit *hit, HitMod *mods)
+{
+  if (arena->nbHits >= arena->maxHits) {
+    arena->maxHits *= 2;
+    if (   (! (arena->hits    = REALLOC(arena->hits, PMHit, arena->maxHits)))
+        || (! (arena->modFrom = REALLOC(arena->modFrom, long, arena->maxHits))))
+      return MEMORY_ERROR();
+  }
+
+  if (arena->nbMods + hit->nbMod > arena->maxMods) {
+    arena->maxMods = 2 * arena->maxMods + hit->nbMod;
+    if (! (arena->mods = REALLOC(arena->mods, HitMod, arena->maxMods)))
+      return MEMORY_ERROR();
+  }
+
+  arena->hits[arena->nbHits]    = *hit;
+  arena->modFrom[arena->nbHits] = arena->nbMods;
+
+  (void) memcpy(arena->mods + arena->nbMods, mods, hit->nbMod * sizeof(HitMod));
+
+  arena->nbHits++;
+  arena->nbMods += hit->nbMod;
+
+  return LX_NO_ERROR;
+}
+
+/* ----------------------------------------------- */
+/* format peptides of hit #ihit                    */
+/* pepSeq   : sequence peptide (e.g. K.ACDEFR.G)   */
+/* pepMatch : match peptide (e.g. Ac[DEF]R)        */
+/* either may be NULL                              */
+/* ----------------------------------------------- */
+
+void ArenaFormatHit(HitArena *arena, long ihit,
+                    LXFastaSequence *fastaSeq, PMAminoAlphabet *alpha,
+                    char *pepSeq, char *pepMatch)
+{
+  long   from, to;
+  char   *buf;
+  PMHit  *hit  = arena->hits + ihit;
+  HitMod *mods = arena->mods + arena->modFrom[ihit];
+
+  /* ------------------------------------------ */
+  /* match peptide                              */
+
+  if (pepMatch) {
+
+    buf = pepMatch;
+
+    if (hit->posMn >= 0)
+      buf = sCopyResidues(buf, hit->posMn, hit->posSn - 1, mods, hit->nbMod, fastaSeq, alpha);
+
+    buf += sprintf(buf, "[%s]", hit->tag->seq);
+
+    if (hit->posMc >= 0)
+      buf = sCopyResidues(buf, hit->posSc + 1, hit->posMc, mods, hit->nbMod, fastaSeq, alpha);
+
+    *buf = '\000';
+  }
+
+  /* ------------------------------------------ */
+  /* sequence peptide                           */
+
+  if (pepSeq) {
+
+    from = (hit->posMn >= 0 ? hit->posMn : hit->posSn);
+    to   = (hit->posMc >= 0 ? hit->posMc : hit->posSc);
+
+    buf = pepSeq;
+
+    *buf++ = (((hit->posMn >= 0) && (from > 0)) ? fastaSeq->seq[from - 1] : '*');
+    *buf++ = '.';
+
+    (void) memcpy(buf, fastaSeq->seq + from, to - from + 1);
+    buf += to - from + 1;
+
+    *buf++ = '.';
+    *buf++ = (((hit->posMc >= 0) && (to < fastaSeq->length - 1)) ? fastaSeq->seq[to + 1] : '*');
+    *buf   = '\000';
+  }
+}
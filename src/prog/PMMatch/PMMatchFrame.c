@@ -0,0 +1,145 @@
+/* -----------------------------------------------------------------------
+ * $Id: PMMatchFrame.c $
+ * -----------------------------------------------------------------------
+ * @file: PMMatchFrame.c
+ * @desc: PMMatch on the fly translation of nucleic sequences
+ *
+ * @history:
+ * @+ <Gloup> : Oct 26 : first version
+ * -----------------------------------------------------------------------
+ * @docstart:
+ *
+ * PepMap PMMatch on the fly translation of nucleic sequences <br>
+ * nucleic sequences are read one at a time, encoded once
+ * (see LXBioSeqEncode) and their 6 frames are translated, one
+ * at a time, into the same reusable sequence. The frames are
+ * delivered in the PMTrans order (D1 D2 D3 R1 R2 R3) and named
+ * as PMTrans does (see PMSeqId2Fasta), so that hits are the same
+ * as with a translated chromosome file.
+ *
+ * @docend:
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "LX.h"
+#include "PM.h"
+
+#include "PMMatch.h"
+
+/* ----------------------------------------------- */
+/* API                                             */
+/* ----------------------------------------------- */
+
+/* ----------------------------------------------- */
+/* new frame reader using genetic code #code       */
+/* ----------------------------------------------- */
+
+FrameReader *FrameNewReader(int code)
+{
+  FrameReader *reader;
+
+  if (! (reader = NEW(FrameReader))) {
+    MEMORY_ERROR();
+    return NULL;
+  }
+
+  reader->iframe   = 6;
+  reader->nucSeq   = LXFastaNewSequence(BUFSIZ);
+  reader->frameSeq = LXFastaNewSequence(BUFSIZ);
+
+  if (! (reader->nucSeq && reader->frameSeq)) {
+    MEMORY_ERROR();
+    return FrameFreeReader(reader);
+  }
+
+  if (! (   LXBioCodonTable(reader->tables[0], code, FALSE)
+         && LXBioCodonTable(reader->tables[1], code, TRUE))) {
+    ARG_ERROR();
+    return FrameFreeReader(reader);
+  }
+
+  return reader;
+}
+
+/* ----------------------------------------------- */
+/* free frame reader                               */
+/* ----------------------------------------------- */
+
+FrameReader *FrameFreeReader(FrameReader *reader)
+{
+  if (reader) {
+    (void) LXFastaFreeSequence(reader->nucSeq);
+    (void) LXFastaFreeSequence(reader->frameSeq);
+    FREE(reader);
+  }
+
+  return NULL;
+}
+
+/* ----------------------------------------------- */
+/* get next translated frame from streamin         */
+/* return NULL at end of file                      */
+/* the returned sequence belongs to reader and is  */
+/* overwritten by next call. Its ok flag is FALSE  */
+/* if the nucleic sequence could not be read       */
+/* ----------------------------------------------- */
+
+LXFastaSequence *FrameNextSequence(FrameReader *reader, FILE *streamin)
+{
+  int             frame;
+  Bool            reverse;
+  LXFastaSequence *nucSeq   = reader->nucSeq;
+  LXFastaSequence *frameSeq = reader->frameSeq;
+
+  /* ---------------------------------- */
+  /* next nucleic sequence              */
+
+  if (reader->iframe >= 6) {
+
+    if (! LXFastaReadSequence(streamin, nucSeq))
+      return NULL;
+
+    if (! (frameSeq->ok = nucSeq->ok))
+      return frameSeq;
+
+    (void) strcpy(reader->seqId.name, nucSeq->name);
+    (void) strcpy(reader->seqId.comment, nucSeq->comment);
+
+    reader->seqId.length = nucSeq->length;
+
+    (void) LXBioSeqEncode(nucSeq->seq, nucSeq->length);
+
+    reader->iframe = 0;
+  }
+
+  /* ---------------------------------- */
+  /* translate frame                    */
+
+  frame   = reader->iframe % 3;
+  reverse = (reader->iframe >= 3);
+
+  reader->seqId.strand = (reverse ? PM_SEQID_REVERSE : PM_SEQID_DIRECT);
+  reader->seqId.frame  = frame + 1;
+
+  frameSeq->length = MAX(0, (nucSeq->length - frame) / 3);
+
+  if (! (frameSeq->seq = LXAssertAlloc(frameSeq->seq, frameSeq->length + 1))) {
+    frameSeq->ok = FALSE;
+    return frameSeq;
+  }
+
+  (void) LXBioFrameTranslate(nucSeq->seq, nucSeq->length, frame,
+                             reader->tables[reverse ? 1 : 0], reverse,
+                             0, frameSeq->length, frameSeq->seq);
+
+  frameSeq->seq[frameSeq->length] = '\000';
+
+  frameSeq->ok = (PMSeqId2Fasta(&reader->seqId, frameSeq) == LX_NO_ERROR);
+
+  reader->iframe++;
+
+  return frameSeq;
+}
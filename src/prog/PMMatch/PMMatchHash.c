@@ -7,10 +7,17 @@
  * @history:
  * @+ <Wanou> : Jul 02 : first version
  * @+ <Gloup> : Aug 06 : complete code revision
+ * @+ <Gloup> : Oct 26 : tags grouped by kuple
+ * @+ <Gloup> : Oct 26 : compact (open addressing) table
+ * @+ <Gloup> : Oct 26 : cleavage map filled around kuple occurrences
  * -----------------------------------------------------------------------
  * @docstart: 
  *
  * PepMap PMChromo hashing functions<br>
+ * the table only holds the kuples of tags : it is an open
+ * addressing table (size twice the number of distinct tags
+ * kuples) mapping each kuple code to its group of tags, with
+ * one positions stack per group.
  *
  * @docend:
  */
@@ -26,14 +33,54 @@
 
 #define ALPHALEN 26  /* do not change */
 
+#define EMPTY_SLOT -1
+
+/* multiplicative hashing constant (2^32 / golden ratio) */
+
+#define HASH_MULT 2654435769U
+
 /* cache powers of ALPHALEN */
 
 static int sPow[16] = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0};
 
+/* tag kuple code (for grouping tags) */
+
+typedef struct {
+  Int32 code;
+  long  itag;
+} TagCode;
+
 /* ----------------------------------------------- */
 /* local functions                                 */
 /* ----------------------------------------------- */
 
+/* ----------------------------------------------- */
+/* compare tags by kuple code then by rank         */
+/* ----------------------------------------------- */
+
+static int sCompareTagCode(const void *p1, const void *p2)
+{
+  const TagCode *t1 = (const TagCode *) p1;
+  const TagCode *t2 = (const TagCode *) p2;
+
+  if (t1->code != t2->code)
+    return (t1->code < t2->code ? -1 : 1);
+
+  return (t1->itag < t2->itag ? -1 : (t1->itag > t2->itag ? 1 : 0));
+}
+
+/* ----------------------------------------------- */
+/* compare positions                               */
+/* ----------------------------------------------- */
+
+static int sComparePositions(const void *p1, const void *p2)
+{
+  long pos1 = *((const long *) p1);
+  long pos2 = *((const long *) p2);
+
+  return (pos1 < pos2 ? -1 : (pos1 > pos2 ? 1 : 0));
+}
+
 /* ----------------------------------------------- */
 /* compute ALPHALEN^k                              */
 /* ----------------------------------------------- */
@@ -55,17 +102,18 @@ static int sPower(int k) {
 }
 
 /* ----------------------------------------------- */
-/* return correct symbol to use with               */
-/* undifferentiable symbol                         */
+/* slot of code in open addressing table           */
+/* (either the slot holding code or an empty one)  */
 /* ----------------------------------------------- */
 
-static int sDifferentiate(int symbol, Bool differentiateKQ)
+static Int32 sSlot(HashTable *table, Int32 code)
 {
-  if (symbol == 'L')
-    return 'I';
-  if ((symbol == 'Q') && (! differentiateKQ))
-    return 'K';
-  return symbol;
+  Int32 slot = (Int32) ((((UInt32) code) * HASH_MULT) >> (32 - table->bits));
+
+  while ((table->keys[slot] != EMPTY_SLOT) && (table->keys[slot] != code))
+    slot = (slot + 1) & (table->size - 1);
+
+  return slot;
 }
 
 /* ----------------------------------------------- */
@@ -113,7 +161,7 @@ Int32 HashUple(char *s, int kuple, Bool differentiateKQ)
 
     code *= ALPHALEN;
 
-    symb = sDifferentiate(s[i], differentiateKQ);
+    symb = PMIndexFoldSymbol(s[i], differentiateKQ);
 
     code += (symb - 'A');
   }
@@ -136,7 +184,7 @@ Int32 HashNextUple(char *s, int kuple, Bool differentiateKQ, Int32 previous)
   
   code *= ALPHALEN;
 
-  symb  = sDifferentiate(s[kuple-1], differentiateKQ);
+  symb  = PMIndexFoldSymbol(s[kuple-1], differentiateKQ);
   
   code += (symb - 'A');
   
@@ -145,11 +193,12 @@ Int32 HashNextUple(char *s, int kuple, Bool differentiateKQ, Int32 previous)
 
 /* ----------------------------------------------- */
 /* new HashTable                                   */
+/* the table is actually allocated by              */
+/* HashInitTable, when tags are known              */
 /* ----------------------------------------------- */
 
 HashTable *HashNewTable(int kuple)
 {
-  int i;
   HashTable *table;
 
   if (! (table = NEW(HashTable))) {
@@ -157,19 +206,20 @@ HashTable *HashNewTable(int kuple)
      return NULL;
   }
 
-  table->kuple = kuple;
-  table->size  = sPower(kuple);
+  table->kuple   = kuple;
+  table->bits    = 0;
+  table->size    = 0;
+  table->keys    = NULL;
+  table->groups  = NULL;
+  table->stk     = NULL;
+  table->nbCodes = 0;
+  table->codes   = NULL;
+  table->start   = NULL;
+  table->tags    = NULL;
+  table->cursor  = NULL;
+  table->last    = NULL;
   
-   if (! (table->stk = NEWN(LXStackpPtr, table->size))) {
-     MEMORY_ERROR();
-     return HashFreeTable(table);
-   }
-     
-   for (i = 0 ; i < table->size ; i++) {
-     table->stk[i] = NULL;
-   }
-   
-   return table;
+  return table;
 }
 
 /* ----------------------------------------------- */
@@ -178,11 +228,25 @@ HashTable *HashNewTable(int kuple)
 
 HashTable *HashFreeTable(HashTable *table)
 {
-  int i;
-  
   if (table) {
-    if (table->stk)
+    if (table->stk) {
       HashResetTable(table);
+      FREE(table->stk);
+    }
+    if (table->keys)
+      FREE(table->keys);
+    if (table->groups)
+      FREE(table->groups);
+    if (table->codes)
+      FREE(table->codes);
+    if (table->start)
+      FREE(table->start);
+    if (table->tags)
+      FREE(table->tags);
+    if (table->cursor)
+      FREE(table->cursor);
+    if (table->last)
+      FREE(table->last);
     FREE(table);
   }
   return NULL;
@@ -194,9 +258,9 @@ HashTable *HashFreeTable(HashTable *table)
 
 void HashResetTable(HashTable *table)
 {
-  int i;
+  Int32 i;
   
-  for (i = 0 ; i < table->size ; i++) {
+  for (i = 0 ; i < table->nbCodes ; i++) {
     if (table->stk[i])
       table->stk[i] = LXFreeStackp(table->stk[i], NULL);
   }
@@ -208,49 +272,122 @@ void HashResetTable(HashTable *table)
 
 void HashFlattenTable(HashTable *table)
 {
-  int i;
+  Int32 i;
   
-  for (i = 0 ; i < table->size ; i++) {
-    if (table->stk[i])
+  for (i = 0 ; i < table->nbCodes ; i++) {
+    if (table->stk[i]->top)
       table->stk[i] = sEmptyStack(table->stk + i);
   }
 }
 
 /* ----------------------------------------------- */
 /* initialize HashTable entries according to tags  */
+/* tags sharing the same kuple are grouped, so     */
+/* that each kuple occurrence is processed once    */
+/* for the whole group (see ThreadProcessGroup)    */
 /* ----------------------------------------------- */
 
 void HashInitTable(HashTable *table, PMTagStack *tagStack, Bool differentiateKQ)
 {
-  long i;
+  long    i, nbTags;
+  Int32   slot;
+  TagCode *tagCodes;
   
-  for (i = 0 ; i < tagStack->top ; i++) {
+  nbTags = tagStack->top;
+
+  if (   (! (table->codes = NEWN(Int32, MAX(1, nbTags))))
+      || (! (table->start = NEWN(long,  MAX(1, nbTags) + 1)))
+      || (! (table->tags  = NEWN(long,  MAX(1, nbTags))))
+      || (! (table->stk   = NEWN(LXStackpPtr, MAX(1, nbTags))))
+      || (! (tagCodes     = NEWN(TagCode, MAX(1, nbTags))))) {
+    MEMORY_ERROR();
+    return;
+  }
+
+  /* ---------------------------------- */
+  /* sort tags by kuple codes           */
+
+  for (i = 0 ; i < nbTags ; i++) {
   
     PMTag *tag = (PMTag *) tagStack->val[i];
     
     (void) UtilValidateSequence(tag->seq);
     
-    Int32 code = HashUple(tag->seq, strlen(tag->seq), differentiateKQ);
-    
-    if (! table->stk[code])
-      table->stk[code] = LXNewStackp(LX_STKP_MIN_SIZE);
+    tagCodes[i].code = HashUple(tag->seq, strlen(tag->seq), differentiateKQ);
+    tagCodes[i].itag = i;
+  }
+
+  qsort(tagCodes, nbTags, sizeof(TagCode), sCompareTagCode);
+
+  /* ---------------------------------- */
+  /* make groups                        */
+
+  for (i = 0 ; i < nbTags ; i++) {
+
+    if ((i == 0) || (tagCodes[i].code != tagCodes[i-1].code)) {
+      table->stk[table->nbCodes] = LXNewStackp(LX_STKP_MIN_SIZE);
+      table->start[table->nbCodes] = i;
+      table->codes[table->nbCodes++] = tagCodes[i].code;
+    }
+
+    table->tags[i] = tagCodes[i].itag;
+  }
+
+  table->start[table->nbCodes] = nbTags;
+
+  FREE(tagCodes);
+
+  /* ---------------------------------- */
+  /* open addressing table              */
+  /* at least twice the number of codes */
+
+  for (table->bits = 1 ; (1 << table->bits) < 2 * table->nbCodes ; table->bits++)
+    /* nop */ ;
+  
+  table->size = 1 << table->bits;
+
+  if (   (! (table->keys   = NEWN(Int32, table->size)))
+      || (! (table->groups = NEWN(Int32, table->size)))) {
+    MEMORY_ERROR();
+    return;
+  }
+
+  for (slot = 0 ; slot < table->size ; slot++)
+    table->keys[slot] = EMPTY_SLOT;
+
+  for (i = 0 ; i < table->nbCodes ; i++) {
+    slot = sSlot(table, table->codes[i]);
+    table->keys[slot]   = table->codes[i];
+    table->groups[slot] = i;
   }
 }
 
+/* ----------------------------------------------- */
+/* get group of tags with kuple code               */
+/* return -1 if there is no such tag               */
+/* ----------------------------------------------- */
+
+Int32 HashGroup(HashTable *table, Int32 code)
+{
+  Int32 slot = sSlot(table, code);
+
+  return (table->keys[slot] == EMPTY_SLOT ? -1 : table->groups[slot]);
+}
+
 /* ----------------------------------------------- */
 /* Fill HashTable entries with sequence positions  */
 /* ----------------------------------------------- */
 
 void HashFillTable(HashTable *table, char *seq, int kuple, Bool differentiateKQ)
 {
-  Int32 pos, code, previous;
+  Int32 pos, code, previous, group;
   char  *s, *end;
     
    /* ---------------------------------- */
    /* check if sequence is large enough  */
 
-   for (pos = 1, end = seq; pos < kuple ; pos++, end++) {
-     if (! *end++)
+   for (pos = 0 ; pos < kuple ; pos++) {
+     if (! seq[pos])
        return;
    }
    
@@ -259,62 +396,151 @@ void HashFillTable(HashTable *table, char *seq, int kuple, Bool differentiateKQ)
       
    code = previous = HashUple(seq, kuple, differentiateKQ);
 
-   if (table->stk[code])
-     (void) LXPushpIn(table->stk[code], (void *) 0);
+   if ((group = HashGroup(table, code)) >= 0)
+     (void) LXPushpIn(table->stk[group], (void *) 0);
 
    /* ---------------------------------- */
-   /* now go ahead, 'end' will ensure    */
-   /* we stop kuple positions from end   */
+   /* now go ahead, 'end' points to the  */
+   /* last symbol of current kuple       */
 
-   for (s = seq + 1, pos = 1 ; *end ; s++, end++, pos++) {
+   for (s = seq + 1, end = seq + kuple, pos = 1 ; *end ; s++, end++, pos++) {
     
      code = HashNextUple(s, kuple, differentiateKQ, previous);
 
-     if (table->stk[code])
-       (void) LXPushpIn(table->stk[code], (void *) pos);
+     if ((group = HashGroup(table, code)) >= 0)
+       (void) LXPushpIn(table->stk[group], (void *) (long) pos);
       
      previous = code;
    }
 }
 
 /* ----------------------------------------------- */
-/* Lookup for tag hits in hashTable                */
-/* return stack of hits (may be empty)             */
+/* bind HashTable to kuple index                   */
+/* i.e. setup positions ranges of tags kuples      */
 /* ----------------------------------------------- */
 
-PMHitStack *HashLookupHits(HashTable *table, PMTag *tag, Bool differentiateKQ)
+int HashBindIndex(HashTable *table, PMIndex *index)
 {
-  long       i;
-  Int32      code;
-  PMHitStack *hitStack;
+  Int32 i;
 
-  if (! (hitStack = PMNewHitStack())) {
-    MEMORY_ERROR();
-    return NULL;
+  if (   (! (table->cursor = NEWN(Int64, MAX(1, table->nbCodes))))
+      || (! (table->last   = NEWN(Int64, MAX(1, table->nbCodes)))))
+    return MEMORY_ERROR();
+
+  for (i = 0 ; i < table->nbCodes ; i++) {
+    (void) PMIndexLookup(index, table->codes[i], table->cursor + i, table->last + i);
   }
-      
-  code = HashUple(tag->seq, table->kuple, differentiateKQ);
-  
-  if (! table->stk[code])
-    return hitStack;
-    
-  for (i = 0 ; i < table->stk[code]->top ; i++) {
 
-    PMHit *hit;
+  return LX_NO_ERROR;
+}
 
-    if (! (hit = PMNewHit())) {
-      MEMORY_ERROR();
-      return NULL;
-    }
+/* ----------------------------------------------- */
+/* Fill HashTable entries with positions of        */
+/* sequence #iseq from kuple index.                */
+/* index positions are sorted, therefore sequences */
+/* must be processed in index order.               */
+/* ----------------------------------------------- */
 
-    hit->type  = InvalidHit;
-    hit->posSn = (int) table->stk[code]->val[i];
-    hit->posSc = hit->posSn + table->kuple - 1;
-    hit->tag   = tag;
-    
-    (void) LXPushpIn(hitStack, (void *) hit);
+void HashFillTableFromIndex(HashTable *table, PMIndex *index, Int64 iseq)
+{
+  Int32 i;
+  Int64 pos, from, to;
+  LXStackpPtr stk;
+
+  from = index->seqs[iseq].from;
+  to   = from + index->seqs[iseq].length;
+
+  for (i = 0 ; i < table->nbCodes ; i++) {
+
+    stk = table->stk[i];
+
+    for ( ; table->cursor[i] < table->last[i] ; table->cursor[i]++) {
+
+      pos = PMIndexPosition(index, table->cursor[i]);
+
+      if (pos >= to)
+        break;
+
+      if (pos >= from)
+        (void) LXPushpIn(stk, (void *) (pos - from));
+    }
   }
+}
+
+/* ----------------------------------------------- */
+/* number of kuple occurrences in HashTable        */
+/* ----------------------------------------------- */
+
+long HashNbOccurrences(HashTable *table)
+{
+  Int32 i;
+  long  n;
+
+  for (i = 0, n = 0 ; i < table->nbCodes ; i++)
+    n += table->stk[i]->top;
 
-  return hitStack;
+  return n;
 }
 
+/* ----------------------------------------------- */
+/* fill cleavage map of sequence only around the   */
+/* kuple occurrences of HashTable : positions      */
+/* [pos - margin, pos + kuple + margin[ (margin    */
+/* should exceed the longest flank walked, see     */
+/* MassMaxFlank). used with a kuple index, so that */
+/* a sequence is only read around its hits.        */
+/* ----------------------------------------------- */
+
+int HashFillCleavageMap(HashTable *table, PMCleavageMap *map, PMEnzyme *enzyme,
+                        LXFastaSequence *fastaSeq, long margin)
+{
+  Int32 i;
+  long  k, n, from, to, *positions;
+  LXStackpPtr stk;
+
+  if (PMFillCleavageMapRange(map, enzyme, fastaSeq->seq, fastaSeq->length, 0, 0) != LX_NO_ERROR)
+    return LX_MEM_ERROR;
+
+  if ((n = HashNbOccurrences(table)) == 0)
+    return LX_NO_ERROR;
+
+  if (! (positions = NEWN(long, n)))
+    return MEMORY_ERROR();
+
+  for (i = 0, n = 0 ; i < table->nbCodes ; i++) {
+    stk = table->stk[i];
+    for (k = 0 ; k < stk->top ; k++)
+      positions[n++] = (long) stk->val[k];
+  }
+
+  qsort(positions, n, sizeof(long), sComparePositions);
+
+  /* ---------------------------------- */
+  /* merge overlapping ranges           */
+
+  from = positions[0] - margin;
+  to   = positions[0] + table->kuple + margin;
+
+  for (k = 1 ; k <= n ; k++) {
+
+    if ((k < n) && (positions[k] - margin <= to)) {
+      to = positions[k] + table->kuple + margin;
+      continue;
+    }
+
+    if (PMFillCleavageMapRange(map, enzyme, fastaSeq->seq, fastaSeq->length, 
+                               from, to) != LX_NO_ERROR) {
+      FREE(positions);
+      return LX_MEM_ERROR;
+    }
+
+    if (k < n) {
+      from = positions[k] - margin;
+      to   = positions[k] + table->kuple + margin;
+    }
+  }
+
+  FREE(positions);
+
+  return LX_NO_ERROR;
+}
@@ -7,6 +7,8 @@
  * @history:
  * @+ <Wanou> : Jul 02 : first version
  * @+ <Gloup> : Aug 06 : complete code revision
+ * @+ <Gloup> : Oct 26 : -n limit
+ * @+ <Gloup> : Oct 26 : -W only with -f
  * -----------------------------------------------------------------------
  * @docstart: 
  *
@@ -64,6 +66,8 @@ void PrintHelp()
   fprintf(stderr," options:\n");
   fprintf(stderr," -a AminoAcidFile : aminoacid reference file\n");
   fprintf(stderr,"                    (default = \"%s\")\n", DFT_AA_FILENAME);
+  fprintf(stderr," -c code          : genetic code used with -g (see PMTrans -h)\n");
+  fprintf(stderr,"                    (default = %d)\n", DFT_GENETIC_CODE);
   fprintf(stderr," -d tolerance     : mass tolerance in ppm\n");
   fprintf(stderr,"                    (default = %d)\n", DFT_TOLERANCE);
   fprintf(stderr," -D tolerance     : mass tolerance in amu\n");
@@ -71,22 +75,40 @@ void PrintHelp()
   fprintf(stderr," -e EnzymeFile    : digestion enzyme reference file\n");
   fprintf(stderr,"                    (default = \"%s\")\n", DFT_ENZ_FILENAME);
   fprintf(stderr," -f FastaFile     : translated chromosome filename\n");
-  fprintf(stderr,"                    (default = NONE) *you should provide this filename*\n");
+  fprintf(stderr,"                    (default = NONE) *you should provide this filename (or use -g or -I)*\n");
   fprintf(stderr," -F pkl | PKL | dta  : spectrum format\n");
   fprintf(stderr,"                    (default = pkl)\n");
+  fprintf(stderr," -g FastaFile     : (untranslated) chromosome filename\n");
+  fprintf(stderr,"                    the 6 frames are translated on the fly (see -c)\n");
+  fprintf(stderr,"                    to be used instead of -f (same hits as PMTrans + -f)\n");
+  fprintf(stderr,"                    (default = NONE)\n");
   fprintf(stderr," -h               : print this help\n");
+  fprintf(stderr," -I IndexFile     : kuple index of translated chromosome (built by PMIndex)\n");
+  fprintf(stderr,"                    to be used instead of -f\n");
+  fprintf(stderr,"                    (default = NONE)\n");
   fprintf(stderr," -i PSTFile       : PSTs filename\n");
+  fprintf(stderr,"                    may be repeated to process several PSTs files\n");
+  fprintf(stderr,"                    in a single pass on the chromosome (see -O)\n");
   fprintf(stderr,"                    (default = <stdin>)\n");
+  fprintf(stderr," -j nbThreads     : number of threads used to process tags\n");
+  fprintf(stderr,"                    output is identical whatever the number of threads\n");
+  fprintf(stderr,"                    (default = %d)\n", DFT_THREADS);
   fprintf(stderr," -k               : differentiate between K/Q\n");
   fprintf(stderr,"                    (default = off)\n");
+  fprintf(stderr," -l listFile      : file containing PSTs filenames (one per line)\n");
+  fprintf(stderr,"                    same as as many -i options\n");
+  fprintf(stderr,"                    (default = NONE)\n");
   fprintf(stderr," -m miscleavage   : maximum number of miscleavage(s)\n");
   fprintf(stderr,"                    (default = %d)\n", DFT_MAX_MISCLEAVAGE);
   fprintf(stderr," -M overcleavage  : maximum number of overcleavage(s) (0, 1 or 2)\n");
   fprintf(stderr,"                    (default = %d)\n", DFT_MAX_OVERCLEAVAGE);
-  fprintf(stderr," -n maxModif      : maximum number of modified residues\n");
+  fprintf(stderr," -n maxModif      : maximum number of modified residues (0-%d)\n", MAX_MODIF);
   fprintf(stderr,"                    (default = %d)\n", DFT_MAX_MODIF);
   fprintf(stderr," -o outputFile    : output (hits) filename\n");
   fprintf(stderr,"                    (default = <stdout>)\n");
+  fprintf(stderr," -O suffix        : with several PSTs files, hits of each PSTFile\n");
+  fprintf(stderr,"                    are written into PSTFile<suffix> (-o is not allowed)\n");
+  fprintf(stderr,"                    (default = \"%s\")\n", DFT_BATCH_SUFFIX);
   fprintf(stderr," -p               : report partial hits too\n");
   fprintf(stderr,"                    (default = off)\n");
   fprintf(stderr," -S (P|R|S|D)     : type of hit score\n");
@@ -94,10 +116,27 @@ void PrintHelp()
   fprintf(stderr,"                    note: all score types (except P) need the -s option too\n");
   fprintf(stderr,"                    (default = P)\n");
   fprintf(stderr," -s spectrumFile  : spectrum file\n");
+  fprintf(stderr,"                    with several PSTs files, give one -s per -i (in the same order)\n");
   fprintf(stderr,"                    you should provide a spectrum file for all score types except P\n");
   fprintf(stderr,"                    (default = NONE)\n"); 
   fprintf(stderr," -v               : verbose mode (add some internal information)\n");
+  fprintf(stderr,"                    and report time spent in each processing phase\n");
   fprintf(stderr,"                    (default = off)\n");
+  fprintf(stderr," -w t|c|b         : output (hits) format\n");
+  fprintf(stderr,"                    t = text : sequence and tag written before each block of hits\n");
+  fprintf(stderr,"                    c = compact text : sequences and tags written once\n");
+  fprintf(stderr,"                        and referred to by index\n");
+  fprintf(stderr,"                    b = binary : same as compact, binary encoded\n");
+  fprintf(stderr,"                    (c and b are readable by PMClust and PMHitConv)\n");
+  fprintf(stderr,"                    (default = t)\n");
+  fprintf(stderr," -W windowSize    : only with -f, sequences are read by windows of (about)\n");
+  fprintf(stderr,"                    windowSize aa, so that sequences larger than memory\n");
+  fprintf(stderr,"                    can be processed (same hits, but possibly in several\n");
+  fprintf(stderr,"                    blocks per sequence and tag). fasta file is read\n");
+  fprintf(stderr,"                    twice (sequences lengths are scanned first)\n");
+  fprintf(stderr,"                    (-g and -I always read whole sequences)\n");
+  fprintf(stderr,"                    0 means whole sequences\n");
+  fprintf(stderr,"                    (default = %ld)\n", DFT_WINDOW_SIZE);
   fprintf(stderr," -y metBefore     : number of positions to scan for Nterm Methionine\n");
   fprintf(stderr,"                    0 means no Nterm scan\n");
   fprintf(stderr,"                    (default = %d)\n", DFT_MET_SCAN);
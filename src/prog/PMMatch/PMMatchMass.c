@@ -8,10 +8,24 @@
  * @+ <Wanou> : Jan 02 : first version
  * @+ <Gloup> : Aug 06 : complete code revision
  * @+ <Gloup> : Jan 10 : 64 bits polish
+ * @+ <Gloup> : Oct 26 : prefix masses and bounded search of modifications
+ * @+ <Gloup> : Oct 26 : cleavage maps
+ * @+ <Gloup> : Oct 26 : hit peptides are no longer built here (see PMMatchArena.c)
+ * @+ <Gloup> : Oct 26 : max flank length (for windowed sequences)
+ * @+ <Gloup> : Oct 26 : flanks walked once per group, single search of modifications
+ * @+ <Gloup> : Oct 26 : unused (and thread shared) sVerbose removed
+ * @+ <Gloup> : Oct 26 : flank masses summed when walked if no mass table
  * -----------------------------------------------------------------------
  * @docstart: 
  *
  * PepMap PMMatch mass matching functions <br>
+ * masses of the current sequence residues are cumulated once
+ * (see MassFillTable) so that the mass of any (unmodified) flank
+ * of a kuple is a simple difference. Each occurrence of a kuple
+ * is walked once for all the tags sharing it (see MassWalkFlanks) :
+ * flanks matching a tag mass are then searched by binary search,
+ * and modifications by a single bounded search over the modifiable
+ * residues of the flank, keeping the fewest possible modifications.
  *
  * @docend:
  */
@@ -25,140 +39,356 @@
 #include "PMMatch.h"
 
 /* ----------------------------------------------- */
-/* statics                                         */
+/* mass search state (one side of a hit)           */
+/* modDist/modCode hold the modifications being    */
+/* placed, bestDist/bestCode the modifications of  */
+/* the best flank found so far (nbModif of them)   */
 /* ----------------------------------------------- */
 
-/* placeholders for mass comparisons */
+typedef struct {
+  MassFlank       *flank;
+  LXFastaSequence *fastaSeq;
+  PMAminoAlphabet *alpha;
+  float           massMini, massMaxi;
+  int             maxModif;
+  int             nbModif;            /* maxModif + 1 if not found          */
+  long            length;             /* best flank length                  */
+  long            modDist[MAX_MODIF];
+  PMSymbol        modCode[MAX_MODIF];
+  long            bestDist[MAX_MODIF];
+  PMSymbol        bestCode[MAX_MODIF];
+} MassSearch;
 
-/* placeholder or verbosity          */
+/* ----------------------------------------------- */
+/* mass of unmodified flank of length len          */
+/* ----------------------------------------------- */
+
+static double sFlankMass(MassFlank *flank, long len)
+{
+  return flank->mass[len];
+}
+
+/* ----------------------------------------------- */
+/* sequence position at distance d                 */
+/* ----------------------------------------------- */
+
+static long sFlankPosition(MassFlank *flank, long d)
+{
+  return (flank->isNterm ? flank->origin - d : flank->origin + d - 1);
+}
+
+/* ----------------------------------------------- */
+/* first flank length in [from, flank->length]     */
+/* with mass + delta >= bound (or > bound if       */
+/* strict). return flank->length + 1 if none       */
+/* lengths are probed at doubling steps from       */
+/* 'from' first, since the answer is usually close */
+/* ----------------------------------------------- */
+
+static long sFirstLength(MassFlank *flank, long from, double delta, 
+                         double bound, Bool strict)
+{
+  long   lo, hi, mid, step;
+  double mass;
+
+  lo = mid = from;
+  hi = flank->length + 1;
+
+  for (step = 1 ; mid < hi ; step *= 2) {
+    mass = sFlankMass(flank, mid) + delta;
+    if (strict ? (mass > bound) : (mass >= bound)) {
+      hi = mid;
+      break;
+    }
+    lo  = mid + 1;
+    mid = lo + step;
+  }
+
+  while (lo < hi) {
+    mid  = (lo + hi) / 2;
+    mass = sFlankMass(flank, mid) + delta;
+    if (strict ? (mass > bound) : (mass >= bound))
+      hi = mid;
+    else
+      lo = mid + 1;
+  }
+
+  return lo;
+}
+
+/* ----------------------------------------------- */
+/* check flank of length >= from with (already     */
+/* placed) modifications delta.                    */
+/* since masses increase with length, the first    */
+/* length reaching massMini should not be over     */
+/* massMaxi.                                       */
+/* return length or -1                             */
+/* ----------------------------------------------- */
+
+static long sCheckFlank(MassSearch *ms, long from, double delta)
+{
+  long len = sFirstLength(ms->flank, from, delta, ms->massMini, FALSE);
+
+  if (   (len > ms->flank->length)
+      || (sFlankMass(ms->flank, len) + delta > ms->massMaxi))
+    return -1;
+
+  return len;
+}
+
+/* ----------------------------------------------- */
+/* is code a modifiable residue                    */
+/* ----------------------------------------------- */
+
+static Bool sModifiable(PMAminoAlphabet *alpha, PMSymbol code)
+{
+  return (    (code >= 0) && (code < PM_MAX_AA)
+           && alpha->valid[code]
+           && (alpha->table[code].nbMod > 0));
+}
+
+/* ----------------------------------------------- */
+/* record flank of length len with the nmod        */
+/* modifications being placed, if it has fewer     */
+/* modifications than the best one so far          */
+/* ----------------------------------------------- */
+
+static void sKeepFlank(MassSearch *ms, int nmod, long len)
+{
+  if (nmod >= ms->nbModif)
+    return;
+
+  ms->nbModif = nmod;
+  ms->length  = len;
+
+  (void) memcpy(ms->bestDist, ms->modDist, nmod * sizeof(long));
+  (void) memcpy(ms->bestCode, ms->modCode, nmod * sizeof(PMSymbol));
+}
+
+/* ----------------------------------------------- */
+/* place modifications at distances >= dmin        */
+/* (nmod modifications of mass shift delta are     */
+/* already placed) and check flanks.               */
+/* this is a single depth first search over the    */
+/* modifiable residues of the flank :              */
+/* - farthest residues first, then in modIndx      */
+/* order, so that among the flanks with the fewest */
+/* modifications the first one found is the one   */
+/* a residue by residue walk would find.           */
+/* - residues whose flank is already over massMaxi */
+/* are not reached.                                */
+/* - branches that cannot end with fewer           */
+/* modifications than the best flank are pruned.   */
+/* a N (resp C) terminal modification ends the     */
+/* flank.                                          */
+/* ----------------------------------------------- */
+
+static void sPlaceModif(MassSearch *ms, int nmod, long dmin, double delta)
+{
+  int         imod;
+  long        d, dmax, len;
+  PMSymbol    code;
+  double      shift;
+  MassFlank   *flank = ms->flank;
+  PMAminoAcid *amino, *aaMod;
+
+  if (nmod + 1 >= ms->nbModif)
+    return;         /* cannot do better */
+
+  /* ---------------------------------- */
+  /* the residue at distance d is only  */
+  /* reached if flank of length d-1 is  */
+  /* not over massMaxi                  */
+
+  dmax = MIN(sFirstLength(flank, 0, delta, ms->massMaxi, TRUE), flank->length);
+
+  for (d = dmax ; d >= dmin ; d--) {
+
+    code = (PMSymbol) ms->fastaSeq->seq[sFlankPosition(flank, d)];
+
+    if (! sModifiable(ms->alpha, code))
+      continue;
+
+    amino = ms->alpha->table + code;
+
+    for (imod = 0 ; imod < amino->nbMod ; imod++) {
+
+      if (nmod + 1 >= ms->nbModif)
+        return;     /* cannot do better */
+
+      aaMod = PMGetAminoAcid(ms->alpha, amino->modIndx[imod]);
+
+      if (flank->isNterm && (aaMod->modLocation == PM_AA_MOD_LOC_CTERM))
+        continue;
+
+      if ((! flank->isNterm) && (aaMod->modLocation == PM_AA_MOD_LOC_NTERM))
+        continue;
+
+      ms->modDist[nmod] = d;
+      ms->modCode[nmod] = aaMod->oneLetterCode;
 
-static Bool sVerbose = FALSE;
+      shift = delta + aaMod->mass - amino->mass;
+
+      if (aaMod->modLocation != PM_AA_MOD_LOC_ANY) {   /* terminal : last try */
+        if (    (sFlankMass(flank, d) + shift >= ms->massMini)
+             && (sFlankMass(flank, d) + shift <= ms->massMaxi))
+          sKeepFlank(ms, nmod + 1, d);
+        continue;
+      }
+
+      if ((len = sCheckFlank(ms, d, shift)) >= 0)
+        sKeepFlank(ms, nmod + 1, len);
+
+      if (nmod + 1 < ms->maxModif)
+        sPlaceModif(ms, nmod + 1, d + 1, shift);
+    }
+  }
+}
 
 /* ----------------------------------------------- */
-/* recursive check of masses                       */
+/* check masses on one side of hit                 */
+/* i.e. find a flank whose mass is in              */
+/* [massMini, massMaxi] with the fewest            */
+/* modifications (up to maxModif).                 */
+/* the modified residues are copied to mods        */
+/* return flank length or -1                       */
 /* ----------------------------------------------- */
 
-static long sCheckMass  (float           massCumul,
+static long sCheckMass  (MassFlank       *flank,
                          float           massMini,
                          float           massMaxi,
-                         Bool            isNterm,
-                         Bool            lastTry,
-                         long            position,
                          int             maxModif,
                          int             *nbModif,
-                         char            *peptide,
+                         HitMod          *mods,
                          LXFastaSequence *fastaSeq,
                          PMAminoAlphabet *alpha)
 {
-  long        found;
-  int         imod;
-  PMAminoAcid *amino;
-
-  /* -------------------------------- */
-  /* let's check current position     */
-  
-  if (massCumul > massMaxi)                 /* too far                             */
-    return -1;                              /* not found                           */
-
-  if (    (massCumul >= massMini) 
-       && (massCumul <= massMaxi)) {        /* correct mass found                  */
-    return position;
+  int        i;
+  MassSearch ms;
+
+  ms.flank    = flank;
+  ms.fastaSeq = fastaSeq;
+  ms.alpha    = alpha;
+  ms.massMini = massMini;
+  ms.massMaxi = massMaxi;
+  ms.maxModif = MIN(maxModif, MAX_MODIF);
+  ms.nbModif  = ms.maxModif + 1;
+  ms.length   = -1;
+
+  if ((ms.length = sCheckFlank(&ms, 0, 0.)) >= 0)
+    ms.nbModif = 0;
+  else if (ms.maxModif > 0)
+    sPlaceModif(&ms, 0, 1, 0.);
+
+  if (ms.nbModif > ms.maxModif)
+    return -1;  /* not found */
+
+  *nbModif = ms.nbModif;
+  
+  for (i = 0 ; i < *nbModif ; i++) {
+    mods[i].pos  = sFlankPosition(flank, ms.bestDist[i]);
+    mods[i].code = ms.bestCode[i];
   }
-  
-  if (lastTry)                              /* this is our last try                */
-    return -1;                              /* not found                           */
 
-  /* -------------------------------- */
-  /* let's check next position        */
-      
-  position += (isNterm ? -1 : +1);
-  
-  if (    (position < 0)
-       || (position >= fastaSeq->length))
-    return -1;                              /* not found                           */
-  
-  amino = PMGetAminoAcid(alpha, (PMSymbol) fastaSeq->seq[position]);
-  
-  if (    (amino == NULL)                   /* nothing interesting at this position */
-       || (amino->type != PM_AA_ORIGIN))    /* maybe a Stop or invalid code         */
-    return -1;                              /* not found                            */
-  
-  /* -------------------- */
-  /* try with original aa */  
-
-  *peptide = amino->oneLetterCode;
-  
-  if ((found = sCheckMass(massCumul + amino->mass, massMini, massMaxi,
-                          isNterm, lastTry, position, maxModif,
-                          nbModif, peptide + 1, fastaSeq, alpha)) != -1) {
-    return found;
-  }
+  return ms.length;
+}
 
-  /* -------------------- */
-  /* try with modified aa */  
+/* ----------------------------------------------- */
+/* lightest mass shift of a modification (<= 0)    */
+/* ----------------------------------------------- */
 
-  if (*nbModif >= maxModif)                  /* too many modifications             */
-    return -1;                               /* not found                          */
-   
-  (*nbModif)++;
-  
-  for (imod = 0 ; imod < amino->nbMod ; imod++) {
-  
-    PMAminoAcid *aaMod = PMGetAminoAcid(alpha, amino->modIndx[imod]);
+static double sMinShift(PMAminoAlphabet *alpha)
+{
+  int         i, imod;
+  double      shift, minShift;
+  PMAminoAcid *amino;
 
-    if (isNterm && (aaMod->modLocation == PM_AA_MOD_LOC_CTERM))
-      continue;
+  minShift = 0.;
 
-    if ((! isNterm) && (aaMod->modLocation == PM_AA_MOD_LOC_NTERM))
+  for (i = 0 ; i < PM_MAX_AA ; i++) {
+    if (! alpha->valid[i])
       continue;
-
-    lastTry = (aaMod->modLocation != PM_AA_MOD_LOC_ANY);
-
-    *peptide = aaMod->oneLetterCode;
-      
-    if ((found = sCheckMass(massCumul + aaMod->mass, massMini, massMaxi,
-                            isNterm, lastTry, position, maxModif,
-                            nbModif, peptide + 1, fastaSeq, alpha)) != -1) {
-      return found;
+    amino = alpha->table + i;
+    for (imod = 0 ; imod < amino->nbMod ; imod++) {
+      shift = (double) PMGetAminoAcid(alpha, amino->modIndx[imod])->mass - amino->mass;
+      minShift = MIN(minShift, shift);
     }
   }
 
-  (*nbModif)--;
-  
-  return -1;  /* not found */
+  return minShift;
 }
 
 /* ----------------------------------------------- */
-/* check enzyme cut sites                          */
+/* upper bound of flank masses to walk for a mass  */
+/* window <= massMaxi : modifications may lighten  */
+/* flank by at most maxModif * minShift (plus      */
+/* 1 Da against rounding)                          */
 /* ----------------------------------------------- */
 
-static Bool sHasCleavage(LXFastaSequence *fastaSeq, long pos, PMEnzyme *enzyme)
+static double sWalkBound(float massMaxi, int maxModif, double minShift)
 {
-  int i;
-  
-  if ((pos < 0) || (pos >= fastaSeq->length))
-    return FALSE;
-  
-  for (i = 0 ; i < enzyme->nbCuts ; i++) {
+  return massMaxi - maxModif * minShift + 1.;
+}
 
-    PMCutSite cut    = enzyme->cutSite[i];
-    Bool      ok     = FALSE;
-    long      offset = MAX(pos - cut.NCutOffset, 0);
+/* ----------------------------------------------- */
+/* walk one side of kuple occurrence : record the  */
+/* masses of flanks up to the longest flank a tag  */
+/* of window <= massMaxi may reach with up to      */
+/* maxModif modifications, into walk->masses.      */
+/* masses are read from the cumulated masses of    */
+/* the sequence (or summed here if table is NULL)  */
+/* and the walk stops at invalid residues          */
+/* (weighting 0)                                   */
+/* ----------------------------------------------- */
 
-    char save = fastaSeq->seq[pos];
-    fastaSeq->seq[pos] = '\000';
+static int sWalkFlank(FlankWalk *walk, MassFlank *flank, Bool isNterm,
+                      long origin, float massMaxi, int maxModif,
+                      MassTable *table, LXFastaSequence *fastaSeq,
+                      PMAminoAlphabet *alpha)
+{
+  long        d, maxLen;
+  double      bound, *mass, *cumul;
+  PMAminoAcid *amino;
 
-    ok = LXRegExec(cut.NCutRegExp, fastaSeq->seq + offset, TRUE);
+  maxLen = MIN((isNterm ? origin : fastaSeq->length - origin), BUFSIZ - 1);
 
-    fastaSeq->seq[pos] = save;
+  if (walk->nbMasses + maxLen + 1 > walk->maxMasses) {
+    walk->maxMasses = MAX(2 * walk->maxMasses, walk->nbMasses + maxLen + 1);
+    if (! (walk->masses = (walk->masses ? REALLOC(walk->masses, double, walk->maxMasses)
+                                        : NEWN(double, walk->maxMasses))))
+      return MEMORY_ERROR();
+  }
 
-    ok = ok && LXRegExec(cut.CCutRegExp, fastaSeq->seq + pos, TRUE);
-    
-    if (ok)
-      return TRUE;
+  flank->isNterm = isNterm;
+  flank->origin  = origin;
+  flank->from    = walk->nbMasses;
+
+  bound = sWalkBound(massMaxi, maxModif, walk->minShift);
+
+  mass  = walk->masses + walk->nbMasses;
+  cumul = (table ? table->mass : NULL);
+
+  mass[0] = 0.;
+
+  for (d = 1 ; (d <= maxLen) && (mass[d-1] <= bound) ; d++) {
+
+    amino = PMGetAminoAcid(alpha, (PMSymbol) fastaSeq->seq[sFlankPosition(flank, d)]);
+
+    if ((amino == NULL) || (amino->type != PM_AA_ORIGIN))
+      break;
+
+    if (! cumul)
+      mass[d] = mass[d-1] + amino->mass;
+    else
+      mass[d] = (isNterm ? cumul[origin] - cumul[origin - d]
+                         : cumul[origin + d] - cumul[origin]);
   }
-  
-  return FALSE;
+
+  flank->length = d - 1;
+
+  walk->nbMasses += d;
+
+  return LX_NO_ERROR;
 }
 
 /* ----------------------------------------------- */
@@ -220,59 +450,298 @@ static Bool sInvalid(PMHitPtr hit)
 /* API                                             */
 /* ----------------------------------------------- */
 
+/* ----------------------------------------------- */
+/* compute mass window of tag on N or C side       */
+/* ----------------------------------------------- */
+
+void MassTagWindow (PMTag *tag,
+                    Parameter *param,
+                    Bool isNterm,
+                    float *massMini,
+                    float *massMaxi)
+{
+  if (isNterm) {
+    if (param->massTolerance >= 0) {
+      *massMini = tag->mN - ((tag->mN + tag->mParent) * param->massTolerance);
+      *massMaxi = tag->mN + ((tag->mN + tag->mParent) * param->massTolerance);
+    }
+    else {
+      *massMini = tag->mN + param->massTolerance;
+      *massMaxi = tag->mN - param->massTolerance;
+    }
+  }
+  else {
+    if (param->massTolerance >= 0) {
+      *massMini = tag->mC - (tag->mC * param->massTolerance);
+      *massMaxi = tag->mC + (tag->mC * param->massTolerance);
+    }
+    else {
+      *massMini = tag->mC + param->massTolerance;
+      *massMaxi = tag->mC - param->massTolerance;
+    }
+  }
+}
+
+/* ----------------------------------------------- */
+/* max number of residues a hit may extend beyond  */
+/* its tag on either side : heaviest flank mass    */
+/* walked (see sWalkFlank) over lightest residue   */
+/* mass                                            */
+/* ----------------------------------------------- */
+
+long MassMaxFlank (PMTagStack *tagStack,
+                   PMAminoAlphabet *alpha,
+                   Parameter *param)
+{
+  int    i;
+  long   itag, flank, maxFlank;
+  float  massMini, massMaxi, minMass;
+  double minShift;
+
+  minShift = sMinShift(alpha);
+
+  minMass = 0.;
+
+  for (i = 0 ; i < PM_MAX_AA ; i++) {
+    if (   alpha->valid[i] && (alpha->table[i].mass > 0.)
+        && ((minMass == 0.) || (alpha->table[i].mass < minMass)))
+      minMass = alpha->table[i].mass;
+  }
+
+  if (minMass == 0.)
+    minMass = 1.;
+
+  maxFlank = 0;
+
+  for (itag = 0 ; itag < LXStackpSize(tagStack) ; itag++) {
+    PMTag *tag = (PMTag *) LXStackpGetValue(tagStack, itag);
+
+    MassTagWindow(tag, param, TRUE, &massMini, &massMaxi);
+    flank    = (long) (sWalkBound(massMaxi, param->maxModif, minShift) / minMass) + 1;
+    maxFlank = MAX(maxFlank, flank);
+
+    MassTagWindow(tag, param, FALSE, &massMini, &massMaxi);
+    flank    = (long) (sWalkBound(massMaxi, param->maxModif, minShift) / minMass) + 1;
+    maxFlank = MAX(maxFlank, flank);
+  }
+
+  return MIN(maxFlank, BUFSIZ - 1);
+}
+
+/* ----------------------------------------------- */
+/* new (empty) mass table                          */
+/* ----------------------------------------------- */
+
+MassTable *MassNewTable()
+{
+  MassTable *table;
+
+  if (! (table = NEW(MassTable))) {
+    MEMORY_ERROR();
+    return NULL;
+  }
+
+  table->size    = 0;
+  table->length  = 0;
+  table->mass    = NULL;
+
+  return table;
+}
+
+/* ----------------------------------------------- */
+/* free mass table                                 */
+/* ----------------------------------------------- */
+
+MassTable *MassFreeTable(MassTable *table)
+{
+  if (table) {
+    if (table->mass)
+      FREE(table->mass);
+    FREE(table);
+  }
+  return NULL;
+}
+
+/* ----------------------------------------------- */
+/* fill mass table with cumulated masses of        */
+/* sequence residues. invalid residues (Stop or    */
+/* unknown) weight 0 (no flank may cross them,     */
+/* see sWalkFlank).                                */
+/* ----------------------------------------------- */
+
+int MassFillTable(MassTable *table, LXFastaSequence *fastaSeq, PMAminoAlphabet *alpha)
+{
+  long        i, len;
+  PMAminoAcid *amino;
+
+  len = fastaSeq->length;
+
+  if (len + 1 > table->size) {
+    table->size = len + 1;
+    if (! (table->mass = (table->mass ? REALLOC(table->mass, double, table->size)
+                                      : NEWN(double, table->size))))
+      return MEMORY_ERROR();
+  }
+
+  table->length = len;
+
+  table->mass[0] = 0.;
+
+  for (i = 0 ; i < len ; i++) {
+
+    amino = PMGetAminoAcid(alpha, (PMSymbol) fastaSeq->seq[i]);
+
+    if ((amino == NULL) || (amino->type != PM_AA_ORIGIN))
+      table->mass[i+1] = table->mass[i];
+    else
+      table->mass[i+1] = table->mass[i] + amino->mass;
+  }
+
+  return LX_NO_ERROR;
+}
+
+/* ----------------------------------------------- */
+/* new (empty) flank walk                          */
+/* ----------------------------------------------- */
+
+FlankWalk *MassNewWalk(PMAminoAlphabet *alpha)
+{
+  FlankWalk   *walk;
+
+  if (! (walk = NEW(FlankWalk))) {
+    MEMORY_ERROR();
+    return NULL;
+  }
+
+  walk->maxFlanks = 0;
+  walk->nFlanks   = NULL;
+  walk->cFlanks   = NULL;
+  walk->nbMasses  = 0;
+  walk->maxMasses = 0;
+  walk->masses    = NULL;
+  walk->minShift  = sMinShift(alpha);
+
+  return walk;
+}
+
+/* ----------------------------------------------- */
+/* free flank walk                                 */
+/* ----------------------------------------------- */
+
+FlankWalk *MassFreeWalk(FlankWalk *walk)
+{
+  if (walk) {
+    if (walk->nFlanks)
+      FREE(walk->nFlanks);
+    if (walk->cFlanks)
+      FREE(walk->cFlanks);
+    if (walk->masses)
+      FREE(walk->masses);
+    FREE(walk);
+  }
+
+  return NULL;
+}
+
+/* ----------------------------------------------- */
+/* walk N and C flanks of each occurrence of a     */
+/* kuple (positions of first kuple residue), once  */
+/* for all the tags of a group : nMaxi and cMaxi   */
+/* are the widest N and C mass windows bounds of   */
+/* the group. walk->nFlanks[i] and cFlanks[i]      */
+/* receive the flanks of occurrence #i             */
+/* masses are read from massTable (or summed along */
+/* flanks if massTable is NULL)                    */
+/* ----------------------------------------------- */
+
+int MassWalkFlanks(FlankWalk *walk,
+                   LXStackpPtr positions,
+                   int kuple,
+                   float nMaxi,
+                   float cMaxi,
+                   MassTable *massTable,
+                   LXFastaSequence *fastaSeq,
+                   PMAminoAlphabet *alpha,
+                   Parameter *param)
+{
+  long i, posSn;
+  int  maxModif = MIN(param->maxModif, MAX_MODIF);
+
+  if (positions->top > walk->maxFlanks) {
+    walk->maxFlanks = MAX(2 * walk->maxFlanks, positions->top);
+    if (   (! (walk->nFlanks = (walk->nFlanks ? REALLOC(walk->nFlanks, MassFlank, walk->maxFlanks)
+                                              : NEWN(MassFlank, walk->maxFlanks))))
+        || (! (walk->cFlanks = (walk->cFlanks ? REALLOC(walk->cFlanks, MassFlank, walk->maxFlanks)
+                                              : NEWN(MassFlank, walk->maxFlanks)))))
+      return MEMORY_ERROR();
+  }
+
+  walk->nbMasses = 0;
+
+  for (i = 0 ; i < positions->top ; i++) {
+    posSn = (long) positions->val[i];
+    if (   (sWalkFlank(walk, walk->nFlanks + i, TRUE,  posSn, nMaxi, maxModif,
+                       massTable, fastaSeq, alpha) != LX_NO_ERROR)
+        || (sWalkFlank(walk, walk->cFlanks + i, FALSE, posSn + kuple, cMaxi, maxModif,
+                       massTable, fastaSeq, alpha) != LX_NO_ERROR))
+      return LX_MEM_ERROR;
+  }
+
+  for (i = 0 ; i < positions->top ; i++) {
+    walk->nFlanks[i].mass = walk->masses + walk->nFlanks[i].from;
+    walk->cFlanks[i].mass = walk->masses + walk->cFlanks[i].from;
+  }
+
+  return LX_NO_ERROR;
+}
+
 /* ----------------------------------------------- */
 /* process single hit                              */
 /* check masses and cut sites                      */
 /* and setup hit attributes accordingly            */
+/* nFlank and cFlank are the flanks of the hit     */
+/* kuple occurrence (see MassWalkFlanks) and       */
+/* cleavageMap the sequence enzyme cut sites       */
+/* the hit->nbMod modified residues of the hit are */
+/* copied to mods (2 * MAX_MODIF entries)          */
 /* ----------------------------------------------- */
 
-Bool MassMatchHit (PMTag *tag, 
+Bool MassMatchHit (PMTag *tag,
                    PMHit *hit,
+                   HitMod *mods,
+                   MassFlank *nFlank,
+                   MassFlank *cFlank,
+                   PMCleavageMap *cleavageMap,
                    LXFastaSequence *fastaSeq,
                    PMAminoAlphabet *alpha,
-                   PMEnzyme *enzyme,
                    Parameter *param)
 {
-  long  from, to, pos;
-  int   nModif, cModif; 
-  float massMini, massMaxi; 
-  char  nBuffer[BUFSIZ], cBuffer[BUFSIZ], buffer[BUFSIZ];
-  char  nChar, cChar;
-  
-  sVerbose = param->verbose;
+  long   from, to, len;
+  int    nModif, cModif; 
+  float  massMini, massMaxi; 
+  HitMod nMods[MAX_MODIF], cMods[MAX_MODIF];
 
   /* ------------------------------------------ */
   /* check mass on Nterm                        */
 
-  if (param->massTolerance >= 0) {
-    massMini = tag->mN - ((tag->mN + tag->mParent) * param->massTolerance);
-    massMaxi = tag->mN + ((tag->mN + tag->mParent) * param->massTolerance);
-  }
-  else {
-    massMini = tag->mN + param->massTolerance;
-    massMaxi = tag->mN - param->massTolerance;
-  }
+  MassTagWindow(tag, param, TRUE, &massMini, &massMaxi);
 
   nModif = 0;
-  hit->posMn = sCheckMass(0.0, massMini, massMaxi, TRUE, FALSE, hit->posSn, 
-                          param->maxModif, &nModif, nBuffer, fastaSeq, alpha);
+  len    = sCheckMass(nFlank, massMini, massMaxi, param->maxModif,
+                      &nModif, nMods, fastaSeq, alpha);
+
+  hit->posMn = (len >= 0 ? hit->posSn - len : -1);
 
   /* ------------------------------------------ */
   /* check mass on Cterm                        */
 
-  if (param->massTolerance >= 0) {
-    massMini = tag->mC - (tag->mC * param->massTolerance);
-    massMaxi = tag->mC + (tag->mC * param->massTolerance);
-  }
-  else {
-    massMini = tag->mC + param->massTolerance;
-    massMaxi = tag->mC - param->massTolerance;
-  }
-  
+  MassTagWindow(tag, param, FALSE, &massMini, &massMaxi);
   
   cModif = 0;
-  hit->posMc = sCheckMass(0.0, massMini, massMaxi, FALSE, FALSE, hit->posSc, 
-                          param->maxModif, &cModif, cBuffer, fastaSeq, alpha);
+  len    = sCheckMass(cFlank, massMini, massMaxi, param->maxModif,
+                      &cModif, cMods, fastaSeq, alpha);
+
+  hit->posMc = (len >= 0 ? hit->posSc + len : -1);
 
   /* ------------------------------------------ */
   /* don't insist if both sides don't match     */
@@ -310,12 +779,12 @@ Bool MassMatchHit (PMTag *tag,
   hit->nbOver = 0;
   
   if (    (hit->posMn >= 0)
-       && (! sHasCleavage(fastaSeq, hit->posMn, enzyme))
+       && (! PMHasCleavage(cleavageMap, hit->posMn))
        && (! sIsNTerm(fastaSeq, hit->posMn, param->metScan)))
     hit->nbOver++;
       
   if (    (hit->posMc >= 0)
-       && (! sHasCleavage(fastaSeq, hit->posMc + 1, enzyme))
+       && (! PMHasCleavage(cleavageMap, hit->posMc + 1))
        && (! sIsCTerm(fastaSeq, hit->posMc)))
     hit->nbOver++;
 
@@ -328,85 +797,21 @@ Bool MassMatchHit (PMTag *tag,
   from = (hit->posMn >= 0 ? hit->posMn + 1 : hit->posSn);
   to   = (hit->posMc >= 0 ? hit->posMc     : hit->posSc);
   
-  for (pos = from ; pos <= to ; pos++) {
-    if (sHasCleavage(fastaSeq, pos, enzyme))
-      hit->nbMis++;
-  }
+  hit->nbMis += PMCountCleavages(cleavageMap, from, to);
 
   if (hit->nbMis > param->maxMisCleavage)
     return sInvalid(hit);
 
   /* ------------------------------------------ */
-  /* compute match peptide                      */
-
-  nBuffer[(hit->posMn >= 0) ? hit->posSn - hit->posMn : 0] = '\000';
-  cBuffer[(hit->posMc >= 0) ? hit->posMc - hit->posSc : 0] = '\000';
-
-  (void) LXReverseStr(nBuffer);
+  /* keep modified residues                     */
 
-  (void) sprintf(buffer, "%s[%s]%s", nBuffer, tag->seq, cBuffer);
-
-  hit->pepMatch = LXStr(buffer);
-  
-  /* ------------------------------------------ */
-  /* compute sequence peptide                   */
-  
-  from = (hit->posMn >= 0 ? hit->posMn : hit->posSn);
-  to   = (hit->posMc >= 0 ? hit->posMc : hit->posSc);
+  if (hit->posMn < 0)
+    nModif = 0;
 
-  (void) strncpy(nBuffer, fastaSeq->seq + from, to - from + 1);
-  nBuffer[to - from + 1] = '\000';
-  
-  nChar = (((hit->posMn >= 0) && (from > 0)) ? fastaSeq->seq[from - 1] : '*');
-  cChar = (((hit->posMc >= 0) && (to < fastaSeq->length - 1)) ? fastaSeq->seq[to + 1] : '*');
-  
-  (void) sprintf(buffer, "%c.%s.%c", nChar, nBuffer, cChar);
-  
-  hit->pepSeq = LXStr(buffer);
+  (void) memcpy(mods, nMods, nModif * sizeof(HitMod));
 
+  if (hit->posMc >= 0)
+    (void) memcpy(mods + nModif, cMods, cModif * sizeof(HitMod));
 
   return TRUE;
 }
-
-/* ----------------------------------------------- */
-/* same but with a stack of hits                   */
-/* also cleanup stack (to save memory)             */
-/* ----------------------------------------------- */
-
-int MassMatchHitStack (PMTag *tag, 
-                       PMHitStack *hitStack,
-                       LXFastaSequence *fastaSeq,
-                       PMAminoAlphabet *alpha,
-                       PMEnzyme *enzyme,
-                       Parameter *param)
-{
-  PMHit *hit;
-  PMHitStack *tmpStack;
-  
-  
-  if (! (tmpStack = PMNewHitStack()))
-    return MEMORY_ERROR();
-  
-  // filter hits
-  
-  while (LXPoppOut(hitStack, (Ptr *) &hit)) {
-    if (MassMatchHit(tag, hit, fastaSeq, alpha, enzyme, param)) {
-      LXPushpIn(tmpStack, (Ptr) hit);
-    }
-    else {
-      PMFreeHit(hit);
-    }
-  }
-
-  // put stuff back
-  
-  while (LXPoppOut(tmpStack, (Ptr *) &hit)) {
-    LXPushpIn(hitStack, (Ptr) hit);
-  }
-
-  // free temporary stack
-  
-  (void) LXFreeStackp(tmpStack, NULL);
-
-  return LX_NO_ERROR;  
-}
@@ -0,0 +1,205 @@
+/* -----------------------------------------------------------------------
+ * $Id: PMMatchPeak.c $
+ * -----------------------------------------------------------------------
+ * @file: PMMatchPeak.c
+ * @desc: PMMatch spectrum peaks mass index
+ *
+ * @history:
+ * @+ <Gloup> : Oct 26 : first version
+ * -----------------------------------------------------------------------
+ * @docstart:
+ *
+ * PepMap PMMatch spectrum peaks mass index <br>
+ * the index is built once per spectrum (when spectra are loaded)
+ * and is used to assign fragments to peaks when scoring hits :
+ * the peaks near a given mass are found in (about) constant time
+ * instead of scanning the whole peak list.
+ *
+ * @docend:
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "LX.h"
+#include "PM.h"
+
+#include "PMMatch.h"
+
+/* ----------------------------------------------- */
+/* peak (mass, index) pair for sorting             */
+/* ----------------------------------------------- */
+
+typedef struct {
+  float mass;
+  Int32 index;
+} PeakEntry;
+
+/* ----------------------------------------------- */
+/* compare peaks on mass (then on index so that    */
+/* sort is stable)                                 */
+/* ----------------------------------------------- */
+
+static int sComparePeakEntries(const void *p1, const void *p2)
+{
+  PeakEntry *e1 = (PeakEntry *) p1,
+            *e2 = (PeakEntry *) p2;
+
+  if (e1->mass != e2->mass)
+    return (e1->mass < e2->mass ? -1 : 1);
+
+  return (e1->index < e2->index ? -1 : (e1->index > e2->index ? 1 : 0));
+}
+
+/* ----------------------------------------------- */
+/* bin of mass (clamped to [0, nbBins[)            */
+/* ----------------------------------------------- */
+
+static long sBin(PeakIndex *index, float mass)
+{
+  long bin;
+
+  if (mass <= index->minMass)
+    return 0;
+
+  bin = (long) ((mass - index->minMass) / index->binWidth);
+
+  return MIN(bin, index->nbBins - 1);
+}
+
+/* ----------------------------------------------- */
+/* API                                             */
+/* ----------------------------------------------- */
+
+/* ----------------------------------------------- */
+/* build mass index of spectrum peaks              */
+/* there are about as many bins as peaks           */
+/* ----------------------------------------------- */
+
+PeakIndex *PeakNewIndex(PMSpectrum *spectrum)
+{
+  long      i, bin;
+  float     maxMass;
+  PeakEntry *entries;
+  PeakIndex *index;
+
+  if (! (index = NEW(PeakIndex))) {
+    MEMORY_ERROR();
+    return NULL;
+  }
+
+  index->spectrum = spectrum;
+  index->nbPeaks  = spectrum->nbPeaks;
+  index->nbBins   = MAX(1, index->nbPeaks);
+
+  index->order = NEWN(Int32, MAX(1, index->nbPeaks));
+  index->mass  = NEWN(float, MAX(1, index->nbPeaks));
+  index->first = NEWN(Int32, index->nbBins + 1);
+
+  entries = NEWN(PeakEntry, MAX(1, index->nbPeaks));
+
+  if (! (index->order && index->mass && index->first && entries)) {
+    MEMORY_ERROR();
+    if (entries) FREE(entries);
+    return PeakFreeIndex(index);
+  }
+
+  /* ---------------------------------- */
+  /* sort peaks by mass                 */
+
+  for (i = 0 ; i < index->nbPeaks ; i++) {
+    entries[i].mass  = spectrum->peak[i].mass;
+    entries[i].index = (Int32) i;
+  }
+
+  qsort(entries, index->nbPeaks, sizeof(PeakEntry), sComparePeakEntries);
+
+  for (i = 0 ; i < index->nbPeaks ; i++) {
+    index->order[i] = entries[i].index;
+    index->mass[i]  = entries[i].mass;
+  }
+
+  FREE(entries);
+
+  /* ---------------------------------- */
+  /* bins                               */
+
+  index->minMass = (index->nbPeaks > 0 ? index->mass[0] : 0.);
+  maxMass        = (index->nbPeaks > 0 ? index->mass[index->nbPeaks - 1] : 0.);
+
+  index->binWidth = (maxMass - index->minMass) / (float) index->nbBins;
+
+  if (index->binWidth <= 0.)
+    index->binWidth = 1.;
+
+  for (bin = i = 0 ; bin < index->nbBins ; bin++) {
+    while ((i < index->nbPeaks) && (sBin(index, index->mass[i]) < bin))
+      i++;
+    index->first[bin] = (Int32) i;
+  }
+
+  index->first[index->nbBins] = (Int32) index->nbPeaks;
+
+  return index;
+}
+
+/* ----------------------------------------------- */
+/* free peak index                                 */
+/* ----------------------------------------------- */
+
+PeakIndex *PeakFreeIndex(PeakIndex *index)
+{
+  if (index) {
+    if (index->order)
+      FREE(index->order);
+    if (index->mass)
+      FREE(index->mass);
+    if (index->first)
+      FREE(index->first);
+    FREE(index);
+  }
+
+  return NULL;
+}
+
+/* ----------------------------------------------- */
+/* get peak matching mass, i.e. the lightest peak  */
+/* within tolerance of mass                        */
+/* tolerance is relative if >= 0 (e.g. 50e-6 for  */
+/* 50 ppm) and absolute (amu) if < 0               */
+/* return NULL if no peak matches                  */
+/* ----------------------------------------------- */
+
+PMPeak *PeakLookup(PeakIndex *index, float mass, float tolerance)
+{
+  long  i, bin;
+  float delta, peakMass, window;
+
+  if (index->nbPeaks == 0)
+    return NULL;
+
+  window = (tolerance >= 0 ? tolerance * mass : - tolerance);
+
+  // start one bin ahead, in case of rounding
+
+  bin = MAX(0, sBin(index, mass - window) - 1);
+
+  for (i = index->first[bin] ; i < index->nbPeaks ; i++) {
+
+    peakMass = index->mass[i];
+
+    delta = ABS(peakMass - mass);
+
+    if (tolerance >= 0)
+      delta /= mass;
+
+    if (delta < ABS(tolerance))
+      return index->spectrum->peak + index->order[i];
+
+    if (peakMass > mass)   // peaks are sorted by increasing masses
+      break;               // so we don't need to go further
+  }
+
+  return NULL;
+}
@@ -0,0 +1,1195 @@
+/* -----------------------------------------------------------------------
+ * $Id: PMMatchRun.c $
+ * -----------------------------------------------------------------------
+ * @file: PMMatchRun.c
+ * @desc: PepMap Chromosome/Prot Matcher main program (Multi-Tags version) 
+ *
+ * @history:
+ * @+ <Wanou> : Jul 02 : first version
+ * @+ <Gloup> : Aug 06 : complete code revision
+ * @+ <Gloup> : Oct 26 : fasta sequences read by windows (-W)
+ * @+ <Gloup> : Oct 26 : moved from PMMatchMain.c to MatchMain, hits
+ *                       may be handed over to a sink (see PMPipeline)
+ * @+ <Gloup> : Oct 26 : -n checked against MAX_MODIF
+ * @+ <Gloup> : Oct 26 : threads pool started once per run
+ * @+ <Gloup> : Oct 26 : index sequences only read around sparse kuple hits
+ * @+ <Gloup> : Oct 26 : windowed sequences lengths scanned first, -W
+ *                       off by default and only with -f
+ * -----------------------------------------------------------------------
+ * @docstart: 
+ *
+ * PepMap PMMatch (MT) main program <br>
+ * MatchMain runs PMMatch with its command line arguments. hits are
+ * either written (into stdout or batch files) or, if sink is not
+ * NULL, handed over to sink by blocks (see PMHitFileOpenSink).
+ *
+ * @docend:
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "LX.h"
+#include "PM.h"
+
+#include "PMMatch.h"
+#include "assert.h"
+
+/* -------------------------------------------------------------------- */
+/* Local functs                                                         */
+/* -------------------------------------------------------------------- */
+
+/* ----------------------------------------------- */
+static HitScoreType sGetHitScoreType(char *type)
+{
+   if (*type == 'P')
+     return PSTHitScoreType;
+
+   if (*type == 'R')
+     return REMTHitScoreType;
+
+   if (*type == 'D')
+     return Dancink99HitScoreType;
+
+   if (*type == 'S')
+     return RankSumHitScoreType;
+
+   return UnknownHitScoreType;
+}
+
+
+/* ----------------------------------------------- */
+static int sReadSpectrumFile(char *filename, LXStackpPtr *spectrumStack, PMSpectrumReader spectrumReader)
+{
+  FILE *spectrumFile;
+  PMSpectrum *spRaw;
+
+  if (! (spectrumFile = LXOpenFile(filename, "r")))
+    return IO_ERROR();
+    
+  *spectrumStack = LXNewStackp(LX_STKP_MIN_SIZE);
+  
+  spRaw = PMNewSpectrum();
+
+  while (spectrumReader(spectrumFile, spRaw) == LX_NO_ERROR) {
+  
+    LXPushpIn(*spectrumStack, spRaw );
+
+    spRaw = PMNewSpectrum();
+  }
+
+  PMFreeSpectrum(spRaw);
+
+  fclose(spectrumFile);
+  
+  return LX_NO_ERROR;
+}
+
+
+/* ----------------------------------------------- */
+/* retrieve spectrum associated to tag from tag id */
+/* tag id has the form : string.int.int            */
+/* where the seconf int indicates the spectrum     */
+/* index.                                          */
+/* *peakIndex receives the spectrum peaks index    */
+/* (from peakIndexStack)                           */
+
+static int sRetrieveSpectrum(PMTag *tag, LXStackpPtr spectrumStack,
+                             LXStackpPtr peakIndexStack, PeakIndex **peakIndex)
+{
+  char buffer[BUFSIZ];
+
+  int index;
+  
+  char *lastDot;
+
+  // line is : string.int.int
+  (void) strcpy( buffer, tag->id );
+  
+  if (! (lastDot = strrchr( buffer, '.')) ) {
+     fprintf(stderr, "# Wrong value for PST id : %s (not any dot)\n", tag->id);
+     return LX_IO_ERROR;
+  }
+  
+  *lastDot = '\0';  // remove the last dot and integer
+  
+  if (! (lastDot = strrchr( buffer, '.')) ) {
+     fprintf(stderr, "# Wrong value for PST id : %s (no two dots)\n", tag->id);
+     return LX_IO_ERROR;
+  }
+  
+  // increment lastDot to keep only the first integer
+  
+  if (! *(lastDot++) ) {
+     fprintf(stderr, "# Wrong value for PST id : %s (empty spectrum index)\n", tag->id);
+     return LX_IO_ERROR;
+  }
+  
+  if (   (sscanf( lastDot ,"%d", &index ) != 1)
+      || (index <= 0)) {
+     fprintf(stderr, "# Wrong value for PST id : %s (spectrum index is not a number)\n", tag->id);
+     return LX_IO_ERROR;
+  }
+
+  // spectrum count begins at 1: decrease one
+  
+  tag->spectrum = (PMSpectrum *) LXStackpGetValue( spectrumStack, index - 1 );
+  
+  if ( ! tag->spectrum) {
+     fprintf(stderr, "# PST id : %s and spectrum file are incoherent.\n", tag->id);
+     return LX_IO_ERROR;
+  }
+
+  *peakIndex = (PeakIndex *) LXStackpGetValue( peakIndexStack, index - 1 );
+
+  return LX_NO_ERROR;
+}
+
+
+/* ----------------------------------------------- */
+/* read list of filenames (one per line) and push  */
+/* them into stack                                 */
+
+static int sReadFileList(char *filename, LXStackpPtr stack)
+{
+  FILE *listFile;
+  char buffer[BUFSIZ], name[BUFSIZ];
+
+  if (! (listFile = LXOpenFile(filename, "r")))
+    return IO_ERROR();
+
+  while (LXGetLine(buffer, sizeof(buffer), listFile)) {
+    if (sscanf(buffer, "%s", name) == 1)
+      (void) LXPushpIn(stack, LXStr(name));
+  }
+
+  (void) fclose(listFile);
+
+  return LX_NO_ERROR;
+}
+
+/* ----------------------------------------------- */
+/* get next sequence to process, either from fasta */
+/* file, from kuple index or translated on the fly */
+/* from a nucleic fasta file (frameReader) or by  */
+/* windows from fasta file (window)                */
+
+static LXFastaSequence *sNextSequence(FILE *fastaFile, LXFastaSequence *fastaSeq, 
+                                      PMIndex *index, long iseq,
+                                      LXFastaSequence *indexSeq,
+                                      FrameReader *frameReader,
+                                      LXFastaWindow *window)
+{
+  if (index)
+    return (PMIndexGetSequence(index, iseq, indexSeq) == LX_NO_ERROR ? indexSeq : NULL);
+
+  if (frameReader)
+    return FrameNextSequence(frameReader, fastaFile);
+
+  if (window)
+    return (LXFastaReadWindow(fastaFile, window) ? window->seq : NULL);
+
+  return (LXFastaReadSequence(fastaFile, fastaSeq) ? fastaSeq : NULL);
+}
+
+/* ----------------------------------------------- */
+/* scan lengths of fasta file sequences (without   */
+/* holding them) then rewind file. used with       */
+/* windows, since unformated sequences ids hold    */
+/* the whole sequence length.                      */
+/* returns NULL if file cannot be rewound or on    */
+/* memory error                                    */
+/* ----------------------------------------------- */
+
+static Int64 *sScanLengths(FILE *fastaFile, long size)
+{
+  long          nbSeq, maxSeq;
+  Int64         *lengths;
+  LXFastaWindow *window;
+
+  if (! (window = LXFastaNewWindow(size, 0)))
+    return NULL;
+
+  nbSeq   = 0;
+  maxSeq  = 16;
+  lengths = NEWN(Int64, maxSeq);
+
+  while (lengths && LXFastaReadWindow(fastaFile, window)) {
+
+    if (! window->seq->ok)
+      break;
+
+    if (window->first && (nbSeq++ >= maxSeq))
+      lengths = REALLOC(lengths, Int64, (maxSeq *= 2));
+
+    if (lengths)
+      lengths[nbSeq - 1] = window->start + window->seq->length;
+  }
+
+  (void) LXFastaFreeWindow(window);
+
+  if (lengths && (fseek(fastaFile, 0L, SEEK_SET) != 0)) {
+    FREE(lengths);
+    lengths = NULL;
+  }
+
+  return lengths;
+}
+
+/* -------------------------------------------------------------------- */
+/* API                                                                  */
+/* -------------------------------------------------------------------- */
+
+/* ----------------------------------------------- */
+/* run PMMatch with command line arguments         */
+/* hits are handed over to sink (with sinkArg) if  */
+/* sink is not NULL, else they are written         */
+/* ----------------------------------------------- */
+
+int MatchMain(int argc, char *argv[], PMHitSink sink, Ptr sinkArg)
+{
+  extern char *optarg;
+  
+  int i, opt, kuple, nbSeq, nbTags, nbSpectrums, nbInputs, input, code;
+  
+  FILE *fastaFile, *tagFile, *outputFile;
+
+  PMHitFile **outputFiles;
+
+  PMSeqId seqId;
+
+  PMAminoAlphabet alpha;
+
+  PMEnzyme enzyme;
+  
+  Parameter param;
+  
+  HashTable  *hashTable;
+
+  MassTable  *massTable;
+
+  PMCleavageMap *cleavageMap;
+  
+  PMTagStack *tagStack;
+
+  LXStackpPtr inputStack, spectrumFileStack, *spectrumStacks, *peakIndexStacks;
+
+  int *tagInput;
+  
+  LXFastaSequence *fastaSeq, *readSeq, indexSeq;
+  
+  PMIndex *index;
+
+  FrameReader *frameReader;
+
+  LXFastaWindow *window;
+
+  SeqWindow seqWindow;
+
+  Int64 *seqLengths;
+
+  Bool newSeq;
+
+  MatchContext context;
+
+  TagHits    *tagHits;
+  HitArena   **arenas;
+  ThreadPool *pool;
+
+  MatchTiming *timings, *timing;
+
+  double clock, startTime;
+
+  long nbHits, margin;
+
+  char outputFilename[BUFSIZ], 
+       outputSuffix[BUFSIZ],
+       aminoFilename[BUFSIZ],
+       enzymeFilename[BUFSIZ],
+       fastaFilename[BUFSIZ],
+       dnaFilename[BUFSIZ],
+       indexFilename[BUFSIZ],
+       buffer[BUFSIZ];
+  
+  PMSpectrumReader spectrumReader;
+ 
+
+  /* --------------------------------- */
+  /* setup default parameters          */
+  
+  param.maxMisCleavage     = DFT_MAX_MISCLEAVAGE;
+  param.maxOverCleavage    = DFT_MAX_OVERCLEAVAGE;
+  param.maxModif           = DFT_MAX_MODIF;
+  param.massTolerance      = DFT_TOLERANCE;
+  param.metScan            = DFT_MET_SCAN;
+  param.differentiateKQ    = FALSE;
+  param.partialHit         = FALSE;
+  param.verbose            = FALSE;
+  param.hitScoreType       = DFT_HITSCORE;
+  param.nbThreads          = DFT_THREADS;
+  param.outputFormat       = DFT_OUTPUT_FORMAT;
+  param.windowSize         = DFT_WINDOW_SIZE;
+
+  code                     = DFT_GENETIC_CODE;
+  
+  (void) strcpy(aminoFilename,  DFT_AA_FILENAME);
+  (void) strcpy(enzymeFilename, DFT_ENZ_FILENAME);
+  
+  *outputFilename    = '\000';
+  *fastaFilename     = '\000';
+  *dnaFilename       = '\000';
+  *indexFilename     = '\000';
+
+  (void) strcpy(outputSuffix, DFT_BATCH_SUFFIX);
+
+  inputStack        = LXNewStackp(LX_STKP_MIN_SIZE);
+  spectrumFileStack = LXNewStackp(LX_STKP_MIN_SIZE);
+
+  spectrumReader = PMReadPKL1Spectrum;
+  
+  /* --------------------------------- */
+  /* get user's parameters             */
+
+  while ((opt = getopt(argc, argv, "a:c:d:D:e:f:F:g:HhI:i:j:kl:n:m:M:o:O:ps:S:vw:W:y:")) != -1) {
+  
+    switch (opt) {
+      
+      case 'a' :                                  // Amino-acid filename
+        (void) strcpy(aminoFilename, optarg);
+        break;
+  
+      case 'c':                                   // genetic code (with -g)
+        if (   (sscanf(optarg, "%d", &code) != 1)
+            || (code < 0) || (code >= LX_GENETIC_MAX_CODES)) {
+          fprintf(stderr, "# Wrong value for genetic code (0-%d)\n", LX_GENETIC_MAX_CODES - 1);
+          ExitUsage(LX_ARG_ERROR);
+        }
+        break;
+
+      case 'd':                                   // mass tolerance (ppm)
+        if (   (sscanf(optarg, "%f", &param.massTolerance) != 1)
+            || (param.massTolerance <= 0)) {
+          fprintf(stderr, "# Wrong value for mass tolerance\n");
+          ExitUsage(LX_ARG_ERROR);
+        }
+        break;
+
+      case 'D':                                   // mass tolerance (amu)
+        if (   (sscanf(optarg, "%f", &param.massTolerance) != 1)
+            || (param.massTolerance <= 0)) {
+          fprintf(stderr, "# Wrong value for mass tolerance\n");
+          ExitUsage(LX_ARG_ERROR);
+        }
+        param.massTolerance = - param.massTolerance;
+        break;
+
+      case 'e' :                                  // Enzyme filename
+        (void) strcpy(enzymeFilename, optarg);
+        break;
+
+      case 'f' :                                  // Fasta filename
+        (void) strcpy(fastaFilename, optarg);
+        break;
+
+      case 'F':                                   // input spectrum format
+        if ( (sscanf(optarg, "%s", buffer) != 1) ||
+             (! (spectrumReader = PMGetSpectrumReader(buffer))) ) {
+          fprintf(stderr, "# Unknown data format %s\n", buffer);
+          ExitUsage(LX_ARG_ERROR);
+        }
+        break;
+
+      case 'g' :                                  // nucleic Fasta filename
+        (void) strcpy(dnaFilename, optarg);
+        break;
+
+      case 'H' :                                  // help
+      case 'h' :
+        PrintHelp();
+        exit(0);
+        break;
+  
+      case 'I' :                                  // kuple index filename
+        (void) strcpy(indexFilename, optarg);
+        break;
+  
+      case 'i' :                                  // input (tags) filename(s)
+        (void) LXPushpIn(inputStack, LXStr(optarg));
+        break;
+
+      case 'j':                                   // number of threads
+        if (   (sscanf(optarg, "%d", &param.nbThreads) != 1)
+            || (param.nbThreads <= 0)) {
+          fprintf(stderr, "# Wrong value for number of threads\n");
+          ExitUsage(LX_ARG_ERROR);
+        }
+        break;
+
+      case 'k' :                                  // differentiate K/Q
+        param.differentiateKQ = TRUE;
+        break;
+
+      case 'l' :                                  // list of input (tags) filenames
+        if (sReadFileList(optarg, inputStack) != LX_NO_ERROR) {
+          fprintf(stderr,"# Cannot read list of tags files : %s\n", optarg);
+          exit (LX_IO_ERROR); 
+        }
+        break;
+
+      case 'm':                                   // max number of miscleavage
+        if (   (sscanf(optarg, "%d", &param.maxMisCleavage) != 1)
+            || (param.maxMisCleavage < 0)) {
+          fprintf(stderr, "# Wrong value for maximum miscleavage\n");
+          ExitUsage(LX_ARG_ERROR);
+        }
+        break;
+
+      case 'M':                                   // max number of overcleavage
+        if (   (sscanf(optarg, "%d", &param.maxOverCleavage) != 1)
+            || (param.maxOverCleavage < 0)
+            || (param.maxOverCleavage > 2)) {
+          fprintf(stderr, "# Wrong value for maximum overcleavage\n");
+          ExitUsage(LX_ARG_ERROR);
+        }
+        break;
+
+      case 'n':                                   // max number of modifications
+        if (   (sscanf(optarg, "%d", &param.maxModif) != 1)
+            || (param.maxModif < 0)
+            || (param.maxModif > MAX_MODIF)) {
+          fprintf(stderr, "# Wrong value for maximum number of modifications (0-%d)\n", MAX_MODIF);
+          ExitUsage(LX_ARG_ERROR);
+        }
+        break;
+
+      case 'o' :                                  // output (hits) filename
+        if (sink) {
+          fprintf(stderr, "# -o option cannot be used in pipeline mode\n");
+          ExitUsage(LX_ARG_ERROR);
+        }
+        (void) strcpy(outputFilename, optarg);
+        if (! LXAssignToStdout(outputFilename)) {
+          fprintf(stderr,"# Cannot create : %s\n", outputFilename);
+          exit (LX_IO_ERROR);
+        }
+        break;
+
+      case 'O' :                                  // output suffix (batch mode)
+        if (sink) {
+          fprintf(stderr, "# -O option cannot be used in pipeline mode\n");
+          ExitUsage(LX_ARG_ERROR);
+        }
+        (void) strcpy(outputSuffix, optarg);
+        break;
+
+      case 'w' :                                  // output format
+        if (sink) {
+          fprintf(stderr, "# -w option cannot be used in pipeline mode\n");
+          ExitUsage(LX_ARG_ERROR);
+        }
+        if (PMHitFileFormatFromName(optarg, &param.outputFormat) != LX_NO_ERROR) {
+          fprintf(stderr, "# Wrong output format %s\n", optarg);
+          ExitUsage(LX_ARG_ERROR);
+        }
+        break;
+
+      case 'W':                                   // window size
+        if (   (sscanf(optarg, "%ld", &param.windowSize) != 1)
+            || (param.windowSize < 0)) {
+          fprintf(stderr, "# Wrong value for window size\n");
+          ExitUsage(LX_ARG_ERROR);
+        }
+        break;
+
+      case 'p' :                                  // report partial hits
+        param.partialHit = TRUE;
+        break;
+
+      case 'v' :                                  // verbose mode
+        param.verbose = TRUE;
+        break;
+
+      case 'y':                                   // met scan
+        if (   (sscanf(optarg, "%d", &param.metScan) != 1)
+            || (param.metScan < 0)) {
+          fprintf(stderr, "# Wrong value for methionine scan\n");
+          ExitUsage(LX_ARG_ERROR);
+        }
+        break;
+  
+      case 'S':
+        if (   (sscanf(optarg,"%s", buffer) != 1)
+            || (! (param.hitScoreType = sGetHitScoreType(buffer)))) {
+          fprintf(stderr, "# Wrong value for hit score\n");
+          ExitUsage(LX_ARG_ERROR);
+        }
+        break;
+	
+      case 's' :                                  // input (spectrum) filename(s)
+        (void) LXPushpIn(spectrumFileStack, LXStr(optarg));
+        break;
+	
+      case '?' :                                  // oops !
+        ExitUsage(LX_ARG_ERROR);
+        break;      
+    }
+  }
+
+  /* --------------------------------- */
+  /* check parameters                  */
+
+  if ((! *fastaFilename) && (! *indexFilename) && (! *dnaFilename)) {
+    fprintf(stderr, "# You should provide a translated chromosome (fasta) filename ");
+    fprintf(stderr, " by using -f option (or a kuple index by using -I option");
+    fprintf(stderr, " or a chromosome by using -g option)\n");
+    ExitUsage(LX_ARG_ERROR);
+  }
+
+  if ((*fastaFilename != 0) + (*indexFilename != 0) + (*dnaFilename != 0) > 1) {
+    fprintf(stderr, "# -f, -g and -I options are mutually exclusive\n");
+    ExitUsage(LX_ARG_ERROR);
+  }
+
+  if ((param.windowSize > 0) && (! *fastaFilename)) {
+    fprintf(stderr, "# -W option only applies to -f option\n");
+    ExitUsage(LX_ARG_ERROR);
+  }
+
+  fastaFile   = NULL;
+  index       = NULL;
+  frameReader = NULL;
+
+  if (*fastaFilename && (! (fastaFile = LXOpenFile(fastaFilename, "r")))) {
+    fprintf(stderr, "# Cannot access fasta file : %s\n", fastaFilename);
+    ExitUsage(LX_ARG_ERROR);
+  }
+
+  if (*dnaFilename && (! (fastaFile = LXOpenFile(dnaFilename, "r")))) {
+    fprintf(stderr, "# Cannot access fasta file : %s\n", dnaFilename);
+    ExitUsage(LX_ARG_ERROR);
+  }
+
+  if (*dnaFilename && (! (frameReader = FrameNewReader(code)))) {
+    fprintf(stderr, "# Not enough memory for chromosome translation\n");
+    exit(LX_MEM_ERROR);
+  }
+
+  if (*indexFilename && (! (index = PMIndexOpen(indexFilename)))) {
+    fprintf(stderr, "# Cannot open kuple index : %s\n", indexFilename);
+    ExitUsage(LX_ARG_ERROR);
+  }
+
+  if (LXAccess(aminoFilename, "r") != LX_NO_ERROR) {
+    fprintf(stderr,"# Cannot access to aminoacid alphabet file : %s\n", aminoFilename);
+    exit(LX_IO_ERROR);
+  }
+
+  if (LXAccess(enzymeFilename, "r") != LX_NO_ERROR) {
+    fprintf(stderr,"# Cannot access to digestion enzyme file : %s\n", enzymeFilename);
+    exit(LX_IO_ERROR);
+  }
+
+  nbInputs = LXStackpSize(inputStack);
+
+  if ((nbInputs > 1) && *outputFilename) {
+    fprintf(stderr, "# -o option cannot be used with several tags files\n");
+    fprintf(stderr, "# (hits are written into <tagsFile>%s, see -O option)\n", outputSuffix);
+    ExitUsage(LX_ARG_ERROR);
+  }
+
+  if ((param.hitScoreType != PSTHitScoreType) && (LXStackpSize(spectrumFileStack) == 0)) {
+    fprintf(stderr, "# This score type requires a spectra data file\n");
+    fprintf(stderr, "# please provide a spectra file by using -s option\n");
+    ExitUsage(LX_ARG_ERROR);
+  }
+
+  if (   (param.hitScoreType != PSTHitScoreType) 
+      && (LXStackpSize(spectrumFileStack) != MAX(1, nbInputs))) {
+    fprintf(stderr, "# This score type requires one spectra data file per tags file\n");
+    fprintf(stderr, "# please provide as many -s as -i options\n");
+    ExitUsage(LX_ARG_ERROR);
+  }
+
+  assert(param.hitScoreType != UnknownHitScoreType);
+
+  /* --------------------------------- */
+  /* adjust arguments units            */
+  
+  if (param.massTolerance > 0)
+    param.massTolerance = param.massTolerance * 1e-6;
+  
+  /* --------------------------------- */
+  /* load aminoacid alphabet           */
+
+  if (PMLoadAminoAlphabet(aminoFilename, &alpha) != LX_NO_ERROR) {
+    fprintf(stderr,"# Cannot load alphabet from %s\n", aminoFilename);
+    exit(LX_IO_ERROR);
+  }
+
+  /* --------------------------------- */
+  /* load enzyme                       */
+
+  if (PMLoadEnzyme(enzymeFilename, &enzyme) != LX_NO_ERROR) {
+    fprintf(stderr,"# Cannot load digestion enzyme from %s\n", enzymeFilename);
+    exit(LX_IO_ERROR);
+  }
+
+  /* --------------------------------- */
+  /* start processing                  */
+  /* --------------------------------- */
+
+  StartupBanner(argc, argv);
+
+  if (param.verbose) {
+    fprintf(stderr, "# amino acid alphabet loaded from : %s\n", aminoFilename);
+    fprintf(stderr, "# digestion enzyme loaded from : %s\n", enzymeFilename);
+  }
+
+  (void) LXStrCpuTime(TRUE);
+
+  /* --------------------------------- */
+  /* setup timing (verbose mode only)  */
+  /* timings[i] : thread #i (main      */
+  /* thread uses timings[0])           */
+
+  if (! (timings = NEWN(MatchTiming, MAX(1, param.nbThreads)))) {
+    fprintf(stderr,"# Not enough memory for %d threads\n", param.nbThreads);
+    exit(LX_MEM_ERROR);
+  }
+
+  (void) memset(timings, 0, MAX(1, param.nbThreads) * sizeof(MatchTiming));
+
+  timing = (param.verbose ? timings : NULL);
+
+  startTime = LXCurrentTime();
+
+  clock = UtilClock(timing);
+  
+  /* --------------------------------- */
+  /* load tags                         */
+  /* skip mark, read everything        */
+  /* in batch mode, tags from all      */
+  /* files are put into the same stack */
+  /* and tagInput keeps track of their */
+  /* origin                            */
+  
+  tagStack = LXNewStackp(LX_STKP_MIN_SIZE);
+
+  tagInput = NULL;
+  
+  for (input = 0 ; input < MAX(1, nbInputs) ; input++) {
+
+    char *inputFilename = (nbInputs ? (char *) LXStackpGetValue(inputStack, input) : NULL);
+
+    long itag, first = LXStackpSize(tagStack);
+
+    if (! (tagFile = (inputFilename ? LXOpenFile(inputFilename, "r") : stdin))) {
+      fprintf(stderr,"# Cannot open : %s\n", inputFilename);
+      exit (LX_IO_ERROR); 
+    }
+
+    if (PMReadTagStack(tagFile, tagStack, TRUE)) {
+      fprintf(stderr,"Cannot read tags\n");
+      exit(LX_IO_ERROR);
+    }
+
+    if (tagFile != stdin)
+      (void) fclose(tagFile);
+
+    nbTags = LXStackpSize(tagStack);
+
+    if (! (tagInput = (tagInput ? REALLOC(tagInput, int, MAX(1, nbTags)) 
+                                : NEWN(int, MAX(1, nbTags))))) {
+      fprintf(stderr,"# Not enough memory for %d tags\n", nbTags);
+      exit(LX_MEM_ERROR);
+    }
+
+    for (itag = first ; itag < nbTags ; itag++)
+      tagInput[itag] = input;
+
+    if (param.verbose) {
+      fprintf(stderr, "# %ld tags loaded from : %s\n", nbTags - first,
+                      (inputFilename ? inputFilename : "<stdin>"));
+    }
+  }
+
+  /* --------------------------------- */
+  /* open output files                 */
+  /* one per tags file in batch mode   */
+  /* (or a single sink for all tags    */
+  /* files in pipeline mode)           */
+
+  if (! (outputFiles = NEWN(PMHitFile *, MAX(1, nbInputs)))) {
+    fprintf(stderr,"# Not enough memory for %d output files\n", nbInputs);
+    exit(LX_MEM_ERROR);
+  }
+
+  for (input = 0 ; input < MAX(1, nbInputs) ; input++) {
+
+    if (sink) {
+      if (! (outputFiles[input] = (input ? outputFiles[0] : PMHitFileOpenSink(sink, sinkArg)))) {
+        fprintf(stderr,"# Not enough memory for hits\n");
+        exit(LX_MEM_ERROR);
+      }
+      continue;
+    }
+
+    outputFile = stdout;
+
+    if (nbInputs > 1) {
+      (void) sprintf(buffer, "%s%s", (char *) LXStackpGetValue(inputStack, input), outputSuffix);
+      if (! (outputFile = LXOpenFile(buffer, "w"))) {
+        fprintf(stderr,"# Cannot create : %s\n", buffer);
+        exit (LX_IO_ERROR);
+      }
+    }
+
+    if (! (outputFiles[input] = PMHitFileOpenWrite(outputFile, param.outputFormat))) {
+      fprintf(stderr,"# Cannot write hits\n");
+      exit (LX_IO_ERROR);
+    }
+
+    if ((nbInputs > 1) && param.verbose) {
+      fprintf(stderr, "# hits of %s written into : %s\n", 
+                      (char *) LXStackpGetValue(inputStack, input), buffer);
+    }
+  }
+
+  /* --------------------------------- */
+  /* load spectra                      */
+  /* one spectra file per tags file    */
+  /* and index their peaks             */
+  
+  spectrumStacks  = NULL;
+  peakIndexStacks = NULL;
+
+  if ( param.hitScoreType != PSTHitScoreType ) {
+
+    if (   (! (spectrumStacks  = NEWN(LXStackpPtr, MAX(1, nbInputs))))
+        || (! (peakIndexStacks = NEWN(LXStackpPtr, MAX(1, nbInputs))))) {
+      fprintf(stderr,"# Not enough memory for %d spectra files\n", nbInputs);
+      exit(LX_MEM_ERROR);
+    }
+  
+    for (input = 0 ; input < MAX(1, nbInputs) ; input++) {
+
+      char *spectrumFilename = (char *) LXStackpGetValue(spectrumFileStack, input);
+
+      if ( sReadSpectrumFile( spectrumFilename, spectrumStacks + input, spectrumReader ) != LX_NO_ERROR ) {
+        fprintf(stderr,"Cannot read spectra\n");
+        exit(LX_IO_ERROR);
+      }
+      nbSpectrums = LXStackpSize( spectrumStacks[input] );
+
+      if (! (peakIndexStacks[input] = LXNewStackp(MAX(nbSpectrums, LX_STKP_MIN_SIZE)))) {
+        fprintf(stderr,"# Not enough memory for %d spectra\n", nbSpectrums);
+        exit(LX_MEM_ERROR);
+      }
+
+      for (i = 0 ; i < nbSpectrums ; i++) {
+        PeakIndex *peakIndex;
+        if (! (peakIndex = PeakNewIndex((PMSpectrum *) LXStackpGetValue(spectrumStacks[input], i)))) {
+          fprintf(stderr,"# Not enough memory for %d spectra\n", nbSpectrums);
+          exit(LX_MEM_ERROR);
+        }
+        (void) LXPushpIn(peakIndexStacks[input], peakIndex);
+      }
+
+      if (param.verbose) {
+        fprintf(stderr, "# %d spectra loaded from : %s\n", 
+                        nbSpectrums, spectrumFilename );
+      }
+    }
+  }
+
+  
+  UtilLapTime(timing, LoadPhase, &clock);
+
+  /* --------------------------------- */
+  /* init hashTable                    */
+
+  if (! (kuple = UtilCheckTags(tagStack))) {
+    fprintf(stderr, "# Tags should all have the same length\n");
+    exit(LX_ARG_ERROR);
+  }
+
+  hashTable = HashNewTable(kuple);
+  
+  HashInitTable(hashTable, tagStack, param.differentiateKQ);
+
+  /* --------------------------------- */
+  /* check kuple index                 */
+
+  if (index) {
+
+    if (   (index->header->kuple != kuple)
+        || (index->header->differentiateKQ != param.differentiateKQ)) {
+      fprintf(stderr, "# Kuple index %s does not match tags\n", indexFilename);
+      fprintf(stderr, "# (index built with kuple=%d%s, tags kuple=%d%s)\n",
+                      index->header->kuple, 
+                      (index->header->differentiateKQ ? " -k" : ""),
+                      kuple, (param.differentiateKQ ? " -k" : ""));
+      exit(LX_ARG_ERROR);
+    }
+
+    if (HashBindIndex(hashTable, index) != LX_NO_ERROR) {
+      fprintf(stderr,"# Not enough memory to bind kuple index\n");
+      exit(LX_MEM_ERROR);
+    }
+
+    if (param.verbose) {
+      fprintf(stderr, "# %ld sequences mapped from kuple index : %s\n", 
+                      (long) PMIndexNbSeq(index), indexFilename);
+    }
+  }
+
+  UtilLapTime(timing, HashFillPhase, &clock);
+
+  /* --------------------------------- */
+  /* init matching context             */
+
+  if (! (massTable = MassNewTable())) {
+    fprintf(stderr,"# Not enough memory for mass table\n");
+    exit(LX_MEM_ERROR);
+  }
+
+  if (! (cleavageMap = PMNewCleavageMap())) {
+    fprintf(stderr,"# Not enough memory for cleavage map\n");
+    exit(LX_MEM_ERROR);
+  }
+
+  context.tagStack    = tagStack;
+  context.hashTable   = hashTable;
+  context.massTable   = massTable;
+  context.cleavageMap = cleavageMap;
+  context.alpha       = &alpha;
+  context.enzyme      = &enzyme;
+  context.param       = &param;
+  context.peakIndex   = NULL;
+
+  if (! (context.scoreModel = ScoreNewModel(&param))) {
+    fprintf(stderr,"# Not enough memory for scoring model\n");
+    exit(LX_MEM_ERROR);
+  }
+
+  /* --------------------------------- */
+  /* retrieve the spectrum (and its    */
+  /* peaks index) associated with      */
+  /* each PST, once for all sequences  */
+
+  if (param.hitScoreType != PSTHitScoreType) {
+
+    if (! (context.peakIndex = NEWN(PeakIndex *, MAX(1, nbTags)))) {
+      fprintf(stderr,"# Not enough memory for %d tags\n", nbTags);
+      exit(LX_MEM_ERROR);
+    }
+
+    for (i = 0 ; i < nbTags ; i++) {
+      PMTag *tag = (PMTag *) LXStackpGetValue(tagStack, i);
+      if (sRetrieveSpectrum(tag, spectrumStacks[tagInput[i]], peakIndexStacks[tagInput[i]],
+                            context.peakIndex + i) != LX_NO_ERROR) {
+        fprintf(stderr,"Cannot retrieve spectrum. The spectrum file may not correspond.\n");
+        exit(LX_IO_ERROR);
+      }
+    }
+  }
+
+  if (! (tagHits = NEWN(TagHits, MAX(1, nbTags)))) {
+    fprintf(stderr,"# Not enough memory for %d tags\n", nbTags);
+    exit(LX_MEM_ERROR);
+  }
+
+  if (! (arenas = NEWN(HitArena *, MAX(1, param.nbThreads)))) {
+    fprintf(stderr,"# Not enough memory for %d threads\n", param.nbThreads);
+    exit(LX_MEM_ERROR);
+  }
+
+  for (i = 0 ; i < MAX(1, param.nbThreads) ; i++) {
+    if (! (arenas[i] = ArenaNew())) {
+      fprintf(stderr,"# Not enough memory for hits\n");
+      exit(LX_MEM_ERROR);
+    }
+  }
+
+  /* --------------------------------- */
+  /* start threads pool, once for all  */
+  /* sequences                         */
+
+  if (! (pool = ThreadNewPool(&context, arenas, timing, tagHits))) {
+    fprintf(stderr,"# Not enough memory for %d threads\n", param.nbThreads);
+    exit(LX_MEM_ERROR);
+  }
+
+  if (param.verbose) {
+    fprintf(stderr, "# using %d thread(s)\n", param.nbThreads);
+  }
+
+  /* --------------------------------- */
+  /* loop on chromosome                */
+  /* translation frames                */
+  
+  nbSeq  = 0;
+  nbHits = 0;
+  
+  readSeq = LXFastaNewSequence(BUFSIZ);
+
+  /* --------------------------------- */
+  /* fasta sequences are read by       */
+  /* overlapping windows : a hit found */
+  /* in window core (i.e. farther than */
+  /* margin from window ends) is the   */
+  /* same as in the whole sequence     */
+
+  window     = NULL;
+  seqLengths = NULL;
+  margin     = 0;
+
+  if (index)
+    margin = MassMaxFlank(tagStack, &alpha, &param) + 1;
+
+  if (*fastaFilename && (param.windowSize > 0)) {
+
+    margin = MassMaxFlank(tagStack, &alpha, &param) 
+           + kuple + param.metScan + 2;
+
+    if (! (window = LXFastaNewWindow(MAX(param.windowSize, 4 * margin), 2 * margin))) {
+      fprintf(stderr,"# Not enough memory for sequence window\n");
+      exit(LX_MEM_ERROR);
+    }
+
+    if (! (seqLengths = sScanLengths(fastaFile, window->size))) {
+      fprintf(stderr,"# Cannot scan sequences lengths of fasta file : %s\n", fastaFilename);
+      fprintf(stderr,"# (-W needs a regular file, use -W 0 to read a stream)\n");
+      exit(LX_IO_ERROR);
+    }
+
+    if (param.verbose)
+      fprintf(stderr, "# reading sequences by windows of %ld aa (overlap %ld)\n",
+                      window->size, window->overlap);
+  }
+
+  clock = UtilClock(timing);
+  
+  while ((fastaSeq = sNextSequence(fastaFile, readSeq, index, nbSeq, &indexSeq,
+                                     frameReader, window))) {
+  
+    newSeq = ((! window) || window->first);
+
+    if (newSeq)
+      nbSeq++;
+    
+    if (! (fastaSeq->ok)) {
+      fprintf(stderr,"# Error reading sequence #%d\n", nbSeq);
+      exit(LX_MEM_ERROR);
+    }
+
+    /* ------------------------------------ */ 
+    /* check if sequence looks like protein */
+    /* because its a common mistake to run  */
+    /* PMMatch directly on DNA sequence     */
+    /* (just check on first sequence)       */
+    
+    if (   (nbSeq == 1) && newSeq && (! index) 
+        && (LXBioSeqType(fastaSeq->seq) == LX_BIO_SEQ_DNA)) {
+        fprintf(stderr,"# WARNING : the sequences look like DNA\n");
+        fprintf(stderr,"#           PMMatch works with proteic sequence(s)\n");
+        fprintf(stderr,"#           Please use PMTrans before (or use -g)\n");
+    }
+
+    if (param.verbose && newSeq) 
+      fprintf(stderr, "# processing sequence: %d %s %s (%ld aa)\n", 
+                      nbSeq, fastaSeq->name, fastaSeq->comment, fastaSeq->length);
+
+    if (window) {
+      seqWindow.offset   = window->start;
+      seqWindow.coreFrom = (window->first ? 0 : margin);
+      seqWindow.coreTo   = (window->last  ? fastaSeq->length : fastaSeq->length - margin);
+      if (param.verbose && ! (window->first && window->last))
+        fprintf(stderr, "# processing window: %ld-%ld\n", 
+                        window->start, window->start + fastaSeq->length);
+    }
+
+    /* ----------------------------- */
+    /* fill hash table with kuples   */
+    /* from sequence                 */
+    /* (index sequences are already  */
+    /* validated and read only and   */
+    /* translated frames only hold   */
+    /* valid symbols)                */
+
+    UtilLapTime(timing, ReadPhase, &clock);
+
+    if (index) {
+      HashFillTableFromIndex(hashTable, index, nbSeq - 1);
+    }
+    else {
+      if (! frameReader)
+        (void) UtilValidateSequence(fastaSeq->seq);
+      HashFillTable(hashTable, fastaSeq->seq, kuple, param.differentiateKQ);
+    }
+
+    UtilLapTime(timing, LookupPhase, &clock);
+
+    /* ----------------------------- */
+    /* cumulate residues masses and  */
+    /* locate enzyme cut sites       */
+    /* with a kuple index, if hits   */
+    /* are sparse, only cut sites    */
+    /* around hits are located and   */
+    /* masses are summed when flanks */
+    /* are walked (so that sequence  */
+    /* is only read around hits)     */
+
+    if (   index 
+        && (HashNbOccurrences(hashTable) * (2 * margin + kuple) < fastaSeq->length)) {
+      context.massTable = NULL;
+      if (HashFillCleavageMap(hashTable, cleavageMap, &enzyme, fastaSeq, margin) != LX_NO_ERROR) {
+        fprintf(stderr,"# Not enough memory for sequence #%d cut sites\n", nbSeq);
+        exit(LX_MEM_ERROR);
+      }
+    }
+    else {
+      context.massTable = massTable;
+      if (   (MassFillTable(massTable, fastaSeq, &alpha) != LX_NO_ERROR)
+          || (PMFillCleavageMap(cleavageMap, &enzyme, fastaSeq->seq, fastaSeq->length) != LX_NO_ERROR)) {
+        fprintf(stderr,"# Not enough memory for sequence #%d masses\n", nbSeq);
+        exit(LX_MEM_ERROR);
+      }
+    }
+
+    context.fastaSeq = fastaSeq;
+
+    int itag;
+
+    UtilLapTime(timing, ReadPhase, &clock);
+
+    /* ----------------------------- */
+    /* process tags (by groups of    */
+    /* tags sharing the same kuple)  */
+    /* to :                          */
+    /*  - retrieve hits              */
+    /*  - extend hits left and right */
+    /*  - score hits                 */
+    /* (in parallel in multithreaded */
+    /* mode) then print hits in tag  */
+    /* order                         */
+
+    if (ThreadProcessTags(pool) != LX_NO_ERROR) {
+      fprintf(stderr,"# Not enough memory to process tags\n");
+      exit(LX_MEM_ERROR);
+    }
+
+    clock = UtilClock(timing);  // threads timed themselves
+
+    // [AV] SafeId is for use with unformated proteic sequences
+    
+    // with windows, unformated sequences length is the scanned one
+    
+    if (PMFasta2SeqId(fastaSeq, &seqId) != LX_NO_ERROR) {
+      (void) PMFasta2SeqIdSafe(fastaSeq, &seqId);
+      if (window)
+        seqId.length = seqLengths[nbSeq - 1];
+    }
+
+    for (itag = 0 ; itag < nbTags ; itag++) {
+    
+      PMTag *tag = (PMTag *) LXStackpGetValue(tagStack, itag);
+      
+      // print hits
+      if (UtilPrintHits(outputFiles[tagInput[itag]], nbSeq, &seqId, itag, tag,
+                        tagHits + itag, fastaSeq, &alpha,
+                        (window ? &seqWindow : NULL)) != LX_NO_ERROR) {
+        fprintf(stderr,"# Cannot write hits\n");
+        exit(LX_IO_ERROR);
+      }
+
+      nbHits += UtilCountHits(tagHits + itag, (window ? &seqWindow : NULL));
+    } 
+
+    UtilLapTime(timing, OutputPhase, &clock);
+
+    /* ----------------------------- */
+    /* remove kuples from hashtable  */
+    /* for next sequence             */
+    
+    HashFlattenTable(hashTable);
+
+    UtilLapTime(timing, LookupPhase, &clock);
+  }
+  /* --------------------------------- */
+  /* done: free memory                 */
+  
+  if (fastaFile)
+    (void) fclose(fastaFile);
+
+  if (index)
+    (void) PMIndexClose(index);
+
+  (void) FrameFreeReader(frameReader);
+
+  (void) LXFastaFreeWindow(window);
+
+  IFFREE(seqLengths);
+  
+  (void) fprintf(stderr, "# number of sequence read : %d\n", nbSeq);
+
+  if (param.verbose)
+    UtilPrintTiming(stderr, timings, MAX(1, param.nbThreads),
+                    nbTags, nbSeq, nbHits, LXCurrentTime() - startTime);
+
+  FREE(timings);
+
+  (void) HashFreeTable(hashTable);
+
+  (void) MassFreeTable(massTable);
+
+  (void) PMFreeCleavageMap(cleavageMap);
+
+  (void) ScoreFreeModel(context.scoreModel);
+
+  (void) LXFastaFreeSequence(readSeq);
+  
+  (void) PMFreeTagStack(tagStack);
+
+  (void) ThreadFreePool(pool);
+
+  FREE(tagHits);
+
+  for (i = 0 ; i < MAX(1, param.nbThreads) ; i++)
+    (void) ArenaFree(arenas[i]);
+
+  FREE(arenas);
+
+  for (input = 0 ; input < (sink ? 1 : MAX(1, nbInputs)) ; input++)
+    (void) PMHitFileClose(outputFiles[input]);
+
+  FREE(outputFiles);
+
+  FREE(tagInput);
+
+  if (peakIndexStacks) {
+    for (input = 0 ; input < MAX(1, nbInputs) ; input++)
+      (void) LXFreeStackp(peakIndexStacks[input], (LXStackDestroy) PeakFreeIndex);
+    FREE(peakIndexStacks);
+    FREE(context.peakIndex);
+  }
+
+  (void) LXFreeStackp(inputStack, (LXStackDestroy) LXFree);
+  (void) LXFreeStackp(spectrumFileStack, (LXStackDestroy) LXFree);
+
+  fprintf(stderr,"# %s\n", LXStrCpuTime(FALSE));
+
+  return LX_NO_ERROR;
+}
+
+
+
+
+
+
+
+
+
+
+
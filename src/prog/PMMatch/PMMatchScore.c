@@ -7,6 +7,9 @@
  * @note: most score functions are still being debugged... not fully tested yet
  * @history:
  * @+ <Gloup> : Aug 06 : first (trivial) version
+ * @+ <Gloup> : Oct 26 : fragments walk on spectrum peaks index
+ * @+ <Gloup> : Oct 26 : scoring model built once per run
+ * @+ <Gloup> : Oct 26 : REMT score (batch per tag)
  * -----------------------------------------------------------------------
  * @docstart: 
  *
@@ -28,68 +31,148 @@
 #include "PMMatch.h"
 #include "PMFrag.h"
 
+/* fragments above this index share the same model */
+
+#define MAX_MODEL_INDEX 64
+
+/* REMT log factorials are tabulated up to this   */
+/* number of fragments                             */
+
+#define MAX_MODEL_FRAGS 256
+
 /* ----------------------------------------------- */
-/* clean up peptide sequence					   */
+/* match peptide of a hit                          */
+/* i.e. hit residues from sequence (possibly       */
+/* modified) with tag residues in the middle.      */
+/* peptides are never built as strings : residues  */
+/* are read directly from sequence, tag and mods   */
 /* ----------------------------------------------- */
 
-static char *sNewCleanSequence(char *seq) {
-  char *pepSeq;
+typedef struct {
+  PMHit           *hit;
+  HitMod          *mods;
+  char            *seq;
+  PMAminoAlphabet *alpha;
+  long            from;       /* sequence position of 1st residue */
+  long            length;     /* peptide length                   */
+  long            tagFrom;    /* tag offset in peptide            */
+  long            tagLength;  /* tag length                       */
+} Peptide;
 
-  // copy sequence and remove '[' and ']'
+/* ----------------------------------------------- */
+/* fragment visitor (see sWalkFragments)           */
+/* ----------------------------------------------- */
 
-  pepSeq = LXStr(seq);
-  
-  (void) LXEraseChar(pepSeq, '[');
-  (void) LXEraseChar(pepSeq, ']');
-  
-  return pepSeq;
+typedef void (*FragmentVisitor) (FragmentType type, int index, 
+                                 PMPeak *peak, void *data);
+
+/* ----------------------------------------------- */
+/* setup peptide of hit #ihit                      */
+/* ----------------------------------------------- */
+
+static void sSetPeptide(Peptide *pep, HitArena *arena, long ihit,
+                        LXFastaSequence *fastaSeq, PMAminoAlphabet *alpha)
+{
+  PMHit *hit = arena->hits + ihit;
+  long  to;
+
+  pep->hit   = hit;
+  pep->mods  = arena->mods + arena->modFrom[ihit];
+  pep->seq   = fastaSeq->seq;
+  pep->alpha = alpha;
+
+  pep->from  = (hit->posMn >= 0 ? hit->posMn : hit->posSn);
+  to         = (hit->posMc >= 0 ? hit->posMc : hit->posSc);
+
+  pep->length    = to - pep->from + 1;
+  pep->tagFrom   = hit->posSn - pep->from;
+  pep->tagLength = hit->posSc - hit->posSn + 1;
 }
 
 /* ----------------------------------------------- */
-/* fragment the given sequence and assign peaks    */
+/* mass of residue #i of peptide (-1 if invalid)   */
 /* ----------------------------------------------- */
 
-static LXStackpPtr sFragmentAndAssign(char *sequence, PMSpectrum *spectrum,
-                                      PMAminoAlphabet *alpha, Parameter *param)
+static float sResidueMass(Peptide *pep, long i)
 {
-  LXStackpPtr fragments;
+  int         imod;
+  PMSymbol    code;
+  PMAminoAcid *amino;
 
-  char *pepSeq = sNewCleanSequence(sequence);
-  
-  if (! (fragments = PMGenerateFragments(pepSeq, alpha))) {
-    fprintf(stderr, "# An error occured during fragments generation of sequence %s\n", pepSeq);
-    free(pepSeq);
-    return NULL;
+  if ((i >= pep->tagFrom) && (i < pep->tagFrom + pep->tagLength)) {
+    code = (PMSymbol) pep->hit->tag->seq[i - pep->tagFrom];
+  }
+  else {
+    code = (PMSymbol) pep->seq[pep->from + i];
+    for (imod = 0 ; imod < pep->hit->nbMod ; imod++) {
+      if (pep->mods[imod].pos == pep->from + i)
+        code = pep->mods[imod].code;
+    }
   }
 
-  LXSortStackp(fragments, PMCompareFragmentMasses);
+  amino = PMGetAminoAcid(pep->alpha, code);
 
-  (void) PMAssignPeaks(spectrum, fragments, param );
-  
-  free(pepSeq);
-
-  return fragments;
+  return (amino ? amino->mass : -1.);
 }
 
-/* ----------------------------------------------- *
- * compute the number of assigned fragments        *
- * ----------------------------------------------- */
+/* ----------------------------------------------- */
+/* walk b and y fragments of peptide, assign them  */
+/* to spectrum peaks (using peakIndex) and call    */
+/* visit on each of them.                          */
+/* fragments are b1..b(n-1) and y1..y(n-1) (as     */
+/* [M+H]+ ions), fragments with an invalid residue */
+/* are skipped.                                    */
+/* return number of fragments                      */
+/* ----------------------------------------------- */
 
-// [AV] this function is unused 
-// but useful for debug
-//
-static long sGetNbAssigned( LXStackpPtr fragments )
+static long sWalkFragments(Peptide *pep, PeakIndex *peakIndex, 
+                           Parameter *param, 
+                           FragmentVisitor visit, void *data)
 {
-  PMFragmentPtr fragment;
+  long   i, k, nbFrags, firstBad, lastBad;
+  float  mass;
+  double cumul;
 
-  long nbAssigned = 0;
+  /* ---------------------------------- */
+  /* locate invalid residues            */
 
-  LXCurspToBottom( fragments );
+  firstBad = pep->length;
+  lastBad  = -1;
 
-  while ( LXReadpUp( fragments, (Ptr *)&fragment ) ) 
-    if ( fragment->peak ) nbAssigned++;
-  
-  return nbAssigned;
+  for (i = 0 ; i < pep->length ; i++) {
+    if (sResidueMass(pep, i) < 0) {
+      firstBad = MIN(firstBad, i);
+      lastBad  = i;
+    }
+  }
+
+  nbFrags = 0;
+
+  /* ---------------------------------- */
+  /* b ions : prefixes                  */
+
+  cumul = 0.;
+
+  for (k = 1 ; (k < pep->length) && (k <= firstBad) ; k++) {
+    cumul += sResidueMass(pep, k - 1);
+    mass = (float) (cumul + PM_MASS_H);
+    visit(B_Fragment, (int) k, PeakLookup(peakIndex, mass, param->massTolerance), data);
+    nbFrags++;
+  }
+
+  /* ---------------------------------- */
+  /* y ions : suffixes                  */
+
+  cumul = 0.;
+
+  for (k = 1 ; (k < pep->length) && (pep->length - k > lastBad) ; k++) {
+    cumul += sResidueMass(pep, pep->length - k);
+    mass = (float) (cumul + PM_MASS_H2O + PM_MASS_H);
+    visit(Y_Fragment, (int) k, PeakLookup(peakIndex, mass, param->massTolerance), data);
+    nbFrags++;
+  }
+
+  return nbFrags;
 }
 
 /* ----------------------------------------------- */
@@ -103,66 +186,173 @@ static float sComputePSTHitScore( PMHit *hit )
 }
 
 /* ----------------------------------------------- */
-/* score one hit associated to a pst using REMT    */
+/* REMT fragment visitor : count matched fragments */
+/* ----------------------------------------------- */
+
+typedef struct {
+  int nbMatch;
+} REMTData;
+
+static void sVisitREMT(FragmentType type, int index, PMPeak *peak, void *data)
+{
+  REMTData *rd = (REMTData *) data;
+
+  if (peak)
+    rd->nbMatch++;
+}
+
+/* ----------------------------------------------- */
+/* probability for a theoretical fragment to match */
+/* a spectrum peak at random, i.e. fraction of the */
+/* spectrum mass range covered by the tolerance    */
+/* windows of its peaks                            */
+/* ----------------------------------------------- */
+
+static double sREMTRandomProba(PeakIndex *peakIndex, Parameter *param)
+{
+  double range, window, proba;
+
+  if (peakIndex->nbPeaks == 0)
+    return 0.;
+
+  range = peakIndex->spectrum->parent.mass;
+
+  if (range <= 0.)
+    range = peakIndex->mass[peakIndex->nbPeaks - 1];
+
+  if (range <= 0.)
+    return 1.;
+
+  window = (param->massTolerance >= 0 ? param->massTolerance * range / 2.
+                                      : - param->massTolerance);
+
+  proba = peakIndex->nbPeaks * 2. * window / range;
+
+  return MIN(proba, 1.);
+}
+
+/* ----------------------------------------------- */
+/* ln probability to match k fragments out of n at */
+/* random, lp = ln(p), lq = ln(1-p)                */
+/* ----------------------------------------------- */
+
+static double sREMTLogPMF(ScoreModel *model, int n, int k, 
+                          double p, double lp, double lq)
+{
+  if (n > model->maxFrags)
+    return LXLogBinomialPMF(n, k, p);
+
+  return   model->logFact[n] - model->logFact[k] - model->logFact[n - k]
+         + k * lp + (n - k) * lq;
+}
+
+/* ----------------------------------------------- */
+/* REMT score : -log10 of the probability to match */
+/* at least k fragments out of n at random         */
+/* (binomial tail B(n, p) with p the random match  */
+/* probability of the spectrum)                    */
+/* ----------------------------------------------- */
+
+static float sREMTScore(ScoreModel *model, int n, int k, 
+                        double p, double lp, double lq)
+{
+  int    j;
+  double logTerm, logMax, sum;
+
+  if ((k <= 0) || (p <= 0.) || (p >= 1.))
+    return 0.;
+
+  /* ---------------------------------- */
+  /* sum of tail terms (log-sum-exp)    */
+
+  logMax = sREMTLogPMF(model, n, k, p, lp, lq);
+
+  for (j = k + 1 ; j <= n ; j++) {
+    logTerm = sREMTLogPMF(model, n, j, p, lp, lq);
+    logMax  = MAX(logMax, logTerm);
+  }
+
+  for (sum = 0., j = k ; j <= n ; j++)
+    sum += exp(sREMTLogPMF(model, n, j, p, lp, lq) - logMax);
+
+  return (float) (- (logMax + log(sum)) / log(10.));
+}
+
+/* ----------------------------------------------- */
+/* score all hits associated to a pst using REMT   */
 /* Random Match between Experiment and Theoretical */
 /* "The Probability for a random Match between an  */
 /*  Experimental Theoretical Spectral Pair in      */
 /*  Tandem Mass Spectrometry"                      */
 /*             Tema Fridman 2005                   */
+/* all hits of the tag share the same spectrum,    */
+/* so the random match probability is computed     */
+/* once for the whole batch.                       */
 /* ----------------------------------------------- */
 
-static float sComputeREMTHitScore(PMHit *hit, PMTag *tag, 
-                                  LXFastaSequence *fastaSeq,
-                                  PMAminoAlphabet *alpha,
-                                  PMEnzyme *enzyme,
-                                  Parameter *param)
+static void sScoreREMTHits(TagHits *tagHits, PeakIndex *peakIndex,
+                           ScoreModel *model, LXFastaSequence *fastaSeq,
+                           PMAminoAlphabet *alpha, Parameter *param)
 {
+  long     i, nbFrags;
+  double   p, lp, lq;
+  Peptide  pep;
+  REMTData rd;
 
-  LXStackpPtr fragments;
+  p  = sREMTRandomProba(peakIndex, param);
+  lp = (p > 0. ? log(p)      : 0.);
+  lq = (p < 1. ? log(1. - p) : 0.);
 
-  if (! (fragments = sFragmentAndAssign(hit->pepMatch, hit->tag->spectrum, alpha, param))) {
-    fprintf(stderr, "# cannot fragment sequence %s\n", hit->pepMatch );
-    return 0.; // [AV] FIXME : what is the correct result in case of error ?
-  }
+  for (i = tagHits->from ; i < tagHits->from + tagHits->count ; i++) {
 
-  // [AV] je pense qu'il manque le calcul !!!
-  
-  LXFreeStackp(fragments, (LXStackDestroy) PMFreeFragment);
-  
-  return 0.;
+    sSetPeptide(&pep, tagHits->arena, i, fastaSeq, alpha);
+
+    rd.nbMatch = 0;
+
+    nbFrags = sWalkFragments(&pep, peakIndex, param, sVisitREMT, &rd);
+
+    pep.hit->score = sREMTScore(model, (int) nbFrags, rd.nbMatch, p, lp, lq);
+  }
 }
 
 /* ----------------------------------------------- *
  * probabilistic model for Dancink 99 scoring algo *
+ * probability of fragment type<index> to be       *
+ * observed                                        *
  * (should be in a config file)                    *
  * ----------------------------------------------- */
  
-static void sInitDancink99Model(int nbAa, double **p, double *pRandom)
+static double sDancink99Proba(int iFragType, int index, double pRandom)
 {
-  int iFragType, iAa;
-
-  *pRandom = 0.05;
-  
-  *p = (double *) malloc( sizeof(double) * NB_FRAG_TYPES * nbAa );
-  
-  for (iAa = 0 ; iAa < nbAa ; iAa++) {
-  
-    for (iFragType = 0 ; iFragType < NB_FRAG_TYPES ; iFragType++) {
-    
-      double proba = 0.;
+  double proba = 0.;
       
-      if ((iFragType == B_Fragment) && (iAa != 0))
-        proba = 0.6;
-      if (iFragType == Y_Fragment)
-        proba = 0.8;
+  if ((iFragType == B_Fragment) && (index != 1))
+    proba = 0.6;
+  if (iFragType == Y_Fragment)
+    proba = 0.8;
 
-      if (proba < *pRandom)
-        proba = *pRandom;
+  if (proba < pRandom)
+    proba = pRandom;
 
-      (*p)[iFragType + iAa * NB_FRAG_TYPES] = proba;
-      
-    }
-  }
+  return proba;
+}
+
+/* ----------------------------------------------- *
+ * Dancink 99 fragment visitor                     *
+ * ----------------------------------------------- */
+
+typedef struct {
+  ScoreModel *model;
+  double     logProba;
+} Dancink99Data;
+
+static void sVisitDancink99(FragmentType type, int index, PMPeak *peak, void *data)
+{
+  Dancink99Data *dd    = (Dancink99Data *) data;
+  ScoreModel    *model = dd->model;
+  int           k      = type + (MIN(index, model->maxIndex) - 1) * model->nbTypes;
+
+  dd->logProba += (peak ? model->logMatch[k] : model->logMiss[k]);
 }
 
 /* ----------------------------------------------- *
@@ -174,127 +364,81 @@ static void sInitDancink99Model(int nbAa, double **p, double *pRandom)
  * ----------------------------------------------- */
 
 
-static float sComputeDancink99HitScore(PMHit *hit, PMTag *tag, 
-                                       LXFastaSequence *fastaSeq,
-                                       PMAminoAlphabet *alpha,
-                                       PMEnzyme *enzyme,
-                                       Parameter *param)
+static float sComputeDancink99HitScore(Peptide *pep, PeakIndex *peakIndex,
+                                       ScoreModel *model, Parameter *param)
 {
-  LXStackpPtr fragments;
+  Dancink99Data dd;
 
-  if (! (fragments = sFragmentAndAssign(hit->pepMatch, hit->tag->spectrum, alpha, param))) {
-    fprintf(stderr, "# cannot fragment sequence %s\n", hit->pepMatch );
-    return -1.; // [AV] FIXME : what is the correct result in case of error ?
-  }
-
-  double pRandom, *model;
+  dd.model    = model;
+  dd.logProba = 0.;
 
-  sInitDancink99Model( strlen(hit->pepMatch), &model, &pRandom );
+  (void) sWalkFragments(pep, peakIndex, param, sVisitDancink99, &dd);
+  
+  return dd.logProba;
+}
 
-  LXCurspToBottom(fragments);
+/* ----------------------------------------------- *
+ * rank sum fragment visitor                       *
+ * ----------------------------------------------- */
 
-  double logProba = 0.;
+typedef struct {
+  int   nbPeaks;
+  float rankSum;
+} RankSumData;
 
-  PMFragmentPtr frag;
- 
-  while (LXReadpUp(fragments, (Ptr *) &frag)) {
-  
-    double peakProba;
-    
-    if (frag->peak)
-      peakProba = model[frag->type + (frag->index - 1) * NB_FRAG_TYPES] / pRandom;
-    else
-      peakProba = (1. - model[frag->type + (frag->index - 1) * NB_FRAG_TYPES ]) / (1. - pRandom);
+static void sVisitRankSum(FragmentType type, int index, PMPeak *peak, void *data)
+{
+  RankSumData *rd = (RankSumData *) data;
 
-    logProba += log10(peakProba);
-  }
-  
-  (void) LXFreeStackp(fragments, (LXStackDestroy) PMFreeFragment);
-  
-  free(model);
-  
-  return logProba;
+  rd->rankSum += (float) (peak ? peak->rank : rd->nbPeaks);
 }
 
-
 /* ----------------------------------------------- *
  * score one hit associated to a pst using simple  *
  * model based on the sum of the peaks ranks       *
  * ----------------------------------------------- */
 
 
-static float sRankSumHitScore(PMHit *hit, PMTag *tag, 
-                              LXFastaSequence *fastaSeq,
-                              PMAminoAlphabet *alpha,
-                              PMEnzyme *enzyme,
+static float sRankSumHitScore(Peptide *pep, PeakIndex *peakIndex,
                               Parameter *param)
 {
-  LXStackpPtr fragments;
+  long        nbFragments;
+  float       minSum, maxSum;
+  RankSumData rd;
 
-  if (! (fragments = sFragmentAndAssign(hit->pepMatch, hit->tag->spectrum, alpha, param))) {
-    fprintf(stderr, "# cannot fragment sequence %s\n", hit->pepMatch );
-    return -1; // [AV] FIXME : what is the correct result in case of error ?
-  }
+  rd.nbPeaks = peakIndex->spectrum->nbPeaks;
+  rd.rankSum = 0.;
 
-  int nbPeaks = hit->tag->spectrum->nbPeaks;
+  nbFragments = sWalkFragments(pep, peakIndex, param, sVisitRankSum, &rd);
 
-  LXCurspToBottom(fragments);
-  
-  float rankSum = 0.;
+  minSum = nbFragments * ( nbFragments + 1 ) / 2. ;
+  maxSum = nbFragments * rd.nbPeaks;
 
-  PMFragmentPtr frag;
- 
-  while (LXReadpUp(fragments, (Ptr *) &frag)) {
-  
-    int peakRank;
-    
-    if (frag->peak)
-      peakRank = frag->peak->rank;
-    else
-      peakRank = nbPeaks;
-
-    rankSum += (float) peakRank;
-  }
-
-  long nbFragments = LXStackpSize(fragments);
-
-  float minSum = nbFragments * ( nbFragments + 1 ) / 2. ;
-  float maxSum = nbFragments * nbPeaks;
-
-// fprintf( stderr, "@ seq=%s nbF= %ld nbP= %d nbA= %d max= %f min= %f rankSum= %f\n", 
-//                 hit->pepMatch, 
-//                 nbFragments, nbPeaks, sGetNbAssigned(fragments), maxSum, minSum, rankSum);
-  
-  (void) LXFreeStackp(fragments, (LXStackDestroy) PMFreeFragment);
-
-  return (maxSum - rankSum) / (maxSum - minSum);
+  return (maxSum - rd.rankSum) / (maxSum - minSum);
 }
 
 /* ----------------------------------------------- *
  * score one hit associated to a pst               *
  * ----------------------------------------------- */
 
-float sComputeHitScore(PMHit *hit, PMTag *tag, 
-                       LXFastaSequence *fastaSeq,
-                       PMAminoAlphabet *alpha,
-                       PMEnzyme *enzyme,
-                       Parameter *param)
+static float sComputeHitScore(Peptide *pep, PeakIndex *peakIndex, 
+                              ScoreModel *model, Parameter *param)
 {
 
   switch ( param->hitScoreType ) {
 
     case ( UnknownHitScoreType ) :
     case ( PSTHitScoreType ) :
-      return sComputePSTHitScore( hit );
+      return sComputePSTHitScore( pep->hit );
 
-    case ( REMTHitScoreType ) :
-      return sComputeREMTHitScore( hit, tag, fastaSeq, alpha, enzyme, param);
+    case ( REMTHitScoreType ) :  /* batch : see sScoreREMTHits */
+      break;
 
     case ( Dancink99HitScoreType ) :
-      return sComputeDancink99HitScore( hit, tag, fastaSeq, alpha, enzyme, param );
+      return sComputeDancink99HitScore( pep, peakIndex, model, param );
 
     case ( RankSumHitScoreType ) :
-      return sRankSumHitScore( hit, tag, fastaSeq, alpha, enzyme, param );
+      return sRankSumHitScore( pep, peakIndex, param );
 
   }
   
@@ -305,29 +449,105 @@ float sComputeHitScore(PMHit *hit, PMTag *tag,
 /* API											   */
 /* =============================================== */
 
+/* ----------------------------------------------- */
+/* new scoring model                               */
+/* model is built once per run, so that hits      */
+/* scores are mere table lookups                   */
+/* ----------------------------------------------- */
+
+ScoreModel *ScoreNewModel(Parameter *param)
+{
+  int        type, index, k;
+  double     proba;
+  ScoreModel *model;
+
+  if (! (model = NEW(ScoreModel))) {
+    MEMORY_ERROR();
+    return NULL;
+  }
+
+  model->nbTypes  = NB_FRAG_TYPES;
+  model->maxIndex = MAX_MODEL_INDEX;
+  model->maxFrags = MAX_MODEL_FRAGS;
+  model->pRandom  = 0.05;
+
+  model->logMatch = NEWN(double, model->nbTypes * model->maxIndex);
+  model->logMiss  = NEWN(double, model->nbTypes * model->maxIndex);
+  model->logFact  = NEWN(double, model->maxFrags + 1);
+
+  if (! (model->logMatch && model->logMiss && model->logFact)) {
+    MEMORY_ERROR();
+    return ScoreFreeModel(model);
+  }
+
+  for (index = 1 ; index <= model->maxIndex ; index++) {
+    for (type = 0 ; type < model->nbTypes ; type++) {
+      k = type + (index - 1) * model->nbTypes;
+      proba = sDancink99Proba(type, index, model->pRandom);
+      model->logMatch[k] = log10(proba / model->pRandom);
+      model->logMiss[k]  = log10((1. - proba) / (1. - model->pRandom));
+    }
+  }
+
+  for (k = 0 ; k <= model->maxFrags ; k++)
+    model->logFact[k] = LXLogFactorial(k);
+
+  return model;
+}
+
+/* ----------------------------------------------- */
+/* free scoring model                              */
+/* ----------------------------------------------- */
+
+ScoreModel *ScoreFreeModel(ScoreModel *model)
+{
+  if (model) {
+    if (model->logMatch)
+      FREE(model->logMatch);
+    if (model->logMiss)
+      FREE(model->logMiss);
+    if (model->logFact)
+      FREE(model->logFact);
+    FREE(model);
+  }
+
+  return NULL;
+}
+
 /* ----------------------------------------------- */
 /* score all hits associated to a pst              */
+/* peakIndex is the mass index of the pst spectrum */
+/* (may be NULL for PST score)                     */
 /* ----------------------------------------------- */
 
-int ScoreHitStack (PMTag *tag, 
-                   PMHitStack *hitStack,
-                   LXFastaSequence *fastaSeq,
-                   PMAminoAlphabet *alpha,
-                   PMEnzyme *enzyme,
-                   Parameter *param)
+int ScoreHits (TagHits *tagHits,
+               PeakIndex *peakIndex,
+               ScoreModel *model,
+               LXFastaSequence *fastaSeq,
+               PMAminoAlphabet *alpha,
+               PMEnzyme *enzyme,
+               Parameter *param)
 {
 /*ARGSUSED*/
-  long i, n;
-  
-  n = LXStackpSize(hitStack);
-  
-  for (i = 0 ; i < n ; i++) {
+  long    i;
+  Peptide pep;
+
+  if (    (param->hitScoreType != UnknownHitScoreType)
+       && (param->hitScoreType != PSTHitScoreType)
+       && (! peakIndex))
+    return ARG_ERROR();
+
+  if (param->hitScoreType == REMTHitScoreType) {
+    sScoreREMTHits(tagHits, peakIndex, model, fastaSeq, alpha, param);
+    return LX_NO_ERROR;
+  }
   
-    PMHit *hit = (PMHit *) LXStackpGetValue(hitStack, i);
+  for (i = tagHits->from ; i < tagHits->from + tagHits->count ; i++) {
+
+    sSetPeptide(&pep, tagHits->arena, i, fastaSeq, alpha);
     
-    hit->score = sComputeHitScore(hit, tag, fastaSeq, alpha, enzyme, param);
+    pep.hit->score = sComputeHitScore(&pep, peakIndex, model, param);
   } 
 
   return LX_NO_ERROR;
 }
-
@@ -0,0 +1,367 @@
+/* -----------------------------------------------------------------------
+ * $Id: PMMatchThread.c $
+ * -----------------------------------------------------------------------
+ * @file: PMMatchThread.c
+ * @desc: PMMatch multithreaded tag processing
+ *
+ * @history:
+ * @+ <Gloup> : Oct 26 : first version
+ * @+ <Gloup> : Oct 26 : pool of threads started once per run
+ * -----------------------------------------------------------------------
+ * @docstart:
+ *
+ * PepMap PMMatch multithreaded tag processing <br>
+ * tags are processed by groups sharing the same kuple (see
+ * HashInitTable) : each occurrence of the kuple is looked up
+ * and its flanks walked once for the whole group.
+ * groups are processed by a pool of worker threads, started once
+ * per run and woken up for each sequence. Each worker pulls
+ * chunks of groups from a shared counter and pushes hits
+ * in its own arena (see PMMatchArena.c). The hits of each tag are
+ * referenced in the tag own slot, so that the main thread
+ * can later print them in the original (serial) tag order.
+ *
+ * @docend:
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <pthread.h>
+
+#include "LX.h"
+#include "PM.h"
+
+#include "PMMatch.h"
+
+/* number of groups handed to a worker at once */
+
+#define GROUP_CHUNK 8
+
+/* ----------------------------------------------- */
+/* get next chunk of groups [*from, *to[           */
+/* ----------------------------------------------- */
+
+static Bool sNextChunk(ThreadPool *pool, long *from, long *to)
+{
+  Bool ok;
+
+  pthread_mutex_lock(&pool->lock);
+
+  *from = pool->next;
+  *to   = MIN(*from + GROUP_CHUNK, pool->nbGroups);
+
+  pool->next = *to;
+
+  ok = (*from < *to);
+
+  pthread_mutex_unlock(&pool->lock);
+
+  return ok;
+}
+
+/* ----------------------------------------------- */
+/* process chunks of groups of current round       */
+/* ----------------------------------------------- */
+
+static void sProcessChunks(ThreadWorker *worker)
+{
+  int    stat;
+  long   from, to, igroup;
+  ThreadPool *pool = worker->pool;
+
+  while (sNextChunk(pool, &from, &to)) {
+    for (igroup = from ; igroup < to ; igroup++) {
+      stat = ThreadProcessGroup(pool->context, igroup, worker->arena,
+                                worker->walk, worker->timing, pool->tagHits);
+      if (stat != LX_NO_ERROR) {
+        pthread_mutex_lock(&pool->lock);
+        pool->status = stat;
+        pthread_mutex_unlock(&pool->lock);
+      }
+    }
+  }
+}
+
+/* ----------------------------------------------- */
+/* worker thread entry point                       */
+/* wait for next round (or end of run)             */
+/* ----------------------------------------------- */
+
+static void *sWorker(void *arg)
+{
+  ThreadWorker *worker = (ThreadWorker *) arg;
+  ThreadPool   *pool   = worker->pool;
+
+  while (TRUE) {
+
+    pthread_mutex_lock(&pool->lock);
+
+    while ((! pool->quit) && (worker->round == pool->round))
+      pthread_cond_wait(&pool->start, &pool->lock);
+
+    if (pool->quit) {
+      pthread_mutex_unlock(&pool->lock);
+      break;
+    }
+
+    worker->round = pool->round;
+
+    pthread_mutex_unlock(&pool->lock);
+
+    sProcessChunks(worker);
+
+    pthread_mutex_lock(&pool->lock);
+
+    if (--pool->nbBusy == 0)
+      pthread_cond_signal(&pool->done);
+
+    pthread_mutex_unlock(&pool->lock);
+  }
+
+  return NULL;
+}
+
+/* ----------------------------------------------- */
+/* API                                             */
+/* ----------------------------------------------- */
+
+/* ----------------------------------------------- */
+/* process group of tags #igroup on current        */
+/* sequence, i.e. walk left and right flanks of    */
+/* each occurrence of the group kuple once, then   */
+/* for each tag of the group : extend hits left    */
+/* and right in these flanks and score hits.       */
+/* hits are pushed in arena, tagHits[itag] receives*/
+/* the (contiguous) hits of tag #itag              */
+/* walk holds the flanks (reused by each call)     */
+/* time spent is added to timing (if not NULL)     */
+/* ----------------------------------------------- */
+
+int ThreadProcessGroup(MatchContext *context, Int32 igroup,
+                       HitArena *arena, FlankWalk *walk,
+                       MatchTiming *timing, TagHits *tagHits)
+{
+  long        i, k, itag, from, to;
+  float       mini, maxi, nMaxi, cMaxi;
+  double      clock;
+  PMTag       *tag;
+  PMHit       hit;
+  HitMod      mods[2 * MAX_MODIF];
+  LXStackpPtr stk;
+  HashTable   *table = context->hashTable;
+  Parameter   *param = context->param;
+
+  from = table->start[igroup];
+  to   = table->start[igroup + 1];
+  stk  = table->stk[igroup];
+
+  clock = UtilClock(timing);
+
+  // widest mass windows of group
+
+  nMaxi = cMaxi = 0.;
+
+  for (k = from ; k < to ; k++) {
+    tag = (PMTag *) LXStackpGetValue(context->tagStack, table->tags[k]);
+    MassTagWindow(tag, param, TRUE,  &mini, &maxi);
+    nMaxi = MAX(nMaxi, maxi);
+    MassTagWindow(tag, param, FALSE, &mini, &maxi);
+    cMaxi = MAX(cMaxi, maxi);
+  }
+
+  // walk flanks of each occurrence once
+
+  if (MassWalkFlanks(walk, stk, table->kuple, nMaxi, cMaxi, context->massTable,
+                     context->fastaSeq, context->alpha, param) != LX_NO_ERROR)
+    return LX_MEM_ERROR;
+
+  for (k = from ; k < to ; k++) {
+
+    itag = table->tags[k];
+    tag  = (PMTag *) LXStackpGetValue(context->tagStack, itag);
+
+    tagHits[itag].arena = arena;
+    tagHits[itag].from  = arena->nbHits;
+    tagHits[itag].count = 0;
+
+    // extend hits left and right
+
+    for (i = 0 ; i < stk->top ; i++) {
+
+      (void) memset(&hit, 0, sizeof(PMHit));
+
+      hit.type  = InvalidHit;
+      hit.posSn = (long) stk->val[i];
+      hit.posSc = hit.posSn + table->kuple - 1;
+      hit.tag   = tag;
+
+      if (MassMatchHit(tag, &hit, mods, walk->nFlanks + i, walk->cFlanks + i,
+                       context->cleavageMap, context->fastaSeq, context->alpha, param)) {
+        if (ArenaPushHit(arena, &hit, mods) != LX_NO_ERROR)
+          return LX_MEM_ERROR;
+      }
+    }
+
+    tagHits[itag].count = arena->nbHits - tagHits[itag].from;
+
+    UtilLapTime(timing, ExtendPhase, &clock);
+
+    // score hits
+
+    (void) ScoreHits(tagHits + itag,
+                     (context->peakIndex ? context->peakIndex[itag] : NULL),
+                     context->scoreModel,
+                     context->fastaSeq, context->alpha, context->enzyme, param);
+
+    UtilLapTime(timing, ScorePhase, &clock);
+  }
+
+  return LX_NO_ERROR;
+}
+
+/* ----------------------------------------------- */
+/* new pool of param->nbThreads threads (or none   */
+/* if param->nbThreads <= 1, tags are then         */
+/* processed by the calling thread).               */
+/* arenas[i] is the hits arena of thread #i,       */
+/* tagHits[i] receives the hits of tag #i.         */
+/* timings[i] (if timings is not NULL) cumulates   */
+/* the times spent by thread #i                    */
+/* ----------------------------------------------- */
+
+ThreadPool *ThreadNewPool(MatchContext *context, HitArena **arenas,
+                          MatchTiming *timings, TagHits *tagHits)
+{
+  int        i;
+  ThreadPool *pool;
+
+  if (! (pool = NEW(ThreadPool))) {
+    MEMORY_ERROR();
+    return NULL;
+  }
+
+  pool->context   = context;
+  pool->tagHits   = tagHits;
+  pool->nbThreads = MAX(1, context->param->nbThreads);
+  pool->nbStarted = 0;
+  pool->nbGroups  = 0;
+  pool->next      = 0;
+  pool->round     = 0;
+  pool->nbBusy    = 0;
+  pool->status    = LX_NO_ERROR;
+  pool->quit      = FALSE;
+
+  pool->threads = NEWN(pthread_t, pool->nbThreads);
+  pool->workers = NEWN(ThreadWorker, pool->nbThreads);
+
+  if (! (pool->threads && pool->workers)) {
+    if (pool->threads) FREE(pool->threads);
+    if (pool->workers) FREE(pool->workers);
+    FREE(pool);
+    MEMORY_ERROR();
+    return NULL;
+  }
+
+  for (i = 0 ; i < pool->nbThreads ; i++) {
+    pool->workers[i].pool   = pool;
+    pool->workers[i].arena  = arenas[i];
+    pool->workers[i].walk   = MassNewWalk(context->alpha);
+    pool->workers[i].timing = (timings ? timings + i : NULL);
+    pool->workers[i].round  = 0;
+    if (! pool->workers[i].walk)
+      pool->status = LX_MEM_ERROR;
+  }
+
+  (void) pthread_mutex_init(&pool->lock, NULL);
+  (void) pthread_cond_init(&pool->start, NULL);
+  (void) pthread_cond_init(&pool->done, NULL);
+
+  if (pool->status != LX_NO_ERROR)
+    return ThreadFreePool(pool);
+
+  for (i = 0 ; (pool->nbThreads > 1) && (i < pool->nbThreads) ; i++) {
+    if (pthread_create(pool->threads + pool->nbStarted, NULL, sWorker, 
+                       pool->workers + pool->nbStarted) == 0)
+      pool->nbStarted++;
+  }
+
+  return pool;
+}
+
+/* ----------------------------------------------- */
+/* stop pool threads and free pool                 */
+/* ----------------------------------------------- */
+
+ThreadPool *ThreadFreePool(ThreadPool *pool)
+{
+  int i;
+
+  if (! pool)
+    return NULL;
+
+  pthread_mutex_lock(&pool->lock);
+  pool->quit = TRUE;
+  pthread_cond_broadcast(&pool->start);
+  pthread_mutex_unlock(&pool->lock);
+
+  for (i = 0 ; i < pool->nbStarted ; i++)
+    (void) pthread_join(pool->threads[i], NULL);
+
+  (void) pthread_cond_destroy(&pool->done);
+  (void) pthread_cond_destroy(&pool->start);
+  (void) pthread_mutex_destroy(&pool->lock);
+
+  for (i = 0 ; i < pool->nbThreads ; i++)
+    (void) MassFreeWalk(pool->workers[i].walk);
+
+  FREE(pool->threads);
+  FREE(pool->workers);
+  FREE(pool);
+
+  return NULL;
+}
+
+/* ----------------------------------------------- */
+/* process all tags on current sequence            */
+/* (pool->context->fastaSeq) with pool threads     */
+/* (or the calling thread if no thread could be    */
+/* started). arenas are reset here.                */
+/* ----------------------------------------------- */
+
+int ThreadProcessTags(ThreadPool *pool)
+{
+  int i;
+
+  (void) memset(pool->tagHits, 0, LXStackpSize(pool->context->tagStack) * sizeof(TagHits));
+
+  for (i = 0 ; i < pool->nbThreads ; i++)
+    ArenaReset(pool->workers[i].arena);
+
+  pool->nbGroups = pool->context->hashTable->nbCodes;
+  pool->next     = 0;
+  pool->status   = LX_NO_ERROR;
+
+  // single thread or no thread could be started : 
+  // do the job ourselves
+
+  if (pool->nbStarted == 0) {
+    sProcessChunks(pool->workers);
+    return pool->status;
+  }
+
+  pthread_mutex_lock(&pool->lock);
+
+  pool->round++;
+  pool->nbBusy = pool->nbStarted;
+
+  pthread_cond_broadcast(&pool->start);
+
+  while (pool->nbBusy > 0)
+    pthread_cond_wait(&pool->done, &pool->lock);
+
+  pthread_mutex_unlock(&pool->lock);
+
+  return pool->status;
+}
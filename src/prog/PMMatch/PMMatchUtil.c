@@ -7,6 +7,8 @@
  * @history:
  * @+ <Wanou> : Jul 02 : first version
  * @+ <Gloup> : Aug 06 : complete code revision
+ * @+ <Gloup> : Oct 26 : timing report
+ * @+ <Gloup> : Oct 26 : windowed sequences
  * -----------------------------------------------------------------------
  * @docstart: 
  *
@@ -74,34 +76,170 @@ int UtilCheckTags(PMTagStack *tagStack)
 }
 
 /* ----------------------------------------------------- */
-/* print stack of hits associated to tag                 */
+/* does hit start in window core                         */
 /* ----------------------------------------------------- */
 
-int UtilPrintHitStack(PMTag *tag, PMHitStack *hitStack, LXFastaSequence *fastaSeq)
+static Bool sInWindow(PMHit *hit, SeqWindow *window)
 {
-  PMSeqId seqId;
+  return (hit->posSn >= window->coreFrom) && (hit->posSn < window->coreTo);
+}
+
+/* ----------------------------------------------------- */
+/* shift hit positions by offset                         */
+/* (unmatched sides, i.e. negative posM, are kept)       */
+/* ----------------------------------------------------- */
+
+static void sShiftHit(PMHit *hit, long offset)
+{
+  if (hit->posMn >= 0)
+    hit->posMn += offset;
+
+  if (hit->posMc >= 0)
+    hit->posMc += offset;
+
+  hit->posSn += offset;
+  hit->posSc += offset;
+}
+
+/* ----------------------------------------------------- */
+/* number of hits associated to tag to be printed        */
+/* (all hits or hits starting in window core)            */
+/* ----------------------------------------------------- */
+
+long UtilCountHits(TagHits *tagHits, SeqWindow *window)
+{
+  long i, count;
+
+  if (! window)
+    return tagHits->count;
+
+  for (count = 0, i = tagHits->from ; i < tagHits->from + tagHits->count ; i++)
+    count += sInWindow(tagHits->arena->hits + i, window);
+
+  return count;
+}
+
+/* ----------------------------------------------------- */
+/* print hits associated to tag #itag on sequence #iseq  */
+/* peptides are formatted here from hits positions       */
+/* if window is not NULL, only hits starting in window   */
+/* core are printed, at their whole sequence positions   */
+/* ----------------------------------------------------- */
+
+int UtilPrintHits(PMHitFile *hitFile, Int32 iseq, PMSeqId *seqId,
+                  Int32 itag, PMTag *tag, TagHits *tagHits,
+                  LXFastaSequence *fastaSeq, PMAminoAlphabet *alpha,
+                  SeqWindow *window)
+{
+  long    i, count, offset;
+  char    pepSeq[BUFSIZ], pepMatch[BUFSIZ];
   
-  if (LXStackpSize(hitStack) == 0)
+  if ((count = UtilCountHits(tagHits, window)) == 0)
     return LX_NO_ERROR;
 
-#if 0
-  if (PMFasta2SeqId(fastaSeq, &seqId) != LX_NO_ERROR)
-    return ERROR("Invalid Sequence header", LX_ARG_ERROR);
-#else
-  // [AV] this is for use with unformated proteic sequences
-  (void) PMFasta2SeqIdSafe(fastaSeq, &seqId);
-#endif
+  offset = (window ? window->offset : 0);
 
-  if (PMWriteSeqId(stdout, &seqId) != LX_NO_ERROR)
+  if (PMHitFileBeginHits(hitFile, iseq, seqId, itag, tag, 
+                         (Int32) count) != LX_NO_ERROR)
     return IO_ERROR();
 
-  if (PMWriteTag(stdout, tag) != LX_NO_ERROR)
-    return IO_ERROR();
-    
-  if (PMWriteHitStack(stdout, hitStack) != LX_NO_ERROR)  
-    return IO_ERROR();
+  for (i = tagHits->from ; i < tagHits->from + tagHits->count ; i++) {
+
+    int   res;
+    PMHit *hit = tagHits->arena->hits + i;
+
+    if (window && ! sInWindow(hit, window))
+      continue;
+
+    ArenaFormatHit(tagHits->arena, i, fastaSeq, alpha, pepSeq, pepMatch);
+
+    hit->pepSeq   = pepSeq;
+    hit->pepMatch = pepMatch;
+
+    sShiftHit(hit, offset);
+
+    res = PMHitFileWriteHit(hitFile, hit);
+
+    sShiftHit(hit, -offset);
+
+    hit->pepSeq   = NULL;
+    hit->pepMatch = NULL;
+
+    if (res != LX_NO_ERROR)
+      return IO_ERROR();
+  }
     
-  return LX_NO_ERROR;
+  return PMHitFileEndHits(hitFile);
+}
+
+
+
+/* ----------------------------------------------------- */
+/* timing : current clock (0 if timing is off)           */
+/* ----------------------------------------------------- */
+
+double UtilClock(MatchTiming *timing)
+{
+  return (timing ? LXCurrentTime() : 0.);
+}
+
+/* ----------------------------------------------------- */
+/* timing : add time elapsed since *clock to phase       */
+/* and restart *clock                                    */
+/* ----------------------------------------------------- */
+
+void UtilLapTime(MatchTiming *timing, MatchPhase phase, double *clock)
+{
+  double now;
+
+  if (! timing)
+    return;
+
+  now = LXCurrentTime();
+
+  timing->elapsed[phase] += now - *clock;
+
+  *clock = now;
 }
 
+/* ----------------------------------------------------- */
+/* print timing report                                   */
+/* timings[0..nbTimings-1] are the per thread timings    */
+/* total is the overall elapsed time                     */
+/* ----------------------------------------------------- */
+
+void UtilPrintTiming(FILE *streamou, MatchTiming *timings, int nbTimings,
+                     long nbTags, long nbSeq, long nbHits, double total)
+{
+  int    i, phase;
+  double elapsed[NbPhases], match;
+
+  static char *sPhaseName[NbPhases] = {
+    "load", "hashfill", "read", "lookup", "extend", "score", "output"
+  };
+
+  for (phase = 0 ; phase < NbPhases ; phase++) {
+    elapsed[phase] = 0.;
+    for (i = 0 ; i < nbTimings ; i++)
+      elapsed[phase] += timings[i].elapsed[phase];
+  }
 
+  for (phase = 0 ; phase < NbPhases ; phase++)
+    fprintf(streamou, "# timing %-10s %12.4f sec\n", sPhaseName[phase], elapsed[phase]);
+
+  if (nbTimings > 1)
+    fprintf(streamou, "# timing (extend and score are summed over %d threads)\n", nbTimings);
+
+  match = total - elapsed[LoadPhase] - elapsed[HashFillPhase];
+
+  fprintf(streamou, "# timing %-10s %12.4f sec\n", "total", total);
+  fprintf(streamou, "# timing %-10s %12ld\n", "tags", nbTags);
+  fprintf(streamou, "# timing %-10s %12ld\n", "sequences", nbSeq);
+  fprintf(streamou, "# timing %-10s %12ld\n", "hits", nbHits);
+  fprintf(streamou, "# timing %-10s %12.1f\n", "tags/s", 
+                    (match > 0. ? (double) nbTags * nbSeq / match : 0.));
+  fprintf(streamou, "# timing %-10s %12.1f\n", "hits/s", 
+                    (match > 0. ? (double) nbHits / match : 0.));
+  fprintf(streamou, "# timing %-10s %12.1f Mb\n", "peakmem", 
+                    (double) LXGetPeakMemory() / (1024. * 1024.));
+}
@@ -0,0 +1,719 @@
+/* -----------------------------------------------------------------------
+ * $Id: PMSynth.c $
+ * -----------------------------------------------------------------------
+ * @file: PMSynth.c
+ * @desc: synthetic data generator for PMMatch benchmarks
+ *
+ * @history:
+ * @+ <Gloup> : Oct 26 : first version
+ * -----------------------------------------------------------------------
+ * @docstart:
+ *
+ * PepMap PMSynth : generate a reproducible synthetic data set <br>
+ * - <prefix>.dna.fst : random chromosome(s)
+ * - <prefix>.fst     : 6 frames translation (as produced by PMTrans)
+ * - <prefix>.pst     : tags (as produced by Taggor)
+ * - <prefix>.pkl     : spectra (pkl format) matching the tags
+ *
+ * spectra are theoretical b/y ions spectra of peptides, plus
+ * noise peaks. Peptides are either sampled from the translated
+ * chromosome (between two enzyme cut sites) or random (decoys).
+ * each tag id is <prefix>.<spectrum>.<tag> as expected by PMMatch
+ * spectrum based scores.
+ *
+ * the random generator is internal, so that a given seed
+ * produces the same data set on every platform.
+ *
+ * @docend:
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "LX.h"
+#include "PM.h"
+
+#ifndef VERSION
+#define VERSION "?"
+#endif
+
+#define DFT_AA_FILENAME     "aa_mono.ref"
+#define DFT_ENZ_FILENAME    "trypsin.ref"
+#define DFT_GENOME_LENGTH   1000000
+#define DFT_CHROMOSOMES     1
+#define DFT_SPECTRA         1000
+#define DFT_TAGS_PER_SPECT  3
+#define DFT_TAG_LENGTH      3
+#define DFT_DECOYS          0.1
+#define DFT_NOISE_PEAKS     50
+#define DFT_CHARGE          2
+#define DFT_SEED            1
+
+#define MIN_PEPTIDE_LEN     7
+#define MAX_PEPTIDE_LEN     35
+#define MAX_TRIALS          1000
+
+/* -------------------------------------------------------------------- */
+/* Parameters                                                           */
+/* -------------------------------------------------------------------- */
+
+typedef struct {
+  long  genomeLength;
+  int   nbChromosomes;
+  long  nbSpectra;
+  int   nbTagsPerSpectrum;
+  int   tagLength;
+  float decoys;
+  int   nbNoisePeaks;
+  int   charge;
+  Bool  verbose;
+} Parameter;
+
+/* -------------------------------------------------------------------- */
+/* Output state                                                         */
+/* -------------------------------------------------------------------- */
+
+typedef struct {
+  FILE            *pstFile;
+  FILE            *pklFile;
+  char            *prefix;
+  long            nbSpectra;
+  long            nbTags;
+  PMAminoAlphabet *alpha;
+  Parameter       *param;
+} Output;
+
+/* -------------------------------------------------------------------- */
+/* Random generator                                                     */
+/* (xorshift64*, so that data sets do not depend on the libc)           */
+/* -------------------------------------------------------------------- */
+
+static UInt64 sSeed = 88172645463325252ULL;
+
+static void sRandomSeed(long seed)
+{
+  int i;
+
+  sSeed = 88172645463325252ULL ^ ((UInt64) seed * 2685821657736338717ULL);
+
+  if (sSeed == 0)
+    sSeed = 88172645463325252ULL;
+
+  for (i = 0 ; i < 16 ; i++)   // warm up
+    sSeed ^= sSeed >> 12, sSeed ^= sSeed << 25, sSeed ^= sSeed >> 27;
+}
+
+/* ----------------------------------------------- */
+/* uniform in [0, 1[                               */
+
+static double sRandom()
+{
+  sSeed ^= sSeed >> 12;
+  sSeed ^= sSeed << 25;
+  sSeed ^= sSeed >> 27;
+
+  return (double) ((sSeed * 2685821657736338717ULL) >> 11) / 9007199254740992.;
+}
+
+/* ----------------------------------------------- */
+/* uniform in [0, n[                               */
+
+static long sRandomInt(long n)
+{
+  return (long) (sRandom() * (double) n);
+}
+
+/* -------------------------------------------------------------------- */
+/* Local functs                                                         */
+/* -------------------------------------------------------------------- */
+
+/* ----------------------------------------------- */
+static void sStartupBanner(int argc, char *argv[])
+{
+  int i;
+  fprintf(stderr,"# ------------------------------\n");
+  fprintf(stderr,"# PepMap PMSynth v %s\n", VERSION);
+  fprintf(stderr,"#\n");
+  fprintf(stderr,"# Synthetic chromosome, tags and\n");
+  fprintf(stderr,"# spectra for PMMatch benchmarks\n");
+  fprintf(stderr,"# ------------------------------\n");
+  fprintf(stderr,"# run: ");
+  for (i = 0 ; i < argc ; i++)
+    fprintf(stderr,"%s ", argv[i]);
+  fprintf(stderr,"\n");
+  fprintf(stderr,"# ------------------------------\n");
+}
+
+/* ----------------------------------------------- */
+static void sUsage(int err)
+{
+  fprintf(stderr,"Usage: PMSynth [options] -o prefix\n");
+  fprintf(stderr,"type PMSynth -h for help\n");
+  exit(err);
+}
+
+/* ----------------------------------------------- */
+static void sHelp()
+{
+  fprintf(stderr,"Usage: PMSynth [options] -o prefix\n");
+  fprintf(stderr," options:\n");
+  fprintf(stderr," -a aaFile        : aminoacids filename\n");
+  fprintf(stderr,"                    (default = %s)\n", DFT_AA_FILENAME);
+  fprintf(stderr," -c count         : number of chromosomes\n");
+  fprintf(stderr,"                    (default = %d)\n", DFT_CHROMOSOMES);
+  fprintf(stderr," -e enzymeFile    : digestion enzyme filename\n");
+  fprintf(stderr,"                    (default = %s)\n", DFT_ENZ_FILENAME);
+  fprintf(stderr," -g length        : total chromosomes length (nt)\n");
+  fprintf(stderr,"                    (default = %d)\n", DFT_GENOME_LENGTH);
+  fprintf(stderr," -h               : print this help\n");
+  fprintf(stderr," -k length        : tags length (aa)\n");
+  fprintf(stderr,"                    (default = %d)\n", DFT_TAG_LENGTH);
+  fprintf(stderr," -n count         : number of spectra (i.e. peptides)\n");
+  fprintf(stderr,"                    (default = %d)\n", DFT_SPECTRA);
+  fprintf(stderr," -o prefix        : output files prefix\n");
+  fprintf(stderr,"                    writes <prefix>.dna.fst <prefix>.fst\n");
+  fprintf(stderr,"                           <prefix>.pst and <prefix>.pkl\n");
+  fprintf(stderr," -p count         : number of noise peaks per spectrum\n");
+  fprintf(stderr,"                    (default = %d)\n", DFT_NOISE_PEAKS);
+  fprintf(stderr," -r seed          : random seed\n");
+  fprintf(stderr,"                    (default = %d)\n", DFT_SEED);
+  fprintf(stderr," -t count         : number of tags per spectrum\n");
+  fprintf(stderr,"                    (default = %d)\n", DFT_TAGS_PER_SPECT);
+  fprintf(stderr," -v               : verbose mode\n");
+  fprintf(stderr," -x fraction      : fraction of decoy (random) peptides\n");
+  fprintf(stderr,"                    (default = %.2f)\n", DFT_DECOYS);
+  fprintf(stderr," -z charge        : spectra parent charge\n");
+  fprintf(stderr,"                    (default = %d)\n", DFT_CHARGE);
+  exit(0);
+}
+
+/* ----------------------------------------------- */
+/* mass of residue (-1 if invalid)                 */
+
+static float sMass(PMAminoAlphabet *alpha, char c)
+{
+  PMAminoAcid *amino = PMGetAminoAcid(alpha, (PMSymbol) c);
+
+  if ((amino == NULL) || (amino->type != PM_AA_ORIGIN))
+    return -1.;
+
+  return amino->mass;
+}
+
+/* ----------------------------------------------- */
+/* peaks comparison (by mass)                      */
+
+static int sComparePeaks(const void *p1, const void *p2)
+{
+  float m1 = ((PMPeak *) p1)->mass,
+        m2 = ((PMPeak *) p2)->mass;
+
+  return (m1 < m2 ? -1 : (m1 > m2 ? 1 : 0));
+}
+
+/* ----------------------------------------------- */
+/* output spectrum and tags of peptide pep[0..len[ */
+
+static int sOutputPeptide(Output *out, char *pep, int len)
+{
+  int        i, j, npeaks, itag, ntags, kuple, offset;
+  float      mass[MAX_PEPTIDE_LEN + 1], mParent;
+  Bool       used[MAX_PEPTIDE_LEN];
+  PMPeak     peaks[2 * MAX_PEPTIDE_LEN], *noise;
+  PMSpectrum *sp;
+  PMTag      tag;
+  Parameter  *param = out->param;
+
+  kuple = param->tagLength;
+
+  /* ---------------------------------- */
+  /* cumulated masses                   */
+
+  mass[0] = 0.;
+  for (i = 0 ; i < len ; i++)
+    mass[i + 1] = mass[i] + sMass(out->alpha, pep[i]);
+
+  mParent = mass[len] + PM_MASS_H2O + PM_MASS_H;   // [M+H]+
+
+  out->nbSpectra++;
+
+  /* ---------------------------------- */
+  /* tags                               */
+  /* (never at peptide ends)            */
+
+  ntags = MIN(param->nbTagsPerSpectrum, len - kuple - 1);
+
+  for (i = 0 ; i < len ; i++)
+    used[i] = FALSE;
+
+  for (itag = 0 ; itag < ntags ; itag++) {
+
+    do {
+      offset = 1 + sRandomInt(len - kuple - 1);
+    } while (used[offset]);
+
+    used[offset] = TRUE;
+
+    (void) sprintf(tag.id, "%s.%ld.%d", out->prefix, out->nbSpectra, itag + 1);
+    (void) memcpy(tag.seq, pep + offset, kuple);
+    tag.seq[kuple] = '\000';
+
+    tag.mN      = mass[offset];
+    tag.mC      = mass[len] - mass[offset + kuple];
+    tag.mParent = mParent;
+    tag.score   = 1. + 40. * sRandom();
+
+    if (PMWriteTag(out->pstFile, &tag) != LX_NO_ERROR)
+      return IO_ERROR();
+
+    out->nbTags++;
+  }
+
+  /* ---------------------------------- */
+  /* spectrum : b and y ions + noise    */
+
+  if (! (sp = PMNewSpectrum()))
+    return MEMORY_ERROR();
+
+  sp->charge           = param->charge;
+  sp->parent.mass      = mParent;
+  sp->parent.intensity = 100.;
+
+  npeaks = 0;
+
+  for (i = 1 ; i < len ; i++) {
+    peaks[npeaks].mass        = mass[i] + PM_MASS_H;                            // b
+    peaks[npeaks++].intensity = 10. + 90. * sRandom();
+    peaks[npeaks].mass        = mass[len] - mass[i] + PM_MASS_H2O + PM_MASS_H;  // y
+    peaks[npeaks++].intensity = 10. + 90. * sRandom();
+  }
+
+  if (! (noise = NEWN(PMPeak, npeaks + param->nbNoisePeaks))) {
+    (void) PMFreeSpectrum(sp);
+    return MEMORY_ERROR();
+  }
+
+  (void) memcpy(noise, peaks, npeaks * sizeof(PMPeak));
+
+  for (j = 0 ; j < param->nbNoisePeaks ; j++, npeaks++) {
+    noise[npeaks].mass      = 50. + (mParent - 50.) * sRandom();
+    noise[npeaks].intensity = 1. + 30. * sRandom();
+  }
+
+  qsort(noise, npeaks, sizeof(PMPeak), sComparePeaks);
+
+  for (j = 0 ; j < npeaks ; j++)
+    (void) PMAddPeakToSpectrum(sp, noise[j]);
+
+  (void) PMWritePKL1Spectrum(out->pklFile, sp);
+
+  FREE(noise);
+
+  (void) PMFreeSpectrum(sp);
+
+  return LX_NO_ERROR;
+}
+
+/* ----------------------------------------------- */
+/* sample nbPeptides peptides from translated seq  */
+/* a peptide is a stretch of valid residues        */
+/* between two cut sites (or stops)                */
+
+static int sSamplePeptides(Output *out, LXFastaSequence *prtSeq,
+                           PMCleavageMap *map, long nbPeptides)
+{
+  long   n, trial, pos, left, right;
+  char   *seq = prtSeq->seq;
+  int    kuple = out->param->tagLength;
+
+  if ((nbPeptides <= 0) || (prtSeq->length <= 0))
+    return LX_NO_ERROR;
+
+  for (n = trial = 0 ; (n < nbPeptides) && (trial < MAX_TRIALS * nbPeptides) ; trial++) {
+
+    pos = sRandomInt(prtSeq->length);
+
+    if (sMass(out->alpha, seq[pos]) < 0)
+      continue;
+
+    for (left = pos ; (left > 0) && (! PMHasCleavage(map, left)) ; left--) {
+      if (sMass(out->alpha, seq[left - 1]) < 0)
+        break;
+    }
+
+    for (right = pos ; (right < prtSeq->length - 1) && (! PMHasCleavage(map, right + 1)) ; right++) {
+      if (sMass(out->alpha, seq[right + 1]) < 0)
+        break;
+    }
+
+    if (   (right - left + 1 < MAX(MIN_PEPTIDE_LEN, kuple + 2))
+        || (right - left + 1 > MAX_PEPTIDE_LEN))
+      continue;
+
+    if (sOutputPeptide(out, seq + left, (int) (right - left + 1)) != LX_NO_ERROR)
+      return LX_IO_ERROR;
+
+    n++;
+  }
+
+  if ((n < nbPeptides) && out->param->verbose)
+    fprintf(stderr, "# only %ld peptides (out of %ld) found in %s\n",
+                    n, nbPeptides, prtSeq->name);
+
+  return LX_NO_ERROR;
+}
+
+/* ----------------------------------------------- */
+/* output nbPeptides random peptides               */
+
+static int sRandomPeptides(Output *out, long nbPeptides)
+{
+  long n;
+  int  i, len;
+  char pep[MAX_PEPTIDE_LEN + 1];
+  char *letters = PMGetNormalAlphabet(out->alpha);
+  int  nbLetters = strlen(letters);
+  int  kuple = out->param->tagLength;
+
+  for (n = 0 ; n < nbPeptides ; n++) {
+
+    len = MAX(MIN_PEPTIDE_LEN, kuple + 2);
+    len += sRandomInt(MAX_PEPTIDE_LEN / 2 - len + 1);
+
+    for (i = 0 ; i < len ; i++)
+      pep[i] = letters[sRandomInt(nbLetters)];
+
+    if (sOutputPeptide(out, pep, len) != LX_NO_ERROR)
+      return LX_IO_ERROR;
+  }
+
+  return LX_NO_ERROR;
+}
+
+/* ----------------------------------------------- */
+/* open output file <prefix><suffix>               */
+
+static FILE *sOpenOutput(char *prefix, char *suffix)
+{
+  FILE *file;
+  char filename[BUFSIZ];
+
+  (void) sprintf(filename, "%s%s", prefix, suffix);
+
+  if (! (file = LXOpenFile(filename, "w"))) {
+    fprintf(stderr,"# Cannot create : %s\n", filename);
+    exit(LX_IO_ERROR);
+  }
+
+  return file;
+}
+
+/* -------------------------------------------------------------------- */
+/* Main Entry point                                                     */
+/* -------------------------------------------------------------------- */
+
+int main(int argc, char *argv[])
+{
+  extern char *optarg;
+
+  int    opt, ichr, istrand, iframe;
+  long   i, seed, chrLength, nbGenuine, nbDecoys, prtLength, nbAa, totAa, quota;
+  int    strands[] = {PM_SEQID_DIRECT, PM_SEQID_REVERSE};
+
+  FILE   *dnaFile, *prtFile;
+
+  Parameter param;
+  Output    out;
+
+  PMAminoAlphabet alpha;
+  PMEnzyme        enzyme;
+  PMCleavageMap   *map;
+  PMSeqId         seqId;
+
+  LXFastaSequence *nucSeq, *prtSeq;
+
+  char aminoFilename[BUFSIZ],
+       enzymeFilename[BUFSIZ],
+       prefix[BUFSIZ],
+       buffer[BUFSIZ];
+
+  static char sNuc[] = "ACGT";
+
+  /* --------------------------------- */
+  /* setup default parameters          */
+
+  param.genomeLength      = DFT_GENOME_LENGTH;
+  param.nbChromosomes     = DFT_CHROMOSOMES;
+  param.nbSpectra         = DFT_SPECTRA;
+  param.nbTagsPerSpectrum = DFT_TAGS_PER_SPECT;
+  param.tagLength         = DFT_TAG_LENGTH;
+  param.decoys            = DFT_DECOYS;
+  param.nbNoisePeaks      = DFT_NOISE_PEAKS;
+  param.charge            = DFT_CHARGE;
+  param.verbose           = FALSE;
+
+  seed = DFT_SEED;
+
+  (void) strcpy(aminoFilename,  DFT_AA_FILENAME);
+  (void) strcpy(enzymeFilename, DFT_ENZ_FILENAME);
+
+  *prefix = '\000';
+
+  /* --------------------------------- */
+  /* get user's parameters             */
+
+  while ((opt = getopt(argc, argv, "a:c:e:g:hHk:n:o:p:r:t:vx:z:")) != -1) {
+
+    switch (opt) {
+
+      case 'a' :                                  // Amino-acid filename
+        (void) strcpy(aminoFilename, optarg);
+        break;
+
+      case 'c' :                                  // number of chromosomes
+        if (   (sscanf(optarg, "%d", &param.nbChromosomes) != 1)
+            || (param.nbChromosomes <= 0)) {
+          fprintf(stderr, "# Wrong value for number of chromosomes\n");
+          sUsage(LX_ARG_ERROR);
+        }
+        break;
+
+      case 'e' :                                  // Enzyme filename
+        (void) strcpy(enzymeFilename, optarg);
+        break;
+
+      case 'g' :                                  // genome length
+        if (   (sscanf(optarg, "%ld", &param.genomeLength) != 1)
+            || (param.genomeLength <= 0)) {
+          fprintf(stderr, "# Wrong value for genome length\n");
+          sUsage(LX_ARG_ERROR);
+        }
+        break;
+
+      case 'H' :                                  // help
+      case 'h' :
+        sHelp();
+        break;
+
+      case 'k' :                                  // tag length
+        if (   (sscanf(optarg, "%d", &param.tagLength) != 1)
+            || (param.tagLength <= 0)
+            || (param.tagLength > MAX_PEPTIDE_LEN - 2)) {
+          fprintf(stderr, "# Wrong value for tag length\n");
+          sUsage(LX_ARG_ERROR);
+        }
+        break;
+
+      case 'n' :                                  // number of spectra
+        if (   (sscanf(optarg, "%ld", &param.nbSpectra) != 1)
+            || (param.nbSpectra < 0)) {
+          fprintf(stderr, "# Wrong value for number of spectra\n");
+          sUsage(LX_ARG_ERROR);
+        }
+        break;
+
+      case 'o' :                                  // output prefix
+        (void) strcpy(prefix, optarg);
+        break;
+
+      case 'p' :                                  // noise peaks
+        if (   (sscanf(optarg, "%d", &param.nbNoisePeaks) != 1)
+            || (param.nbNoisePeaks < 0)) {
+          fprintf(stderr, "# Wrong value for number of noise peaks\n");
+          sUsage(LX_ARG_ERROR);
+        }
+        break;
+
+      case 'r' :                                  // random seed
+        if (sscanf(optarg, "%ld", &seed) != 1) {
+          fprintf(stderr, "# Wrong value for random seed\n");
+          sUsage(LX_ARG_ERROR);
+        }
+        break;
+
+      case 't' :                                  // tags per spectrum
+        if (   (sscanf(optarg, "%d", &param.nbTagsPerSpectrum) != 1)
+            || (param.nbTagsPerSpectrum <= 0)) {
+          fprintf(stderr, "# Wrong value for number of tags per spectrum\n");
+          sUsage(LX_ARG_ERROR);
+        }
+        break;
+
+      case 'v' :                                  // verbose mode
+        param.verbose = TRUE;
+        break;
+
+      case 'x' :                                  // decoys fraction
+        if (   (sscanf(optarg, "%f", &param.decoys) != 1)
+            || (param.decoys < 0) || (param.decoys > 1)) {
+          fprintf(stderr, "# Wrong value for decoys fraction\n");
+          sUsage(LX_ARG_ERROR);
+        }
+        break;
+
+      case 'z' :                                  // parent charge
+        if (   (sscanf(optarg, "%d", &param.charge) != 1)
+            || (param.charge <= 0)) {
+          fprintf(stderr, "# Wrong value for parent charge\n");
+          sUsage(LX_ARG_ERROR);
+        }
+        break;
+
+      case '?' :                                  // oops !
+        sUsage(LX_ARG_ERROR);
+        break;
+    }
+  }
+
+  /* --------------------------------- */
+  /* check parameters                  */
+
+  if (! *prefix) {
+    fprintf(stderr, "# You should provide an output prefix by using -o option\n");
+    sUsage(LX_ARG_ERROR);
+  }
+
+  if (PMLoadAminoAlphabet(aminoFilename, &alpha) != LX_NO_ERROR) {
+    fprintf(stderr,"# Cannot load alphabet from %s\n", aminoFilename);
+    exit(LX_IO_ERROR);
+  }
+
+  if (PMLoadEnzyme(enzymeFilename, &enzyme) != LX_NO_ERROR) {
+    fprintf(stderr,"# Cannot load digestion enzyme from %s\n", enzymeFilename);
+    exit(LX_IO_ERROR);
+  }
+
+  /* --------------------------------- */
+  /* start processing                  */
+
+  sStartupBanner(argc, argv);
+
+  sRandomSeed(seed);
+
+  dnaFile     = sOpenOutput(prefix, ".dna.fst");
+  prtFile     = sOpenOutput(prefix, ".fst");
+  out.pstFile = sOpenOutput(prefix, ".pst");
+  out.pklFile = sOpenOutput(prefix, ".pkl");
+
+  out.prefix    = LXBaseName(prefix, FALSE);
+  out.nbSpectra = 0;
+  out.nbTags    = 0;
+  out.alpha     = &alpha;
+  out.param     = &param;
+
+  nbDecoys  = (long) (param.decoys * param.nbSpectra + 0.5);
+  nbGenuine = param.nbSpectra - nbDecoys;
+
+  chrLength = MAX(3, param.genomeLength / param.nbChromosomes);
+
+  totAa = 0;
+  for (iframe = 0 ; iframe < 3 ; iframe++)
+    totAa += 2 * param.nbChromosomes * ((chrLength - iframe) / 3);
+
+  if (   (! (nucSeq = LXFastaNewSequence(chrLength + 1)))
+      || (! (prtSeq = LXFastaNewSequence(chrLength + 1)))
+      || (! (map = PMNewCleavageMap()))) {
+    fprintf(stderr,"# Not enough memory for %ld nt chromosomes\n", chrLength);
+    exit(LX_MEM_ERROR);
+  }
+
+  (void) fprintf(out.pstFile, "# Tags generated by PMSynth (seed %ld)\n", seed);
+
+  /* --------------------------------- */
+  /* chromosomes loop                  */
+  /* genuine peptides are spread over  */
+  /* frames proportionally to their    */
+  /* length                            */
+
+  nbAa = 0;
+
+  for (ichr = 0 ; ichr < param.nbChromosomes ; ichr++) {
+
+    for (i = 0 ; i < chrLength ; i++)
+      nucSeq->seq[i] = sNuc[sRandomInt(4)];
+
+    nucSeq->seq[chrLength] = '\000';
+    nucSeq->length = chrLength;
+
+    (void) sprintf(buffer, "synth_%d", ichr + 1);
+    nucSeq->name    = LXStrcpy(nucSeq->name, buffer);
+    nucSeq->comment = LXStrcpy(nucSeq->comment, "synthetic chromosome");
+
+    LXFastaWriteSequence(dnaFile, nucSeq, LX_FASTA_CHARS_PER_LINE);
+
+    (void) strcpy(seqId.name, nucSeq->name);
+    (void) strcpy(seqId.comment, nucSeq->comment);
+
+    seqId.length = nucSeq->length;
+
+    for (istrand = 0 ; istrand <= 1 ; istrand++) {
+
+      seqId.strand = strands[istrand];
+
+      for (iframe = 0 ; iframe < 3 ; iframe++) {
+
+        (void) strcpy(prtSeq->seq, nucSeq->seq + iframe);
+
+        LXBioSeqTranslate(prtSeq->seq, 0);
+
+        prtLength = prtSeq->length = (nucSeq->length - iframe) / 3;
+
+        seqId.frame = iframe + 1;
+
+        if (PMSeqId2Fasta(&seqId, prtSeq) != LX_NO_ERROR)
+          LX_ERROR("write format error", 10);
+
+        LXFastaWriteSequence(prtFile, prtSeq, LX_FASTA_CHARS_PER_LINE);
+
+        if (PMFillCleavageMap(map, &enzyme, prtSeq->seq, prtSeq->length) != LX_NO_ERROR) {
+          fprintf(stderr,"# Not enough memory for cleavage map\n");
+          exit(LX_MEM_ERROR);
+        }
+
+        quota = (long) ((double) nbGenuine * (nbAa + prtLength) / totAa)
+              - (long) ((double) nbGenuine * nbAa / totAa);
+
+        nbAa += prtLength;
+
+        if (sSamplePeptides(&out, prtSeq, map, quota) != LX_NO_ERROR) {
+          fprintf(stderr,"# Cannot write tags\n");
+          exit(LX_IO_ERROR);
+        }
+      }
+
+      if (istrand == 0)
+        (void) LXBioSeqReverseComplement(nucSeq->seq);
+    }
+  }
+
+  /* --------------------------------- */
+  /* decoy peptides                    */
+
+  if (sRandomPeptides(&out, nbDecoys) != LX_NO_ERROR) {
+    fprintf(stderr,"# Cannot write tags\n");
+    exit(LX_IO_ERROR);
+  }
+
+  if (param.verbose) {
+    fprintf(stderr, "# %d chromosome(s) of %ld nt written into : %s.dna.fst\n",
+                    param.nbChromosomes, chrLength, prefix);
+    fprintf(stderr, "# %ld spectra (%ld decoys) written into : %s.pkl\n",
+                    out.nbSpectra, nbDecoys, prefix);
+    fprintf(stderr, "# %ld tags written into : %s.pst\n", out.nbTags, prefix);
+  }
+
+  /* --------------------------------- */
+  /* done                              */
+
+  (void) fclose(dnaFile);
+  (void) fclose(prtFile);
+  (void) fclose(out.pstFile);
+  (void) fclose(out.pklFile);
+
+  (void) PMFreeCleavageMap(map);
+  (void) LXFastaFreeSequence(nucSeq);
+  (void) LXFastaFreeSequence(prtSeq);
+
+  exit(0);
+}
@@ -0,0 +1,142 @@
+/* -----------------------------------------------------------------------
+ * $Id: PMPipeline.c $
+ * -----------------------------------------------------------------------
+ * @file: PMPipeline.c
+ * @desc: PepMap in process PMMatch | PMClust pipeline
+ *
+ * @history:
+ * @+ <Gloup> : Oct 26 : first version
+ * @+ <Gloup> : Oct 26 : main returns int
+ * -----------------------------------------------------------------------
+ * @docstart:
+ *
+ * PepMap pipeline program <br>
+ * run PMMatch then PMClust in a single process :
+ * <pre>
+ *   PMPipeline [PMMatch options] -- [PMClust options]
+ * </pre>
+ * is the same as
+ * <pre>
+ *   PMMatch [PMMatch options] | PMClust [PMClust options]
+ * </pre>
+ * but hits are handed over to PMClust in memory (see PMHitSink)
+ * instead of being written then parsed back. chromosomes are
+ * translated on the fly with PMMatch -g (instead of PMTrans).
+ * PMMatch -o, -O, -w and PMClust -i options cannot be used.
+ *
+ * @docend:
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "LX.h"
+#include "PM.h"
+
+#include "PMPipeline.h"
+
+/* ----------------------------------------------- */
+/* command line arguments of a stage               */
+/* ----------------------------------------------- */
+
+typedef struct {
+  int  argc;
+  char **argv;
+} StageArgs;
+
+/* ----------------------------------------------- */
+static void sUsage(int err)
+{
+  fprintf(stderr,"Usage: PMPipeline [PMMatch options] -- [PMClust options]\n");
+  fprintf(stderr,"type PMPipeline -h for help\n");
+  exit(err);
+}
+
+/* ----------------------------------------------- */
+static void sHelp()
+{
+  fprintf(stderr,"Usage: PMPipeline [PMMatch options] -- [PMClust options]\n");
+  fprintf(stderr," run PMMatch then PMClust in a single process\n");
+  fprintf(stderr," same as : PMMatch [PMMatch options] | PMClust [PMClust options]\n");
+  fprintf(stderr," but hits are handed over to PMClust in memory\n");
+  fprintf(stderr," options:\n");
+  fprintf(stderr," -h               : print this help\n");
+  fprintf(stderr," PMMatch options  : see PMMatch -h\n");
+  fprintf(stderr,"                    (except -o, -O and -w)\n");
+  fprintf(stderr," PMClust options  : see PMClust -h\n");
+  fprintf(stderr,"                    (except -i, clusters are written\n");
+  fprintf(stderr,"                    into <stdout> or -o file)\n");
+  fprintf(stderr,"\n");
+  exit(0);
+}
+
+/* ----------------------------------------------- */
+/* hit source : run PMMatch                        */
+/* ----------------------------------------------- */
+
+static int sRunMatch(PMHitSink sink, Ptr sinkArg, Ptr arg)
+{
+  extern int optind;  /* externs for getopts (3C) */
+
+  StageArgs *match = (StageArgs *) arg;
+
+  optind = 1;      /* restart getopt on PMMatch arguments */
+
+  return MatchMain(match->argc, match->argv, sink, sinkArg);
+}
+
+/* ----------------------------------------------- */
+
+int main(int argc, char *argv[])
+{
+  int i, sep;
+
+  StageArgs match, clust;
+
+  /* -------------------------- */
+  /* split arguments at --      */
+
+  if ((argc > 1) && (! strcmp(argv[1], "-h") || ! strcmp(argv[1], "-H")))
+    sHelp();
+
+  for (sep = 1 ; sep < argc ; sep++) {
+    if (! strcmp(argv[sep], "--"))
+      break;
+  }
+
+  if (sep == 1)
+    sUsage(LX_ARG_ERROR);
+
+  if (! (   (match.argv = NEWN(char *, sep + 1))
+         && (clust.argv = NEWN(char *, MAX(1, argc - sep) + 1)))) {
+    fprintf(stderr,"# Not enough memory for arguments\n");
+    exit(LX_MEM_ERROR);
+  }
+
+  match.argc = clust.argc = 0;
+
+  match.argv[match.argc++] = argv[0];
+  clust.argv[clust.argc++] = argv[0];
+
+  for (i = 1 ; i < argc ; i++) {
+    if (i < sep)
+      match.argv[match.argc++] = argv[i];
+    else if (i > sep)
+      clust.argv[clust.argc++] = argv[i];
+  }
+
+  match.argv[match.argc] = NULL;
+  clust.argv[clust.argc] = NULL;
+
+  /* -------------------------- */
+  /* PMClust pulls hits from    */
+  /* PMMatch                    */
+
+  i = ClustMain(clust.argc, clust.argv, sRunMatch, (Ptr) &match);
+
+  FREE(match.argv);
+  FREE(clust.argv);
+
+  return i;
+}
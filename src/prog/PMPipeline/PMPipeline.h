@@ -0,0 +1,47 @@
+/* -----------------------------------------------------------------------
+ * $Id: PMPipeline.h $
+ * -----------------------------------------------------------------------
+ * @file: PMPipeline.h
+ * @desc: PMPipeline library
+ *
+ * @history:
+ * @+ <Gloup> : Oct 26 : first version
+ * -----------------------------------------------------------------------
+ * @docstart:
+ *
+ * PMPipeline library <br>
+ * PMMatch and PMClust entry points. PMMatch.h and PMClust.h cannot
+ * be both included (they both define Parameter), so that their
+ * prototypes are repeated here.
+ *
+ * @docend:
+ */
+
+#ifndef _H_PMPipeline
+#define _H_PMPipeline
+
+#ifndef _H_LX
+#include "LX.h"
+#endif
+
+#ifndef _H_PM
+#include "PM.h"
+#endif
+
+/* ----------------------------------------------- */
+/* prototypes                                      */
+/* ----------------------------------------------- */
+
+                /* ------------------------------------ */
+                /* ../PMMatch/PMMatchRun.c              */
+                /* ------------------------------------ */
+
+int MatchMain(int argc, char *argv[], PMHitSink sink, Ptr sinkArg);
+
+                /* ------------------------------------ */
+                /* ../PMClust/PMClustRun.c              */
+                /* ------------------------------------ */
+
+int ClustMain(int argc, char *argv[], PMHitSource source, Ptr sourceArg);
+
+#endif
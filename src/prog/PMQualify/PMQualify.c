@@ -0,0 +1,1027 @@
+/* -----------------------------------------------------------------------
+ * $Id: PMQualify.c $
+ * -----------------------------------------------------------------------
+ * @file: PMQualify.c
+ * @desc: qualify clusters according to CDS annotations
+ *
+ * @history:
+ * @+ <Gloup> : Oct 26 : first version (from LXQualifyCluster.awk)
+ * @+ <Gloup> : Oct 26 : documented difference with LXQualifyCluster.awk
+ * @+ <Gloup> : Oct 26 : main returns int, getopt declared
+ * @+ <Gloup> : Oct 26 : LXQualifyCluster.awk search by default, exhaustive
+ *                       search on option (-x)
+ * -----------------------------------------------------------------------
+ * @docstart:
+ *
+ * Cluster qualification program <br>
+ * read CDS features from a feature table (as produced by LXGffToTab.awk)
+ * and a PMClust cluster file, and classify each hit of each cluster as
+ * inside a CDS, crossing a CDS or outside any CDS.
+ * output has the format of LXQualifyCluster.awk : one line per protein
+ * (i.e. gene) touched by the cluster (or a single NONE line).
+ *
+ * by default, CDS are searched the way LXQualifyCluster.awk does, so
+ * that output is the same : all CDS are sorted by start, a dichotomic
+ * search locates the hit start, then CDS are scanned backward while
+ * they may reach the hit (start + longest CDS span) and forward up to
+ * the first CDS starting after the hit start only. A hit straddling
+ * the start of a further CDS is thus missed and counted as outside
+ * (or inside).
+ *
+ * with -x, the search is exhaustive : a hit is classified against
+ * all CDS it overlaps. hitin, hitcross, hitout (and thus status) may
+ * then differ from the awk script on real annotations.
+ *
+ * in both cases, CDS are kept, per contig, in an interval tree (a
+ * sorted array whose implicit balanced tree is augmented with the
+ * maximum CDS end of each subtree), so that each hit is classified
+ * in O(log(n) + k), k being the number of CDS it overlaps. the awk
+ * search then only drops the CDS beyond its forward scan.
+ *
+ * @docend:
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "LX.h"
+#include "PM.h"
+
+/* ----------------------------------------------- */
+/* constants                                       */
+/* ----------------------------------------------- */
+
+#define CLUSTER_KEY   "CLUSTER"
+#define END_KEY       "%EndOfCluster"
+
+/* ----------------------------------------------- */
+/* structures                                      */
+/* (name must come first, so that all these can    */
+/* be compared by sCompareNames)                   */
+/* ----------------------------------------------- */
+
+typedef struct {                /* protein (gene)               */
+  char     *name;
+  long     nbExons;             /* number of (distinct) CDS     */
+  long     nbClusters;          /* number of clusters hitting   */
+  long     mark;                /* last cluster hitting         */
+} Prot;
+
+typedef struct {                /* spectrum                     */
+  char     *name;
+  long     nbClusters;          /* number of clusters with it   */
+  long     mark;                /* last cluster with it         */
+} Spectrum;
+
+typedef struct {                /* contig                       */
+  char     *name;
+  LXStackp *exons;              /* Exon* sorted by from         */
+  long     *maxTo;              /* max exon end in subtree      */
+} Contig;
+
+typedef struct {                /* CDS (distinct contig/from/to) */
+  Contig   *contig;
+  long     from, to;
+  long     rank;                /* reading order (from 1)       */
+  long     index;               /* awk sorted order (from 1)    */
+  LXStackp *prots;              /* Prot*                        */
+  long     markIn;              /* last cluster with hit in     */
+  long     markCross;           /* last cluster with hit across */
+} Exon;
+
+typedef struct {                /* cluster qualification        */
+  char     *clusno;
+  char     *contig;
+  char     strand[8];
+  long     from, to;
+  long     nbHits, nbPep;
+  long     nbHitIn, nbHitCross, nbHitOut;
+  LXStackp *spectra;            /* Spectrum*                    */
+  LXStackp *prots;              /* Prot*                        */
+  LXStackp *cdsIn;              /* Exon*                        */
+  LXStackp *cdsCross;           /* Exon*                        */
+} Qualif;
+
+typedef struct {                /* all features                 */
+  LXDict   *contigs;            /* Contig*                      */
+  LXDict   *prots;              /* Prot*                        */
+  LXDict   *exonDict;           /* Exon*                        */
+  LXStackp *exons;              /* Exon* in reading order       */
+  Exon     **sorted;            /* all Exon* sorted as awk does */
+} Features;
+
+/* ----------------------------------------------- */
+static void sStartupBanner(int argc, char *argv[])
+{
+  int i;
+  fprintf(stderr,"# ------------------------------\n");
+  fprintf(stderr,"# PepMap PMQualify v %s\n", VERSION);
+  fprintf(stderr,"#\n");
+  fprintf(stderr,"# Qualify clusters according\n");
+  fprintf(stderr,"# to CDS annotations\n");
+  fprintf(stderr,"# ------------------------------\n");
+  fprintf(stderr,"# run: ");
+  for (i = 0 ; i < argc ; i++)
+    fprintf(stderr,"%s ", argv[i]);
+  fprintf(stderr,"\n");
+  fprintf(stderr,"# ------------------------------\n");
+}
+
+/* ----------------------------------------------- */
+static void sUsage(int err)
+{
+  fprintf(stderr,"Usage: PMQualify [options]\n");
+  fprintf(stderr,"type PMQualify -h for help\n");
+  exit(err);
+}
+
+/* ----------------------------------------------- */
+static void sHelp()
+{
+  fprintf(stderr,"Usage: PMQualify [options]\n");
+  fprintf(stderr," options:\n");
+  fprintf(stderr," -f featFile      : CDS features filename (mandatory)\n");
+  fprintf(stderr,"                    (as produced by LXGffToTab.awk)\n");
+  fprintf(stderr," -h               : print this help\n");
+  fprintf(stderr," -i clustFile     : input clusters filename (as produced by PMClust)\n");
+  fprintf(stderr,"                    (default = <stdin>)\n");
+  fprintf(stderr," -o qualFile      : output qualification filename\n");
+  fprintf(stderr,"                    (default = <stdout>)\n");
+  fprintf(stderr," -v               : verbose mode (report clusters on stderr)\n");
+  fprintf(stderr,"                    (default = off)\n");
+  fprintf(stderr," -x               : exhaustive CDS search : a hit straddling the start\n");
+  fprintf(stderr,"                    of a CDS is counted as crossing it\n");
+  fprintf(stderr,"                    (default = off : same search, and output, as\n");
+  fprintf(stderr,"                    LXQualifyCluster.awk, that may miss such CDS)\n");
+  fprintf(stderr,"\n");
+  fprintf(stderr," output format: one line per protein hit by cluster\n");
+  fprintf(stderr,"   clusno contig strand from to totspec typspec tothit hitin hitcross\n");
+  fprintf(stderr,"   hitout totpep totprot prot totclus protcds cdsin cdscross status\n");
+  fprintf(stderr,"\n");
+  exit(0);
+}
+
+/* ----------------------------------------------- */
+/* compare (Prot, Spectrum, Contig) names          */
+/* ----------------------------------------------- */
+
+static int sCompareNames(const void *p1, const void *p2)
+{
+  return strcmp(*((char **) p1), *((char **) p2));
+}
+
+/* ----------------------------------------------- */
+/* compare exons on contig, from, to               */
+/* ----------------------------------------------- */
+
+static int sCompareExons(const void *p1, const void *p2)
+{
+  Exon *e1 = (Exon *) p1;
+  Exon *e2 = (Exon *) p2;
+
+  int cmp;
+
+  if ((e1->contig != e2->contig) && ((cmp = strcmp(e1->contig->name, e2->contig->name)) != 0))
+    return cmp;
+
+  if (e1->from != e2->from)
+    return ((e1->from < e2->from) ? -1 : 1);
+
+  if (e1->to != e2->to)
+    return ((e1->to < e2->to) ? -1 : 1);
+
+  return 0;
+}
+
+/* ----------------------------------------------- */
+/* sort Exon* on from, to (stable)                 */
+/* ----------------------------------------------- */
+
+static int sSortExons(const void *p1, const void *p2)
+{
+  return sCompareExons(*((Exon **) p1), *((Exon **) p2));
+}
+
+/* ----------------------------------------------- */
+/* sort Exon* as LXQualifyCluster.awk does : on    */
+/* from, then on rank compared as strings          */
+/* ----------------------------------------------- */
+
+static int sSortAwkExons(const void *p1, const void *p2)
+{
+  Exon *e1 = *((Exon **) p1);
+  Exon *e2 = *((Exon **) p2);
+
+  char r1[32], r2[32];
+
+  if (e1->from != e2->from)
+    return ((e1->from < e2->from) ? -1 : 1);
+
+  (void) sprintf(r1, "%ld", e1->rank);
+  (void) sprintf(r2, "%ld", e2->rank);
+
+  return strcmp(r1, r2);
+}
+
+/* ----------------------------------------------- */
+/* sort Exon* on awk index                         */
+/* ----------------------------------------------- */
+
+static int sSortAwkIndex(const void *p1, const void *p2)
+{
+  long i1 = (*((Exon **) p1))->index;
+  long i2 = (*((Exon **) p2))->index;
+
+  return (i1 < i2 ? -1 : (i1 > i2 ? 1 : 0));
+}
+
+/* ----------------------------------------------- */
+/* free functions                                  */
+/* ----------------------------------------------- */
+
+static void sFreeProt(void *p)
+{
+  Prot *prot = (Prot *) p;
+  IFFREE(prot->name);
+  FREE(prot);
+}
+
+static void sFreeSpectrum(void *p)
+{
+  Spectrum *spectrum = (Spectrum *) p;
+  IFFREE(spectrum->name);
+  FREE(spectrum);
+}
+
+static void sFreeContig(void *p)
+{
+  Contig *contig = (Contig *) p;
+  IFFREE(contig->name);
+  IFFREE(contig->maxTo);
+  if (contig->exons)
+    (void) LXFreeStackp(contig->exons, NULL);
+  FREE(contig);
+}
+
+static void sFreeExon(Ptr p)
+{
+  Exon *exon = (Exon *) p;
+  if (exon->prots)
+    (void) LXFreeStackp(exon->prots, NULL);
+  FREE(exon);
+}
+
+static void sFreeQualif(Ptr p)
+{
+  Qualif *qualif = (Qualif *) p;
+  IFFREE(qualif->clusno);
+  IFFREE(qualif->contig);
+  if (qualif->spectra)  (void) LXFreeStackp(qualif->spectra, NULL);
+  if (qualif->prots)    (void) LXFreeStackp(qualif->prots, NULL);
+  if (qualif->cdsIn)    (void) LXFreeStackp(qualif->cdsIn, NULL);
+  if (qualif->cdsCross) (void) LXFreeStackp(qualif->cdsCross, NULL);
+  FREE(qualif);
+}
+
+/* ----------------------------------------------- */
+/* get named entry from dictionary or make a new   */
+/* one (of size sizeEntry, zeroed)                 */
+/* ----------------------------------------------- */
+
+static void *sGetNamed(LXDict *dict, char *name, size_t sizeEntry)
+{
+  char **entry;
+
+  if ((entry = (char **) LXGetDict(dict, &name)))
+    return entry;
+
+  if (! (entry = (char **) LXMalloc(sizeEntry))) {
+    MEMORY_ERROR();
+    return NULL;
+  }
+
+  (void) memset(entry, 0, sizeEntry);
+
+  if (! (*entry = LXStr(name))) {
+    MEMORY_ERROR();
+    FREE(entry);
+    return NULL;
+  }
+
+  (void) LXAddDict(dict, entry);
+
+  return entry;
+}
+
+/* ----------------------------------------------- */
+/* push p into stack if not yet there              */
+/* (stacks are small : linear search)              */
+/* ----------------------------------------------- */
+
+static Bool sAddUnique(LXStackp *stack, Ptr p)
+{
+  size_t i;
+
+  for (i = 0 ; i < stack->top ; i++)
+    if (stack->val[i] == p)
+      return TRUE;
+
+  return LXPushpIn(stack, p);
+}
+
+/* ----------------------------------------------- */
+/* build interval tree of contig in [lo, hi[       */
+/* node is (lo + hi) / 2, maxTo[node] is the max   */
+/* end of exons in subtree. returns maxTo[node]    */
+/* ----------------------------------------------- */
+
+static long sBuildTree(Contig *contig, long lo, long hi)
+{
+  long mid, maxTo, subTo;
+
+  if (lo >= hi)
+    return -1;
+
+  mid = (lo + hi) / 2;
+
+  maxTo = ((Exon *) contig->exons->val[mid])->to;
+
+  if ((subTo = sBuildTree(contig, lo, mid)) > maxTo)
+    maxTo = subTo;
+
+  if ((subTo = sBuildTree(contig, mid + 1, hi)) > maxTo)
+    maxTo = subTo;
+
+  return (contig->maxTo[mid] = maxTo);
+}
+
+/* ----------------------------------------------- */
+/* query interval tree of contig in [lo, hi[ for   */
+/* exons overlapping [from, to]. exons containing  */
+/* [from, to] are pushed into resIn, other ones    */
+/* into resCross (both in from order)              */
+/* ----------------------------------------------- */
+
+static void sQueryTree(Contig *contig, long lo, long hi, long from, long to,
+                       LXStackp *resIn, LXStackp *resCross)
+{
+  long mid;
+  Exon *exon;
+
+  while (lo < hi) {
+
+    mid = (lo + hi) / 2;
+
+    if (contig->maxTo[mid] < from)     /* whole subtree ends before */
+      return;
+
+    sQueryTree(contig, lo, mid, from, to, resIn, resCross);
+
+    exon = (Exon *) contig->exons->val[mid];
+
+    if (exon->from > to)               /* node and right subtree    */
+      return;                          /* start after               */
+
+    if (exon->to >= from) {
+      if ((exon->from <= from) && (exon->to >= to))
+        (void) LXPushpIn(resIn, (Ptr) exon);
+      else
+        (void) LXPushpIn(resCross, (Ptr) exon);
+    }
+
+    lo = mid + 1;                      /* right subtree             */
+  }
+}
+
+/* ----------------------------------------------- */
+/* keep exons of stack with awk index <= last, in  */
+/* awk index order                                 */
+/* ----------------------------------------------- */
+
+static void sKeepAwkExons(LXStackp *stack, long last)
+{
+  size_t i, n;
+
+  for (i = n = 0 ; i < stack->top ; i++)
+    if (((Exon *) stack->val[i])->index <= last)
+      stack->val[n++] = stack->val[i];
+
+  stack->top = n;
+
+  LXSortStackp(stack, sSortAwkIndex);
+}
+
+/* ----------------------------------------------- */
+/* search exons of contig overlapping [from, to]   */
+/* as LXQualifyCluster.awk (mysearch) does : the   */
+/* awk dichotomic search of from among all exons   */
+/* sorted, then forward scan up to the first exon  */
+/* starting after from (last). the awk backward    */
+/* scan (while exons may reach from) misses none,  */
+/* so that the exons found are the ones of the     */
+/* interval tree with awk index <= last.           */
+/* exons containing [from, to] are pushed into     */
+/* resIn, other ones into resCross                 */
+/* (awk indices, from 1)                           */
+/* ----------------------------------------------- */
+
+static void sScanExons(Features *feat, Contig *contig, long from, long to,
+                       LXStackp *resIn, LXStackp *resCross)
+{
+  long n, low, hig, cur, last;
+  Exon **sorted;
+
+  n      = (long) feat->exons->top;
+  sorted = feat->sorted;
+
+  low = 1;
+  hig = n;
+  cur = 0;                              /* awk : unset */
+
+  while ((hig - low) > 1) {
+    cur = (low + hig) / 2;
+    if (sorted[cur - 1]->from == from)
+      break;
+    if (sorted[cur - 1]->from < from)
+      low = cur;
+    else
+      hig = cur;
+  }
+
+  for (last = cur ; (last <= n) && ((last < 1) || (sorted[last - 1]->from <= from)) ; last++)
+    /* nop */ ;
+
+  sQueryTree(contig, 0, (long) contig->exons->top, from, to, resIn, resCross);
+
+  sKeepAwkExons(resIn, last);
+  sKeepAwkExons(resCross, last);
+}
+
+/* ----------------------------------------------- */
+/* read CDS features                               */
+/* format : feat contig from to strand phase len   */
+/*          gene                                   */
+/* (first line is a header, gene may be missing)   */
+/* ----------------------------------------------- */
+
+static int sReadFeatures(FILE *streamin, Features *feat)
+{
+  long    from, to, nbCds;
+  size_t  i;
+  Exon    key, *exon;
+  Prot    *prot;
+  Contig  *contig;
+  LXArray *contigs;
+  char    buffer[BUFSIZ], type[BUFSIZ], name[BUFSIZ], gene[BUFSIZ];
+
+  if (! LXGetRawLine(buffer, sizeof(buffer), streamin))
+    return FIO_ERROR("cannot read feature file header");
+
+  nbCds = 0;
+
+  while (LXGetLine(buffer, sizeof(buffer), streamin)) {
+
+    *gene = '\000';
+
+    if (   (sscanf(buffer, "%s%s%ld%ld%*s%*s%*s%s", type, name, &from, &to, gene) < 4)
+        || strcmp(type, "CDS"))
+      continue;
+
+    nbCds++;
+
+    if (! (contig = (Contig *) sGetNamed(feat->contigs, name, sizeof(Contig))))
+      return LX_MEM_ERROR;
+
+    if ((! contig->exons) && (! (contig->exons = LXNewStackp(LX_STKP_MIN_SIZE))))
+      return MEMORY_ERROR();
+
+    key.contig = contig;
+    key.from   = from;
+    key.to     = to;
+
+    // same CDS in several genes : single exon with several prots
+
+    if (! (exon = (Exon *) LXGetDict(feat->exonDict, &key))) {
+
+      if (! (exon = NEW(Exon)))
+        return MEMORY_ERROR();
+
+      *exon = key;
+      exon->rank   = (long) feat->exons->top + 1;
+      exon->markIn = exon->markCross = 0;
+
+      if (! (   (exon->prots = LXNewStackp(LX_STKP_MIN_SIZE))
+             && LXPushpIn(feat->exons, (Ptr) exon)
+             && LXPushpIn(contig->exons, (Ptr) exon)))
+        return MEMORY_ERROR();
+
+      (void) LXAddDict(feat->exonDict, exon);
+    }
+
+    if (*gene == '\000')
+      continue;
+
+    if (! (prot = (Prot *) sGetNamed(feat->prots, gene, sizeof(Prot))))
+      return LX_MEM_ERROR;
+
+    if (! sAddUnique(exon->prots, (Ptr) prot))
+      return MEMORY_ERROR();
+  }
+
+  // sort exons and build interval trees
+
+  if (! (contigs = LXDictToArray(feat->contigs)))
+    return MEMORY_ERROR();
+
+  for (i = 0 ; i < contigs->nbelt ; i++) {
+
+    contig = ((Contig **) contigs->data)[i];
+
+    LXSortStackp(contig->exons, sSortExons);
+
+    if (! (contig->maxTo = NEWN(long, contig->exons->top + 1))) {
+      (void) LXFreeArray(contigs);
+      return MEMORY_ERROR();
+    }
+
+    (void) sBuildTree(contig, 0, (long) contig->exons->top);
+  }
+
+  (void) LXFreeArray(contigs);
+
+  // all exons sorted for awk search
+
+  if (! (feat->sorted = NEWN(Exon *, feat->exons->top + 1)))
+    return MEMORY_ERROR();
+
+  for (i = 0 ; i < feat->exons->top ; i++)
+    feat->sorted[i] = (Exon *) feat->exons->val[i];
+
+  qsort(feat->sorted, feat->exons->top, sizeof(Exon *), sSortAwkExons);
+
+  for (i = 0 ; i < feat->exons->top ; i++)
+    feat->sorted[i]->index = (long) i + 1;
+
+  // count distinct exons per prot
+
+  for (i = 0 ; i < feat->exons->top ; i++) {
+    size_t j;
+    exon = (Exon *) feat->exons->val[i];
+    for (j = 0 ; j < exon->prots->top ; j++)
+      ((Prot *) exon->prots->val[j])->nbExons++;
+  }
+
+  fprintf(stderr, "# Nb CDS read : %ld (%ld distinct)\n", nbCds, (long) feat->exons->top);
+
+  return LX_NO_ERROR;
+}
+
+/* ----------------------------------------------- */
+/* add prot to cluster (once)                      */
+/* ----------------------------------------------- */
+
+static Bool sAddProt(Qualif *qualif, Prot *prot, long nclust)
+{
+  if (prot->mark == nclust)
+    return TRUE;
+
+  prot->mark = nclust;
+  prot->nbClusters++;
+
+  return LXPushpIn(qualif->prots, (Ptr) prot);
+}
+
+/* ----------------------------------------------- */
+/* add exons in res to cluster exons cds (once,    */
+/* using mark), together with their prots          */
+/* ----------------------------------------------- */
+
+static Bool sAddExons(Qualif *qualif, LXStackp *res, LXStackp *cds,
+                      Bool isIn, long nclust)
+{
+  size_t i, j;
+  long   *mark;
+  Exon   *exon;
+
+  for (i = 0 ; i < res->top ; i++) {
+
+    exon = (Exon *) res->val[i];
+
+    mark = (isIn ? &exon->markIn : &exon->markCross);
+
+    if (*mark != nclust) {
+      *mark = nclust;
+      if (! LXPushpIn(cds, (Ptr) exon))
+        return FALSE;
+    }
+
+    for (j = 0 ; j < exon->prots->top ; j++)
+      if (! sAddProt(qualif, (Prot *) exon->prots->val[j], nclust))
+        return FALSE;
+  }
+
+  return TRUE;
+}
+
+/* ----------------------------------------------- */
+/* new cluster qualification                       */
+/* ----------------------------------------------- */
+
+static Qualif *sNewQualif(char *clusno, long nbHits, long nbPep)
+{
+  Qualif *qualif;
+
+  if (! (qualif = NEW(Qualif))) {
+    MEMORY_ERROR();
+    return NULL;
+  }
+
+  (void) memset(qualif, 0, sizeof(Qualif));
+
+  qualif->nbHits = nbHits;
+  qualif->nbPep  = nbPep;
+
+  if (! (   (qualif->clusno   = LXStr(clusno))
+         && (qualif->contig   = LXStr(""))
+         && (qualif->spectra  = LXNewStackp(LX_STKP_MIN_SIZE))
+         && (qualif->prots    = LXNewStackp(LX_STKP_MIN_SIZE))
+         && (qualif->cdsIn    = LXNewStackp(LX_STKP_MIN_SIZE))
+         && (qualif->cdsCross = LXNewStackp(LX_STKP_MIN_SIZE)))) {
+    MEMORY_ERROR();
+    sFreeQualif(qualif);
+    return NULL;
+  }
+
+  return qualif;
+}
+
+/* ----------------------------------------------- */
+/* read clusters                                   */
+/* format (see PMClust) : for each cluster         */
+/*   CLUSTER clusno nbhits nbfull nbpep score      */
+/*   { seqId line, tag line, hit line }            */
+/*   %EndOfCluster                                 */
+/* ----------------------------------------------- */
+
+static int sReadClusters(FILE *streamin, Features *feat, LXDict *spectra,
+                         LXStackp *qualifs, Bool exhaustive, Bool verbose)
+{
+  int      state;
+  Bool     first;
+  long     nclust, from, to, nbHits, nbPep;
+  char     *dot;
+  Contig   *contig;
+  Spectrum *spectrum;
+  Qualif   *qualif;
+  LXStackp *resIn, *resCross;
+  char     buffer[BUFSIZ], name[BUFSIZ], *pname;
+
+  if (! (   (resIn    = LXNewStackp(LX_STKP_MIN_SIZE))
+         && (resCross = LXNewStackp(LX_STKP_MIN_SIZE))))
+    return MEMORY_ERROR();
+
+  state  = 0;
+  nclust = 0;
+  qualif = NULL;
+  contig = NULL;
+  pname  = name;
+
+  while (LXGetLine(buffer, sizeof(buffer), streamin)) {
+
+                                        /* ------------ */
+    if (! strncmp(buffer, CLUSTER_KEY,  /* new cluster  */
+                  strlen(CLUSTER_KEY))) {
+                                        /* ------------ */
+      if (verbose)
+        fprintf(stderr, "# %s", buffer);
+
+      nbHits = nbPep = 0;
+
+      (void) sscanf(buffer, "%*s%s%ld%*s%ld", name, &nbHits, &nbPep);
+
+      if (! (   (qualif = sNewQualif(name, nbHits, nbPep))
+             && LXPushpIn(qualifs, (Ptr) qualif)))
+        return MEMORY_ERROR();
+
+      nclust++;
+      state = 1;
+      continue;
+    }
+                                        /* ------------ */
+    if (! strncmp(buffer, END_KEY,      /* end cluster  */
+                  strlen(END_KEY))) {
+                                        /* ------------ */
+      state = 0;
+      continue;
+    }
+                                        /* ------------ */
+    if (state == 1) {                   /* seqId line   */
+                                        /* ------------ */
+      if (sscanf(buffer, "%s%7s", name, qualif->strand) != 2)
+        return FIO_ERROR("invalid sequence line in cluster file");
+
+      if (strcmp(name, qualif->contig)) {
+        FREE(qualif->contig);
+        if (! (qualif->contig = LXStr(name)))
+          return MEMORY_ERROR();
+        contig = (Contig *) LXGetDict(feat->contigs, &pname);
+      }
+
+      state = 2;
+      continue;
+    }
+                                        /* ------------ */
+    if (state == 2) {                   /* tag line     */
+                                        /* ------------ */
+      if (sscanf(buffer, "%s", name) != 1)
+        return FIO_ERROR("invalid tag line in cluster file");
+
+      if ((dot = strchr(name, '.')))    /* spectrum name is tag id */
+        *dot = '\000';                  /* up to first dot         */
+
+      if (! (spectrum = (Spectrum *) sGetNamed(spectra, name, sizeof(Spectrum))))
+        return LX_MEM_ERROR;
+
+      if (spectrum->mark != nclust) {
+        spectrum->mark = nclust;
+        spectrum->nbClusters++;
+        if (! LXPushpIn(qualif->spectra, (Ptr) spectrum))
+          return MEMORY_ERROR();
+      }
+
+      state = 3;
+      continue;
+    }
+                                        /* ------------ */
+    if (state == 3) {                   /* hit line     */
+                                        /* ------------ */
+      if (   ((*buffer != 'F') && (*buffer != 'P'))
+          || (sscanf(buffer, "%*s%ld%ld", &from, &to) != 2))
+        return FIO_ERROR("invalid hit line in cluster file");
+
+      first = (qualif->nbHitIn + qualif->nbHitCross + qualif->nbHitOut == 0);
+
+      if (first || (from < qualif->from))
+        qualif->from = from;
+
+      if (first || (to > qualif->to))
+        qualif->to = to;
+
+      resIn->top = resCross->top = 0;
+
+      if (contig && exhaustive)
+        sQueryTree(contig, 0, (long) contig->exons->top, from, to, resIn, resCross);
+      else if (contig)
+        sScanExons(feat, contig, from, to, resIn, resCross);
+
+      if (resIn->top > 0) {
+        if (! sAddExons(qualif, resIn, qualif->cdsIn, TRUE, nclust))
+          return MEMORY_ERROR();
+        qualif->nbHitIn++;
+      }
+      else if (resCross->top > 0) {
+        if (! sAddExons(qualif, resCross, qualif->cdsCross, FALSE, nclust))
+          return MEMORY_ERROR();
+        qualif->nbHitCross++;
+      }
+      else {
+        qualif->nbHitOut++;
+      }
+
+      state = 1;
+      continue;
+    }
+  }
+
+  (void) LXFreeStackp(resIn, NULL);
+  (void) LXFreeStackp(resCross, NULL);
+
+  return LX_NO_ERROR;
+}
+
+/* ----------------------------------------------- */
+/* count exons in cds belonging to prot            */
+/* ----------------------------------------------- */
+
+static long sCountProtExons(LXStackp *cds, Prot *prot)
+{
+  size_t i, j;
+  long   count;
+  Exon   *exon;
+
+  count = 0;
+
+  for (i = 0 ; i < cds->top ; i++) {
+    exon = (Exon *) cds->val[i];
+    for (j = 0 ; j < exon->prots->top ; j++) {
+      if (exon->prots->val[j] == (Ptr) prot) {
+        count++;
+        break;
+      }
+    }
+  }
+
+  return count;
+}
+
+/* ----------------------------------------------- */
+/* print cluster qualification                     */
+/* (one line per prot or a single NONE line)       */
+/* ----------------------------------------------- */
+
+static void sPrintQualif(FILE *streamou, Qualif *qualif)
+{
+  size_t i;
+  long   ntypic;
+  Prot   *prot;
+  char   info[BUFSIZ], *level;
+
+  ntypic = 0;
+
+  for (i = 0 ; i < qualif->spectra->top ; i++)
+    if (((Spectrum *) qualif->spectra->val[i])->nbClusters <= 1)
+      ntypic++;
+
+  (void) sprintf(info, "%s %s %s %ld %ld %ld %ld %ld %ld %ld %ld %ld %ld",
+                 qualif->clusno, qualif->contig, qualif->strand,
+                 qualif->from, qualif->to,
+                 (long) qualif->spectra->top, ntypic,
+                 qualif->nbHits, qualif->nbHitIn,
+                 qualif->nbHitCross, qualif->nbHitOut,
+                 qualif->nbPep, (long) qualif->prots->top);
+
+  level = ((ntypic < 2)          ? "DUBIOUS"
+        : ((qualif->nbPep < 3)   ? "POSSIBLE"
+        :                          "SURE"));
+
+  for (i = 0 ; i < qualif->prots->top ; i++) {
+
+    prot = (Prot *) qualif->prots->val[i];
+
+    fprintf(streamou, "%s %s %ld %ld %ld %ld ANNOTATED_%s_%s\n",
+            info, prot->name, prot->nbClusters, prot->nbExons,
+            sCountProtExons(qualif->cdsIn, prot),
+            sCountProtExons(qualif->cdsCross, prot),
+            level,
+            ((qualif->nbHits == qualif->nbHitIn) ? "OK" : "CHECK"));
+  }
+
+  if (qualif->prots->top == 0)
+    fprintf(streamou, "%s NONE 0 0 0 0 UNANNOTATED_%s_CHECK\n", info, level);
+}
+
+/* ----------------------------------------------- */
+
+int main(int argc, char *argv[])
+{
+  int  opt, stat;
+
+  size_t i;
+
+  Bool verbose, exhaustive;
+
+  FILE *featFile;
+
+  Features feat;
+
+  LXDict *spectra;
+
+  LXStackp *qualifs;
+
+  char featFileName[BUFSIZ];
+  char inputFileName[BUFSIZ];
+  char outputFileName[BUFSIZ];
+
+  extern char *optarg;  /* externs for getopts (3C) */
+
+  /* -------------------------- */
+  /* setup default parameters   */
+
+  verbose         = FALSE;
+  exhaustive      = FALSE;
+  *featFileName   ='\000';
+  *inputFileName  ='\000';
+  *outputFileName ='\000';
+
+  /* -------------------------- */
+  /* get user's parameters      */
+
+  while ((opt = getopt(argc, argv, "f:hHi:o:vx")) != -1) {
+
+    switch (opt) {
+
+      case 'f' :                                  // feature file
+        (void) strcpy(featFileName, optarg);
+        break;
+
+      case 'H' :                                  // help
+      case 'h' :
+        sHelp();
+        break;
+
+      case 'i' :                                  // input file
+        (void) strcpy(inputFileName, optarg);
+        if(! LXAssignToStdin(inputFileName)) {
+          fprintf(stderr,"Cannot open : %s\n", inputFileName);
+          exit (LX_IO_ERROR);
+        }
+        break;
+
+      case 'o' :                                  // output file
+        (void) strcpy(outputFileName, optarg);
+        if (! LXAssignToStdout(outputFileName)) {
+          fprintf(stderr,"Cannot create : %s\n", outputFileName);
+          exit (LX_IO_ERROR);
+        }
+        break;
+
+      case 'v' :                                  // verbose mode
+        verbose = TRUE;
+        break;
+
+      case 'x' :                                  // exhaustive search
+        exhaustive = TRUE;
+        break;
+
+      case '?' :                                  // oops !
+        sUsage(LX_ARG_ERROR);
+        break;
+      }
+  }
+
+  if (! *featFileName) {
+    fprintf(stderr,"# Missing feature file (-f)\n");
+    sUsage(LX_ARG_ERROR);
+  }
+
+  /* -------------------------- */
+  /* start processing           */
+
+  sStartupBanner(argc, argv);
+
+  if (! (featFile = fopen(featFileName, "r"))) {
+    fprintf(stderr,"Cannot open : %s\n", featFileName);
+    exit(LX_IO_ERROR);
+  }
+
+  feat.contigs  = LXNewDict(sCompareNames);
+  feat.prots    = LXNewDict(sCompareNames);
+  feat.exonDict = LXNewDict(sCompareExons);
+  feat.exons    = LXNewStackp(LX_STKP_MIN_SIZE);
+  feat.sorted   = NULL;
+
+  spectra       = LXNewDict(sCompareNames);
+  qualifs       = LXNewStackp(LX_STKP_MIN_SIZE);
+
+  if (! (feat.contigs && feat.prots && feat.exonDict && feat.exons
+         && spectra && qualifs)) {
+    fprintf(stderr,"# Not enough memory\n");
+    exit(LX_MEM_ERROR);
+  }
+
+  /* -------------------------- */
+  /* read CDS features          */
+
+  fprintf(stderr,"# Reading CDS from %s\n", featFileName);
+
+  if ((stat = sReadFeatures(featFile, &feat)) != LX_NO_ERROR) {
+    fprintf(stderr,"# Cannot read features\n");
+    exit(stat);
+  }
+
+  (void) fclose(featFile);
+
+  /* -------------------------- */
+  /* qualify clusters           */
+  /* (spectra and prots counts  */
+  /* are known at end only)     */
+
+  if ((stat = sReadClusters(stdin, &feat, spectra, qualifs, exhaustive, verbose)) != LX_NO_ERROR) {
+    fprintf(stderr,"# Cannot read clusters\n");
+    exit(stat);
+  }
+
+  printf("#clusno contig strand from to totspec typspec tothit hitin hitcross ");
+  printf("hitout totpep totprot prot totclus protcds cdsin cdscross status\n");
+
+  for (i = 0 ; i < qualifs->top ; i++)
+    sPrintQualif(stdout, (Qualif *) qualifs->val[i]);
+
+  if (verbose)
+    fprintf(stderr, "# %ld clusters qualified\n", (long) qualifs->top);
+
+  /* ------------------- */
+  /* end of program      */
+
+  (void) LXFreeStackp(qualifs, sFreeQualif);
+  (void) LXFreeDict(spectra, sFreeSpectrum);
+  IFFREE(feat.sorted);
+  (void) LXFreeStackp(feat.exons, sFreeExon);
+  (void) LXFreeDict(feat.exonDict, NULL);
+  (void) LXFreeDict(feat.prots, sFreeProt);
+  (void) LXFreeDict(feat.contigs, sFreeContig);
+
+  return 0;
+}
@@ -9,10 +9,17 @@
  * @+ <Wanou> : Jan 02 : revision & adaptation to PepMap 
  * @+ <Wanou> : Mar 02 : last revision to being included in PepMap release v1.0
  * @+ <Gloup> : Jul 06 : code revision          
+ * @+ <Gloup> : Oct 26 : table driven, multithreaded translation
  * -----------------------------------------------------------------------
  * @docstart: 
  *
  * Chromosome translation program <br>
+ * sequences are read by batches. Each sequence is encoded once
+ * (see LXBioSeqEncode) and its 6 frames are translated through
+ * codon tables (see LXBioCodonTable), reverse frames being read
+ * backward on the direct strand. Encoding and translation are
+ * split into chunks processed by a pool of threads (-j), then
+ * frames are written in the original order.
  *
  * @docend:
  */
@@ -21,9 +28,64 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include <pthread.h>
+
 #include "LX.h"
 #include "PM.h"
 
+/* sequences are read by batches of at most BATCH_SEQS     */
+/* sequences and BATCH_NT nucleotides (or a single larger   */
+/* sequence)                                                */
+
+#define BATCH_SEQS  4096
+#define BATCH_NT    (1L << 24)
+
+/* frames of a batch are translated by rounds of at most    */
+/* ROUND_AA amino acids (or a single larger frame)          */
+
+#define ROUND_AA    (1L << 24)
+
+/* size of thread jobs (nucleotides or codons)              */
+
+#define CHUNK       (1L << 20)
+
+/* ----------------------------------------------- */
+/* translation job : encode nucleotides [from, to[ */
+/* or translate codons [from, to[ of frame         */
+/* ----------------------------------------------- */
+
+typedef struct {
+  char  *codes;
+  long  length;
+  int   frame;
+  Bool  reverse;
+  char  *table;
+  char  *prot;
+  long  from, to;
+} TransJob;
+
+/* ----------------------------------------------- */
+/* jobs pool                                       */
+/* ----------------------------------------------- */
+
+typedef struct {
+  TransJob        *jobs;
+  long            nbJobs;
+  long            capacity;
+  long            next;
+  void            (*run) (TransJob *job);
+  pthread_mutex_t lock;
+} JobPool;
+
+/* ----------------------------------------------- */
+/* batch sequence                                  */
+/* ----------------------------------------------- */
+
+typedef struct {
+  LXFastaSequence *nucSeq;
+  PMSeqId         seqId;
+} TransSeq;
+
 /* ----------------------------------------------- */
 static void sStartupBanner(int argc, char *argv[])
 {
@@ -65,6 +127,8 @@ static void sHelp()
   fprintf(stderr," -i fastaFile     : input chromosome(s) filename (fasta format)\n");
   fprintf(stderr,"                    (default = <stdin>)\n");
   fprintf(stderr,"                    note: may contain more than one sequence\n");
+  fprintf(stderr," -j threads       : number of threads\n");
+  fprintf(stderr,"                    (default = 1)\n");
   fprintf(stderr," -o outputFile    : output translated chromosome(s) filename\n");
   fprintf(stderr,"                    (default = <stdout>)\n");
   fprintf(stderr," -v               : verbose mode (add some internal information)\n");
@@ -72,22 +136,130 @@ static void sHelp()
   exit(0);
 }
 
+/* ----------------------------------------------- */
+/* run jobs                                        */
+/* ----------------------------------------------- */
+
+static void sRunEncode(TransJob *job)
+{
+  (void) LXBioSeqEncode(job->codes + job->from, job->to - job->from);
+}
+
+static void sRunTranslate(TransJob *job)
+{
+  (void) LXBioFrameTranslate(job->codes, job->length, job->frame,
+                             job->table, job->reverse,
+                             job->from, job->to, job->prot + job->from);
+}
+
+/* ----------------------------------------------- */
+/* add jobs covering [0, length[ by chunks         */
+/* ----------------------------------------------- */
+
+static void sAddJobs(JobPool *pool, TransJob *model, long length)
+{
+  long from;
+
+  for (from = 0 ; from < length ; from += CHUNK) {
+
+    if (pool->nbJobs >= pool->capacity) {
+      pool->capacity *= 2;
+      if (! (pool->jobs = REALLOC(pool->jobs, TransJob, pool->capacity)))
+        MEMORY_ERROR();
+    }
+
+    pool->jobs[pool->nbJobs]      = *model;
+    pool->jobs[pool->nbJobs].from = from;
+    pool->jobs[pool->nbJobs].to   = MIN(from + CHUNK, length);
+    pool->nbJobs++;
+  }
+}
+
+/* ----------------------------------------------- */
+/* worker thread entry point                       */
+/* ----------------------------------------------- */
+
+static void *sWorker(void *arg)
+{
+  long    ijob;
+  JobPool *pool = (JobPool *) arg;
+
+  while (TRUE) {
+
+    pthread_mutex_lock(&pool->lock);
+    ijob = pool->next++;
+    pthread_mutex_unlock(&pool->lock);
+
+    if (ijob >= pool->nbJobs)
+      break;
+
+    pool->run(pool->jobs + ijob);
+  }
+
+  return NULL;
+}
+
+/* ----------------------------------------------- */
+/* run all jobs of pool with nbThreads threads     */
+/* (or the calling thread only if nbThreads <= 1)  */
+/* ----------------------------------------------- */
+
+static void sRunJobs(JobPool *pool, void (*run) (TransJob *job),
+                     pthread_t *threads, int nbThreads)
+{
+  int i, nbStarted;
+
+  pool->run  = run;
+  pool->next = 0;
+
+  nbThreads = MIN(nbThreads, pool->nbJobs);
+
+  for (i = nbStarted = 0 ; (nbThreads > 1) && (i < nbThreads) ; i++) {
+    if (pthread_create(threads + nbStarted, NULL, sWorker, pool) == 0)
+      nbStarted++;
+  }
+
+  // single thread or no thread could be started : 
+  // do the job ourselves
+
+  if (nbStarted == 0)
+    (void) sWorker(pool);
+
+  for (i = 0 ; i < nbStarted ; i++)
+    (void) pthread_join(threads[i], NULL);
+
+  pool->nbJobs = 0;
+}
+
+/* ----------------------------------------------- */
+/* length of frame #iframe (0-5) of sequence       */
+/* ----------------------------------------------- */
+
+static long sFrameLength(TransSeq *tseq, int iframe)
+{
+  return MAX(0, (tseq->nucSeq->length - (iframe % 3)) / 3);
+}
+
 /* ----------------------------------------------- */
 
 main(int argc, char *argv[])
 {
-  long nbseq;
-  int  istrand, iframe;
+  long nbseq, nbBatch, nbFrames, ifirst, ilast, iframe, total;
+  int  i, nbThreads;
   int  opt, code;
   
   int strands[] = {PM_SEQID_DIRECT, PM_SEQID_REVERSE};
   
   Bool verbose;
-  
-  LXFastaSequence *nucSeq, *prtSeq;
-  
-  PMSeqId seqId;
-  
+
+  char tables[2][LX_BIO_CODON_TABLE_SIZE];
+
+  TransSeq        *batch, *tseq;
+  LXFastaSequence **prtSeqs, *prtSeq;
+  JobPool         pool;
+  TransJob        job;
+  pthread_t       *threads;
+
   char inputFileName[BUFSIZ];
   char outputFileName[BUFSIZ];
   char buffer[BUFSIZ];
@@ -98,6 +270,7 @@ main(int argc, char *argv[])
   /* setup default parameters   */
   
   code            = 0;
+  nbThreads       = 1;
   verbose         = FALSE;
   *inputFileName  ='\000';
   *outputFileName ='\000';
@@ -105,7 +278,7 @@ main(int argc, char *argv[])
   /* -------------------------- */
   /* get user's parameters      */
 
-  while ((opt = getopt(argc, argv, "c:hHi:o:v")) != -1) {
+  while ((opt = getopt(argc, argv, "c:hHi:j:o:v")) != -1) {
   
     switch (opt) {
     
@@ -130,6 +303,14 @@ main(int argc, char *argv[])
         }
         break;
 
+      case 'j':                                   // number of threads
+        if (   (sscanf(optarg, "%d", &nbThreads) != 1)
+            || (nbThreads <= 0)) {
+          fprintf(stderr,"invalid number of threads: -j\n");
+          sUsage(LX_ARG_ERROR);
+        }
+        break;
+
       case 'o' :                                  // output (tag) filename
         (void) strcpy(outputFileName, optarg);
         if (! LXAssignToStdout(outputFileName)) {
@@ -155,60 +336,145 @@ main(int argc, char *argv[])
 
   (void) LXStrCpuTime(TRUE);
 
-  if (! (nucSeq = LXFastaNewSequence(0)))
+  if (! (   LXBioCodonTable(tables[0], code, FALSE)
+         && LXBioCodonTable(tables[1], code, TRUE))) {
+    fprintf(stderr,"invalid code value: -c (0-%d)\n", LX_GENETIC_MAX_CODES - 1);
+    sUsage(LX_ARG_ERROR);
+  }
+
+  pool.nbJobs   = 0;
+  pool.capacity = 64;
+
+  batch     = NEWN(TransSeq, BATCH_SEQS);
+  prtSeqs   = NEWN(LXFastaSequence *, 6 * BATCH_SEQS);
+  threads   = NEWN(pthread_t, nbThreads);
+  pool.jobs = NEWN(TransJob, pool.capacity);
+
+  if (! (batch && prtSeqs && threads && pool.jobs))
     MEMORY_ERROR();
 
+  for (i = 0 ; i < BATCH_SEQS ; i++)
+    batch[i].nucSeq = NULL;
+
+  for (i = 0 ; i < 6 * BATCH_SEQS ; i++)
+    prtSeqs[i] = NULL;
+
+  (void) pthread_mutex_init(&pool.lock, NULL);
+
   /* ---------------------- */
   /* main fasta loop        */
   
   nbseq = 0;
-  
-  while (LXFastaReadSequence(stdin, nucSeq)) {
 
-    nbseq++;
+  do {
+
+    /* ---------------------- */
+    /* read batch             */
+
+    for (nbBatch = total = 0 ; (nbBatch < BATCH_SEQS) && (total < BATCH_NT) ; ) {
+
+      tseq = batch + nbBatch;
+
+      if ((! tseq->nucSeq) && (! (tseq->nucSeq = LXFastaNewSequence(0))))
+        MEMORY_ERROR();
+
+      if (! LXFastaReadSequence(stdin, tseq->nucSeq))
+        break;
+
+      nbseq++;
     
-    if (! nucSeq->ok) {
-      sprintf(buffer,"# error with sequence No %ld (skipped)\n", nbseq);
-      LX_WARNING(buffer);
-      continue;
+      if (! tseq->nucSeq->ok) {
+        sprintf(buffer,"# error with sequence No %ld (skipped)\n", nbseq);
+        LX_WARNING(buffer);
+        continue;
+      }
+
+      if (verbose)
+        fprintf(stderr, "# read sequence %s (%ld nt)\n",
+              tseq->nucSeq->name, tseq->nucSeq->length);
+
+      (void) strcpy(tseq->seqId.name, tseq->nucSeq->name);
+      (void) strcpy(tseq->seqId.comment, tseq->nucSeq->comment);
+
+      tseq->seqId.length = tseq->nucSeq->length;
+
+      total += tseq->nucSeq->length;
+
+      nbBatch++;
+    }
+
+    /* ---------------------- */
+    /* encode batch           */
+
+    for (i = 0 ; i < nbBatch ; i++) {
+      job.codes = batch[i].nucSeq->seq;
+      sAddJobs(&pool, &job, batch[i].nucSeq->length);
     }
 
-    if (verbose)
-      fprintf(stderr, "# read sequence %s (%ld nt)\n",
-            nucSeq->name, nucSeq->length);
+    sRunJobs(&pool, sRunEncode, threads, nbThreads);
 
-    if (! (prtSeq = LXFastaNewSequence(nucSeq->length + 1)))
-      MEMORY_ERROR();
+    /* ---------------------- */
+    /* translate frames by    */
+    /* rounds                 */
 
-    (void) strcpy(seqId.name, nucSeq->name);
-    (void) strcpy(seqId.comment, nucSeq->comment);
+    nbFrames = 6 * nbBatch;
 
-    seqId.length = nucSeq->length;
-    
-    for (istrand = 0 ; istrand <= 1 ; istrand++) {
+    for (ifirst = 0 ; ifirst < nbFrames ; ifirst = ilast) {
 
-      seqId.strand = strands[istrand];
-      
-      for (iframe = 0 ; iframe < 3 ; iframe++) {
-  
-        (void) strcpy(prtSeq->seq, nucSeq->seq + iframe);
-        
-        LXBioSeqTranslate(prtSeq->seq, code);
-  
-        prtSeq->length = (nucSeq->length - iframe) / 3;
-	
-        seqId.frame = iframe + 1;
+      for (ilast = ifirst, total = 0 ; ilast < nbFrames ; ilast++) {
+        total += sFrameLength(batch + ilast / 6, ilast % 6);
+        if ((ilast > ifirst) && (total > ROUND_AA))
+          break;
+      }
+
+      for (iframe = ifirst ; iframe < ilast ; iframe++) {
+
+        tseq = batch + iframe / 6;
+
+        if (   (! (prtSeq = prtSeqs[iframe - ifirst]))
+            && (! (prtSeq = prtSeqs[iframe - ifirst] = LXFastaNewSequence(0))))
+          MEMORY_ERROR();
+
+        prtSeq->length = sFrameLength(tseq, iframe % 6);
+
+        if (! (prtSeq->seq = LXAssertAlloc(prtSeq->seq, prtSeq->length + 1)))
+          MEMORY_ERROR();
+
+        prtSeq->seq[prtSeq->length] = '\000';
+
+        job.codes   = tseq->nucSeq->seq;
+        job.length  = tseq->nucSeq->length;
+        job.frame   = iframe % 3;
+        job.reverse = (iframe % 6 >= 3);
+        job.table   = tables[job.reverse ? 1 : 0];
+        job.prot    = prtSeq->seq;
+
+        sAddJobs(&pool, &job, prtSeq->length);
+      }
+
+      sRunJobs(&pool, sRunTranslate, threads, nbThreads);
+
+      /* ---------------------- */
+      /* write frames in order  */
+
+      for (iframe = ifirst ; iframe < ilast ; iframe++) {
+
+        tseq   = batch + iframe / 6;
+        prtSeq = prtSeqs[iframe - ifirst];
+
+        tseq->seqId.strand = strands[(iframe % 6) / 3];
+        tseq->seqId.frame  = (iframe % 3) + 1;
 
 #if 1
 // [AV] version originale
-       if (PMSeqId2Fasta(&seqId, prtSeq) != LX_NO_ERROR)
+       if (PMSeqId2Fasta(&tseq->seqId, prtSeq) != LX_NO_ERROR)
          LX_ERROR("write format error", 10);
 #else
 // [AV] version JET
 // [AV] FIXME : le commentaire est perdu
         sprintf(prtSeq->name, "%s@%c%1d@%d", 
-                      seqId.name, seqId.strand,
-                      seqId.frame, seqId.length);
+                      tseq->seqId.name, tseq->seqId.strand,
+                      tseq->seqId.frame, tseq->seqId.length);
 #endif
 
         if (verbose)
@@ -216,27 +482,26 @@ main(int argc, char *argv[])
                          prtSeq->name, prtSeq->length);
           
         LXFastaWriteSequence(stdout, prtSeq, LX_FASTA_CHARS_PER_LINE);
-
       }
-
-      if (istrand == 0)
-        (void) LXBioSeqReverseComplement(nucSeq->seq);
     }
 
-    (void) LXFastaFreeSequence(prtSeq);
-    
-  }
+  } while (nbBatch > 0);
 
   /* ------------------- */
   /* end of program      */
 
-  (void) LXFastaFreeSequence(nucSeq);
- 
-  exit(0);
-}
-
-
+  (void) pthread_mutex_destroy(&pool.lock);
 
-    
+  for (i = 0 ; i < BATCH_SEQS ; i++)
+    (void) LXFastaFreeSequence(batch[i].nucSeq);
 
+  for (i = 0 ; i < 6 * BATCH_SEQS ; i++)
+    (void) LXFastaFreeSequence(prtSeqs[i]);
 
+  FREE(pool.jobs);
+  FREE(threads);
+  FREE(prtSeqs);
+  FREE(batch);
+ 
+  exit(0);
+}